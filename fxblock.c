@@ -0,0 +1,179 @@
+/**
+ * @file fxblock.c
+ *
+ * @brief  Run-time library that normalizes block-floating-point arrays
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-18T11:02:51-0500
+ * @date Last modified: 2014-01-18T11:02:51-0500
+ *
+ * @details  An array with the fxblock attribute keeps one exponent for all of
+ *           its elements. A program marks the points where the block should
+ *           be renormalized, typically after each stage of an FFT, with a
+ *           call to fxblock_normalize(). When the program is compiled with
+ *           the plugin, that call is replaced by a call to
+ *           __fxopt_block_normalize(), which shifts every element so that
+ *           the largest magnitude just fills the format of the array, and
+ *           the plugin adds the shift to the block's exponent.
+ *
+ *           When the program is compiled without the plugin the arrays are
+ *           still real and fxblock_normalize() does nothing, so the same
+ *           source can be built both ways. This file must be linked with the
+ *           program in either case.
+ *
+ *           This is not part of the plugin and does not use any gcc
+ *           headers.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include <stdint.h>
+
+/**
+ * @brief Mark a point where a block should be renormalized.
+ *
+ * @details Only called when the program was compiled without the plugin.
+ *
+ * @param[in] block the array with the fxblock attribute
+ */
+void fxblock_normalize(void *block)
+{
+  (void) block;
+}
+
+/**
+ * @brief Find the bits that are the same as the sign bit in every element.
+ *
+ * @details Each element is XORed with its own sign, so that the leading zeros
+ * of the result are the redundant sign bits, and the results are ORed
+ * together.
+ *
+ * @param[in] block    the array
+ * @param[in] elements number of elements in the array
+ * @param[in] bytes    number of bytes in one element
+ * @return    the ORed magnitudes, as an unsigned 64-bit word
+ */
+static uint64_t block_magnitude(void *block, int elements, int bytes)
+{
+  uint64_t m = 0;
+  int i;
+
+  for (i = 0; i < elements; i++) {
+    switch (bytes) {
+    case 1:
+      m |= (uint8_t) (((int8_t *) block)[i] ^ (((int8_t *) block)[i] >> 7));
+      break;
+    case 2:
+      m |= (uint16_t) (((int16_t *) block)[i] ^
+                       (((int16_t *) block)[i] >> 15));
+      break;
+    case 4:
+      m |= (uint32_t) (((int32_t *) block)[i] ^
+                       (((int32_t *) block)[i] >> 31));
+      break;
+    default:
+      m |= (uint64_t) (((int64_t *) block)[i] ^
+                       (((int64_t *) block)[i] >> 63));
+      break;
+    }
+  }
+  return m;
+}
+
+/**
+ * @brief Shift every element of a block.
+ *
+ * @param[in] block    the array
+ * @param[in] elements number of elements in the array
+ * @param[in] bytes    number of bytes in one element
+ * @param[in] count    bits to shift left, or right if negative
+ */
+static void shift_block(void *block, int elements, int bytes, int count)
+{
+  int i;
+
+  for (i = 0; i < elements; i++) {
+    int64_t x;
+    switch (bytes) {
+    case 1:
+      x = ((int8_t *) block)[i];
+      break;
+    case 2:
+      x = ((int16_t *) block)[i];
+      break;
+    case 4:
+      x = ((int32_t *) block)[i];
+      break;
+    default:
+      x = ((int64_t *) block)[i];
+      break;
+    }
+    if (count > 0)
+      x = (int64_t) ((uint64_t) x << count);
+    else
+      x = x >> -count;
+    switch (bytes) {
+    case 1:
+      ((int8_t *) block)[i] = (int8_t) x;
+      break;
+    case 2:
+      ((int16_t *) block)[i] = (int16_t) x;
+      break;
+    case 4:
+      ((int32_t *) block)[i] = (int32_t) x;
+      break;
+    default:
+      ((int64_t *) block)[i] = x;
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Normalize a block.
+ *
+ * @details The elements are shifted left until the largest magnitude has
+ * exactly @p headroom redundant sign bits, or shifted right if it has fewer.
+ * The exponent of the block must not become negative, so a right shift is
+ * limited to the current exponent. A block of zeros is not changed.
+ *
+ * @param[in] block    the array
+ * @param[in] elements number of elements in the array
+ * @param[in] bytes    number of bytes in one element, 1, 2, 4 or 8
+ * @param[in] headroom redundant sign bits wanted in the largest element
+ * @param[in] exponent the current exponent of the block
+ * @return    the number of bits shifted left, to be added to the exponent
+ */
+int __fxopt_block_normalize(void *block, int elements, int bytes,
+                            int headroom, int exponent)
+{
+  int bits = 8 * bytes;
+  uint64_t m = block_magnitude(block, elements, bytes);
+  int lrsb, count;
+
+  if (0 == m)
+    return 0;
+  // leading redundant sign bits, not counting the sign bit itself
+  for (lrsb = 0; lrsb < bits - 1; lrsb++) {
+    if (m & ((uint64_t) 1 << (bits - 2 - lrsb)))
+      break;
+  }
+  count = lrsb - headroom;
+  if (count < -exponent)
+    count = -exponent;
+  if (count != 0)
+    shift_block(block, elements, bytes, count);
+  return count;
+}
+
+// vim:syntax=c.doxygen
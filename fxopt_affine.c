@@ -29,26 +29,152 @@
 #include "fxopt_plugin.h"
 #include "utlist.h"
 
-extern struct SIF *var_formats;
+/**
+ * @brief Number of ::AA terms allocated at a time.
+ */
+#define AA_BLOCK_SIZE 1024
+
+/**
+ * @brief A block of ::AA terms.
+ */
+struct AA_BLOCK {
+  struct AA_BLOCK *next;          ///< Next block in the arena
+  int used;                       ///< Number of terms handed out
+  struct AA term[AA_BLOCK_SIZE];  ///< The ::AA terms
+};
+
+/**
+ * @brief An arena of ::AA terms.
+ * @details Terms are handed out from a chain of blocks and are never freed
+ * individually. When the arena is reset its blocks are reused from the
+ * start of the chain.
+ */
+struct AA_ARENA {
+  struct AA_BLOCK *blocks;    ///< First block in the chain
+  struct AA_BLOCK *current;   ///< Block that terms are taken from
+};
+
+/**
+ * @brief The ::AA terms of one function, kept in its ::FXOPT_CONTEXT.
+ */
+struct AA_ARENAS {
+  struct AA_ARENA function;   ///< Terms that live as long as the formats
+  struct AA_ARENA statement;  ///< Terms that only live for a statement
+  struct AA_ARENA *current;   ///< The arena that new terms come from
+};
+
+/**
+ * @brief Make the empty arenas for a new ::FXOPT_CONTEXT.
+ * @details The arenas are freed with free() once delete_all_aa() has
+ * released their terms.
+ *
+ * @return pointer to the new ::AA_ARENAS structure
+ */
+struct AA_ARENAS *new_aa_arenas()
+{
+  struct AA_ARENAS *arenas;
+
+  arenas = (struct AA_ARENAS *) xcalloc(1, sizeof(struct AA_ARENAS));
+  arenas->current = &(arenas->function);
+  return arenas;
+}
+
+/**
+ * @brief Allocate an ::AA term from the current arena.
+ * @return pointer to an uninitialized ::AA structure
+ */
+static struct AA *alloc_aa_element()
+{
+  struct AA_ARENA *arena = fxctx->arenas->current;
+
+  COUNT_STAT(aa_terms);
+  if ((NULL == arena->current) || (arena->current->used == AA_BLOCK_SIZE)) {
+    if ((NULL != arena->current) && (NULL != arena->current->next)) {
+      arena->current = arena->current->next;    // reuse an existing block
+    } else {
+      struct AA_BLOCK *block;
+      block = (struct AA_BLOCK *) xmalloc(sizeof(struct AA_BLOCK));
+      block->next = NULL;
+      if (NULL == arena->current)
+        arena->blocks = block;
+      else
+        arena->current->next = block;
+      arena->current = block;
+    }
+    arena->current->used = 0;
+  }
+  return &(arena->current->term[arena->current->used++]);
+}
 
 /**
- *  @brief  ID number for the next unique error term.
- *  @details Some operations are not strictly affine and introduce error terms
- *  that are not linearly correlated with input variables. When these error
- *  terms are created we need a unique ID value for each one, and this variable
- *  holds the next available unique ID number. It must be incremented after it
- *  is used.
+ * @brief Free all of the blocks in an arena.
+ *
+ * @param[in,out] arena pointer to the arena
  */
-int next_error_id = 1;
+static void free_aa_arena(struct AA_ARENA *arena)
+{
+  while (NULL != arena->blocks) {
+    struct AA_BLOCK *block = arena->blocks->next;
+    free(arena->blocks);
+    arena->blocks = block;
+  }
+  arena->current = NULL;
+}
+
+/**
+ * @brief Start allocating ::AA terms that are local to a statement.
+ *
+ * @details Until end_aa_scratch() is called, new terms come from the
+ * statement arena. Lists that must outlive the statement, such as those
+ * stored in a variable's ::SIF format, are made with copy_aa_list(), which
+ * always allocates from the function arena.
+ */
+void begin_aa_scratch()
+{
+  fxctx->arenas->current = &(fxctx->arenas->statement);
+}
+
+/**
+ * @brief Release all of the ::AA terms that were local to a statement.
+ *
+ * @details The statement arena is reset in one step and later terms are
+ * allocated from the function arena again.
+ */
+void end_aa_scratch()
+{
+  struct AA_ARENAS *arenas = fxctx->arenas;
+
+  arenas->statement.current = arenas->statement.blocks;
+  if (NULL != arenas->statement.current)
+    arenas->statement.current->used = 0;
+  arenas->current = &(arenas->function);
+}
+
+/**
+ * @brief Free every ::AA term.
+ * @details Called when all of the formats for a function are deleted.
+ */
+void delete_all_aa()
+{
+  struct AA_ARENAS *arenas = fxctx->arenas;
+
+  free_aa_arena(&(arenas->statement));
+  free_aa_arena(&(arenas->function));
+  arenas->current = &(arenas->function);
+}
 
 /**
  *  @brief  Sorting function for affine elements.
  *
  *  @details The ID values of two affine elements are compared to determine how
- *  the elements are sorted. Elements with smaller GIMPLE UID values precede
- *  elements with higher UID values. Elements with the same UID value are sorted
- *  by the array index. Elements with the same UID and the same index are sorted
- *  by pass number.
+ *  the elements are sorted. Because the GIMPLE UID occupies the upper bits of
+ *  an ID, followed by the pass number and then the array index, comparing IDs
+ *  numerically orders elements by UID, then by pass, then by index. This is
+ *  the same order in which formats are kept in the format store. The constant
+ *  term (ID zero) and the error terms (UID zero) always precede variables.
+ *
+ *  Every AA list is kept in this order, which allows two lists to be combined
+ *  with a single merge pass.
  *
  *  A negative return value indicates that element <tt>a</tt> should precede
  *  element <tt>b</tt>, while a return value greater than zero indicates that
@@ -61,12 +187,45 @@ int next_error_id = 1;
  *  @return    comparison result     
  */
 int aa_id_sort(struct AA *a, struct AA *b) {
-  if (KEY_TO_UID(a->id) != KEY_TO_UID(b->id))
-    return (KEY_TO_UID(a->id) - KEY_TO_UID(b->id));
-  else if (KEY_TO_IDX(a->id) != KEY_TO_IDX(b->id))
-    return (KEY_TO_IDX(a->id) - KEY_TO_IDX(b->id));
-  else 
-    return (KEY_TO_PASS(a->id) - KEY_TO_PASS(b->id));
+  return (a->id < b->id) ? -1 : (a->id > b->id);
+}
+
+/**
+ *  @brief  Link an element into an AA list in ID order.
+ *
+ *  @details The element is appended directly if its ID is greater than that
+ *  of the last element in the list, which is the common case when a list is
+ *  built in order. Otherwise the list is walked to find the first element
+ *  with a greater ID and the new element is linked in ahead of it.
+ *
+ *  @param[in,out] aa_list_p pointer to the AA list head pointer
+ *  @param[in]     aa_p      the element to be linked into the list
+ *  @return        false if the list already has an element with the same ID
+ */
+static bool insert_aa_element(struct AA **aa_list_p, struct AA *aa_p)
+{
+  struct AA *aa_elt_p;
+
+  if ((NULL == *aa_list_p) || ((*aa_list_p)->prev->id < aa_p->id)) {
+    DL_APPEND(*aa_list_p, aa_p);
+    return true;
+  }
+
+  for (aa_elt_p = *aa_list_p; aa_elt_p->id < aa_p->id;
+       aa_elt_p = aa_elt_p->next)
+    ;
+  if (aa_elt_p->id == aa_p->id)
+    return false;
+
+  if (aa_elt_p == *aa_list_p) {
+    DL_PREPEND(*aa_list_p, aa_p);
+  } else {
+    aa_p->prev = aa_elt_p->prev;
+    aa_p->next = aa_elt_p;
+    aa_elt_p->prev->next = aa_p;
+    aa_elt_p->prev = aa_p;
+  }
+  return true;
 }
 
 /**
@@ -75,46 +234,65 @@ int aa_id_sort(struct AA *a, struct AA *b) {
  *  @details Create a new list element and populate it with the hash table key
  *  for the variable being added, its coefficient, and the binary point
  *  location for the coefficient. If the coefficient is zero then this term
- *  is simply discarded. Append the new element to the existing affine
- *  definition. An error occurs if the list pointer is NULL or an element
- *  with the same ID is already in the list. Warnings are printed if the
- *  coefficient is zero and the element is discarded or if it appears that
- *  the list has been deleted.
+ *  is simply discarded. Link the new element into the existing affine
+ *  definition so that the list stays sorted by ID. An error occurs if the
+ *  list pointer is NULL or an element with the same ID is already in the
+ *  list. Warnings are printed if the coefficient is zero and the element is
+ *  discarded or if it appears that the list has been deleted.
  *   
  *  @param[in]  aa_list_p pointer to the AA list head pointer
  *  @param[in]  var_key   hash table ID for variable being added to list
  *  @param[in]  coeff     double_int, the coefficient for variable being added
  *  @param[in]  bp        int, binary point location for coefficient
  */
-void append_aa_var(struct AA **aa_list_p, int var_key, double_int coeff, int bp)
+void append_aa_var(struct AA **aa_list_p, fxkey_t var_key, double_int coeff,
+                   int bp)
 {
   if (NULL == aa_list_p) {
     error("fxopt: cannot append to list at NULL address");
     return;
   }
-  if (NULL != search_aa_var(*aa_list_p, var_key)) {
-    error("fxopt: cannot append to list, already has this element");
-    return;
-  }
 
   if ((NULL != *aa_list_p) && (*aa_list_p)->id == 0xbad)
-    fprintf(stderr, "%p already destroyed, can't append!\n",
-            (void *) *aa_list_p);
-
-  struct AA *aa_p = (struct AA *) xmalloc(sizeof(struct AA));
+    FXLOG(1, "%p already destroyed, can't append!\n",
+          (void *) *aa_list_p);
 
-  if (NULL == aa_p) {
-    error("fxopt: could not create AA list node");
-  }
+  struct AA *aa_p = alloc_aa_element();
   if (bp > 63)
-    fprintf(stderr, "  append_aa_var -- bp is %d\n", bp);
+    FXLOG(1, "  append_aa_var -- bp is %d\n", bp);
   // fill its elements
   aa_p->id = var_key;
   aa_p->coeff = coeff;
   aa_p->bp = bp;
   aa_p->next = NULL;
-  // append it to the variable's list
-  DL_APPEND(*aa_list_p, aa_p);
+  // link it into the variable's list
+  if (!insert_aa_element(aa_list_p, aa_p))
+    error("fxopt: cannot append to list, already has this element");
+}
+
+/**
+ *  @brief Change the ID of a term in an affine definition.
+ *
+ *  @details The element is unlinked and then linked back in at the position
+ *  given by its new ID, so that the list stays sorted.
+ *
+ *  @param[in,out] aa_list_p pointer to the AA list head pointer
+ *  @param[in]     old_key   hash table ID of the term to be renamed
+ *  @param[in]     new_key   new hash table ID for the term
+ *  @return        true if a term with ID <tt>old_key</tt> was found
+ */
+bool rename_aa_var(struct AA **aa_list_p, fxkey_t old_key, fxkey_t new_key)
+{
+  struct AA *aa_elt_p = search_aa_var(*aa_list_p, old_key);
+
+  if (NULL == aa_elt_p)
+    return false;
+
+  DL_DELETE(*aa_list_p, aa_elt_p);
+  aa_elt_p->id = new_key;
+  if (!insert_aa_element(aa_list_p, aa_elt_p))
+    error("fxopt: cannot rename list element, already has this element");
+  return true;
 }
 
 /**
@@ -122,23 +300,27 @@ void append_aa_var(struct AA **aa_list_p, int var_key, double_int coeff, int bp)
  *
  * @details Given the hash key for a variable, search an AA list for that
  * variable. If found, return a pointer to the list element. If not found
- * return NULL.
+ * return NULL. Since the list is sorted by ID the search stops at the first
+ * element with a greater ID.
  *
  * @param[in] aa_list_p head of AA list to be searched
  * @param[in] var_key   hash id for variable that is searched for
  * @return          pointer to AA element if found, else NULL
  */
-struct AA *search_aa_var(struct AA *aa_list_p, int var_key)
+struct AA *search_aa_var(struct AA *aa_list_p, fxkey_t var_key)
 {
   struct AA *aa_elt_p;
 
-  DL_SEARCH_SCALAR(aa_list_p, aa_elt_p, id, var_key);
+  for (aa_elt_p = aa_list_p; aa_elt_p != NULL; aa_elt_p = aa_elt_p->next) {
+    if (aa_elt_p->id >= var_key)
+      return (aa_elt_p->id == var_key) ? aa_elt_p : NULL;
+  }
 
-  return aa_elt_p;
+  return NULL;
 }
 
 /**
- * @brief Print a single affine list element to stderr.
+ * @brief Print a single affine list element to the log.
  *
  * @details Converts the coefficient to a floating-point value and prints it.
  * Determines whether the variable is a declared variable or gcc created
@@ -152,21 +334,21 @@ struct AA *search_aa_var(struct AA *aa_list_p, int var_key)
 void print_aa_element(struct AA *aa_elt_p)
 {
   tree var_tree;
-  struct SIF *s;
+  const struct SIF *s;
   double fcoeff;
 
   if (! double_int_fits_in_shwi_p(aa_elt_p->coeff))
     warning(0, G_("fxopt: double_int bigger than SHWI!"));
   fcoeff = ((double) double_int_to_shwi(aa_elt_p->coeff))/(1ULL << aa_elt_p->bp);
-  fprintf(stderr, "%6.3f", fcoeff);
+  fprintf(fxlog, "%6.3f", fcoeff);
 
   if (aa_elt_p->id != 0) {
-    int elt_id = aa_elt_p->id;
+    fxkey_t elt_id = aa_elt_p->id;
     int uid = KEY_TO_UID(elt_id);
 
     if (uid != 0) {
       // get the SIF struct for the variable in the list element
-      HASH_FIND_INT(var_formats, &elt_id, s);
+      s = get_format_ptr(elt_id);
 
       if (s->alias != 0) {
         var_tree = referenced_var_lookup(cfun, KEY_TO_UID(s->alias));
@@ -179,16 +361,16 @@ void print_aa_element(struct AA *aa_elt_p)
       int idx = KEY_TO_IDX(elt_id);
       int pass = KEY_TO_PASS(elt_id);
       if (DECL_NAME(var_tree)) {
-        fprintf(stderr, "*%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
+        fprintf(fxlog, "*%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
       } else {
-        fprintf(stderr, "*%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
+        fprintf(fxlog, "*%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
                 DECL_UID(var_tree));
       }
       if (idx != NOT_AN_ARRAY)
-        fprintf(stderr, "[%1d]", idx);
-      fprintf(stderr, "#%d", pass);
+        fprintf(fxlog, "[%1d]", idx);
+      fprintf(fxlog, "#%d", pass);
     } else {
-      fprintf(stderr, "*ERR%d", elt_id);
+      fprintf(fxlog, "*ERR%d", (int) elt_id);
     }
   }
 }
@@ -208,11 +390,10 @@ void print_aa_list(struct AA *aa_list_p)
   if (aa_list_p == NULL) 
     return;
 
-  //DL_SORT(aa_list_p, aa_id_sort);  // sort is broken?
   DL_FOREACH(aa_list_p, aa_elt_p) {
     print_aa_element(aa_elt_p);
     if (aa_elt_p->next != NULL)
-      fprintf(stderr, "+");
+      fprintf(fxlog, "+");
   }
 }
 
@@ -234,7 +415,7 @@ int get_aa_bp(struct AA *aa_list_p)
       if (list_bp == 0xbad)
         list_bp = aa_elt_p->bp;
       else
-        fprintf(stderr, " Inconsistent binary point in AA list\n");
+        FXLOG(1, " Inconsistent binary point in AA list\n");
     }
   }
   return list_bp;
@@ -243,8 +424,9 @@ int get_aa_bp(struct AA *aa_list_p)
 /**
  * @brief Delete an entire AA definition
  *
- * @details Each element in the AA list is deleted individually, and its memory
- * is freed. After this function ends, `aa_list_p` will be NULL.
+ * @details Each element in the AA list is unlinked individually. Its memory
+ * is reclaimed when the arena it came from is reset or freed. After this
+ * function ends, `aa_list_p` will be NULL.
  *
  * @param[in,out] aa_list_pp pointer to a pointer to a head of AA list
  */
@@ -282,7 +464,7 @@ struct AA *copy_aa_element(struct AA *aa_src_elt_p)
   if (aa_src_elt_p == NULL)
     return NULL;
 
-  aa_dest_elt_p = (struct AA *) xmalloc(sizeof(struct AA));
+  aa_dest_elt_p = alloc_aa_element();
   aa_dest_elt_p->id = aa_src_elt_p->id;
   aa_dest_elt_p->coeff = aa_src_elt_p->coeff;
   aa_dest_elt_p->bp = aa_src_elt_p->bp;
@@ -296,6 +478,8 @@ struct AA *copy_aa_element(struct AA *aa_src_elt_p)
  *
  * @details Create a deep copy of an AA linked list. A copy of each element
  * of the source list is created and then appended to the destination list.
+ * The copy is always allocated from the function arena, so it may be stored
+ * in a variable's ::SIF format.
  *
  * @param[in] aa_src_list_p pointer to source AA struct
  * @return                  pointer to destination AA struct
@@ -305,17 +489,21 @@ struct AA *copy_aa_list(struct AA *aa_src_list_p)
   struct AA *aa_dest_list_p = NULL;
   struct AA *src_elt_p;
   struct AA *dest_elt_p;
+  struct AA_ARENA *saved_arena = fxctx->arenas->current;
 
   if (aa_src_list_p == NULL)
     return NULL;
 
+  fxctx->arenas->current = &(fxctx->arenas->function);
   DL_FOREACH(aa_src_list_p, src_elt_p) {
-    dest_elt_p = copy_aa_element(src_elt_p);
     if (src_elt_p->id == 0xbad) {
-      return NULL;
+      aa_dest_list_p = NULL;
+      break;
     }
+    dest_elt_p = copy_aa_element(src_elt_p);
     DL_APPEND(aa_dest_list_p, dest_elt_p);
   }
+  fxctx->arenas->current = saved_arena;
 
   return aa_dest_list_p;
 }
@@ -343,8 +531,8 @@ struct AA *affine_assign(struct AA *aa_src_list_p, bool add)
 
   DL_FOREACH(aa_src_list_p, src_elt_p) {
     if (src_elt_p->id == 0xbad) {
-      fprintf(stderr, "%p already destroyed, can't copy!\n",
-              (void *) src_elt_p);
+      FXLOG(1, "%p already destroyed, can't copy!\n",
+            (void *) src_elt_p);
       return NULL;
     }
     dest_elt_p = copy_aa_element(src_elt_p);
@@ -389,6 +577,40 @@ struct AA *shift_aa_list(struct SIF op_fmt, int k)
   return new_list_p;
 }
 
+/**
+ * @brief Get the coefficient of an AA element at a binary point location.
+ *
+ * @details The coefficient is shifted, and possibly rounded according to the
+ * global option flags, so that it has <tt>org_bp</tt> bits to the right of
+ * the binary point. The element itself is not changed.
+ *
+ * @param[in] aa_elt_p pointer to an AA list element
+ * @param[in] org_bp   the desired binary point location
+ * @return    the shifted coefficient
+ */
+double_int aligned_aa_coeff(struct AA *aa_elt_p, int org_bp)
+{
+  double_int constant;
+  double_int coeff = aa_elt_p->coeff;
+  int shift = aa_elt_p->bp - org_bp;
+
+  if (shift != 0) {
+    if ((shift > 0) && ROUNDING) {
+      constant = double_int_lshift(double_int_one,
+                                            (shift - 1),
+                                            HOST_BITS_PER_DOUBLE_INT,
+                                            LOGICAL);
+      if (double_int_negative_p(coeff) && !POSITIVE) {
+        constant = double_int_sub(constant, double_int_one);
+      }
+      coeff = double_int_add(coeff, constant);
+    }
+    coeff =
+      double_int_rshift(coeff, shift, HOST_BITS_PER_DOUBLE_INT, ARITH);
+  }
+  return coeff;
+}
+
 /**
  * @brief Apply shift and round operations to an AA list.
  *
@@ -408,8 +630,7 @@ struct AA *new_aa_list(struct SIF op_fmt)
 {
   struct AA *new_list_p = NULL;
   struct AA *aa_elt_p;
-  double_int constant, coeff;
-  int org_bp, shift;
+  int org_bp;
 
   if (op_fmt.aa == NULL)
     return NULL;
@@ -417,23 +638,8 @@ struct AA *new_aa_list(struct SIF op_fmt)
   org_bp = op_fmt.F + op_fmt.E;
 
   DL_FOREACH(op_fmt.aa, aa_elt_p) {
-    coeff = aa_elt_p->coeff;
-    shift = aa_elt_p->bp - org_bp;
-    if (shift != 0) {
-      if ((shift > 0) && ROUNDING) {
-        constant = double_int_lshift(double_int_one,
-                                              (shift - 1),
-                                              HOST_BITS_PER_DOUBLE_INT,
-                                              LOGICAL);
-        if (double_int_negative_p(coeff) && !POSITIVE) {
-          constant = double_int_sub(constant, double_int_one);
-        }
-        coeff = double_int_add(coeff, constant);
-      }
-      coeff =
-        double_int_rshift(coeff, shift, HOST_BITS_PER_DOUBLE_INT, ARITH);
-    }
-    append_aa_var(&new_list_p, aa_elt_p->id, coeff, org_bp);
+    append_aa_var(&new_list_p, aa_elt_p->id, aligned_aa_coeff(aa_elt_p, org_bp),
+                  org_bp);
   }
 
   return new_list_p;
@@ -676,6 +882,9 @@ double_int new_aa_min(struct SIF op_fmt)
  * the coefficient of operand 2 is negated first. If the affine definition
  * of either operand is missing return a NULL pointer.
  *
+ * Both lists are sorted by ID, so the result is built in order with a single
+ * merge pass over the two operands.
+ *
  * @note Assumes that operands are already aligned (have the same binary
  * point location). A warning is issued if this is not the case.
  *   
@@ -693,37 +902,44 @@ struct AA *affine_add(struct SIF oprnd_frmt[], bool add)
   if ((oprnd_frmt[1].aa == NULL) || (oprnd_frmt[2].aa == NULL))
     return NULL;
 
-  struct AA *aa1_list_p = new_aa_list(oprnd_frmt[1]);
-  struct AA *aa2_list_p = new_aa_list(oprnd_frmt[2]);
-
-  DL_FOREACH(aa1_list_p, aa1_elt_p) {
-    aa2_elt_p = search_aa_var(aa2_list_p, aa1_elt_p->id);
-    if (aa2_elt_p == NULL) {    // in aa1 but not in aa2
-      append_aa_var(&result_p, aa1_elt_p->id, aa1_elt_p->coeff, aa1_elt_p->bp);
-    } else {                    // in both aa1 and aa2
-      op1_coeff = aa1_elt_p->coeff;
-      op2_coeff = aa2_elt_p->coeff;
-      if (aa1_elt_p->bp != aa2_elt_p->bp)
-        fprintf(stderr, "  affine_add : binary points not equal\n");
+  //
+  // The operands' coefficients are aligned to their formats as they are
+  // read, rather than by making aligned copies of both lists
+  //
+  int bp1 = oprnd_frmt[1].F + oprnd_frmt[1].E;
+  int bp2 = oprnd_frmt[2].F + oprnd_frmt[2].E;
+
+  aa1_elt_p = oprnd_frmt[1].aa;
+  aa2_elt_p = oprnd_frmt[2].aa;
+  while ((aa1_elt_p != NULL) || (aa2_elt_p != NULL)) {
+    if ((aa2_elt_p == NULL) ||
+        ((aa1_elt_p != NULL) && (aa1_elt_p->id < aa2_elt_p->id))) {
+      // in aa1 but not in aa2
+      op1_coeff = aligned_aa_coeff(aa1_elt_p, bp1);
+      append_aa_var(&result_p, aa1_elt_p->id, op1_coeff, bp1);
+      aa1_elt_p = aa1_elt_p->next;
+    } else if ((aa1_elt_p == NULL) || (aa2_elt_p->id < aa1_elt_p->id)) {
+      // in aa2 but not in aa1
+      op2_coeff = aligned_aa_coeff(aa2_elt_p, bp2);
       if (!add)
         op2_coeff = double_int_neg(double_int_add(double_int_one,op2_coeff));
-      append_aa_var(&result_p, aa1_elt_p->id,
-                    double_int_add(op1_coeff, op2_coeff), aa1_elt_p->bp);
-    }
-  }
-
-  DL_FOREACH(aa2_list_p, aa2_elt_p) {
-    aa1_elt_p = search_aa_var(aa1_list_p, aa2_elt_p->id);
-    if (aa1_elt_p == NULL) {    // in aa2 but not in aa1
-      op2_coeff = aa2_elt_p->coeff;
+      append_aa_var(&result_p, aa2_elt_p->id, op2_coeff, bp2);
+      aa2_elt_p = aa2_elt_p->next;
+    } else {                    // in both aa1 and aa2
+      op1_coeff = aligned_aa_coeff(aa1_elt_p, bp1);
+      op2_coeff = aligned_aa_coeff(aa2_elt_p, bp2);
+      if (bp1 != bp2)
+        FXLOG(1, "  affine_add : binary points not equal\n");
       if (!add)
         op2_coeff = double_int_neg(double_int_add(double_int_one,op2_coeff));
-      append_aa_var(&result_p, aa2_elt_p->id, op2_coeff, aa2_elt_p->bp);
+      append_aa_var(&result_p, aa1_elt_p->id,
+                    double_int_add(op1_coeff, op2_coeff), bp1);
+      aa1_elt_p = aa1_elt_p->next;
+      aa2_elt_p = aa2_elt_p->next;
     }
   }
 
-  delete_aa_list(&aa1_list_p);
-  delete_aa_list(&aa2_list_p);
+  condense_aa_list(&result_p);
   return result_p;
 }
 
@@ -750,13 +966,15 @@ struct AA *affine_add(struct SIF oprnd_frmt[], bool add)
  *
  * In all other cases we have the product of two affine terms that depend on
  * different variables. Such a product cannot be represented in affine form so
- * it becomes a new uncorrelated error term. However, if the same two variables
- * exist in the affine definitions for both multiplicands we will effectively
- * have the same product term twice. In this special case we should cancel the
- * two coefficient products before lumping the result into the uncorrelated
- * error term. Note that since all of these error terms are uncorrelated we
- * must sum the absolute values of the products of their coefficients to get a
- * coefficient for the lumped error term.
+ * it becomes a new uncorrelated error term. Since all of these error terms are
+ * uncorrelated we must sum the absolute values of the products of their
+ * coefficients to get a coefficient for the lumped error term. That sum is
+ * the product of the radii of the two operands (the sums of the absolute
+ * values of their non-constant coefficients), less the squared terms that
+ * were already accounted for.
+ *
+ * Both lists are sorted by ID, so the affine terms and both radii are found
+ * with a single merge pass over the two operands.
  *
  * @param  aa1_list_p head of AA linked list for first operand
  * @param  aa2_list_p head of AA linked list for second operand
@@ -767,70 +985,173 @@ struct AA *affine_multiply(struct AA *aa1_list_p, struct AA *aa2_list_p)
   struct AA *result_p = NULL;
   struct AA *aa1_elt_p;
   struct AA *aa2_elt_p;
-  struct AA *res_elt_p;
+  double_int product;
 
   if ((aa1_list_p == NULL) || (aa2_list_p == NULL))
     return NULL;
 
   int new_bp = get_aa_bp(aa1_list_p) + get_aa_bp(aa2_list_p);
 
+  //
+  // The constant terms, if any, are at the head of each list
+  //
+  bool has_center1 = (aa1_list_p->id == 0);
+  bool has_center2 = (aa2_list_p->id == 0);
+  double_int center1 = has_center1 ? aa1_list_p->coeff : double_int_zero;
+  double_int center2 = has_center2 ? aa2_list_p->coeff : double_int_zero;
+  bool has_center = has_center1 && has_center2;
+  double_int center = double_int_mul(center1, center2);
+
+  double_int radius1 = double_int_zero;
+  double_int radius2 = double_int_zero;
+  double_int squares = double_int_zero;
   double_int aa_err = double_int_zero;
-  DL_FOREACH(aa1_list_p, aa1_elt_p) {
-    DL_FOREACH(aa2_list_p, aa2_elt_p) {
-      double_int product = double_int_mul(aa1_elt_p->coeff, aa2_elt_p->coeff);
-      if (aa1_elt_p->id == 0) { // op1 constant term
-        res_elt_p = search_aa_var(result_p, aa2_elt_p->id);
-        if (NULL != res_elt_p)
-          res_elt_p->coeff = double_int_add(res_elt_p->coeff, product);
-        else
-          append_aa_var(&result_p, aa2_elt_p->id, product, new_bp);
-      } else if (aa2_elt_p->id == 0) {  // op2 constant term
-        res_elt_p = search_aa_var(result_p, aa1_elt_p->id);
-        if (NULL != res_elt_p)
-          res_elt_p->coeff = double_int_add(res_elt_p->coeff, product);
-        else
-          append_aa_var(&result_p, aa1_elt_p->id, product, new_bp);
+
+  aa1_elt_p = has_center1 ? aa1_list_p->next : aa1_list_p;
+  aa2_elt_p = has_center2 ? aa2_list_p->next : aa2_list_p;
+  while ((aa1_elt_p != NULL) || (aa2_elt_p != NULL)) {
+    if ((aa2_elt_p == NULL) ||
+        ((aa1_elt_p != NULL) && (aa1_elt_p->id < aa2_elt_p->id))) {
+      // in aa1 but not in aa2
+      if (has_center2)
+        append_aa_var(&result_p, aa1_elt_p->id,
+                      double_int_mul(aa1_elt_p->coeff, center2), new_bp);
+      radius1 = double_int_add(radius1, double_int_abs(aa1_elt_p->coeff));
+      aa1_elt_p = aa1_elt_p->next;
+    } else if ((aa1_elt_p == NULL) || (aa2_elt_p->id < aa1_elt_p->id)) {
+      // in aa2 but not in aa1
+      if (has_center1)
+        append_aa_var(&result_p, aa2_elt_p->id,
+                      double_int_mul(center1, aa2_elt_p->coeff), new_bp);
+      radius2 = double_int_add(radius2, double_int_abs(aa2_elt_p->coeff));
+      aa2_elt_p = aa2_elt_p->next;
+    } else {                    // in both aa1 and aa2
+      if (has_center1 || has_center2)
+        append_aa_var(&result_p, aa1_elt_p->id,
+                      double_int_add(double_int_mul(aa1_elt_p->coeff, center2),
+                                     double_int_mul(center1, aa2_elt_p->coeff)),
+                      new_bp);
+      radius1 = double_int_add(radius1, double_int_abs(aa1_elt_p->coeff));
+      radius2 = double_int_add(radius2, double_int_abs(aa2_elt_p->coeff));
       //
       // This is an error term that must be positive because the input is
       // squared. Add half of the coefficient to the 'center' term. Since
       // this error is uncorrelated with other squared errors, the absolute
       // value of half of the coefficient is added to a new error term.
       //
-      } else if (aa1_elt_p->id == aa2_elt_p->id) {
-        product = double_int_rshift(product, 1, HOST_BITS_PER_DOUBLE_INT,
-                                    ARITH);
-        res_elt_p = search_aa_var(result_p, 0);
-        if (NULL == res_elt_p)
-          append_aa_var(&result_p, 0, product, new_bp);
-        else
-          res_elt_p->coeff = double_int_add(res_elt_p->coeff, product);
-        aa_err = double_int_add(aa_err, double_int_abs(product));
-      } else {                  // uncorrelated error term
-        //
-        // if this product will occur twice then allow cancellation
-        // divide the sum of the product terms by 2 since we will see it twice
-        //
-        struct AA *other1 = search_aa_var(aa2_list_p, aa1_elt_p->id);
-        struct AA *other2 = search_aa_var(aa1_list_p, aa2_elt_p->id);
-        if (other1 && other2) {
-          double_int otherp = double_int_mul(other1->coeff, other2->coeff);
-          product = double_int_abs(double_int_add(product, otherp));
-          product = double_int_rshift(product, 1, HOST_BITS_PER_DOUBLE_INT,
-                                        ARITH);
-          aa_err = double_int_add(aa_err, product);
-        } else {
-          aa_err = double_int_add(aa_err, double_int_abs(product));
-        }
-      }
+      product = double_int_mul(aa1_elt_p->coeff, aa2_elt_p->coeff);
+      squares = double_int_add(squares, double_int_abs(product));
+      product = double_int_rshift(product, 1, HOST_BITS_PER_DOUBLE_INT,
+                                  ARITH);
+      center = double_int_add(center, product);
+      has_center = true;
+      aa_err = double_int_add(aa_err, double_int_abs(product));
+      aa1_elt_p = aa1_elt_p->next;
+      aa2_elt_p = aa2_elt_p->next;
     }
   }
 
+  //
+  // All remaining products of two non-constant terms are uncorrelated errors
+  //
+  aa_err = double_int_add(aa_err,
+                          double_int_sub(double_int_mul(radius1, radius2),
+                                         squares));
+
+  if (has_center)
+    append_aa_var(&result_p, 0, center, new_bp);
   if (!double_int_zero_p(aa_err)) {
-    append_aa_var(&result_p, next_error_id++, aa_err, new_bp);
+    append_aa_var(&result_p, fxctx->next_error_id++, aa_err, new_bp);
   }
+  condense_aa_list(&result_p);
   return result_p;
 }
 
+/**
+ * @brief Order error terms by the magnitude of their coefficients.
+ *
+ * @details Used with qsort. Terms with equal magnitude are ordered by ID so
+ * that the same terms are always chosen for condensation.
+ *
+ * @param[in] a pointer to a pointer to an AA list element
+ * @param[in] b pointer to a pointer to an AA list element
+ * @return    comparison result
+ */
+static int aa_magnitude_sort(const void *a, const void *b)
+{
+  const struct AA *aa_a = *(const struct AA * const *) a;
+  const struct AA *aa_b = *(const struct AA * const *) b;
+  int cmp = double_int_scmp(double_int_abs(aa_a->coeff),
+                            double_int_abs(aa_b->coeff));
+
+  if (cmp != 0)
+    return cmp;
+  return (aa_a->id < aa_b->id) ? -1 : (aa_a->id > aa_b->id);
+}
+
+/**
+ * @brief Limit the number of terms in an affine definition.
+ *
+ * @details If the list has more than ::AFFINE_MAX_TERMS terms then the error
+ * terms with the smallest coefficients are removed and replaced by a single
+ * new error term. The error terms are uncorrelated, so the coefficient of
+ * the new term is the sum of the absolute values of the coefficients that it
+ * replaces, and the range of the affine definition is unchanged. Only error
+ * terms are condensed, so a list whose variable terms alone exceed the limit
+ * is left larger than the limit.
+ *
+ * @param[in,out] aa_list_p pointer to the AA list head pointer
+ */
+void condense_aa_list(struct AA **aa_list_p)
+{
+  struct AA *aa_elt_p;
+  struct AA *tmp_p;
+  struct AA **errors;
+  int num_terms = 0;
+  int num_errors = 0;
+  int i, excess;
+
+  if ((AFFINE_MAX_TERMS <= 0) || (NULL == *aa_list_p))
+    return;
+
+  DL_FOREACH(*aa_list_p, aa_elt_p) {
+    num_terms++;
+    if ((aa_elt_p->id != 0) && (KEY_TO_UID(aa_elt_p->id) == 0))
+      num_errors++;
+  }
+  if (num_terms <= AFFINE_MAX_TERMS)
+    return;
+  //
+  // Folding n error terms into one removes n - 1 terms from the list
+  //
+  excess = num_terms - AFFINE_MAX_TERMS + 1;
+  if (excess > num_errors)
+    excess = num_errors;
+  if (excess < 2)
+    return;
+
+  errors = (struct AA **) xmalloc(num_errors * sizeof(struct AA *));
+  i = 0;
+  DL_FOREACH(*aa_list_p, aa_elt_p) {
+    if ((aa_elt_p->id != 0) && (KEY_TO_UID(aa_elt_p->id) == 0))
+      errors[i++] = aa_elt_p;
+  }
+  qsort(errors, num_errors, sizeof(struct AA *), aa_magnitude_sort);
+
+  int bp = errors[0]->bp;
+  double_int aa_err = double_int_zero;
+  for (i = 0; i < excess; i++) {
+    tmp_p = errors[i];
+    if (tmp_p->bp != bp)
+      FXLOG(1, "  condense_aa_list : binary points not equal\n");
+    aa_err = double_int_add(aa_err, double_int_abs(tmp_p->coeff));
+    DL_DELETE(*aa_list_p, tmp_p);
+  }
+  free(errors);
+
+  append_aa_var(aa_list_p, fxctx->next_error_id++, aa_err, bp);
+}
+
 /**
  * @brief Affine division, numerator/denominator
  *
@@ -904,7 +1225,7 @@ struct AA *affine_divide(struct AA *numerator_p, struct AA *denominator_p)
   reciprocal_p = temp_p;
 
   if (num_bp != get_aa_bp(reciprocal_p))
-    fprintf(stderr, "  !!!!! expected bp of num_bp\n");
+    FXLOG(1, "  !!!!! expected bp of num_bp\n");
 
   if (!double_int_zero_p(zeta)) {
     zeta = double_int_lshift(zeta, den_bp, HOST_BITS_PER_DOUBLE_INT, ARITH);
@@ -914,15 +1235,15 @@ struct AA *affine_divide(struct AA *numerator_p, struct AA *denominator_p)
     if (NULL == elt_p)
       append_aa_var(&reciprocal_p, 0, zeta, num_bp);
     else if (num_bp != elt_p->bp)
-      fprintf(stderr, " incorrect bp location ");
+      FXLOG(1, " incorrect bp location ");
     elt_p->coeff = double_int_add(elt_p->coeff, zeta);
   }
 
   if (!double_int_zero_p(delta)) {
     delta = double_int_lshift(delta, den_bp, HOST_BITS_PER_DOUBLE_INT, ARITH);
 
-    append_aa_var(&reciprocal_p, next_error_id, delta, num_bp);
-    next_error_id++;
+    append_aa_var(&reciprocal_p, fxctx->next_error_id, delta, num_bp);
+    fxctx->next_error_id++;
   }
 
   quotient_p = affine_multiply(numerator_p, reciprocal_p);
@@ -0,0 +1,780 @@
+/**
+ * @file fxopt_aggregate.c
+ *
+ * @brief  Functions for the formats of struct fields and nested arrays
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-23T08:47:15-0500
+ * @date Last modified: 2014-01-23T08:47:15-0500
+ *
+ * @details  The key of a format holds one index, so an array of arrays, like
+ *           a DCT's block[8][8], or a struct, like a complex sample with
+ *           real and imaginary fields, has no place for the format of each
+ *           of its values. Such an aggregate is given a format for each real
+ *           value it holds, its leaves, which are numbered in the order they
+ *           are laid out in memory:
+ * @code
+ *           struct cplx { double re, im; } x[4];  // x[2].im is leaf 5
+ *           double block[8][8];                   // block[2][3] is leaf 19
+ * @endcode
+ *           and the number of a leaf is used as the element index of its
+ *           format. The fields of a struct then get formats of their own,
+ *           so a small field is not widened to the range of a large one.
+ *
+ *           The leaf of a reference is only known when its array indices are
+ *           constants. An array whose elements are referenced with a variable
+ *           index anywhere in the function, such as the row of a 2-D array
+ *           in a loop over the rows, is counted as a single element: all of
+ *           its elements share one format, which keeps the join of the values
+ *           stored in them, as with the uniform option. The fields within the
+ *           elements still have their own formats. With the uniform option,
+ *           or the fxblock attribute, every array level is shared.
+ *
+ *           Only variables declared in the function, automatic or static,
+ *           are handled, and only if all of their leaves are real, they are
+ *           used just through references to their leaves, and their address
+ *           is not taken except in calls to fxblock_normalize(). Others are
+ *           left to the handling of single arrays and pointers. A converted
+ *           variable gets integer copies of its types, so the types it shares
+ *           with other variables and functions keep their real leaves.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "utlist.h"
+
+/**
+ * @brief An array type whose elements all share one format.
+ */
+struct SHARED_LEVEL {
+  tree type;                    ///< main variant of the array type
+  struct SHARED_LEVEL *next;
+};
+
+/**
+ * @brief A struct or array of arrays with a format for each leaf.
+ */
+struct AGGREGATE {
+  tree var;                     ///< the variable's declaration
+  bool all_shared;              ///< every array level is shared
+  struct SHARED_LEVEL *shared;  ///< array levels indexed by a variable
+  int leaves;                   ///< number of formats, once counted
+  bool rejected;                ///< found not to be usable by leaf
+  struct AGGREGATE *next;
+};
+
+/**
+ * @brief The initial values of one leaf, while an initializer is converted.
+ */
+struct LEAF_INIT {
+  bool seen;                    ///< some initial value is real
+  int i_bits;                   ///< integer bits of the largest value
+  double_int max;               ///< largest scaled value
+  double_int min;               ///< smallest scaled value
+};
+
+/**
+ * @brief All of the aggregates of the current function.
+ */
+static struct AGGREGATE *aggregates = NULL;
+
+/**
+ * @brief Predicate for a type whose values are all real.
+ *
+ * @param[in] type gcc tree for a type
+ * @return    true if type is real, or an array with constant bounds or a
+ *            struct whose elements or fields all have only real values
+ */
+static bool all_real_leaves(tree type)
+{
+  tree field;
+  bool any = false;
+
+  switch (TREE_CODE(type)) {
+    case REAL_TYPE:
+      return true;
+    case ARRAY_TYPE:
+      if ((TYPE_DOMAIN(type) == NULL_TREE) ||
+          !host_integerp(TYPE_MIN_VALUE(TYPE_DOMAIN(type)), 0) ||
+          (TYPE_MAX_VALUE(TYPE_DOMAIN(type)) == NULL_TREE) ||
+          !host_integerp(TYPE_MAX_VALUE(TYPE_DOMAIN(type)), 0))
+        return false;
+      return all_real_leaves(TREE_TYPE(type));
+    case RECORD_TYPE:
+      for (field = TYPE_FIELDS(type); field; field = DECL_CHAIN(field)) {
+        if (TREE_CODE(field) != FIELD_DECL)
+          continue;
+        if (DECL_BIT_FIELD(field) || !all_real_leaves(TREE_TYPE(field)))
+          return false;
+        any = true;
+      }
+      return any;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Predicate for a type that is not handled as a single array.
+ *
+ * @param[in] type gcc tree for a type
+ * @return    true if type is a struct, or an array of arrays or structs
+ */
+static bool is_aggregate_type(tree type)
+{
+  if (TREE_CODE(type) == RECORD_TYPE)
+    return true;
+  return (TREE_CODE(type) == ARRAY_TYPE) &&
+      ((TREE_CODE(TREE_TYPE(type)) == ARRAY_TYPE) ||
+       (TREE_CODE(TREE_TYPE(type)) == RECORD_TYPE));
+}
+
+/**
+ * @brief Find the aggregate with a given declaration.
+ *
+ * @param[in] var gcc tree for a declaration, or NULL_TREE
+ * @return    the aggregate, or NULL if var is not one
+ */
+static struct AGGREGATE *find_aggregate(tree var)
+{
+  struct AGGREGATE *a;
+
+  if ((var == NULL_TREE) || !DECL_P(var))
+    return NULL;
+  LL_FOREACH(aggregates, a) {
+    if ((a->var == var) && !a->rejected)
+      return a;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Find the tree under the array and field references of an operand.
+ *
+ * @param[in] ref gcc tree for an operand
+ * @return    the innermost operand, a declaration if ref is a reference to
+ *            a part of a variable
+ */
+static tree ref_base(tree ref)
+{
+  while ((TREE_CODE(ref) == ARRAY_REF) || (TREE_CODE(ref) == COMPONENT_REF))
+    ref = TREE_OPERAND(ref, 0);
+  return ref;
+}
+
+/**
+ * @brief Predicate for an array level whose elements share one format.
+ *
+ * @param[in] a    the aggregate
+ * @param[in] type gcc tree for an array type within the aggregate
+ * @return    true if the level counts as a single element
+ */
+static bool is_shared_level(struct AGGREGATE *a, tree type)
+{
+  struct SHARED_LEVEL *s;
+
+  if (a->all_shared)
+    return true;
+  LL_FOREACH(a->shared, s) {
+    if (s->type == TYPE_MAIN_VARIANT(type))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Count the leaves of a type.
+ *
+ * @param[in] a    the aggregate
+ * @param[in] type gcc tree for a type within the aggregate
+ * @return    number of formats that a value of the type needs
+ */
+static int type_leaves(struct AGGREGATE *a, tree type)
+{
+  tree field;
+  int leaves = 0;
+
+  if (TREE_CODE(type) == ARRAY_TYPE) {
+    leaves = type_leaves(a, TREE_TYPE(type));
+    if (!is_shared_level(a, type))
+      leaves *= TREE_INT_CST_LOW(TYPE_MAX_VALUE(TYPE_DOMAIN(type))) -
+          TREE_INT_CST_LOW(TYPE_MIN_VALUE(TYPE_DOMAIN(type))) + 1;
+    return leaves;
+  }
+  if (TREE_CODE(type) == RECORD_TYPE) {
+    for (field = TYPE_FIELDS(type); field; field = DECL_CHAIN(field)) {
+      if (TREE_CODE(field) == FIELD_DECL)
+        leaves += type_leaves(a, TREE_TYPE(field));
+    }
+    return leaves;
+  }
+  return 1;
+}
+
+/**
+ * @brief Find the number of the first leaf of a field.
+ *
+ * @param[in] a     the aggregate
+ * @param[in] field gcc tree for a FIELD_DECL
+ * @return    number of leaves in the fields before it
+ */
+static int field_offset(struct AGGREGATE *a, tree field)
+{
+  tree f;
+  int offset = 0;
+
+  for (f = TYPE_FIELDS(DECL_CONTEXT(field)); f && (f != field);
+       f = DECL_CHAIN(f)) {
+    if (TREE_CODE(f) == FIELD_DECL)
+      offset += type_leaves(a, TREE_TYPE(f));
+  }
+  return offset;
+}
+
+/**
+ * @brief Find the number of the first leaf of an array element.
+ *
+ * @param[in] a     the aggregate
+ * @param[in] type  gcc tree for the array type
+ * @param[in] index gcc tree for the index of the element
+ * @return    number of leaves in the elements before it
+ */
+static int array_offset(struct AGGREGATE *a, tree type, tree index)
+{
+  if (is_shared_level(a, type))
+    return 0;
+  if (INTEGER_CST != TREE_CODE(index)) {
+    error("fxopt: Unexpected index of a nested array");
+    return 0;
+  }
+  return (TREE_INT_CST_LOW(index) -
+          TREE_INT_CST_LOW(TYPE_MIN_VALUE(TYPE_DOMAIN(type)))) *
+      type_leaves(a, TREE_TYPE(type));
+}
+
+/**
+ * @brief Find the number of the leaf that a reference selects.
+ *
+ * @param[in] a        the aggregate
+ * @param[in] ref      gcc tree for a reference to a part of the aggregate
+ * @param[out] shared_p set true if a shared array level is crossed
+ * @return    number of the first leaf of the part
+ */
+static int ref_offset(struct AGGREGATE *a, tree ref, bool *shared_p)
+{
+  tree base;
+
+  if (TREE_CODE(ref) == ARRAY_REF) {
+    base = TREE_OPERAND(ref, 0);
+    if (is_shared_level(a, TREE_TYPE(base)))
+      *shared_p = true;
+    return ref_offset(a, base, shared_p) +
+        array_offset(a, TREE_TYPE(base), TREE_OPERAND(ref, 1));
+  }
+  if (TREE_CODE(ref) == COMPONENT_REF)
+    return ref_offset(a, TREE_OPERAND(ref, 0), shared_p) +
+        field_offset(a, TREE_OPERAND(ref, 1));
+  return 0;
+}
+
+/**
+ * @brief Stop giving the leaves of an aggregate their own formats.
+ *
+ * @param[in] a   the aggregate
+ * @param[in] why reason, for the warning
+ */
+static void reject_aggregate(struct AGGREGATE *a, const char *why)
+{
+  if (a->rejected)
+    return;
+  a->rejected = true;
+  warning(0, G_("fxopt: %qs %s, its fields and elements cannot have their "
+                "own formats"),
+          DECL_NAME(a->var) ? IDENTIFIER_POINTER(DECL_NAME(a->var)) : "",
+          why);
+}
+
+/**
+ * @brief Note how an operand uses an aggregate.
+ *
+ * @details A reference to a leaf marks each array level that it indexes
+ * with a variable as shared. Any other use rejects the aggregate.
+ *
+ * @param[in] op gcc tree for a statement operand, or NULL_TREE
+ */
+static void scan_operand(tree op)
+{
+  struct AGGREGATE *a;
+  struct SHARED_LEVEL *s;
+  tree ref;
+
+  if (op == NULL_TREE)
+    return;
+  a = find_aggregate(ref_base(op));
+  if (a == NULL)
+    return;
+  if (is_aggregate_type(TREE_TYPE(op)) ||
+      (TREE_CODE(TREE_TYPE(op)) == ARRAY_TYPE)) {
+    reject_aggregate(a, "is used as a whole");
+    return;
+  }
+  for (ref = op; ref != a->var; ref = TREE_OPERAND(ref, 0)) {
+    if ((TREE_CODE(ref) != ARRAY_REF) ||
+        (INTEGER_CST == TREE_CODE(TREE_OPERAND(ref, 1))) ||
+        is_shared_level(a, TREE_TYPE(TREE_OPERAND(ref, 0))))
+      continue;
+    s = (struct SHARED_LEVEL *) xmalloc(sizeof(struct SHARED_LEVEL));
+    s->type = TYPE_MAIN_VARIANT(TREE_TYPE(TREE_OPERAND(ref, 0)));
+    LL_PREPEND(a->shared, s);
+  }
+}
+
+/**
+ * @brief Find the aggregates of the current function.
+ *
+ * @details Called after find_block_arrays() and before the formats of the
+ * declared variables are set, because the number of formats of an aggregate
+ * depends on the array levels that are shared.
+ */
+void find_aggregates()
+{
+  tree var;
+  referenced_var_iterator rvi;
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  struct AGGREGATE *a, *atmp;
+  struct SHARED_LEVEL *s, *stmp;
+  unsigned i;
+
+  LL_FOREACH_SAFE(aggregates, a, atmp) {
+    LL_FOREACH_SAFE(a->shared, s, stmp) {
+      LL_DELETE(a->shared, s);
+      free(s);
+    }
+    LL_DELETE(aggregates, a);
+    free(a);
+  }
+
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    if ((TREE_CODE(var) != VAR_DECL) || !is_aggregate_type(TREE_TYPE(var)) ||
+        !all_real_leaves(TREE_TYPE(var)))
+      continue;
+    a = (struct AGGREGATE *) xmalloc(sizeof(struct AGGREGATE));
+    a->var = var;
+    a->all_shared = UNIFORM || is_block_array(var);
+    a->shared = NULL;
+    a->leaves = 0;
+    a->rejected = false;
+    LL_PREPEND(aggregates, a);
+    if (DECL_CONTEXT(var) != current_function_decl)
+      reject_aggregate(a, "is not declared in the function");
+    else if (TREE_ADDRESSABLE(var) && !is_block_array(var))
+      reject_aggregate(a, "has its address taken");
+  }
+  if (aggregates == NULL)
+    return;
+
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      for (i = 0; i < gimple_num_ops(stmt); i++)
+        scan_operand(gimple_op(stmt, i));
+    }
+  }
+
+  LL_FOREACH(aggregates, a) {
+    if (a->rejected)
+      continue;
+    a->leaves = type_leaves(a, TREE_TYPE(a->var));
+    if (a->leaves >= NOT_AN_ARRAY) {
+      reject_aggregate(a, "is too large");
+      continue;
+    }
+    FXLOG(1, "  %s has %d formats\n",
+          DECL_NAME(a->var) ? IDENTIFIER_POINTER(DECL_NAME(a->var)) :
+          "(temp)", a->leaves);
+  }
+}
+
+/**
+ * @brief Predicate for a variable with a format for each leaf.
+ *
+ * @param[in] var gcc tree for a declaration, or NULL_TREE
+ * @return    true if var was found by find_aggregates()
+ */
+bool is_aggregate(tree var)
+{
+  return find_aggregate(var) != NULL;
+}
+
+/**
+ * @brief Find the number of formats of an aggregate.
+ *
+ * @param[in] var gcc tree for a declaration
+ * @return    number of leaves, or 1 if var is not an aggregate
+ */
+int aggregate_leaves(tree var)
+{
+  struct AGGREGATE *a = find_aggregate(var);
+
+  return a ? a->leaves : 1;
+}
+
+/**
+ * @brief Predicate for a reference to a leaf of an aggregate.
+ *
+ * @param[in] operand gcc tree for an operand
+ * @return    true if operand is an ARRAY_REF or COMPONENT_REF within a
+ *            variable found by find_aggregates()
+ */
+bool is_aggregate_ref(tree operand)
+{
+  if ((operand == NULL_TREE) || ((TREE_CODE(operand) != ARRAY_REF) &&
+                                 (TREE_CODE(operand) != COMPONENT_REF)))
+    return false;
+  return is_aggregate(ref_base(operand));
+}
+
+/**
+ * @brief Predicate for a reference to a leaf that shares its format.
+ *
+ * @details A store to such a leaf must not narrow the range of the leaves
+ * that share its format, and is aligned with that format.
+ *
+ * @param[in] operand gcc tree for an operand
+ * @return    true if operand selects a leaf through a shared array level
+ */
+bool is_shared_ref(tree operand)
+{
+  struct AGGREGATE *a;
+  bool shared = false;
+
+  if (!is_aggregate_ref(operand))
+    return false;
+  a = find_aggregate(ref_base(operand));
+  ref_offset(a, operand, &shared);
+  return shared;
+}
+
+/**
+ * @brief Find the variable and format index of a reference to a leaf.
+ *
+ * @param[in] operand  gcc tree for a reference, see is_aggregate_ref()
+ * @param[out] index_p the element index of the leaf's format
+ * @return    gcc tree for the aggregate's declaration
+ */
+tree aggregate_leaf(tree operand, int *index_p)
+{
+  tree var = ref_base(operand);
+  struct AGGREGATE *a = find_aggregate(var);
+  bool shared = false;
+
+  *index_p = ref_offset(a, operand, &shared);
+  if (a->leaves == 1)
+    *index_p = NOT_AN_ARRAY;
+  return var;
+}
+
+/**
+ * @brief Visit the real values of a nested initializer.
+ *
+ * @details The first visit finds the integer bits of the largest value of
+ * each leaf, the second scales each value to its leaf's binary point.
+ *
+ * @param[in] a         the aggregate
+ * @param[in,out] ctor  gcc tree for a CONSTRUCTOR within the initial value
+ * @param[in] offset    number of the first leaf of the constructor
+ * @param[in] size      number of bits in each leaf
+ * @param[in,out] init  the initial values of each leaf
+ * @param[in] scale     false for the first visit, true for the second
+ * @param[in] replace   true to replace the real values, in the last pass
+ */
+static void visit_constructor(struct AGGREGATE *a, tree ctor, int offset,
+                              int size, struct LEAF_INIT *init, bool scale,
+                              bool replace)
+{
+  tree type = TREE_TYPE(ctor);
+  unsigned HOST_WIDE_INT ix;
+  tree field, val;
+
+  FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(ctor), ix, field, val) {
+    int leaf = offset;
+    if ((TREE_CODE(type) == RECORD_TYPE) && (field != NULL_TREE) &&
+        (TREE_CODE(field) == FIELD_DECL)) {
+      leaf += field_offset(a, field);
+    } else if ((TREE_CODE(type) == ARRAY_TYPE) && (field != NULL_TREE) &&
+               (TREE_CODE(field) == INTEGER_CST)) {
+      leaf += array_offset(a, type, field);
+    } else {
+      FXLOG(1, " *** Unexpected initial constructor element\n");
+      continue;
+    }
+    if (TREE_CODE(val) == CONSTRUCTOR) {
+      visit_constructor(a, val, leaf, size, init, scale, replace);
+    } else if (TREE_CODE(val) == REAL_CST) {
+      struct LEAF_INIT *li = &init[leaf];
+      if (!scale) {
+        struct SIF temp_fmt = get_format_real_value_type(TREE_REAL_CST(val),
+                                                         size);
+        li->i_bits = MAX(li->i_bits, temp_fmt.I);
+        delete_aa_list(&(temp_fmt.aa));
+      } else {
+        REAL_VALUE_TYPE scaled_real, rounded_real;
+        double_int element;
+        real_ldexp(&scaled_real, &TREE_REAL_CST(val), size - 1 - li->i_bits);
+        real_round(&rounded_real, VOIDmode, &scaled_real);
+        element = shwi_to_double_int(real_to_integer(&rounded_real));
+        if (!li->seen) {
+          li->min = li->max = element;
+          li->seen = true;
+        } else {
+          li->max = double_int_smax(li->max, element);
+          li->min = double_int_smin(li->min, element);
+        }
+        if (replace)
+          CONSTRUCTOR_ELT(ctor, ix)->value =
+              double_int_to_tree(fxopt_integer_type(size), element);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Convert the real values of an aggregate's initial value to
+ * integers.
+ *
+ * @details Each leaf with an initial value gets one sign bit, enough integer
+ * bits for the largest of the values given to it, and a range that covers
+ * them, as uniform_constructor() does for a whole array. A leaf has more than
+ * one value only when it is in a shared array level. The values are replaced
+ * by their integers only if `replace` is true, in the last pass.
+ *
+ * @param[in] var         gcc tree for the aggregate's declaration
+ * @param[in,out] initial gcc tree for the CONSTRUCTOR of the initial value
+ * @param[in] replace     true to replace the real values
+ */
+void aggregate_constructor(tree var, tree initial, bool replace)
+{
+  struct AGGREGATE *a = find_aggregate(var);
+  int size = var_word_size(var);
+  struct LEAF_INIT *init;
+  int leaf;
+
+  if (a == NULL)
+    return;
+  init = XCNEWVEC(struct LEAF_INIT, a->leaves);
+  for (leaf = 0; leaf < a->leaves; leaf++)
+    init[leaf].i_bits = 1;
+  visit_constructor(a, initial, 0, size, init, false, false);
+  visit_constructor(a, initial, 0, size, init, true, replace);
+
+  for (leaf = 0; leaf < a->leaves; leaf++) {
+    struct SIF *op_fmt_p;
+    if (!init[leaf].seen)
+      continue;
+    op_fmt_p = find_var_format(calc_hash_key(var, 0,
+                                             (a->leaves == 1) ? NOT_AN_ARRAY :
+                                             leaf));
+    op_fmt_p->sgnd = op_fmt_p->S = 1;
+    op_fmt_p->I = init[leaf].i_bits;
+    op_fmt_p->F = size - op_fmt_p->S - op_fmt_p->I;
+    op_fmt_p->E = 0;
+    op_fmt_p->size = size;
+    op_fmt_p->max = init[leaf].max;
+    op_fmt_p->min = init[leaf].min;
+    delete_aa_list(&(op_fmt_p->aa));
+    range_to_aa(op_fmt_p, op_fmt_p->id);
+  }
+  free(init);
+}
+
+/**
+ * @brief Build an integer copy of a type within an aggregate.
+ *
+ * @details The real elements and fields are replaced, working from the inside
+ * out, in new array and struct types that belong to the aggregate alone. The
+ * original types may be used by other variables, pointers, and functions
+ * that keep their real values, so they are not changed. A copy of an array
+ * level that is shared is added to the shared levels, so that references to
+ * the copy find the same leaves.
+ *
+ * @param[in] a        the aggregate
+ * @param[in] type     gcc tree for a type within the aggregate
+ * @param[in] int_type gcc tree for the integer type of the leaves
+ * @return    gcc tree for the new type
+ */
+static tree copy_aggregate_type(struct AGGREGATE *a, tree type, tree int_type)
+{
+  tree copy, field, *chain;
+
+  if (TREE_CODE(type) == ARRAY_TYPE) {
+    copy = build_distinct_type_copy(
+        build_array_type(copy_aggregate_type(a, TREE_TYPE(type), int_type),
+                         TYPE_DOMAIN(type)));
+    if (!a->all_shared && is_shared_level(a, type)) {
+      struct SHARED_LEVEL *s =
+          (struct SHARED_LEVEL *) xmalloc(sizeof(struct SHARED_LEVEL));
+      s->type = copy;
+      LL_PREPEND(a->shared, s);
+    }
+  } else if (TREE_CODE(type) == RECORD_TYPE) {
+    copy = build_distinct_type_copy(TYPE_MAIN_VARIANT(type));
+    TYPE_CANONICAL(copy) = copy;
+    TYPE_SIZE(copy) = TYPE_SIZE_UNIT(copy) = NULL_TREE;
+    if (!TYPE_USER_ALIGN(copy))
+      TYPE_ALIGN(copy) = BITS_PER_UNIT;
+    chain = &TYPE_FIELDS(copy);
+    for (field = TYPE_FIELDS(type); field; field = DECL_CHAIN(field)) {
+      tree new_field = copy_node(field);
+      DECL_CONTEXT(new_field) = copy;
+      if (TREE_CODE(field) == FIELD_DECL) {
+        TREE_TYPE(new_field) =
+            copy_aggregate_type(a, TREE_TYPE(field), int_type);
+        DECL_SIZE(new_field) = DECL_SIZE_UNIT(new_field) = NULL_TREE;
+        DECL_MODE(new_field) = VOIDmode;
+        if (!DECL_USER_ALIGN(new_field))
+          DECL_ALIGN(new_field) = 0;
+        layout_decl(new_field, 0);
+      }
+      *chain = new_field;
+      chain = &DECL_CHAIN(new_field);
+    }
+    *chain = NULL_TREE;
+    layout_type(copy);
+  } else {
+    return int_type;
+  }
+  if (TYPE_QUALS(type) != TYPE_UNQUALIFIED)
+    copy = build_qualified_type(copy, TYPE_QUALS(type));
+  return copy;
+}
+
+/**
+ * @brief Find the field of a copied struct that matches an original field.
+ *
+ * @param[in] field gcc tree for a FIELD_DECL of the original struct
+ * @param[in] copy  gcc tree for the copied struct type
+ * @return    gcc tree for the FIELD_DECL in the same position of the copy
+ */
+static tree copied_field(tree field, tree copy)
+{
+  tree f = TYPE_FIELDS(DECL_CONTEXT(field));
+  tree new_field = TYPE_FIELDS(copy);
+
+  while ((f != NULL_TREE) && (new_field != NULL_TREE) && (f != field)) {
+    f = DECL_CHAIN(f);
+    new_field = DECL_CHAIN(new_field);
+  }
+  if ((f == NULL_TREE) || (new_field == NULL_TREE))
+    error("fxopt: Error finding the field of a converted struct");
+  return new_field;
+}
+
+/**
+ * @brief Give a reference to a part of an aggregate the copied types.
+ *
+ * @details The field of each COMPONENT_REF is replaced by the matching field
+ * of the copy, and each reference gets the type of the part it selects.
+ *
+ * @param[in] a       the aggregate, already given its copied type
+ * @param[in,out] ref gcc tree for the aggregate or a reference within it
+ * @return    gcc tree for the new type of ref
+ */
+static tree retype_ref(struct AGGREGATE *a, tree ref)
+{
+  tree type;
+
+  if (ref == a->var)
+    return TREE_TYPE(a->var);
+  type = retype_ref(a, TREE_OPERAND(ref, 0));
+  if (TREE_CODE(ref) == ARRAY_REF) {
+    TREE_TYPE(ref) = TREE_TYPE(type);
+  } else {
+    TREE_OPERAND(ref, 1) = copied_field(TREE_OPERAND(ref, 1), type);
+    TREE_TYPE(ref) = TREE_TYPE(TREE_OPERAND(ref, 1));
+  }
+  return TREE_TYPE(ref);
+}
+
+/**
+ * @brief Give a nested initializer the copied types.
+ *
+ * @details The real values have already been replaced by
+ * aggregate_constructor().
+ *
+ * @param[in,out] ctor gcc tree for a CONSTRUCTOR within the initial value
+ * @param[in] type     gcc tree for the copied type of the constructor
+ */
+static void retype_constructor(tree ctor, tree type)
+{
+  unsigned HOST_WIDE_INT ix;
+  tree field, val;
+
+  TREE_TYPE(ctor) = type;
+  FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(ctor), ix, field, val) {
+    tree val_type = TREE_TYPE(type);
+    if ((TREE_CODE(type) == RECORD_TYPE) && (field != NULL_TREE) &&
+        (TREE_CODE(field) == FIELD_DECL)) {
+      CONSTRUCTOR_ELT(ctor, ix)->index = copied_field(field, type);
+      val_type = TREE_TYPE(CONSTRUCTOR_ELT(ctor, ix)->index);
+    }
+    if (TREE_CODE(val) == CONSTRUCTOR)
+      retype_constructor(val, val_type);
+  }
+}
+
+/**
+ * @brief Convert an aggregate from floating to integer.
+ *
+ * @details Called by convert_real_var_to_integer() in the last pass. The
+ * variable gets a copy of its type whose leaves have the integer type chosen
+ * by var_word_size(), and every reference to it in the function, and its
+ * initial value, are given the copied types.
+ *
+ * @param[in,out] var gcc tree for the aggregate's declaration
+ */
+void convert_aggregate_to_integer(tree var)
+{
+  struct AGGREGATE *a = find_aggregate(var);
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  unsigned i;
+
+  TREE_TYPE(var) = copy_aggregate_type(a, TREE_TYPE(var),
+                                       fxopt_integer_type(var_word_size(var)));
+  relayout_decl(var);
+  if ((DECL_INITIAL(var) != NULL_TREE) &&
+      (TREE_CODE(DECL_INITIAL(var)) == CONSTRUCTOR))
+    retype_constructor(DECL_INITIAL(var), TREE_TYPE(var));
+
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      for (i = 0; i < gimple_num_ops(stmt); i++) {
+        tree op = gimple_op(stmt, i);
+        if (op == NULL_TREE)
+          continue;
+        if ((TREE_CODE(op) == ADDR_EXPR) &&
+            (ref_base(TREE_OPERAND(op, 0)) == var)) {
+          retype_ref(a, TREE_OPERAND(op, 0));
+          TREE_TYPE(op) = build_pointer_type(TREE_TYPE(TREE_OPERAND(op, 0)));
+        } else if (ref_base(op) == var) {
+          retype_ref(a, op);
+        }
+      }
+    }
+  }
+}
+
+// vim:syntax=c.doxygen
@@ -0,0 +1,635 @@
+/**
+ * @file fxopt_block.c
+ *
+ * @brief  Functions for block floating-point arrays
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-18T10:12:37-0500
+ * @date Last modified: 2014-01-18T10:12:37-0500
+ *
+ * @details  The format of a variable is fixed when the function is compiled,
+ *           so an array whose values are sometimes large and sometimes small,
+ *           like the buffer of an FFT, keeps only the fraction bits that its
+ *           largest values allow. An array with the fxblock attribute instead
+ *           shares one exponent among all of its elements, which is found
+ *           when the program runs:
+ * @code
+ *           double __attribute__ ((fxfrmt(1,15,16), fxblock(1))) buf[256];
+ *           ...
+ *           fxblock_normalize(buf);
+ * @endcode
+ *           Each call of fxblock_normalize() is replaced by a call to
+ *           __fxopt_block_normalize(), in fxblock.c, that counts the
+ *           redundant sign bits of all of the elements, shifts every element
+ *           left so that the largest keeps the number of guard bits given
+ *           with the attribute, and returns the number of places it shifted.
+ *           That count is added to the array's exponent, which starts at
+ *           zero. An element is then its value in the fxfrmt format scaled
+ *           by 2^exponent, and the formats found by the plugin describe the
+ *           scaled values; the fxfrmt attribute still gives the largest
+ *           values, which are saturated.
+ *
+ *           The values loaded from the array, and those calculated from
+ *           them, stay scaled as long as they are only added, subtracted,
+ *           negated, compared with MIN and MAX, or multiplied or divided by
+ *           a value that is not scaled. They can be stored back into the
+ *           same array without a shift. Where a scaled value meets one that
+ *           is not scaled, or is stored anywhere else, it is shifted right by
+ *           the exponent, and a value stored into the array from elsewhere
+ *           is saturated and shifted left by the exponent. Which variables
+ *           hold scaled values is found before the formats, and does not
+ *           change them; the shifts are inserted in the last pass.
+ *
+ *           The exponent never goes below zero, so a block that grows past
+ *           its guard bits is saturated just as it would be without the
+ *           attribute. Only local arrays that are not static can have the
+ *           attribute, and a scaled value must not be live across a call of
+ *           fxblock_normalize().
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "utlist.h"
+
+/**
+ * @def   NORMALIZE_MARKER
+ * @brief Name of the function that marks where a block is normalized.
+ */
+#define NORMALIZE_MARKER "fxblock_normalize"
+/**
+ * @def   NORMALIZE_FUNCTION
+ * @brief Name of the run-time function that normalizes a block.
+ */
+#define NORMALIZE_FUNCTION "__fxopt_block_normalize"
+/**
+ * @def   UNSET_BLOCK
+ * @brief Marks a variable whose definitions have not been seen yet.
+ */
+#define UNSET_BLOCK (-1)
+
+/**
+ * @brief An array with the fxblock attribute.
+ */
+struct BLOCK_ARRAY {
+  tree var;                     ///< the array's declaration
+  int guard;                    ///< guard bits kept by normalization
+  tree exponent;                ///< the run-time exponent, once created
+  struct BLOCK_ARRAY *next;
+};
+
+/**
+ * @brief A scalar variable and the array whose exponent scales it.
+ */
+struct BLOCK_VALUE {
+  tree var;                     ///< the variable's declaration
+  int block;                    ///< DECL_UID of the array, zero if unscaled
+  struct BLOCK_VALUE *next;
+};
+
+static struct BLOCK_ARRAY *block_arrays = NULL;
+static struct BLOCK_VALUE *block_values = NULL;
+
+/**
+ * @brief Find the fxblock array with a given declaration.
+ *
+ * @param[in] var gcc tree for a declaration, or NULL_TREE
+ * @return    the array, or NULL if var is not an fxblock array
+ */
+static struct BLOCK_ARRAY *find_block_array(tree var)
+{
+  struct BLOCK_ARRAY *b;
+
+  if ((var == NULL_TREE) || !DECL_P(var))
+    return NULL;
+  LL_FOREACH(block_arrays, b) {
+    if (DECL_UID(b->var) == DECL_UID(var))
+      return b;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Find the fxblock array with a given DECL_UID.
+ */
+static struct BLOCK_ARRAY *find_block_uid(int uid)
+{
+  struct BLOCK_ARRAY *b;
+
+  LL_FOREACH(block_arrays, b) {
+    if ((int) DECL_UID(b->var) == uid)
+      return b;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Predicate for an array with the fxblock attribute.
+ *
+ * @param[in] var gcc tree for a declaration, or NULL_TREE
+ * @return    true if the elements of var share a run-time exponent
+ */
+bool is_block_array(tree var)
+{
+  return find_block_array(var) != NULL;
+}
+
+/**
+ * @brief Find the array whose exponent scales an operand.
+ *
+ * @param[in] op gcc tree for the operand
+ * @return    DECL_UID of the array, zero if the operand is not scaled, or
+ *            UNSET_BLOCK if none of its variable's definitions have been seen
+ */
+static int operand_block(tree op)
+{
+  struct BLOCK_VALUE *v;
+
+  if ((op == NULL_TREE) || TREE_CONSTANT(op))
+    return 0;
+  if (TREE_CODE(op) == ARRAY_REF) {
+    struct BLOCK_ARRAY *b = find_block_array(get_operand_decl(op));
+    return b ? (int) DECL_UID(b->var) : 0;
+  }
+  if ((TREE_CODE(op) != SSA_NAME) ||
+      (TREE_CODE(SSA_NAME_VAR(op)) == PARM_DECL))
+    return 0;
+  LL_FOREACH(block_values, v) {
+    if (v->var == SSA_NAME_VAR(op))
+      return v->block;
+  }
+  return UNSET_BLOCK;
+}
+
+/**
+ * @brief Find the array whose exponent scales the result of an operation.
+ *
+ * @details Operands whose variables have not been seen are ignored. A result
+ * of zero when an operand is scaled means that the operand must be shifted
+ * to remove its exponent.
+ *
+ * @param[in] code   tree code of the operation
+ * @param[in] blocks the block of each operand, from operand_block()
+ * @param[in] n      number of operands, including the LHS
+ * @return    DECL_UID of the array, zero, or UNSET_BLOCK
+ */
+static int result_block(enum tree_code code, int blocks[], int n)
+{
+  int i, block = UNSET_BLOCK, scaled = 0;
+
+  switch (code) {
+    case SSA_NAME:
+    case VAR_DECL:
+    case ARRAY_REF:
+    case NOP_EXPR:
+    case CONVERT_EXPR:
+    case NEGATE_EXPR:
+    case PLUS_EXPR:
+    case MINUS_EXPR:
+    case MIN_EXPR:
+    case MAX_EXPR:
+      for (i = 1; i < n; i++) {
+        if (blocks[i] == UNSET_BLOCK)
+          continue;
+        if ((block != UNSET_BLOCK) && (block != blocks[i]))
+          return 0;
+        block = blocks[i];
+      }
+      return block;
+    case MULT_EXPR:
+    case RDIV_EXPR:
+    case TRUNC_DIV_EXPR:
+      for (i = 1; i < n; i++) {
+        if (blocks[i] > 0) {
+          scaled++;
+          block = blocks[i];
+        } else if ((blocks[i] == 0) && (block == UNSET_BLOCK)) {
+          block = 0;
+        }
+      }
+      // a divisor must not be scaled
+      if ((scaled > 1) || ((code != MULT_EXPR) && (blocks[2] > 0)))
+        return 0;
+      return block;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Find the array whose exponent scales the result of a statement.
+ *
+ * @param[in] stmt    a GIMPLE assignment
+ * @param[out] blocks set to the block of each operand
+ * @return    DECL_UID of the array, zero, or UNSET_BLOCK
+ */
+static int statement_block(gimple stmt, int blocks[])
+{
+  int i, n = gimple_num_ops(stmt);
+
+  for (i = 1; i < n; i++)
+    blocks[i] = operand_block(gimple_op(stmt, i));
+  return result_block(gimple_assign_rhs_code(stmt), blocks, n);
+}
+
+/**
+ * @brief Combine a new definition with the block of a variable.
+ *
+ * @param[in] var   gcc tree for the variable's declaration
+ * @param[in] block the block of the value assigned to it
+ * @return    true if the variable's block changed
+ */
+static bool merge_block_value(tree var, int block)
+{
+  struct BLOCK_VALUE *v;
+
+  if (block == UNSET_BLOCK)
+    return false;
+  LL_FOREACH(block_values, v) {
+    if (v->var == var) {
+      if ((v->block == block) || (v->block == 0))
+        return false;
+      v->block = 0;             // scaled by different exponents, or not at all
+      return true;
+    }
+  }
+  v = (struct BLOCK_VALUE *) xmalloc(sizeof(struct BLOCK_VALUE));
+  v->var = var;
+  v->block = block;
+  LL_PREPEND(block_values, v);
+  return true;
+}
+
+/**
+ * @brief Find the variables that hold values scaled by a block's exponent.
+ *
+ * @details A variable is scaled only if every value assigned to it is scaled
+ * by the same exponent. A variable that is used other than in an assignment,
+ * by a return, a call or a condition, is not scaled.
+ */
+static void find_block_values()
+{
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  bool changed;
+
+  do {
+    changed = false;
+    FOR_EACH_BB(bb) {
+      for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+        gimple stmt = gsi_stmt(gsi);
+        if (is_gimple_debug(stmt))
+          continue;
+        if (is_gimple_assign(stmt)) {
+          tree lhs = gimple_assign_lhs(stmt);
+          int blocks[gimple_num_ops(stmt)];
+          if (TREE_CODE(lhs) == SSA_NAME)
+            changed |= merge_block_value(SSA_NAME_VAR(lhs),
+                                         statement_block(stmt, blocks));
+        } else {
+          ssa_op_iter iter;
+          tree use;
+          FOR_EACH_SSA_TREE_OPERAND(use, stmt, iter, SSA_OP_USE) {
+            changed |= merge_block_value(SSA_NAME_VAR(use), 0);
+          }
+        }
+      }
+    }
+  } while (changed);
+
+  if (LOG_ENABLED(2)) {
+    struct BLOCK_VALUE *v;
+    LL_FOREACH(block_values, v) {
+      if (v->block > 0 && DECL_NAME(v->var))
+        FXLOG(2, "  %s is scaled by a block exponent\n",
+              IDENTIFIER_POINTER(DECL_NAME(v->var)));
+    }
+  }
+}
+
+/**
+ * @brief Find the arrays of the current function that have the fxblock
+ * attribute, and the variables that hold values scaled by their exponents.
+ *
+ * @details Called before the formats of the declared variables are set,
+ * because all of the elements of an fxblock array share one format.
+ */
+void find_block_arrays()
+{
+  tree var;
+  referenced_var_iterator rvi;
+  struct BLOCK_ARRAY *b, *btmp;
+  struct BLOCK_VALUE *v, *vtmp;
+
+  LL_FOREACH_SAFE(block_arrays, b, btmp) {
+    LL_DELETE(block_arrays, b);
+    free(b);
+  }
+  LL_FOREACH_SAFE(block_values, v, vtmp) {
+    LL_DELETE(block_values, v);
+    free(v);
+  }
+
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    tree attr = lookup_attribute("fxblock", DECL_ATTRIBUTES(var));
+    if (attr == NULL_TREE)
+      continue;
+    if ((TREE_CODE(var) != VAR_DECL) || TREE_STATIC(var) ||
+        (TREE_CODE(TREE_TYPE(var)) != ARRAY_TYPE) ||
+        (TREE_CODE(get_innermost_type(var)) != REAL_TYPE)) {
+      warning(0, G_("fxopt: fxblock ignored, %qs is not a local real array"),
+              DECL_NAME(var) ? IDENTIFIER_POINTER(DECL_NAME(var)) : "");
+      continue;
+    }
+    if (lookup_attribute("fxfrmt", DECL_ATTRIBUTES(var)) == NULL_TREE) {
+      error("fxopt: fxblock array %qs needs an fxfrmt attribute",
+            IDENTIFIER_POINTER(DECL_NAME(var)));
+      continue;
+    }
+    //
+    // The attribute handler has checked that the guard bits are a constant,
+    //   but not that they fit in the elements
+    //
+    int guard = 1;
+    if (TREE_VALUE(attr) != NULL_TREE)
+      guard = TREE_INT_CST_LOW(TREE_VALUE(TREE_VALUE(attr)));
+    if (guard >= var_word_size(var)) {
+      error("fxopt: fxblock array %qs has more guard bits than its %d-bit "
+            "elements", IDENTIFIER_POINTER(DECL_NAME(var)),
+            var_word_size(var));
+      continue;
+    }
+    b = (struct BLOCK_ARRAY *) xmalloc(sizeof(struct BLOCK_ARRAY));
+    b->var = var;
+    b->guard = guard;
+    b->exponent = NULL_TREE;
+    LL_PREPEND(block_arrays, b);
+    FXLOG(1, "  %s shares a block exponent, %d guard bits\n",
+          IDENTIFIER_POINTER(DECL_NAME(var)), b->guard);
+  }
+  if (block_arrays != NULL)
+    find_block_values();
+}
+
+/**
+ * @brief Get the run-time exponent of a block, creating it if necessary.
+ *
+ * @details The exponent is assigned again at each normalization, so its name
+ * is kept out of the _fx_ namespace: the passes that run after the conversion
+ * take an _fx_ temporary to hold one value.
+ */
+static tree block_exponent(struct BLOCK_ARRAY *b)
+{
+  if (b->exponent == NULL_TREE)
+    b->exponent = make_rename_temp(integer_type_node, "fxblock_exp");
+  return b->exponent;
+}
+
+/**
+ * @brief Insert a statement before the current one.
+ *
+ * @return the new temporary that holds the statement's result
+ */
+static tree insert_block_stmt(gimple_stmt_iterator * gsi_p,
+                              enum tree_code code, tree type, tree op1,
+                              tree op2)
+{
+  tree var = make_rename_temp(type, "_fx_block0");
+  gimple new_stmt = gimple_build_assign_with_ops(code, var, op1, op2);
+
+  gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return var;
+}
+
+/**
+ * @brief Give a new temporary the format it would have had in the first
+ * pass, so that the statement that uses it can find its format.
+ */
+static void set_block_temp_format(tree temp, struct SIF fmt)
+{
+  struct SIF *temp_fmt = find_var_format(calc_hash_key(temp, 0,
+                                                       NOT_AN_ARRAY));
+  copy_SIF(&fmt, temp_fmt);
+  temp_fmt->size = fmt.size;
+  temp_fmt->sgnd = fmt.sgnd;
+}
+
+/**
+ * @brief Remove the exponent from a scaled operand.
+ *
+ * @details The operand is shifted right by the exponent. Its format is not
+ * changed, since the shift can only make it smaller.
+ *
+ * @param[in] gsi_p    statement iterator, points to the statement
+ * @param[in] opnumber the operand to shift
+ * @param[in] b        the array whose exponent scales the operand
+ */
+static void remove_exponent(gimple_stmt_iterator * gsi_p, int opnumber,
+                            struct BLOCK_ARRAY *b)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  struct SIF fmt = get_operand_format(stmt, opnumber, 0, NOPRINT);
+  tree op = gimple_op(stmt, opnumber);
+  tree type = TREE_TYPE(op);
+
+  if (!is_gimple_reg(op)) {
+    tree loaded = make_rename_temp(type, "_fx_block0");
+    gimple new_stmt = gimple_build_assign(loaded, op);
+    gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+    FXLOG_STMT(2, new_stmt);
+    op = loaded;
+  }
+  op = insert_block_stmt(gsi_p, RSHIFT_EXPR, type, op, block_exponent(b));
+  set_block_temp_format(op, fmt);
+  gimple_set_op(stmt, opnumber, op);
+  update_stmt(stmt);
+}
+
+/**
+ * @brief Scale a value that is stored into a block.
+ *
+ * @details The value is aligned with the block's binary point, saturated so
+ * that it cannot overflow, and shifted left by the exponent.
+ *
+ * @param[in] gsi_p     statement iterator, points to the store
+ * @param[in] block_fmt format of the block, from its fxfrmt attribute
+ * @param[in] b         the array that the value is stored into
+ */
+static void apply_exponent(gimple_stmt_iterator * gsi_p,
+                           struct SIF block_fmt, struct BLOCK_ARRAY *b)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  struct SIF fmt = get_operand_format(stmt, 1, 0, NOPRINT);
+  tree op = gimple_op(stmt, 1);
+  tree type = TREE_TYPE(op);
+  tree count = block_exponent(b);
+  tree limit, neg_limit;
+  int shift = (block_fmt.S + block_fmt.I) - (fmt.S + fmt.I);
+
+  if (shift > 0)
+    op = insert_block_stmt(gsi_p, RSHIFT_EXPR, type, op,
+                           build_int_cst(integer_type_node, shift));
+  else if (shift < 0)
+    count = insert_block_stmt(gsi_p, PLUS_EXPR, integer_type_node, count,
+                              build_int_cst(integer_type_node, -shift));
+  limit = insert_block_stmt(gsi_p, RSHIFT_EXPR, type,
+                            double_int_to_tree(type, block_fmt.max), count);
+  op = insert_block_stmt(gsi_p, MIN_EXPR, type, op, limit);
+  neg_limit = insert_block_stmt(gsi_p, NEGATE_EXPR, type, limit, NULL);
+  op = insert_block_stmt(gsi_p, MAX_EXPR, type, op, neg_limit);
+  op = insert_block_stmt(gsi_p, LSHIFT_EXPR, type, op, count);
+
+  block_fmt.shift = block_fmt.has_attribute = block_fmt.ptr_op = 0;
+  block_fmt.alias = 0;
+  set_block_temp_format(op, block_fmt);
+  gimple_set_op(stmt, 1, op);
+  update_stmt(stmt);
+}
+
+/**
+ * @brief Insert the shifts that a statement needs for block exponents.
+ *
+ * @details Called in the last pass, before the statement is converted.
+ * Scaled operands whose exponent does not carry through to the LHS are
+ * shifted right by it, and a value stored into a block from elsewhere is
+ * shifted left by the block's exponent.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * D.2011_9 = buf[k_3];
+ * buf[k_3] = D.2014_12;
+ * out[k_3] = D.2011_9;
+ * @endcode
+ *
+ * @param[in] gsi_p statement iterator, points to the statement
+ * @param[in] oprnd_frmt format of the LHS in oprnd_frmt[0]
+ */
+void block_scaling(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[])
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree lhs = gimple_assign_lhs(stmt);
+  int i, n = gimple_num_ops(stmt);
+  int blocks[n], result, dest;
+
+  if (block_arrays == NULL)
+    return;
+  result = statement_block(stmt, blocks);
+  dest = operand_block(lhs);
+  if ((result > 0) && (result == dest))
+    return;                     // the exponent carries through
+
+  for (i = 1; i < n; i++) {
+    if (blocks[i] > 0) {
+      FXLOG(2, "  Removing the block exponent from operand %d\n", i);
+      remove_exponent(gsi_p, i, find_block_uid(blocks[i]));
+    }
+  }
+  if ((dest > 0) && (TREE_CODE(lhs) != SSA_NAME)) {
+    FXLOG(2, "  Applying the block exponent to the stored value\n");
+    apply_exponent(gsi_p, oprnd_frmt[0],
+                   find_block_array(get_operand_decl(lhs)));
+  }
+}
+
+/**
+ * @brief Replace each call of fxblock_normalize() with a call that
+ * normalizes the block, and start each block's exponent at zero.
+ *
+ * @details Called after the last pass, when the arrays have integer types.
+ */
+void insert_block_normalization()
+{
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  struct BLOCK_ARRAY *b;
+  tree fn = NULL_TREE;
+
+  if (block_arrays == NULL)
+    return;
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      tree fndecl, arg, count;
+      gimple new_stmt;
+      if (!is_gimple_call(stmt) || (gimple_call_num_args(stmt) != 1))
+        continue;
+      fndecl = gimple_call_fndecl(stmt);
+      if ((fndecl == NULL_TREE) || (DECL_NAME(fndecl) == NULL_TREE) ||
+          strcmp(IDENTIFIER_POINTER(DECL_NAME(fndecl)), NORMALIZE_MARKER))
+        continue;
+      arg = gimple_call_arg(stmt, 0);
+      b = NULL;
+      if (TREE_CODE(arg) == ADDR_EXPR)
+        b = find_block_array(get_base_address(TREE_OPERAND(arg, 0)));
+      if (b == NULL) {
+        warning(0, G_("fxopt: %s of an array without fxblock is ignored"),
+                NORMALIZE_MARKER);
+        continue;
+      }
+      if (fn == NULL_TREE)
+        fn = build_fn_decl(NORMALIZE_FUNCTION,
+                           build_function_type_list(integer_type_node,
+                                                    ptr_type_node,
+                                                    integer_type_node,
+                                                    integer_type_node,
+                                                    integer_type_node,
+                                                    integer_type_node,
+                                                    NULL_TREE));
+      //
+      // The elements of an array of arrays are normalized as one block
+      //
+      tree element_type = strip_array_types(TREE_TYPE(b->var));
+      int elements = int_size_in_bytes(TREE_TYPE(b->var)) /
+          int_size_in_bytes(element_type);
+      const struct SIF *block_fmt =
+          get_format_ptr(calc_hash_key(b->var, 0, NOT_AN_ARRAY));
+      int headroom = b->guard + (block_fmt ? block_fmt->attrS - 1 : 0);
+      //
+      // The new call reads and writes the block, so it takes over the
+      //   virtual operands of the call it replaces
+      //
+      count = make_rename_temp(integer_type_node, "_fx_bnorm0");
+      new_stmt = gimple_build_call(fn, 5, arg,
+                   build_int_cst(integer_type_node, elements),
+                   build_int_cst(integer_type_node,
+                                 int_size_in_bytes(element_type)),
+                   build_int_cst(integer_type_node, headroom),
+                   block_exponent(b));
+      gimple_call_set_lhs(new_stmt, count);
+      gimple_set_vuse(new_stmt, gimple_vuse(stmt));
+      gimple_set_vdef(new_stmt, gimple_vdef(stmt));
+      if (gimple_vdef(stmt) && (TREE_CODE(gimple_vdef(stmt)) == SSA_NAME))
+        SSA_NAME_DEF_STMT(gimple_vdef(stmt)) = new_stmt;
+      gsi_replace(&gsi, new_stmt, false);
+      FXLOG_STMT(2, new_stmt);
+      new_stmt = gimple_build_assign_with_ops(PLUS_EXPR, b->exponent,
+                                              b->exponent, count);
+      gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
+      FXLOG_STMT(2, new_stmt);
+    }
+  }
+  //
+  // Every exponent that was used starts at zero
+  //
+  gsi = gsi_after_labels(single_succ(ENTRY_BLOCK_PTR));
+  LL_FOREACH(block_arrays, b) {
+    if (b->exponent != NULL_TREE) {
+      gimple new_stmt = gimple_build_assign(b->exponent, integer_zero_node);
+      gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
+      FXLOG_STMT(2, new_stmt);
+    }
+  }
+}
+
+// vim:syntax=c.doxygen
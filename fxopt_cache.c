@@ -0,0 +1,491 @@
+/**
+ * @file fxopt_cache.c
+ *
+ * @brief  Functions for saving and restoring solved fixed-point formats
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-05T10:07:44-0500
+ * @date Last modified: 2014-01-08T09:53:24-0500
+ *
+ * @details  Finding the formats of all of the variables in a function takes
+ *           many passes through the function. If the function, its variable
+ *           declarations, and the plugin options are exactly the same as in
+ *           an earlier compilation then the formats will be the same as well.
+ *           When a cache directory is given, the solved formats are saved in a
+ *           binary file whose name is a hash of everything that could change
+ *           them, and a later compilation can restore them from that file and
+ *           go directly to the last pass that rewrites the function.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "utlist.h"
+
+/**
+ * @brief Changed whenever the layout of a cache file or the meaning of a
+ * format changes, so that stale files are never used.
+ */
+#define CACHE_VERSION 2
+
+/**
+ * @brief First bytes of every cache file.
+ */
+static const char cache_magic[8] = "FXOPTC\0\0";
+
+/**
+ * @brief Header at the start of a cache file.
+ */
+struct CACHE_HEADER {
+  char magic[8];        ///< Always ::cache_magic
+  uint64_t key;         ///< Hash of the function, see function_cache_key()
+  int32_t version;      ///< ::CACHE_VERSION
+  int32_t sif_size;     ///< sizeof(struct SIF) of the plugin that wrote it
+  int32_t fxpass;       ///< Pass count when the formats were resolved
+  int32_t next_error_id;  ///< Next unused affine error term ID
+  int32_t formats;      ///< Number of format records that follow
+};
+
+/**
+ * @brief One affine term of a format record.
+ */
+struct CACHE_TERM {
+  fxkey_t id;           ///< Hash key of the term's variable
+  double_int coeff;     ///< Coefficient of the term
+  int32_t bp;           ///< Binary point location of the coefficient
+};
+
+//
+// The 64-bit FNV-1a hash
+//
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+static void hash_bytes(uint64_t *h, const void *p, size_t n)
+{
+  const unsigned char *b = (const unsigned char *) p;
+  while (n-- > 0) {
+    *h ^= *b++;
+    *h *= FNV_PRIME;
+  }
+}
+
+static void hash_int(uint64_t *h, HOST_WIDE_INT value)
+{
+  hash_bytes(h, &value, sizeof(value));
+}
+
+static void hash_string(uint64_t *h, const char *s)
+{
+  hash_bytes(h, s, strlen(s) + 1);
+}
+
+/**
+ * @brief Add a type to a hash.
+ *
+ * @details The type's code, size and precision are hashed, along with the
+ * bounds of an array and the type that an array or pointer refers to.
+ *
+ * @param[in,out] h    the hash
+ * @param[in]     type gcc tree for the type
+ */
+static void hash_type(uint64_t *h, tree type)
+{
+  for (; type != NULL_TREE; type = TREE_TYPE(type)) {
+    hash_int(h, TREE_CODE(type));
+    hash_int(h, TYPE_PRECISION(type));
+    hash_int(h, TYPE_UNSIGNED(type));
+    if (TYPE_SIZE(type) && (INTEGER_CST == TREE_CODE(TYPE_SIZE(type))))
+      hash_int(h, TREE_INT_CST_LOW(TYPE_SIZE(type)));
+    if ((ARRAY_TYPE == TREE_CODE(type)) && TYPE_DOMAIN(type)) {
+      tree domain = TYPE_DOMAIN(type);
+      if (TYPE_MIN_VALUE(domain) &&
+          (INTEGER_CST == TREE_CODE(TYPE_MIN_VALUE(domain))))
+        hash_int(h, TREE_INT_CST_LOW(TYPE_MIN_VALUE(domain)));
+      if (TYPE_MAX_VALUE(domain) &&
+          (INTEGER_CST == TREE_CODE(TYPE_MAX_VALUE(domain))))
+        hash_int(h, TREE_INT_CST_LOW(TYPE_MAX_VALUE(domain)));
+    }
+    if ((ARRAY_TYPE != TREE_CODE(type)) &&
+        (POINTER_TYPE != TREE_CODE(type)) &&
+        (REFERENCE_TYPE != TREE_CODE(type)))
+      break;
+  }
+}
+
+/**
+ * @brief Add an operand to a hash.
+ *
+ * @details Declarations are identified by their UID and SSA names by the UID
+ * of their variable and their version, since these are the values that are
+ * used in the hash keys of the saved formats. Constants are hashed by value,
+ * and any other tree by its code, its type and its operands.
+ *
+ * @param[in,out] h the hash
+ * @param[in]     t gcc tree for the operand
+ */
+static void hash_tree(uint64_t *h, tree t)
+{
+  int i;
+
+  if (t == NULL_TREE) {
+    hash_int(h, -1);
+    return;
+  }
+  hash_int(h, TREE_CODE(t));
+
+  switch (TREE_CODE(t)) {
+  case SSA_NAME:
+    hash_int(h, DECL_UID(SSA_NAME_VAR(t)));
+    hash_int(h, SSA_NAME_VERSION(t));
+    return;
+  case INTEGER_CST:
+    hash_type(h, TREE_TYPE(t));
+    hash_int(h, TREE_INT_CST_LOW(t));
+    hash_int(h, TREE_INT_CST_HIGH(t));
+    return;
+  case REAL_CST: {
+      long target[4];
+      memset(target, 0, sizeof(target));
+      real_to_target(target, TREE_REAL_CST_PTR(t), TYPE_MODE(TREE_TYPE(t)));
+      hash_type(h, TREE_TYPE(t));
+      hash_bytes(h, target, sizeof(target));
+      return;
+    }
+  case CONSTRUCTOR: {
+      unsigned HOST_WIDE_INT ix;
+      tree field, val;
+      FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(t), ix, field, val) {
+        hash_tree(h, field);
+        hash_tree(h, val);
+      }
+      return;
+    }
+  default:
+    break;
+  }
+
+  if (DECL_P(t)) {
+    hash_int(h, DECL_UID(t));
+    return;
+  }
+  if (TREE_TYPE(t) && TYPE_P(TREE_TYPE(t)))
+    hash_type(h, TREE_TYPE(t));
+  if (EXPR_P(t)) {
+    for (i = 0; i < TREE_OPERAND_LENGTH(t); i++)
+      hash_tree(h, TREE_OPERAND(t, i));
+  }
+}
+
+/**
+ * @brief Add a GIMPLE statement to a hash.
+ *
+ * @param[in,out] h    the hash
+ * @param[in]     stmt the statement
+ */
+static void hash_stmt(uint64_t *h, gimple stmt)
+{
+  unsigned i;
+
+  hash_int(h, gimple_code(stmt));
+  hash_int(h, gimple_expr_code(stmt));
+  hash_int(h, gimple_num_ops(stmt));
+  for (i = 0; i < gimple_num_ops(stmt); i++)
+    hash_tree(h, gimple_op(stmt, i));
+}
+
+/**
+ * @brief Calculate the cache key for the current function.
+ *
+ * @details The key is a hash of the plugin options, the declarations of all
+ * of the function's variables (including their types, their initial values
+ * and their fxfrmt and fxiter attributes), and the function body: the
+ * control flow graph, the PHI nodes and all of the GIMPLE statements. It must
+ * be calculated before the function is modified in the last pass.
+ *
+ * @return the cache key
+ */
+uint64_t function_cache_key()
+{
+  uint64_t h = FNV_OFFSET;
+  tree var;
+  referenced_var_iterator rvi;
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  edge e;
+  edge_iterator ei;
+
+  hash_int(&h, CACHE_VERSION);
+  hash_int(&h, sizeof(struct SIF));
+  hash_int(&h, INTERVAL);
+  hash_int(&h, AFFINE);
+  hash_int(&h, GUARDING);
+  hash_int(&h, ROUNDING);
+  hash_int(&h, POSITIVE);
+  hash_int(&h, DBL_PRECISION_MULTS);
+  hash_int(&h, CONST_DIV_TO_MULT);
+  hash_int(&h, ACCUMULATE);
+  hash_int(&h, AFFINE_MAX_TERMS);
+  hash_int(&h, UNIFORM);
+  hash_int(&h, WIDEN_DELAY);
+  hash_int(&h, NARROWING);
+  hash_int(&h, var_word_size(NULL_TREE));
+  hash_int(&h, (HOST_WIDE_INT) (SQNR_TARGET * 1000.0));
+  hash_int(&h, PROFILE_USE ? PROFILE_MARGIN : -1);
+
+  hash_tree(&h, current_function_decl);
+  hash_type(&h, TREE_TYPE(DECL_RESULT(current_function_decl)));
+
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    hash_int(&h, TREE_CODE(var));
+    hash_int(&h, DECL_UID(var));
+    hash_type(&h, TREE_TYPE(var));
+    if (TREE_CODE(var) == VAR_DECL)
+      hash_tree(&h, DECL_INITIAL(var));
+    tree attr;
+    for (attr = DECL_ATTRIBUTES(var); attr != NULL_TREE;
+         attr = TREE_CHAIN(attr)) {
+      tree arg;
+      hash_string(&h, IDENTIFIER_POINTER(TREE_PURPOSE(attr)));
+      for (arg = TREE_VALUE(attr); arg != NULL_TREE; arg = TREE_CHAIN(arg))
+        hash_tree(&h, TREE_VALUE(arg));
+    }
+    double lo, hi;
+    if (PROFILE_USE && profiled_range(var, &lo, &hi)) {
+      hash_bytes(&h, &lo, sizeof(lo));
+      hash_bytes(&h, &hi, sizeof(hi));
+    }
+    if (IPA_SUMMARY_FILE && (TREE_CODE(var) == PARM_DECL) &&
+        ipa_param_range(var, &lo, &hi)) {
+      hash_bytes(&h, &lo, sizeof(lo));
+      hash_bytes(&h, &hi, sizeof(hi));
+    }
+  }
+
+  FOR_EACH_BB(bb) {
+    hash_int(&h, bb->index);
+    FOR_EACH_EDGE(e, ei, bb->succs) {
+      hash_int(&h, e->dest->index);
+      hash_int(&h, e->flags);
+    }
+    for (gsi = gsi_start_phis(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple phi = gsi_stmt(gsi);
+      unsigned i;
+      hash_tree(&h, gimple_phi_result(phi));
+      for (i = 0; i < gimple_phi_num_args(phi); i++) {
+        hash_int(&h, gimple_phi_arg_edge(phi, i)->src->index);
+        hash_tree(&h, gimple_phi_arg_def(phi, i));
+      }
+    }
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      hash_stmt(&h, gsi_stmt(gsi));
+      hash_int(&h, ipa_call_signature(gsi_stmt(gsi)));
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief Build the name of the cache file for a key.
+ *
+ * @param[in] key the cache key
+ * @return    the file name, which must be freed by the caller
+ */
+static char *cache_file_name(uint64_t key)
+{
+  char *name = (char *) xmalloc(strlen(FORMAT_CACHE_DIR) + 32);
+  sprintf(name, "%s/%016llx.fxc", FORMAT_CACHE_DIR, (unsigned long long) key);
+  return name;
+}
+
+/**
+ * @brief Save the formats of the current function in the cache.
+ *
+ * @details Every ::SIF format in the store, including its affine definition,
+ * is written to the cache file for the key. The file is written under a
+ * temporary name and then renamed, so that a concurrent compilation never
+ * reads a partial file. Failing to write the cache only causes a warning.
+ *
+ * @param[in] key the cache key, from function_cache_key()
+ */
+void save_cached_formats(uint64_t key)
+{
+  struct CACHE_HEADER header;
+  struct CACHE_TERM term;
+  struct SIF *s;
+  struct SIF record;
+  struct AA *aa_elt_p;
+  char *name, *temp_name;
+  FILE *cache_file;
+  int32_t terms;
+  int ok = 1;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, cache_magic, sizeof(header.magic));
+  header.key = key;
+  header.version = CACHE_VERSION;
+  header.sif_size = sizeof(struct SIF);
+  header.fxpass = fxctx->fxpass;
+  header.next_error_id = fxctx->next_error_id;
+  for (s = first_var_format(); s != NULL; s = next_var_format(s))
+    header.formats++;
+
+  name = cache_file_name(key);
+  temp_name = (char *) xmalloc(strlen(name) + 16);
+  sprintf(temp_name, "%s.%d", name, (int) getpid());
+  cache_file = fopen(temp_name, "wb");
+  if (NULL == cache_file) {
+    warning(0, G_("fxopt: cannot write format cache %qs"), temp_name);
+    free(temp_name);
+    free(name);
+    return;
+  }
+
+  ok = (fwrite(&header, sizeof(header), 1, cache_file) == 1);
+  for (s = first_var_format(); ok && (s != NULL); s = next_var_format(s)) {
+    record = *s;
+    record.aa = NULL;
+    ok = (fwrite(&record, sizeof(record), 1, cache_file) == 1);
+    terms = 0;
+    DL_FOREACH(s->aa, aa_elt_p)
+      terms++;
+    ok = ok && (fwrite(&terms, sizeof(terms), 1, cache_file) == 1);
+    DL_FOREACH(s->aa, aa_elt_p) {
+      memset(&term, 0, sizeof(term));
+      term.id = aa_elt_p->id;
+      term.coeff = aa_elt_p->coeff;
+      term.bp = aa_elt_p->bp;
+      ok = ok && (fwrite(&term, sizeof(term), 1, cache_file) == 1);
+    }
+  }
+  if (fclose(cache_file) != 0)
+    ok = 0;
+
+  if (ok && (rename(temp_name, name) == 0)) {
+    FXLOG(1, "  ===== Formats saved in %s =====\n", name);
+  } else {
+    warning(0, G_("fxopt: cannot write format cache %qs"), name);
+    remove(temp_name);
+  }
+  free(temp_name);
+  free(name);
+}
+
+/**
+ * @brief Restore the formats of the current function from the cache.
+ *
+ * @details If there is a cache file for the key then the whole file is read
+ * and checked before anything is changed. The formats in the store are then
+ * replaced by those in the file, and the pass count and the next affine error
+ * term ID are restored. A missing or damaged file leaves the store unchanged.
+ *
+ * @param[in] key the cache key, from function_cache_key()
+ * @return    true if the formats were restored
+ */
+bool load_cached_formats(uint64_t key)
+{
+  struct CACHE_HEADER header;
+  struct CACHE_TERM term;
+  struct SIF record;
+  char *name, *buffer, *p, *end;
+  FILE *cache_file;
+  long length;
+  int32_t terms;
+  int i, j, pass;
+
+  name = cache_file_name(key);
+  cache_file = fopen(name, "rb");
+  if (NULL == cache_file) {
+    free(name);
+    return false;
+  }
+  buffer = NULL;
+  length = -1;
+  if (fseek(cache_file, 0, SEEK_END) == 0)
+    length = ftell(cache_file);
+  if ((length >= (long) sizeof(header)) &&
+      (fseek(cache_file, 0, SEEK_SET) == 0)) {
+    buffer = (char *) xmalloc(length);
+    if (fread(buffer, 1, length, cache_file) != (size_t) length) {
+      free(buffer);
+      buffer = NULL;
+    }
+  }
+  fclose(cache_file);
+  if (NULL == buffer) {
+    warning(0, G_("fxopt: cannot read format cache %qs"), name);
+    free(name);
+    return false;
+  }
+  //
+  // Check the header and walk the records once to make sure that the whole
+  // file is present before the store is touched
+  //
+  memcpy(&header, buffer, sizeof(header));
+  end = buffer + length;
+  p = buffer + sizeof(header);
+  int valid = (memcmp(header.magic, cache_magic, sizeof(header.magic)) == 0)
+      && (header.key == key) && (header.version == CACHE_VERSION)
+      && (header.sif_size == (int32_t) sizeof(struct SIF))
+      && (header.fxpass > 0) && (header.fxpass < MAX_PASSES)
+      && (header.formats >= 0);
+  for (i = 0; valid && (i < header.formats); i++) {
+    if (end - p < (long) (sizeof(record) + sizeof(terms))) {
+      valid = 0;
+      break;
+    }
+    memcpy(&record, p, sizeof(record));
+    memcpy(&terms, p + sizeof(record), sizeof(terms));
+    p += sizeof(record) + sizeof(terms);
+    pass = KEY_TO_PASS(record.id);
+    if ((KEY_TO_UID(record.id) <= 0) || (pass > header.fxpass) ||
+        (record.elements < 1) ||
+        (KEY_TO_IDX(record.id) + record.elements > MAX_ELEMENTS) ||
+        (terms < 0) || ((end - p) / (long) sizeof(term) < terms)) {
+      valid = 0;
+      break;
+    }
+    p += terms * sizeof(term);
+  }
+  if (!valid || (p != end)) {
+    warning(0, G_("fxopt: ignoring damaged format cache %qs"), name);
+    free(buffer);
+    free(name);
+    return false;
+  }
+  //
+  // Replace the formats in the store with those from the file
+  //
+  delete_all_formats();
+  p = buffer + sizeof(header);
+  for (i = 0; i < header.formats; i++) {
+    memcpy(&record, p, sizeof(record));
+    memcpy(&terms, p + sizeof(record), sizeof(terms));
+    p += sizeof(record) + sizeof(terms);
+    struct SIF *s = add_run_format(record.id, record.elements);
+    *s = record;
+    s->aa = NULL;
+    for (j = 0; j < terms; j++) {
+      memcpy(&term, p, sizeof(term));
+      p += sizeof(term);
+      append_aa_var(&(s->aa), term.id, term.coeff, term.bp);
+    }
+  }
+  fxctx->fxpass = header.fxpass;
+  fxctx->next_error_id = header.next_error_id;
+
+  FXLOG(1, "  ===== Formats restored from %s =====\n", name);
+  free(buffer);
+  free(name);
+  return true;
+}
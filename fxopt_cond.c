@@ -0,0 +1,470 @@
+/**
+ * @file fxopt_cond.c
+ *
+ * @brief  Functions for converting comparisons of real values
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-15T09:12:44-0500
+ * @date Last modified: 2014-01-15T09:12:44-0500
+ *
+ * @details  A GIMPLE_COND that compares two real values is converted like an
+ *           operation that has no result. When one side is a constant, the
+ *           threshold is converted to the binary point of the variable, with
+ *           the rounding chosen so that the integer comparison gives exactly
+ *           the same answer as the real comparison, and no run-time shift is
+ *           needed:
+ * @code
+ *           if (x_3 > 1.5e+0)           x has 12 fraction bits
+ *           if (x_3 > 6144)
+ * @endcode
+ *           When both sides are variables they are extended to the same size
+ *           and their binary points are aligned by shifting the one with
+ *           fewer fraction bits left, into its redundant sign bits, after
+ *           extending both if it does not have enough.
+ *
+ *           A comparison with a constant also bounds the variable in each
+ *           branch. With -fplugin-arg-fxopt-branch-ranges, the uses of the
+ *           variable in the blocks that are only reached through one edge of
+ *           the branch are replaced by a new variable that is the minimum or
+ *           maximum of the variable and the threshold:
+ * @code
+ *           if (x_3 > 1.5e+0) goto <bb 3>; else goto <bb 4>;
+ *           <bb 4>:
+ *           _fx_edge0 = MIN_EXPR <x_3, 1.5e+0>;
+ * @endcode
+ *           The minimum does not change the value, since the branch was only
+ *           taken when x was not larger than the threshold, but it gives the
+ *           new variable a smaller range, and so a format with fewer integer
+ *           bits, than the variable has on the other path.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+
+/**
+ * @brief Find the ordered comparison that is equivalent to a comparison.
+ *
+ * @details Fixed-point values are never NaN, so an unordered comparison is
+ * the same as the ordered one.
+ *
+ * @param[in] code the comparison
+ * @return    the ordered comparison
+ */
+static enum tree_code ordered_comparison(enum tree_code code)
+{
+  switch (code) {
+    case UNLT_EXPR:
+      return LT_EXPR;
+    case UNLE_EXPR:
+      return LE_EXPR;
+    case UNGT_EXPR:
+      return GT_EXPR;
+    case UNGE_EXPR:
+      return GE_EXPR;
+    case UNEQ_EXPR:
+      return EQ_EXPR;
+    case LTGT_EXPR:
+      return NE_EXPR;
+    default:
+      return code;
+  }
+}
+
+/**
+ * @brief Predicate for a condition that compares real values.
+ *
+ * @details The conditions are marked before the formats are found, because
+ * the types of their operands are changed on the last pass.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @return    true if the statement is a GIMPLE_COND on real operands
+ */
+bool is_real_condition(gimple stmt)
+{
+  return (gimple_code(stmt) == GIMPLE_COND) && gimple_plf(stmt, GF_PLF_2);
+}
+
+/**
+ * @brief Replace a condition by a constant answer.
+ *
+ * @param[in] stmt   the GIMPLE_COND
+ * @param[in] answer the value of the condition
+ */
+static void fold_condition(gimple stmt, bool answer)
+{
+  FXLOG(2, "  Condition is always %s\n", answer ? "true" : "false");
+  if (!fxctx->lastpass)
+    return;
+  if (answer)
+    gimple_cond_make_true(stmt);
+  else
+    gimple_cond_make_false(stmt);
+  update_stmt(stmt);
+  FXLOG_STMT(2, stmt);
+}
+
+/**
+ * @brief Convert a real threshold to the binary point of the variable that
+ * it is compared with.
+ *
+ * @details The threshold is rounded toward the side that gives the same
+ * answer for every value of the variable: x > 2.7 is the same as x > 2 and
+ * x < 2.3 is the same as x < 3, if x is an integer. An equality test with a
+ * threshold that is not an integer has a constant answer, since x == 2.3 is
+ * false for every integer x. If the threshold is outside the range of the
+ * variable's type the condition also has a constant answer.
+ *
+ * @param[in]  type      integer type of the variable
+ * @param[in]  code      the comparison, with the variable on the left
+ * @param[in]  var_frmt  ::SIF structure of the variable
+ * @param[in]  threshold the REAL_CST
+ * @param[out] answer_p  set to the constant answer, if there is one
+ * @return     the integer threshold, or NULL_TREE if the answer is constant
+ */
+static tree convert_threshold(tree type, enum tree_code code,
+                              struct SIF *var_frmt, tree threshold,
+                              bool * answer_p)
+{
+  REAL_VALUE_TYPE real_const = TREE_REAL_CST(threshold);
+  REAL_VALUE_TYPE scaled_real, rounded_real, type_min, type_max;
+  HOST_WIDE_INT low, high;
+
+  real_ldexp(&scaled_real, &real_const, var_frmt->F + var_frmt->E);
+  switch (code) {
+    case GT_EXPR:
+    case LE_EXPR:
+      real_floor(&rounded_real, VOIDmode, &scaled_real);
+      break;
+    case LT_EXPR:
+    case GE_EXPR:
+      real_ceil(&rounded_real, VOIDmode, &scaled_real);
+      break;
+    default:
+      real_round(&rounded_real, VOIDmode, &scaled_real);
+      if (!real_identical(&rounded_real, &scaled_real)) {
+        *answer_p = (code == NE_EXPR);
+        return NULL_TREE;
+      }
+  }
+  //
+  // A threshold that does not fit in the variable is above or below every
+  // value of the variable
+  //
+  real_from_integer(&type_min, VOIDmode,
+                    TREE_INT_CST_LOW(TYPE_MIN_VALUE(type)),
+                    TREE_INT_CST_HIGH(TYPE_MIN_VALUE(type)),
+                    TYPE_UNSIGNED(type));
+  real_from_integer(&type_max, VOIDmode,
+                    TREE_INT_CST_LOW(TYPE_MAX_VALUE(type)),
+                    TREE_INT_CST_HIGH(TYPE_MAX_VALUE(type)),
+                    TYPE_UNSIGNED(type));
+  if (real_compare(LT_EXPR, &rounded_real, &type_min) ||
+      real_compare(GT_EXPR, &rounded_real, &type_max)) {
+    bool above = !real_isneg(&rounded_real);
+    switch (code) {
+      case LT_EXPR:
+      case LE_EXPR:
+        *answer_p = above;
+        break;
+      case GT_EXPR:
+      case GE_EXPR:
+        *answer_p = !above;
+        break;
+      default:
+        *answer_p = (code == NE_EXPR);
+    }
+    return NULL_TREE;
+  }
+  real_to_integer2(&low, &high, &rounded_real);
+  FXLOG(2, "  Threshold is " HOST_WIDE_INT_PRINT_DEC " with %d fraction"
+        " bits\n", low, var_frmt->F + var_frmt->E);
+  return build_int_cst_wide(type, low, high);
+}
+
+/**
+ * @brief Find the size in which two variables are compared.
+ *
+ * @param[in] bits number of bits needed
+ * @return    number of bits in the smallest integer type that has at least
+ *            that many, or in the widest integer type if none does
+ */
+static int comparison_size(int bits)
+{
+  tree candidates[] = { signed_char_type_node, short_integer_type_node,
+    integer_type_node, long_integer_type_node, long_long_integer_type_node,
+    int128_integer_type_node
+  };
+  int widest = 0;
+  unsigned i;
+
+  for (i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    if (candidates[i] == NULL_TREE)
+      continue;
+    widest = MAX(widest, (int) TYPE_PRECISION(candidates[i]));
+    if ((int) TYPE_PRECISION(candidates[i]) >= bits)
+      return TYPE_PRECISION(candidates[i]);
+  }
+  return widest;
+}
+
+/**
+ * @brief Insert the pending shift of one operand of a condition.
+ *
+ * @param[in] gsi_p     statement iterator, points to the GIMPLE_COND
+ * @param[in] oprnd_frmt ::SIF structure array for the two operands
+ * @param[in] oprnd_tree tree array for the two operands
+ * @param[in] opnumber   operand number, 0 or 1
+ */
+static void insert_condition_shift(gimple_stmt_iterator * gsi_p,
+                                   struct SIF oprnd_frmt[], tree oprnd_tree[],
+                                   int opnumber)
+{
+  int shift = oprnd_frmt[opnumber].shift;
+  tree shifted;
+  gimple new_stmt;
+
+  if (shift == 0)
+    return;
+  check_shift(oprnd_frmt[opnumber]);
+  shifted = make_rename_temp(TREE_TYPE(oprnd_tree[opnumber]), "_fx_cmp0");
+  new_stmt = gimple_build_assign_with_ops((shift > 0) ? RSHIFT_EXPR :
+                                          LSHIFT_EXPR, shifted,
+                                          oprnd_tree[opnumber],
+                                          build_int_cst(integer_type_node,
+                                                        abs(shift)));
+  gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  gimple_set_op(gsi_stmt(*gsi_p), opnumber, shifted);
+  oprnd_tree[opnumber] = shifted;
+}
+
+/**
+ * @brief Convert a condition that compares real values.
+ *
+ * @details The formats of the operands are not changed. On the last pass the
+ * constant threshold is replaced, or the operands are extended and shifted,
+ * and an unordered comparison is replaced by the ordered one.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * if (x_3 > 1.5e+0)
+ * if (D.1990_7 unord D.1990_7)
+ * if (peak_4 < level_9)
+ * @endcode
+ *
+ * @param[in] gsi_p statement iterator, points to the GIMPLE_COND
+ * @return    true if the formats of the operands are known
+ */
+bool condition(gimple_stmt_iterator * gsi_p)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  enum tree_code code = ordered_comparison(gimple_cond_code(stmt));
+  tree lhs = gimple_cond_lhs(stmt);
+  tree rhs = gimple_cond_rhs(stmt);
+  struct SIF oprnd_frmt[2];
+  tree oprnd_tree[2];
+  bool answer = false;
+
+  if ((code == ORDERED_EXPR) || (code == UNORDERED_EXPR)) {
+    fold_condition(stmt, code == ORDERED_EXPR);
+    return true;
+  }
+  if ((TREE_CODE(lhs) == REAL_CST) && (TREE_CODE(rhs) == REAL_CST)) {
+    fold_condition(stmt, real_compare(code, TREE_REAL_CST_PTR(lhs),
+                                      TREE_REAL_CST_PTR(rhs)));
+    return true;
+  }
+  initialize_format(&oprnd_frmt[0]);
+  initialize_format(&oprnd_frmt[1]);
+
+  if ((TREE_CODE(lhs) == REAL_CST) || (TREE_CODE(rhs) == REAL_CST)) {
+    //
+    // The variable is put on the left of the threshold
+    //
+    int var_op = (TREE_CODE(lhs) == REAL_CST) ? 1 : 0;
+    if (var_op == 1)
+      code = swap_tree_comparison(code);
+    oprnd_frmt[0] = get_operand_format(stmt, var_op, 0, PRINT);
+    if (!format_initialized(oprnd_frmt[0]))
+      return false;
+    if (!fxctx->lastpass)
+      return true;
+    tree var = gimple_op(stmt, var_op);
+    tree threshold = convert_threshold(TREE_TYPE(var), code, &oprnd_frmt[0],
+                                       gimple_op(stmt, 1 - var_op), &answer);
+    if (threshold == NULL_TREE) {
+      fold_condition(stmt, answer);
+      return true;
+    }
+    gimple_cond_set_lhs(stmt, var);
+    gimple_cond_set_rhs(stmt, threshold);
+  } else {
+    oprnd_tree[0] = lhs;
+    oprnd_tree[1] = rhs;
+    oprnd_frmt[0] = get_operand_format(stmt, 0, 0, PRINT);
+    oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
+    if (!format_initialized(oprnd_frmt[0]) ||
+        !format_initialized(oprnd_frmt[1]))
+      return false;
+    int size = MAX(oprnd_frmt[0].size, oprnd_frmt[1].size);
+    widen_operand(gsi_p, oprnd_frmt, oprnd_tree, 0, size);
+    widen_operand(gsi_p, oprnd_frmt, oprnd_tree, 1, size);
+    //
+    // Align the binary points by shifting the operand with fewer fraction
+    // bits left, so that no fraction bits are lost and close values compare
+    // the same as before. A comparison cannot overflow, so each operand only
+    // needs its own sign bit; if there are not enough redundant sign bits,
+    // both operands are extended first.
+    //
+    int hi = (BINARY_PT(0) > BINARY_PT(1)) ? 0 : 1;
+    int lo = 1 - hi;
+    int diff = BINARY_PT(hi) - BINARY_PT(lo);
+    if (diff > oprnd_frmt[lo].S - oprnd_frmt[lo].sgnd) {
+      size = comparison_size(size + diff -
+                             (oprnd_frmt[lo].S - oprnd_frmt[lo].sgnd));
+      widen_operand(gsi_p, oprnd_frmt, oprnd_tree, 0, size);
+      widen_operand(gsi_p, oprnd_frmt, oprnd_tree, 1, size);
+    }
+    if (diff > 0) {
+      int count = MIN(oprnd_frmt[lo].S - oprnd_frmt[lo].sgnd, diff);
+      if (count > 0)
+        shift_left(oprnd_frmt, oprnd_tree, lo, count);
+      //
+      // Only when there is no integer type wide enough are fraction bits
+      // discarded
+      //
+      if (count < diff)
+        shift_right(oprnd_frmt, oprnd_tree, hi, diff - count);
+    }
+    if (!fxctx->lastpass)
+      return true;
+    insert_condition_shift(gsi_p, oprnd_frmt, oprnd_tree, 0);
+    insert_condition_shift(gsi_p, oprnd_frmt, oprnd_tree, 1);
+  }
+  gimple_cond_set_code(stmt, code);
+  update_stmt(stmt);
+  FXLOG_STMT(2, stmt);
+  return true;
+}
+
+/**
+ * @brief Find the bound that a branch of a comparison places on a variable.
+ *
+ * @param[in] code       the comparison, with the variable on the left
+ * @param[in] true_value true for the edge taken when the comparison is true
+ * @return    MIN_EXPR if the variable is at most the threshold on the edge,
+ *            MAX_EXPR if it is at least the threshold, else ERROR_MARK
+ */
+static enum tree_code branch_bound(enum tree_code code, bool true_value)
+{
+  switch (code) {
+    case LT_EXPR:
+    case LE_EXPR:
+      return true_value ? MIN_EXPR : MAX_EXPR;
+    case GT_EXPR:
+    case GE_EXPR:
+      return true_value ? MAX_EXPR : MIN_EXPR;
+    default:
+      return ERROR_MARK;
+  }
+}
+
+/**
+ * @brief Give a variable a bounded copy in the blocks reached through one
+ * edge.
+ *
+ * @param[in] dest      the block at the end of the edge, which has no other
+ *                      predecessors
+ * @param[in] name      SSA name of the compared variable
+ * @param[in] threshold the REAL_CST it was compared with
+ * @param[in] bound     MIN_EXPR or MAX_EXPR
+ * @return    true if a copy was inserted
+ */
+static bool bound_on_edge(basic_block dest, tree name, tree threshold,
+                          enum tree_code bound)
+{
+  imm_use_iterator imm_iter;
+  use_operand_p use_p;
+  gimple use_stmt, new_stmt;
+  gimple_stmt_iterator gsi;
+  tree copy = NULL_TREE;
+
+  FOR_EACH_IMM_USE_STMT(use_stmt, imm_iter, name) {
+    //
+    // A PHI argument must keep the variable of the PHI result
+    //
+    if ((gimple_code(use_stmt) == GIMPLE_PHI) || is_gimple_debug(use_stmt) ||
+        !dominated_by_p(CDI_DOMINATORS, gimple_bb(use_stmt), dest))
+      continue;
+    if (copy == NULL_TREE) {
+      copy = make_rename_temp(TREE_TYPE(name), "_fx_edge0");
+      set_word_size(copy, var_word_size(SSA_NAME_VAR(name)));
+      new_stmt = gimple_build_assign_with_ops(bound, copy, name, threshold);
+      gsi = gsi_after_labels(dest);
+      gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
+      FXLOG_STMT(2, new_stmt);
+    }
+    FOR_EACH_IMM_USE_ON_STMT(use_p, imm_iter)
+      SET_USE(use_p, copy);
+    update_stmt(use_stmt);
+  }
+  return copy != NULL_TREE;
+}
+
+/**
+ * @brief Bound the variables compared with real constants in the branches
+ * of the comparisons.
+ *
+ * @details Called once for each function, before its formats are found.
+ * Only the blocks that are reached through a single edge of the comparison
+ * are changed, so where the paths join the variable has its full range.
+ */
+void refine_branch_ranges()
+{
+  basic_block bb;
+  edge e;
+  edge_iterator ei;
+  int bounded = 0;
+
+  FXLOG(1, "  ===== Bounding variables in branches =====\n");
+  calculate_dominance_info(CDI_DOMINATORS);
+  FOR_EACH_BB(bb) {
+    gimple stmt = last_stmt(bb);
+    if ((stmt == NULL) || (gimple_code(stmt) != GIMPLE_COND))
+      continue;
+    tree name = gimple_cond_lhs(stmt);
+    tree threshold = gimple_cond_rhs(stmt);
+    enum tree_code code = ordered_comparison(gimple_cond_code(stmt));
+    if (TREE_CODE(name) == REAL_CST) {
+      name = gimple_cond_rhs(stmt);
+      threshold = gimple_cond_lhs(stmt);
+      code = swap_tree_comparison(code);
+    }
+    if ((TREE_CODE(name) != SSA_NAME) || (TREE_CODE(threshold) != REAL_CST)
+        || !SCALAR_FLOAT_TYPE_P(TREE_TYPE(name)))
+      continue;
+    FOR_EACH_EDGE(e, ei, bb->succs) {
+      enum tree_code bound =
+          branch_bound(code, (e->flags & EDGE_TRUE_VALUE) != 0);
+      if ((bound != ERROR_MARK) && single_pred_p(e->dest) &&
+          (e->dest != EXIT_BLOCK_PTR) &&
+          bound_on_edge(e->dest, name, threshold, bound))
+        bounded++;
+    }
+  }
+  free_dominance_info(CDI_DOMINATORS);
+  FXLOG(1, "  %d variables bounded\n", bounded);
+}
+
+// vim:syntax=c.doxygen
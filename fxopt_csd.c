@@ -0,0 +1,317 @@
+/**
+ * @file fxopt_csd.c
+ *
+ * @brief  Functions for replacing constant multiplications by shifts and adds
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-10T10:02:51-0500
+ * @date Last modified: 2014-01-10T10:02:51-0500
+ *
+ * @details  After a function has been converted, every multiplication of a
+ *           variable by an integer constant can be rewritten as a sequence of
+ *           shifts, additions and subtractions. The constant is written in
+ *           canonical signed digit (CSD) form, which has the fewest nonzero
+ *           digits, and the product is built from the most significant digit
+ *           down, as in Horner's rule:
+ * @code
+ *           x * 75  =  x * (1 0 1 0 -1 0 -1)
+ *           t1 = x << 2;  t2 = t1 + x;     // x * 5
+ *           t3 = t2 << 2; t4 = t3 - x;     // x * 19
+ *           t5 = t4 << 2; t6 = t5 - x;     // x * 75
+ * @endcode
+ *           Each partial product, such as x * 5, is remembered for the rest
+ *           of the basic block. When the same variable is multiplied by
+ *           another constant whose leading digits are the same, or whose odd
+ *           part has already been built, the partial product is reused.
+ *
+ *           The multiplicand may be an SSA name or one of the plugin's _fx_
+ *           temporaries. Those are not renamed into SSA form until the pass
+ *           finishes, so a temporary is only rewritten when it is a register
+ *           that is assigned once in the function, which makes its partial
+ *           products safe to reuse.
+ *
+ *           The rewrite is only done when the number of shifts and additions
+ *           is less than the cost of a multiplication given by the
+ *           -fplugin-arg-fxopt-csd option. The arithmetic is done in the
+ *           unsigned type of the product, so the result is exactly the same
+ *           as the product and no signed overflow can occur.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "pointer-set.h"
+#include "utlist.h"
+
+/**
+ * @def   MAX_CSD_DIGITS
+ * @brief Largest number of digits in a constant that is rewritten.
+ */
+#define MAX_CSD_DIGITS (HOST_BITS_PER_WIDE_INT - 1)
+
+/**
+ * @brief A partial product that can be reused in the same basic block.
+ */
+struct PARTIAL {
+  tree multiplicand;                    ///< the variable being multiplied
+  tree type;                            ///< type of the arithmetic
+  unsigned HOST_WIDE_INT value;         ///< the odd constant multiplier
+  tree var;                             ///< variable holding the product
+  struct PARTIAL *next;
+};
+
+/**
+ * @brief Write a positive constant in canonical signed digit form.
+ *
+ * @param[in]  c     the constant
+ * @param[out] digit the digits, each -1, 0 or 1, least significant first
+ * @return     number of digits, or 0 if there are too many
+ */
+static int csd_digits(unsigned HOST_WIDE_INT c, int digit[])
+{
+  int n = 0;
+
+  while (c != 0) {
+    if (n >= MAX_CSD_DIGITS)
+      return 0;
+    if (c & 1) {
+      digit[n] = ((c & 3) == 1) ? 1 : -1;
+      c = (digit[n] > 0) ? c - 1 : c + 1;
+    } else {
+      digit[n] = 0;
+    }
+    c >>= 1;
+    n++;
+  }
+  return n;
+}
+
+/**
+ * @brief Find a partial product that was built earlier in the basic block.
+ *
+ * @param[in] partials     the partial products of the basic block
+ * @param[in] multiplicand the variable being multiplied
+ * @param[in] type         type of the arithmetic
+ * @param[in] value        the odd constant multiplier
+ * @return    variable holding the product, or NULL_TREE if there is none
+ */
+static tree find_partial(struct PARTIAL *partials, tree multiplicand,
+                         tree type, unsigned HOST_WIDE_INT value)
+{
+  struct PARTIAL *p;
+
+  LL_FOREACH(partials, p) {
+    if ((p->multiplicand == multiplicand) && (p->type == type)
+        && (p->value == value))
+      return p->var;
+  }
+  return NULL_TREE;
+}
+
+/**
+ * @brief Remember a partial product for the rest of the basic block.
+ *
+ * @param[in,out] partials_p   pointer to the partial products of the block
+ * @param[in]     multiplicand the variable being multiplied
+ * @param[in]     type         type of the arithmetic
+ * @param[in]     value        the odd constant multiplier
+ * @param[in]     var          variable holding the product
+ */
+static void add_partial(struct PARTIAL **partials_p, tree multiplicand,
+                        tree type, unsigned HOST_WIDE_INT value, tree var)
+{
+  struct PARTIAL *p = (struct PARTIAL *) xmalloc(sizeof(struct PARTIAL));
+
+  p->multiplicand = multiplicand;
+  p->type = type;
+  p->value = value;
+  p->var = var;
+  LL_PREPEND(*partials_p, p);
+}
+
+/**
+ * @brief Insert a statement with two operands before the multiplication.
+ *
+ * @param[in] gsi_p pointer to the multiplication's gimple_stmt_iterator
+ * @param[in] code  the operation
+ * @param[in] type  type of the result
+ * @param[in] op1   first operand
+ * @param[in] op2   second operand, or NULL
+ * @return    the new result variable
+ */
+static tree insert_csd_stmt(gimple_stmt_iterator * gsi_p, enum tree_code code,
+                            tree type, tree op1, tree op2)
+{
+  tree var = make_rename_temp(type, "_fx_csd0");
+  gimple new_stmt = gimple_build_assign_with_ops(code, var, op1, op2);
+
+  gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return var;
+}
+
+/**
+ * @brief Rewrite one multiplication by a constant, if that is cheaper.
+ *
+ * @param[in]     gsi_p        pointer to the multiplication's iterator
+ * @param[in]     multiplicand the variable operand
+ * @param[in]     constant     the INTEGER_CST operand
+ * @param[in,out] partials_p   pointer to the partial products of the block
+ * @return        true if the multiplication was rewritten
+ */
+static bool rewrite_constant_mult(gimple_stmt_iterator * gsi_p,
+                                  tree multiplicand, tree constant,
+                                  struct PARTIAL **partials_p)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree type = unsigned_type_for(TREE_TYPE(gimple_assign_lhs(stmt)));
+  int digit[MAX_CSD_DIGITS];
+  unsigned HOST_WIDE_INT prefix[MAX_CSD_DIGITS];
+  unsigned HOST_WIDE_INT odd;
+  HOST_WIDE_INT c;
+  int n, p, top, start, shift, cost;
+  tree var;
+
+  if (!host_integerp(constant, 0))
+    return false;
+  c = tree_low_cst(constant, 0);
+  if ((c == 0) || (c == 1) || (c == -1))
+    return false;
+  odd = (c < 0) ? -(unsigned HOST_WIDE_INT) c : (unsigned HOST_WIDE_INT) c;
+  shift = ctz_hwi(odd);
+  odd >>= shift;
+  n = csd_digits(odd, digit);
+  if (n == 0)
+    return false;
+  //
+  // The product is built from the most significant digit down. The value
+  // of the product after each nonzero digit is a prefix of the constant.
+  //
+  top = n - 1;
+  prefix[top] = 1;
+  for (p = top - 1, start = top; p >= 0; p--) {
+    if (digit[p] != 0) {
+      prefix[p] = (prefix[start] << (start - p)) + digit[p];
+      start = p;
+    }
+  }
+  //
+  // Start from the longest prefix that has already been built
+  //
+  var = NULL_TREE;
+  for (start = 0; start <= top; start++) {
+    if (digit[start] == 0)
+      continue;
+    var = find_partial(*partials_p, multiplicand, type, prefix[start]);
+    if (var != NULL_TREE)
+      break;
+  }
+  //
+  // Each remaining nonzero digit costs a shift and an addition
+  //
+  cost = (shift > 0) + (c < 0);
+  if (var == NULL_TREE) {
+    start = top;
+    cost++;                     // conversion of the multiplicand
+  }
+  for (p = start - 1; p >= 0; p--) {
+    if (digit[p] != 0)
+      cost += 2;
+  }
+  if (cost >= CSD_MULT_COST)
+    return false;
+
+  FXLOG(2, "  Multiplication by " HOST_WIDE_INT_PRINT_DEC
+        " replaced by %d shifts and adds\n", c, cost);
+  tree x = find_partial(*partials_p, multiplicand, type, 1);
+  if (x == NULL_TREE) {
+    x = insert_csd_stmt(gsi_p, NOP_EXPR, type, multiplicand, NULL);
+    add_partial(partials_p, multiplicand, type, 1, x);
+  }
+  if (var == NULL_TREE)
+    var = x;
+  for (p = start - 1, top = start; p >= 0; p--) {
+    if (digit[p] == 0)
+      continue;
+    var = insert_csd_stmt(gsi_p, LSHIFT_EXPR, type, var,
+                          build_int_cst(integer_type_node, top - p));
+    var = insert_csd_stmt(gsi_p, (digit[p] > 0) ? PLUS_EXPR : MINUS_EXPR,
+                          type, var, x);
+    add_partial(partials_p, multiplicand, type, prefix[p], var);
+    top = p;
+  }
+  if (shift > 0)
+    var = insert_csd_stmt(gsi_p, LSHIFT_EXPR, type, var,
+                          build_int_cst(integer_type_node, shift));
+  if (c < 0)
+    var = insert_csd_stmt(gsi_p, NEGATE_EXPR, type, var, NULL);
+
+  gimple_assign_set_rhs_with_ops(gsi_p, NOP_EXPR, var, NULL);
+  update_stmt(gsi_stmt(*gsi_p));
+  FXLOG_STMT(2, gsi_stmt(*gsi_p));
+  return true;
+}
+
+/**
+ * @brief Predicate for an operand that can be the multiplicand.
+ *
+ * @param[in] op     gcc tree for the operand
+ * @param[in] single the _fx_ temporaries from single_value_temps()
+ * @return    true if the value of the operand is the same wherever it is used
+ */
+static bool is_csd_multiplicand(tree op, struct pointer_set_t *single)
+{
+  return (TREE_CODE(op) == SSA_NAME) || pointer_set_contains(single, op);
+}
+
+/**
+ * @brief Replace multiplications by constants with shifts and adds.
+ *
+ * @details Called after the function has been converted to fixed-point.
+ * Both single- and double-precision multiplications of a variable by an
+ * integer constant are candidates. Partial products are shared within a
+ * basic block.
+ */
+void rewrite_constant_mults()
+{
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  struct PARTIAL *partials, *p, *tmp;
+  struct pointer_set_t *single = single_value_temps();
+
+  FXLOG(1, "  ===== Replacing constant multiplications =====\n");
+  FOR_EACH_BB(bb) {
+    partials = NULL;
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      if (!is_gimple_assign(stmt) ||
+          ((gimple_assign_rhs_code(stmt) != MULT_EXPR) &&
+           (gimple_assign_rhs_code(stmt) != WIDEN_MULT_EXPR)) ||
+          !INTEGRAL_TYPE_P(TREE_TYPE(gimple_assign_lhs(stmt))))
+        continue;
+      tree op1 = gimple_assign_rhs1(stmt);
+      tree op2 = gimple_assign_rhs2(stmt);
+      if (is_csd_multiplicand(op1, single) &&
+          (TREE_CODE(op2) == INTEGER_CST))
+        rewrite_constant_mult(&gsi, op1, op2, &partials);
+      else if (is_csd_multiplicand(op2, single) &&
+               (TREE_CODE(op1) == INTEGER_CST))
+        rewrite_constant_mult(&gsi, op2, op1, &partials);
+    }
+    LL_FOREACH_SAFE(partials, p, tmp) {
+      LL_DELETE(partials, p);
+      free(p);
+    }
+  }
+  pointer_set_destroy(single);
+}
@@ -0,0 +1,1267 @@
+/**
+ * @file fxopt_ipa.c
+ *
+ * @brief  Functions for passing formats across function calls
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-22T09:12:37-0500
+ * @date Last modified: 2014-01-22T09:12:37-0500
+ *
+ * @details  Each function is converted by itself, so without help the
+ *           format of a parameter can only come from an fxfrmt attribute,
+ *           and a caller knows nothing about the value that a function
+ *           returns. With -fplugin-arg-fxopt-ipa=FILE the formats are passed
+ *           across calls in both directions:
+ *
+ *             - gcc converts a function before the functions that call it,
+ *               so when a function has been converted the formats of its
+ *               real parameters and return value are kept. A call to it is
+ *               then analyzed like an operation: each real argument is
+ *               shifted to the binary point of its parameter, and the result
+ *               gets the format and range of the return value.
+ *             - The range of each real argument at each call site is written
+ *               to FILE when gcc finishes, with the formats of the functions
+ *               that were converted. When a file is compiled again, each real
+ *               parameter without an fxfrmt attribute gets a format for the
+ *               join of the ranges that its callers passed, and the formats
+ *               of functions in other files are known to their callers.
+ *             - When the call sites of a function pass ranges that need
+ *               very different numbers of integer bits, the function is
+ *               cloned before it is converted, once for each class of call
+ *               sites, and each call is redirected to the clone for its
+ *               class. The original function keeps the calls that were not
+ *               redirected, including those from other files.
+ *
+ *           The ranges of the arguments are found in one compilation and
+ *           used in the next, like a profile, so a chain of calls needs one
+ *           compilation for each level before its formats stop changing.
+ *           Each line of the file is one of
+ * @code
+ *           function name parameters hash
+ *           param name index S I F E size min max
+ *           return name S I F E size min max
+ *           site callee index caller line min max
+ *           uses caller callee hash
+ * @endcode
+ *           where the ranges are real values and a hash is that of the
+ *           formats of a function's parameters and return value. A uses line
+ *           records the formats of a function in another file that a caller
+ *           was converted with, so that the caller can be reported when the
+ *           function is converted again with other formats.
+ *
+ *           Files that share a summary file may be compiled in parallel.
+ *           The file is only rewritten while a lock file next to it is held,
+ *           and what other compilations wrote since it was read is merged
+ *           in first. The new contents are written under a temporary name
+ *           and renamed, so a compilation never reads a partial file.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include <sys/file.h>
+#include "cgraph.h"
+#include "tree-inline.h"
+#include "utlist.h"
+
+/**
+ * @def   IPA_MAX_CLASSES
+ * @brief Largest number of format classes, including the original function,
+ * that the call sites of one function are divided into.
+ */
+#define IPA_MAX_CLASSES 4
+
+/**
+ * @brief The format of a parameter or return value.
+ */
+struct IPA_FORMAT {
+  int S;                        ///< sign bits
+  int I;                        ///< integer bits
+  int F;                        ///< fraction bits
+  int E;                        ///< empty bits
+  int size;                     ///< size in bits, zero if not a real value
+  double min;                   ///< smallest value
+  double max;                   ///< largest value
+};
+
+/**
+ * @brief The formats at the boundary of one function.
+ */
+struct IPA_SUMMARY {
+  tree decl;                    ///< the function, if converted in this file
+  char *function;               ///< name of the function
+  int params;                   ///< number of parameters
+  struct IPA_FORMAT *param;     ///< format of each parameter
+  struct IPA_FORMAT ret;        ///< format of the return value
+  unsigned long hash;           ///< hash of the formats
+  struct IPA_SUMMARY *next;
+};
+
+/**
+ * @brief The range of one argument at one call site.
+ */
+struct IPA_SITE {
+  char *callee;                 ///< name of the function called
+  int index;                    ///< which argument
+  char *caller;                 ///< name of the function with the call
+  int line;                     ///< source line of the call
+  double min;                   ///< smallest value passed
+  double max;                   ///< largest value passed
+  int cls;                      ///< the format class of the call
+  gimple stmt;                  ///< the call, if found in this compilation
+  struct IPA_SITE *next;
+};
+
+/**
+ * @brief The formats of a function in another file that a caller used.
+ */
+struct IPA_USE {
+  char *caller;                 ///< name of the function with the calls
+  char *callee;                 ///< name of the function called
+  unsigned long hash;           ///< hash of the callee's formats
+  bool here;                    ///< the caller was converted in this file
+  struct IPA_USE *next;
+};
+
+/**
+ * @brief A clone of a function made for one class of call sites.
+ */
+struct IPA_CLONE {
+  tree decl;                    ///< the clone
+  char *function;               ///< name of the function it was cloned from
+  int cls;                      ///< the format class of its calls
+  struct IPA_CLONE *next;
+};
+
+static struct IPA_SUMMARY *summaries = NULL;
+static struct IPA_SITE *sites = NULL;
+static struct IPA_USE *uses = NULL;
+static struct IPA_CLONE *clones = NULL;
+
+/**
+ * @brief Summary of the function being converted, which is not found by
+ * its callers until the function has been converted.
+ */
+static struct IPA_SUMMARY *pending = NULL;
+
+/**
+ * @brief Name of a function declaration.
+ *
+ * @details A clone is renamed by gcc, but its call sites and summary belong
+ * to the function it was cloned from, so the name of that function is
+ * returned for it. The calls in a cloned caller are then recorded under the
+ * caller's name, and the next compilation finds the sites of a clone.
+ */
+static const char *function_name(tree decl)
+{
+  struct IPA_CLONE *c;
+
+  LL_FOREACH(clones, c) {
+    if (c->decl == decl)
+      return c->function;
+  }
+  return IDENTIFIER_POINTER(DECL_NAME(decl));
+}
+
+/**
+ * @brief Find the format class of a function, zero unless it is a clone.
+ */
+static int function_class(tree decl)
+{
+  struct IPA_CLONE *c;
+
+  LL_FOREACH(clones, c) {
+    if (c->decl == decl)
+      return c->cls;
+  }
+  return 0;
+}
+
+/**
+ * @brief Find the number of integer bits needed for a range.
+ */
+static int range_bits(double min, double max)
+{
+  double peak = MAX(fabs(min), fabs(max));
+
+  return (peak >= 1.0) ? (int) floor(log2(peak)) + 1 : 0;
+}
+
+/**
+ * @brief Find the real range of a format.
+ *
+ * @details If the range is not known, the range that the format can
+ * represent is used.
+ *
+ * @param[in]  s     ::SIF structure
+ * @param[out] min_p set to the smallest value
+ * @param[out] max_p set to the largest value
+ */
+static void format_range(struct SIF s, double *min_p, double *max_p)
+{
+  int bp = s.F + s.E;
+
+  if (double_int_scmp(s.max, s.min) < 0) {
+    *max_p = ldexp(1.0, s.I);
+    *min_p = s.sgnd ? -*max_p : 0.0;
+  } else {
+    *max_p = ldexp((double) double_int_to_shwi(s.max), -bp);
+    *min_p = ldexp((double) double_int_to_shwi(s.min), -bp);
+  }
+}
+
+/**
+ * @brief Save a ::SIF format as the format of a parameter or return value.
+ */
+static struct IPA_FORMAT summary_format(struct SIF s)
+{
+  struct IPA_FORMAT f;
+
+  f.S = s.S;
+  f.I = s.I;
+  f.F = s.F;
+  f.E = s.E;
+  f.size = s.size;
+  format_range(s, &f.min, &f.max);
+  return f;
+}
+
+/**
+ * @brief Hash the formats of the parameters and return value of a function.
+ *
+ * @details Only what is written to the summary file is hashed, so a summary
+ * that was read back has the hash of the one that was written.
+ */
+static unsigned long summary_hash(struct IPA_SUMMARY *s)
+{
+  unsigned long h = s->params;
+  int i;
+
+  for (i = -1; i < s->params; i++) {
+    struct IPA_FORMAT *f = (i < 0) ? &s->ret : &s->param[i];
+    h = h * 31 + f->size;
+    if (0 == f->size)
+      continue;                 // not written
+    h = h * 31 + f->F + f->E;
+    h = h * 31 + (HOST_WIDE_INT) ldexp(f->max, f->F + f->E);
+    h = h * 31 + (HOST_WIDE_INT) ldexp(f->min, f->F + f->E);
+  }
+  return h;
+}
+
+/**
+ * @brief Find a summary by its function name, or make a new one.
+ *
+ * @param[in] function name of the function
+ * @param[in] params   number of parameters
+ * @return    the summary
+ */
+static struct IPA_SUMMARY *add_summary(const char *function, int params)
+{
+  struct IPA_SUMMARY *s;
+
+  LL_FOREACH(summaries, s) {
+    if ((NULL == s->decl) && !strcmp(s->function, function))
+      break;
+  }
+  if (NULL == s) {
+    s = (struct IPA_SUMMARY *) xcalloc(1, sizeof(struct IPA_SUMMARY));
+    s->function = xstrdup(function);
+    LL_PREPEND(summaries, s);
+  }
+  if (s->params < params) {
+    s->param = (struct IPA_FORMAT *) xrealloc(s->param, params *
+                                              sizeof(struct IPA_FORMAT));
+    memset(&s->param[s->params], 0, (params - s->params) *
+           sizeof(struct IPA_FORMAT));
+    s->params = params;
+  }
+  return s;
+}
+
+/**
+ * @brief Find the summary of a called function.
+ *
+ * @details A function defined in this file is only summarized once it has
+ * been converted, so that a summary read from the file, which may be out of
+ * date, is never used for it.
+ *
+ * @param[in] fndecl the called function
+ * @return    the summary, or NULL if the formats are not known
+ */
+static struct IPA_SUMMARY *find_summary(tree fndecl)
+{
+  struct IPA_SUMMARY *s;
+  struct cgraph_node *node;
+
+  LL_FOREACH(summaries, s) {
+    if (s->decl == fndecl)
+      return s;
+  }
+  node = cgraph_get_node(fndecl);
+  if (((node != NULL) && node->analyzed) || !TREE_PUBLIC(fndecl))
+    return NULL;
+  LL_FOREACH(summaries, s) {
+    if ((NULL == s->decl) && !strcmp(s->function, function_name(fndecl)))
+      return s;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Read the lines of a summary file.
+ *
+ * @details A line that cannot be read is reported and skipped. A function
+ * whose formats do not match the hash written with them is reported, and its
+ * formats are not used.
+ *
+ * @param[in] ipa_file  the open summary file
+ * @param[in] file_name name of the summary file
+ * @return    the number of call sites read
+ */
+static int read_summaries(FILE * ipa_file, const char *file_name)
+{
+  char line[1024], kind[16], function[256], caller[256];
+  struct IPA_FORMAT f;
+  struct IPA_SUMMARY *s;
+  struct IPA_SITE *site;
+  struct IPA_USE *use;
+  unsigned long hash;
+  int line_number = 0, index, params, call_line, count = 0;
+
+  while (fgets(line, sizeof(line), ipa_file) != NULL) {
+    line_number++;
+    if (sscanf(line, "%15s", kind) != 1)
+      continue;
+    if (!strcmp(kind, "function") &&
+        (sscanf(line, "%*s %255s %d %lx", function, &params, &hash) == 3) &&
+        (params >= 0)) {
+      s = add_summary(function, params);
+      s->hash = hash;
+    } else if (!strcmp(kind, "param") &&
+               (sscanf(line, "%*s %255s %d %d %d %d %d %d %lg %lg", function,
+                       &index, &f.S, &f.I, &f.F, &f.E, &f.size, &f.min,
+                       &f.max) == 9) && (index >= 0)) {
+      s = add_summary(function, index + 1);
+      s->param[index] = f;
+    } else if (!strcmp(kind, "return") &&
+               (sscanf(line, "%*s %255s %d %d %d %d %d %lg %lg", function,
+                       &f.S, &f.I, &f.F, &f.E, &f.size, &f.min,
+                       &f.max) == 8)) {
+      s = add_summary(function, 0);
+      s->ret = f;
+    } else if (!strcmp(kind, "site") &&
+               (sscanf(line, "%*s %255s %d %255s %d %lg %lg", function,
+                       &index, caller, &call_line, &f.min, &f.max) == 6) &&
+               (f.min <= f.max)) {
+      site = (struct IPA_SITE *) xcalloc(1, sizeof(struct IPA_SITE));
+      site->callee = xstrdup(function);
+      site->index = index;
+      site->caller = xstrdup(caller);
+      site->line = call_line;
+      site->min = f.min;
+      site->max = f.max;
+      LL_APPEND(sites, site);
+      count++;
+    } else if (!strcmp(kind, "uses") &&
+               (sscanf(line, "%*s %255s %255s %lx", caller, function,
+                       &hash) == 3)) {
+      use = (struct IPA_USE *) xcalloc(1, sizeof(struct IPA_USE));
+      use->caller = xstrdup(caller);
+      use->callee = xstrdup(function);
+      use->hash = hash;
+      LL_APPEND(uses, use);
+    } else {
+      warning(0, G_("fxopt: ignoring line %d of call summaries %qs"),
+              line_number, file_name);
+    }
+  }
+  LL_FOREACH(summaries, s) {
+    if ((NULL == s->decl) && (summary_hash(s) != s->hash)) {
+      warning(0, G_("fxopt: ignoring damaged call summary of %qs in %qs"),
+              s->function, file_name);
+      if (s->params)
+        memset(s->param, 0, s->params * sizeof(struct IPA_FORMAT));
+      memset(&s->ret, 0, sizeof(struct IPA_FORMAT));
+      s->hash = summary_hash(s);
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Read the summaries written by an earlier compilation.
+ *
+ * @details A missing file is not an error, since the first compilation
+ * makes it.
+ *
+ * @param[in] file_name name of the summary file
+ */
+void load_ipa_summaries(const char *file_name)
+{
+  FILE *ipa_file = fopen(file_name, "r");
+  int count;
+
+  if (NULL == ipa_file) {
+    FXLOG(1, "fxopt: no call summaries in %s yet\n", file_name);
+    return;
+  }
+  count = read_summaries(ipa_file, file_name);
+  fclose(ipa_file);
+  FXLOG(1, "fxopt: %d call sites read from %s\n", count, file_name);
+}
+
+/**
+ * @brief Forget the summaries, call sites and uses that were read from the
+ * summary file, keeping those found in this compilation.
+ */
+static void forget_read_summaries()
+{
+  struct IPA_SUMMARY *s, *stmp;
+  struct IPA_SITE *site, *sitetmp;
+  struct IPA_USE *use, *usetmp;
+
+  LL_FOREACH_SAFE(summaries, s, stmp) {
+    if (s->decl)
+      continue;
+    LL_DELETE(summaries, s);
+    free(s->function);
+    free(s->param);
+    free(s);
+  }
+  LL_FOREACH_SAFE(sites, site, sitetmp) {
+    if (site->stmt)
+      continue;
+    LL_DELETE(sites, site);
+    free(site->callee);
+    free(site->caller);
+    free(site);
+  }
+  LL_FOREACH_SAFE(uses, use, usetmp) {
+    if (use->here)
+      continue;
+    LL_DELETE(uses, use);
+    free(use->caller);
+    free(use->callee);
+    free(use);
+  }
+}
+
+/**
+ * @brief Predicate for a caller whose call sites were found again in this
+ * compilation.
+ */
+static bool caller_recorded(const char *caller)
+{
+  struct IPA_SITE *site;
+
+  LL_FOREACH(sites, site) {
+    if (site->stmt && !strcmp(site->caller, caller))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Predicate for a function that was converted in this compilation.
+ */
+static bool converted_here(const char *function)
+{
+  struct IPA_SUMMARY *s;
+
+  LL_FOREACH(summaries, s) {
+    if (s->decl && !strcmp(s->function, function))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Write one format to the summary file.
+ */
+static void write_format(FILE *ipa_file, struct IPA_FORMAT *f)
+{
+  fprintf(ipa_file, " %d %d %d %d %d %.17g %.17g\n", f->S, f->I, f->F, f->E,
+          f->size, f->min, f->max);
+}
+
+/**
+ * @brief Write the summaries to an open file.
+ *
+ * @details The functions converted in this file, and the call sites that
+ * were found, replace what was read. Everything else that was read is kept,
+ * since it came from other files. Clones are not written, because only the
+ * original functions can be called from other files.
+ */
+static void write_summaries(FILE * ipa_file)
+{
+  struct IPA_SUMMARY *s;
+  struct IPA_SITE *site;
+  struct IPA_USE *use;
+  int i;
+
+  LL_FOREACH(summaries, s) {
+    if (s->decl && function_class(s->decl))
+      continue;
+    if ((NULL == s->decl) && converted_here(s->function))
+      continue;                 // converted again in this file
+    fprintf(ipa_file, "function %s %d %lx\n", s->function, s->params,
+            summary_hash(s));
+    for (i = 0; i < s->params; i++) {
+      if (s->param[i].size) {
+        fprintf(ipa_file, "param %s %d", s->function, i);
+        write_format(ipa_file, &s->param[i]);
+      }
+    }
+    if (s->ret.size) {
+      fprintf(ipa_file, "return %s", s->function);
+      write_format(ipa_file, &s->ret);
+    }
+  }
+  LL_FOREACH(sites, site) {
+    if ((NULL == site->stmt) && caller_recorded(site->caller))
+      continue;
+    fprintf(ipa_file, "site %s %d %s %d %.17g %.17g\n", site->callee,
+            site->index, site->caller, site->line, site->min, site->max);
+  }
+  LL_FOREACH(uses, use) {
+    if (!use->here && converted_here(use->caller))
+      continue;
+    fprintf(ipa_file, "uses %s %s %lx\n", use->caller, use->callee,
+            use->hash);
+  }
+}
+
+/**
+ * @brief Write the summaries when gcc finishes.
+ *
+ * @details Other compilations may have rewritten the file since it was
+ * read, so while the lock file is held the summaries that were read are
+ * replaced by the current contents of the file, and what this compilation
+ * found is merged into them. The file is written under a temporary name and
+ * then renamed. Failing to write the file only causes a warning.
+ *
+ * @param[in] file_name name of the summary file
+ */
+void save_ipa_summaries(const char *file_name)
+{
+  char *lock_name, *temp_name;
+  FILE *ipa_file;
+  int lock_fd, ok;
+
+  lock_name = (char *) xmalloc(strlen(file_name) + 16);
+  sprintf(lock_name, "%s.lock", file_name);
+  temp_name = (char *) xmalloc(strlen(file_name) + 16);
+  sprintf(temp_name, "%s.%d", file_name, (int) getpid());
+  lock_fd = open(lock_name, O_RDWR | O_CREAT, 0666);
+  if ((lock_fd < 0) || (flock(lock_fd, LOCK_EX) != 0)) {
+    warning(0, G_("fxopt: cannot lock call summaries %qs"), lock_name);
+    if (lock_fd >= 0)
+      close(lock_fd);
+    free(temp_name);
+    free(lock_name);
+    return;
+  }
+
+  forget_read_summaries();
+  ipa_file = fopen(file_name, "r");
+  if (ipa_file != NULL) {
+    read_summaries(ipa_file, file_name);
+    fclose(ipa_file);
+  }
+  ipa_file = fopen(temp_name, "w");
+  ok = (ipa_file != NULL);
+  if (ok) {
+    write_summaries(ipa_file);
+    ok = !ferror(ipa_file);
+    if (fclose(ipa_file) != 0)
+      ok = 0;
+  }
+  if (!ok || (rename(temp_name, file_name) != 0)) {
+    warning(0, G_("fxopt: cannot write call summaries %qs"), file_name);
+    remove(temp_name);
+  }
+
+  close(lock_fd);               // releases the lock
+  free(temp_name);
+  free(lock_name);
+}
+
+/**
+ * @brief Find the range passed to a parameter of the current function by
+ * its callers, in the previous compilation.
+ *
+ * @details Only the call sites in the current function's format class are
+ * joined, so a clone gets the range of the calls that were redirected to it.
+ *
+ * @param[in]  var   gcc tree for the parameter
+ * @param[out] min_p set to the smallest value passed
+ * @param[out] max_p set to the largest value passed
+ * @return     true if any call site was found
+ */
+bool ipa_param_range(tree var, double *min_p, double *max_p)
+{
+  const char *function = function_name(current_function_decl);
+  int cls = function_class(current_function_decl);
+  struct IPA_SITE *site;
+  tree parm;
+  int index = 0;
+  bool found = false;
+
+  for (parm = DECL_ARGUMENTS(current_function_decl);
+       (parm != NULL_TREE) && (parm != var); parm = TREE_CHAIN(parm))
+    index++;
+  if (NULL_TREE == parm)
+    return false;
+  LL_FOREACH(sites, site) {
+    if (site->stmt || (site->index != index) || (site->cls != cls) ||
+        strcmp(site->callee, function))
+      continue;
+    if (!found) {
+      *min_p = site->min;
+      *max_p = site->max;
+      found = true;
+    } else {
+      *min_p = MIN(*min_p, site->min);
+      *max_p = MAX(*max_p, site->max);
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief Find the format of a parameter from the ranges passed by its
+ * callers.
+ *
+ * @details The format has one sign bit, as many integer bits as the range
+ * needs, and the rest of the bits for the fraction. A parameter whose calls
+ * have not been seen yet is given half of the bits for its integer part, so
+ * that the first compilation can finish; it is reported, since its format
+ * is only a guess.
+ *
+ * @param[in]  var    gcc tree for the parameter
+ * @param[in]  size   number of bits in the parameter
+ * @param[out] s_bits set to the number of sign bits
+ * @param[out] i_bits set to the number of integer bits
+ * @param[out] f_bits set to the number of fraction bits
+ * @param[out] max_p  set to the largest value, with f_bits fraction bits
+ * @param[out] min_p  set to the smallest value, with f_bits fraction bits
+ * @return     true if the parameter was given a format
+ */
+bool ipa_param_format(tree var, int size, int *s_bits, int *i_bits,
+                      int *f_bits, double_int * max_p, double_int * min_p)
+{
+  double lo, hi;
+
+  *s_bits = 1;
+  if (ipa_param_range(var, &lo, &hi)) {
+    *i_bits = range_bits(lo, hi);
+    *f_bits = size - *s_bits - *i_bits;
+    if (*f_bits < 0) {
+      warning(0, G_("fxopt: range passed to %qs does not fit in %d bits"),
+              IDENTIFIER_POINTER(DECL_NAME(var)), size);
+      return false;
+    }
+    *max_p = shwi_to_double_int((HOST_WIDE_INT) ceil(ldexp(hi, *f_bits)));
+    *min_p = shwi_to_double_int((HOST_WIDE_INT) floor(ldexp(lo, *f_bits)));
+    FXLOG(1, "  Parameter %s gets range %g to %g from its callers\n",
+          IDENTIFIER_POINTER(DECL_NAME(var)), lo, hi);
+  } else {
+    *i_bits = size / 2 - 1;
+    *f_bits = size - *s_bits - *i_bits;
+    warning(0, G_("fxopt: no calls of %qs seen, assuming %d integer bits for "
+                  "parameter %qs"), function_name(current_function_decl),
+            *i_bits, IDENTIFIER_POINTER(DECL_NAME(var)));
+    *max_p = double_int_zero;   // the range of the format
+    *min_p = double_int_one;
+  }
+  return true;
+}
+
+/**
+ * @brief Keep the format of the current function's return value.
+ *
+ * @param[in] var_fmt pointer to ::SIF structure of the returned variable
+ */
+void record_return_format(struct SIF *var_fmt)
+{
+  if (pending && pending->ret.size)
+    pending->ret = summary_format(*var_fmt);
+}
+
+/**
+ * @brief Find the most recent format of a variable.
+ */
+static const struct SIF *latest_format(tree var)
+{
+  const struct SIF *var_fmt = NULL;
+  int pass = fxctx->fxpass + 1;
+
+  while ((NULL == var_fmt) && (--pass >= 0))
+    var_fmt = get_format_ptr(calc_hash_key(var, pass, NOT_AN_ARRAY));
+  return var_fmt;
+}
+
+/**
+ * @brief Start the summary of the current function.
+ *
+ * @details This must be called before the function is converted, while the
+ * real parameters and return value still have real types. They are marked
+ * by a nonzero size until their formats are known.
+ */
+void begin_function_summary()
+{
+  tree parm;
+  int i = 0;
+
+  pending = (struct IPA_SUMMARY *) xcalloc(1, sizeof(struct IPA_SUMMARY));
+  pending->decl = current_function_decl;
+  pending->function = xstrdup(function_name(current_function_decl));
+  for (parm = DECL_ARGUMENTS(current_function_decl); parm != NULL_TREE;
+       parm = TREE_CHAIN(parm))
+    pending->params++;
+  pending->param = (struct IPA_FORMAT *) xcalloc(MAX(pending->params, 1),
+                                                 sizeof(struct IPA_FORMAT));
+  for (parm = DECL_ARGUMENTS(current_function_decl); parm != NULL_TREE;
+       parm = TREE_CHAIN(parm), i++) {
+    if (SCALAR_FLOAT_TYPE_P(TREE_TYPE(parm)))
+      pending->param[i].size = var_word_size(parm);
+  }
+  if (SCALAR_FLOAT_TYPE_P(TREE_TYPE(DECL_RESULT(current_function_decl)))) {
+    pending->ret.size = var_word_size(DECL_RESULT(current_function_decl));
+    pending->ret.min = 1.0;     // an empty range until a return is found
+  }
+}
+
+/**
+ * @brief Keep the formats of the real parameters and return value of the
+ * function that was just converted, for the functions that call it.
+ *
+ * @details A value whose format was not found is left out of the summary,
+ * so calls pass it unchanged, as they would without a summary. A caller in
+ * another file that was converted with different formats of this function
+ * is reported, since its calls no longer match.
+ */
+void end_function_summary()
+{
+  const struct SIF *var_fmt;
+  struct IPA_USE *use;
+  tree parm;
+  int i = 0;
+
+  if (NULL == pending)
+    return;
+  for (parm = DECL_ARGUMENTS(current_function_decl); parm != NULL_TREE;
+       parm = TREE_CHAIN(parm), i++) {
+    if (0 == pending->param[i].size)
+      continue;
+    var_fmt = latest_format(parm);
+    if ((var_fmt != NULL) && format_initialized(*var_fmt))
+      pending->param[i] = summary_format(*var_fmt);
+    else
+      pending->param[i].size = 0;
+  }
+  if (pending->ret.min > pending->ret.max)
+    pending->ret.size = 0;      // no return statement was converted
+  pending->hash = summary_hash(pending);
+  if (!function_class(current_function_decl)) {
+    LL_FOREACH(uses, use) {
+      if (!use->here && (use->hash != pending->hash) &&
+          !strcmp(use->callee, pending->function))
+        warning(0, G_("fxopt: %qs was converted with other formats of %qs, "
+                      "compile it again"), use->caller, pending->function);
+    }
+  }
+  LL_PREPEND(summaries, pending);
+  pending = NULL;
+}
+
+/**
+ * @brief Predicate for a call whose formats are passed across the call.
+ *
+ * @details Before the last pass a call to any function with a real argument
+ * or result is analyzed, so that the ranges of its arguments are recorded.
+ * In the last pass the variables are no longer real, so only the calls to a
+ * summarized function, which are the ones that are changed, are found.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @return    true if the statement is such a call
+ */
+bool is_ipa_call(gimple stmt)
+{
+  tree fndecl;
+  unsigned i;
+
+  if (!IPA_SUMMARY_FILE || !is_gimple_call(stmt))
+    return false;
+  fndecl = gimple_call_fndecl(stmt);
+  if ((NULL_TREE == fndecl) || DECL_BUILT_IN(fndecl))
+    return false;
+  if (find_summary(fndecl))
+    return true;
+  if (fxctx->lastpass)
+    return false;
+  if (gimple_call_lhs(stmt) &&
+      SCALAR_FLOAT_TYPE_P(TREE_TYPE(gimple_call_lhs(stmt))))
+    return true;
+  for (i = 0; i < gimple_call_num_args(stmt); i++) {
+    if (SCALAR_FLOAT_TYPE_P(TREE_TYPE(gimple_call_arg(stmt, i))))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Record the range of an argument at a call site.
+ *
+ * @details A call that is analyzed again replaces its earlier range.
+ */
+static void record_site(gimple stmt, int index, struct SIF arg_frmt)
+{
+  struct IPA_SITE *site;
+
+  LL_FOREACH(sites, site) {
+    if ((site->stmt == stmt) && (site->index == index) &&
+        !strcmp(site->caller, function_name(current_function_decl)))
+      break;
+  }
+  if (NULL == site) {
+    site = (struct IPA_SITE *) xcalloc(1, sizeof(struct IPA_SITE));
+    site->callee = xstrdup(function_name(gimple_call_fndecl(stmt)));
+    site->index = index;
+    site->caller = xstrdup(function_name(current_function_decl));
+    site->line = LOCATION_LINE(gimple_location(stmt));
+    site->stmt = stmt;
+    LL_APPEND(sites, site);
+  }
+  format_range(arg_frmt, &site->min, &site->max);
+}
+
+/**
+ * @brief Record that the current function was converted with the summary of
+ * a function in another file.
+ */
+static void record_use(struct IPA_SUMMARY *s)
+{
+  const char *caller = function_name(current_function_decl);
+  struct IPA_USE *use;
+
+  LL_FOREACH(uses, use) {
+    if (use->here && !strcmp(use->caller, caller) &&
+        !strcmp(use->callee, s->function))
+      break;
+  }
+  if (NULL == use) {
+    use = (struct IPA_USE *) xcalloc(1, sizeof(struct IPA_USE));
+    use->caller = xstrdup(caller);
+    use->callee = xstrdup(s->function);
+    use->here = true;
+    LL_APPEND(uses, use);
+  }
+  use->hash = s->hash;
+}
+
+/**
+ * @brief Insert a statement with two operands before the call.
+ */
+static tree insert_ipa_stmt(gimple_stmt_iterator * gsi_p, enum tree_code code,
+                            tree type, tree op1, tree op2)
+{
+  tree var = make_rename_temp(type, "_fx_arg0");
+  gimple new_stmt = gimple_build_assign_with_ops(code, var, op1, op2);
+
+  gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return var;
+}
+
+/**
+ * @brief Convert an argument to the format of its parameter.
+ *
+ * @details A narrower argument is widened before it is shifted, and a wider
+ * one is shifted before it is narrowed, so no bits are lost that the
+ * parameter could hold.
+ *
+ * @param[in] gsi_p    statement iterator, points to the call
+ * @param[in] arg      the argument, converted to an integer
+ * @param[in] arg_frmt ::SIF structure of the argument
+ * @param[in] parm     format of the parameter
+ * @return    the converted argument
+ */
+static tree convert_argument(gimple_stmt_iterator * gsi_p, tree arg,
+                             struct SIF arg_frmt, struct IPA_FORMAT *parm)
+{
+  tree parm_type = fxopt_integer_type(parm->size);
+  int shift = (parm->F + parm->E) - (arg_frmt.F + arg_frmt.E);
+
+  if (parm->size > arg_frmt.size)
+    arg = insert_ipa_stmt(gsi_p, NOP_EXPR, parm_type, arg, NULL_TREE);
+  if (shift > 0)
+    arg = insert_ipa_stmt(gsi_p, LSHIFT_EXPR, TREE_TYPE(arg), arg,
+                          build_int_cst(integer_type_node, shift));
+  else if (shift < 0)
+    arg = insert_ipa_stmt(gsi_p, RSHIFT_EXPR, TREE_TYPE(arg), arg,
+                          build_int_cst(integer_type_node, -shift));
+  if (parm->size < arg_frmt.size)
+    arg = insert_ipa_stmt(gsi_p, NOP_EXPR, parm_type, arg, NULL_TREE);
+  return arg;
+}
+
+/**
+ * @brief Build the format of a call's result from the callee's return value.
+ *
+ * @details The affine definition of the result is its center plus a new
+ * error term, since nothing is known about how it depends on the arguments.
+ *
+ * @param[in] lhs_frmt ::SIF structure of the call's LHS
+ * @param[in] ret      format of the return value
+ * @return    ::SIF structure for the result
+ */
+static struct SIF return_format(struct SIF lhs_frmt, struct IPA_FORMAT *ret)
+{
+  struct SIF result_frmt = lhs_frmt;
+  int bp = ret->F + ret->E;
+
+  result_frmt.aa = NULL;
+  result_frmt.size = ret->size;
+  result_frmt.sgnd = 1;
+  result_frmt.S = ret->S;
+  result_frmt.I = ret->I;
+  result_frmt.F = ret->F;
+  result_frmt.E = ret->E;
+  result_frmt.originalF = ret->F;
+  result_frmt.shift = 0;
+  result_frmt.iv = 0;
+  result_frmt.max =
+      shwi_to_double_int((HOST_WIDE_INT) ceil(ldexp(ret->max, bp)));
+  result_frmt.min =
+      shwi_to_double_int((HOST_WIDE_INT) floor(ldexp(ret->min, bp)));
+  if (AFFINE)
+    range_to_aa(&result_frmt, fxctx->next_error_id++);
+  result_frmt.noise = quantization_noise(ret->F);
+  return result_frmt;
+}
+
+/**
+ * @brief Fit the result of a call into its LHS, if the LHS has a different
+ * size than the callee's return value.
+ *
+ * @details The call is given a new LHS of the return value's type, and the
+ * result is converted to the original LHS after the call. A narrower LHS
+ * gets the upper bits of the result, so fraction bits are lost.
+ *
+ * @param[in,out] gsi_p       statement iterator, points to the call; on
+ *                            return it points to the last new statement
+ * @param[in]     lhs_size    number of bits in the LHS
+ * @param[in,out] result_frmt ::SIF structure of the result
+ */
+static void fit_result(gimple_stmt_iterator * gsi_p, int lhs_size,
+                       struct SIF *result_frmt)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree lhs = gimple_call_lhs(stmt);
+  tree ret_type = fxopt_integer_type(result_frmt->size);
+  int shift = result_frmt->size - lhs_size;
+  gimple new_stmt;
+
+  if (fxctx->lastpass) {
+    tree result = make_rename_temp(ret_type, "_fx_ret0");
+    gimple_call_set_lhs(stmt, result);
+    update_stmt(stmt);
+    FXLOG_STMT(2, stmt);
+    if (shift > 0) {
+      tree shifted = make_rename_temp(ret_type, "_fx_ret0");
+      new_stmt = gimple_build_assign_with_ops(RSHIFT_EXPR, shifted, result,
+                                              build_int_cst(integer_type_node,
+                                                            shift));
+      gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+      FXLOG_STMT(2, new_stmt);
+      result = shifted;
+    }
+    new_stmt = gimple_build_assign_with_ops(NOP_EXPR, lhs, result, NULL);
+    gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+    FXLOG_STMT(2, new_stmt);
+  }
+  if (shift > 0) {
+    struct SIF shifted = *result_frmt;
+    shifted.shift = shift;
+    shifted = new_range(shifted);
+    if (shift > result_frmt->E) {
+      shifted.F = result_frmt->F + result_frmt->E - shift;
+      shifted.E = 0;
+      shifted.noise += quantization_noise(shifted.F);
+    } else {
+      shifted.E = result_frmt->E - shift;
+    }
+    shifted.shift = 0;
+    *result_frmt = shifted;
+  } else {
+    result_frmt->S -= shift;
+  }
+  result_frmt->size = lhs_size;
+}
+
+/**
+ * @brief Analyze a call, and in the last pass convert its arguments to the
+ * formats of the callee's parameters.
+ *
+ * @details The range of each real argument is recorded for the next
+ * compilation. If the callee has been summarized, the result gets the
+ * format of its return value.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * D.2051_7 = scale (x_3(D), 2.5e-1);
+ * clip (&buf, D.2050_6);
+ * @endcode
+ *
+ * @param[in,out] gsi_p    statement iterator, points to the call; on return
+ *                         it points to the last statement inserted after it
+ * @param[out]    result_p set to the ::SIF structure of the result, which is
+ *                         uninitialized if the format is not known
+ * @return        false if the formats of the arguments are not known yet
+ */
+bool ipa_call(gimple_stmt_iterator * gsi_p, struct SIF *result_p)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree fndecl = gimple_call_fndecl(stmt);
+  tree lhs = gimple_call_lhs(stmt);
+  struct IPA_SUMMARY *s = find_summary(fndecl);
+  struct SIF arg_frmt, lhs_frmt;
+  unsigned i;
+
+  initialize_format(result_p);
+  if (fxctx->lastpass && s && (NULL == s->decl))
+    record_use(s);
+  for (i = 0; i < gimple_call_num_args(stmt); i++) {
+    tree arg = gimple_call_arg(stmt, i);
+    bool summarized = s && (i < (unsigned) s->params) && s->param[i].size;
+    if (fxctx->lastpass ? !summarized :
+        !SCALAR_FLOAT_TYPE_P(TREE_TYPE(arg)))
+      continue;
+    // the call's arguments follow the function and static chain operands
+    arg_frmt = get_operand_format(stmt, i + 3, 0, PRINT);
+    if (!format_initialized(arg_frmt))
+      return false;
+    if (!fxctx->lastpass) {
+      record_site(stmt, i, arg_frmt);
+    } else {
+      struct IPA_FORMAT *parm = &s->param[i];
+      double lo, hi;
+      format_range(arg_frmt, &lo, &hi);
+      if ((hi > parm->max) || (lo < parm->min))
+        warning(0, G_("fxopt: argument %d of %qs is outside the range of "
+                      "its parameter"), i + 1, function_name(fndecl));
+      if (REAL_CST == TREE_CODE(arg))
+        arg = convert_real_constant(arg, parm->size, &arg_frmt);
+      arg = convert_argument(gsi_p, arg, arg_frmt, parm);
+      gimple_call_set_arg(stmt, i, arg);
+      update_stmt(stmt);
+    }
+  }
+  if (s && s->ret.size && (lhs != NULL_TREE)) {
+    lhs_frmt = get_operand_format(stmt, 0, 0, NOPRINT);
+    *result_p = return_format(lhs_frmt, &s->ret);
+    FXLOG(2, "  %s returns range %g to %g\n", function_name(fndecl),
+          s->ret.min, s->ret.max);
+    if (operand_word_size(lhs) != s->ret.size)
+      fit_result(gsi_p, operand_word_size(lhs), result_p);
+  }
+  if (fxctx->lastpass)
+    FXLOG_STMT(2, stmt);
+  return true;
+}
+
+/**
+ * @brief A signature of the formats that a call depends on, for the format
+ * cache.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @return    zero unless the statement is a call to a summarized function
+ */
+HOST_WIDE_INT ipa_call_signature(gimple stmt)
+{
+  struct IPA_SUMMARY *s;
+
+  if (!IPA_SUMMARY_FILE || !is_gimple_call(stmt) ||
+      (NULL_TREE == gimple_call_fndecl(stmt)) ||
+      (NULL == (s = find_summary(gimple_call_fndecl(stmt)))))
+    return 0;
+  return (HOST_WIDE_INT) summary_hash(s);
+}
+
+/**
+ * @brief Predicate for a call site that fits in a format class.
+ *
+ * @details The sites of a call fit if, for each argument, the numbers of
+ * integer bits of its range and of the ranges already in the class differ
+ * by no more than IPA_CLONE_BITS.
+ *
+ * @param[in] callee name of the function called
+ * @param[in] call   one site of the call
+ * @param[in] cls    the format class
+ * @return    true if the call fits
+ */
+static bool call_fits_class(const char *callee, struct IPA_SITE *call,
+                            int cls)
+{
+  struct IPA_SITE *a, *b;
+
+  LL_FOREACH(sites, a) {
+    if (a->stmt || strcmp(a->callee, callee) || (a->line != call->line) ||
+        strcmp(a->caller, call->caller))
+      continue;
+    LL_FOREACH(sites, b) {
+      if (b->stmt || (b->cls != cls) || (b->index != a->index) ||
+          strcmp(b->callee, callee) || (b == a))
+        continue;
+      if ((b->line == call->line) && !strcmp(b->caller, call->caller))
+        continue;               // another site of the same call
+      if (abs(range_bits(a->min, a->max) - range_bits(b->min, b->max)) >
+          IPA_CLONE_BITS)
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Divide the call sites of a function into format classes.
+ *
+ * @details The calls are taken in order, and each is put in the first class
+ * that it fits, or in a new class. When there are already IPA_MAX_CLASSES
+ * classes a call that fits none of them goes into the first class.
+ *
+ * @param[in] callee name of the function
+ * @return    the number of classes
+ */
+static int classify_calls(const char *callee)
+{
+  struct IPA_SITE *call, *site;
+  int classes = 0, cls;
+
+  LL_FOREACH(sites, call)
+      call->cls = -1;
+  LL_FOREACH(sites, call) {
+    if (call->stmt || (call->cls >= 0) || strcmp(call->callee, callee))
+      continue;
+    for (cls = 0; cls < classes; cls++) {
+      if (call_fits_class(callee, call, cls))
+        break;
+    }
+    if (cls == classes) {
+      if (classes < IPA_MAX_CLASSES)
+        classes++;
+      else
+        cls = 0;
+    }
+    LL_FOREACH(sites, site) {
+      if (!site->stmt && (site->line == call->line) &&
+          !strcmp(site->callee, callee) && !strcmp(site->caller, call->caller))
+        site->cls = cls;
+    }
+  }
+  LL_FOREACH(sites, call) {
+    if (call->cls < 0)
+      call->cls = 0;
+  }
+  return classes;
+}
+
+/**
+ * @brief Predicate for a call edge that is the call of a site.
+ */
+static bool site_edge(struct IPA_SITE *site, struct cgraph_edge *e)
+{
+  return (site->line == LOCATION_LINE(gimple_location(e->call_stmt))) &&
+      !strcmp(site->caller, function_name(e->caller->decl));
+}
+
+/**
+ * @brief Find the format class of a call edge.
+ *
+ * @return the class, or zero if the call was not seen
+ */
+static int edge_class(const char *callee, struct cgraph_edge *e)
+{
+  struct IPA_SITE *site;
+
+  LL_FOREACH(sites, site) {
+    if (!site->stmt && !strcmp(site->callee, callee) && site_edge(site, e))
+      return site->cls;
+  }
+  return 0;
+}
+
+/**
+ * @brief Clone the functions whose call sites pass very different ranges.
+ *
+ * @details This runs before the interprocedural passes, so before any
+ * function is converted. Each class of call sites after the first gets a
+ * clone of the function, and its calls are redirected to the clone. A site
+ * of a class whose calls are not in this file is moved to the first class,
+ * which the original function keeps.
+ *
+ * @param event_data not used
+ * @param data       not used
+ */
+void clone_by_format_class(void *event_data, void *data)
+{
+  struct cgraph_node *node, *clone;
+  struct cgraph_edge *e;
+  struct IPA_SITE *site;
+  struct IPA_CLONE *c;
+  int classes, cls;
+
+  for (node = cgraph_nodes; node != NULL; node = node->next) {
+    const char *callee;
+    if (!node->analyzed || (node->global.inlined_to != NULL) ||
+        function_class(node->decl) || !tree_versionable_function_p(node->decl))
+      continue;
+    callee = function_name(node->decl);
+    classes = classify_calls(callee);
+    for (cls = 1; cls < classes; cls++) {
+      VEC(cgraph_edge_p, heap) * redirect = NULL;
+      LL_FOREACH(sites, site) {
+        if (site->stmt || (site->cls != cls) || strcmp(site->callee, callee))
+          continue;
+        for (e = node->callers; e != NULL; e = e->next_caller) {
+          if (e->call_stmt && site_edge(site, e))
+            break;
+        }
+        if (NULL == e)
+          site->cls = 0;        // called from another file
+      }
+      for (e = node->callers; e != NULL; e = e->next_caller) {
+        if (e->call_stmt && (edge_class(callee, e) == cls))
+          VEC_safe_push(cgraph_edge_p, heap, redirect, e);
+      }
+      if (VEC_empty(cgraph_edge_p, redirect))
+        continue;
+      clone = cgraph_function_versioning(node, redirect, NULL, NULL, NULL,
+                                         NULL, "fxopt");
+      VEC_free(cgraph_edge_p, heap, redirect);
+      if (NULL == clone)
+        continue;
+      c = (struct IPA_CLONE *) xmalloc(sizeof(struct IPA_CLONE));
+      c->decl = clone->decl;
+      c->function = xstrdup(callee);
+      c->cls = cls;
+      LL_PREPEND(clones, c);
+      FXLOG(1, "fxopt: clone %d of %s made for its format class %d\n",
+            cls, callee, cls);
+    }
+  }
+}
+
+// vim:syntax=c.doxygen
@@ -0,0 +1,675 @@
+/**
+ * @file fxopt_loops.c
+ *
+ * @brief  Functions for the formats of variables that are carried around loops
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-20T10:41:08-0500
+ * @date Last modified: 2014-01-20T10:41:08-0500
+ *
+ * @details  A variable that is assigned in a loop and used again in the next
+ *           iteration, like the output of a recursive filter, has a range
+ *           that depends on itself. Such a variable is found from gcc's loop
+ *           tree: it is the result of a PHI node in the header of a loop,
+ *           with an argument from the loop's latch. The format stored for it
+ *           is then the join of every value assigned to it, so the passes
+ *           repeat until the ranges stop growing, with no fxiter attribute.
+ *
+ *           The ranges of a stable recurrence grow toward their limit
+ *           geometrically, which would take far too many passes. After a
+ *           range has grown WIDEN_DELAY times it is widened instead:
+ *             1. The first time, the limit of the last three ranges is
+ *                extrapolated, with a small margin. A stable first-order
+ *                filter reaches its true bound this way in one step.
+ *             2. After that, a bound that grows is moved to the largest
+ *                value that its number of integer bits can hold, so that
+ *                each further step adds an integer bit and the passes must
+ *                end within the size of the variable.
+ *           Once no range grows, each variable that was widened is narrowed:
+ *           a pass re-evaluates all of its assignments with the widened
+ *           format held fixed, and their join, if it is smaller, replaces the
+ *           format. This is repeated NARROWING times.
+ *
+ *           The values assigned to the variable are aligned with its format
+ *           in the last pass, so that every assignment, inside and before
+ *           the loop, leaves the same binary point in the variable.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "cfgloop.h"
+#include "utlist.h"
+
+/**
+ * @def   EXTRAPOLATION_MARGIN
+ * @brief An extrapolated bound is enlarged by this fraction of itself, to
+ * cover rounding in the fixed-point arithmetic.
+ */
+#define EXTRAPOLATION_MARGIN (1.0 / 256.0)
+
+/**
+ * @brief A variable that is carried around a loop.
+ */
+struct LOOP_VAR {
+  tree var;                     ///< the variable's declaration
+  tree name;                    ///< the PHI result in the loop header
+  int loop;                     ///< number of the loop, for the log
+  int expansions;               ///< times the stored range has grown
+  int history;                  ///< number of bounds in hi[] and lo[]
+  double hi[2];                 ///< the last two upper bounds, oldest first
+  double lo[2];                 ///< the last two lower bounds, oldest first
+  bool extrapolated;            ///< the limit has been extrapolated
+  bool widened;                 ///< some bound was widened
+  bool overflowed;              ///< the range did not fit, already reported
+  bool sweep;                   ///< a narrowing pass is collecting values
+  bool seen;                    ///< a value was collected in the sweep
+  bool commit;                  ///< the next store is the narrowed format
+  struct SIF narrow;            ///< join of the values collected in the sweep
+  struct LOOP_VAR *next;
+};
+
+/**
+ * @brief All of the loop-carried variables of the current function.
+ */
+static struct LOOP_VAR *loop_vars = NULL;
+/**
+ * @brief Narrowing passes done in the current function.
+ */
+static int narrowing_passes = 0;
+/**
+ * @brief True while a narrowing pass is being done.
+ */
+static bool sweeping = false;
+
+/**
+ * @brief Find the loop-carried variable that underlies an operand.
+ *
+ * @param[in] operand gcc tree for an SSA name or a declaration
+ * @return    pointer to the ::LOOP_VAR, or NULL
+ */
+static struct LOOP_VAR *find_loop_var(tree operand)
+{
+  struct LOOP_VAR *lv;
+
+  if ((NULL == loop_vars) || (NULL_TREE == operand))
+    return NULL;
+  if (SSA_NAME == TREE_CODE(operand))
+    operand = SSA_NAME_VAR(operand);
+  LL_FOREACH(loop_vars, lv) {
+    if (lv->var == operand)
+      return lv;
+  }
+  return NULL;
+}
+
+/**
+ * @brief The name of a loop-carried variable, for messages.
+ *
+ * @param[in] lv the loop-carried variable
+ * @return    the name, or "(temp)" for a temporary
+ */
+static const char *loop_var_name(struct LOOP_VAR *lv)
+{
+  return DECL_NAME(lv->var) ? IDENTIFIER_POINTER(DECL_NAME(lv->var)) :
+      "(temp)";
+}
+
+/**
+ * @brief Predicate for an operand whose variable is carried around a loop.
+ *
+ * @param[in] operand gcc tree for an SSA name or a declaration
+ * @return    true if the variable was found by find_loop_vars()
+ */
+bool is_loop_var(tree operand)
+{
+  return (NULL != find_loop_var(operand));
+}
+
+/**
+ * @brief Predicate for a PHI node that carries a variable around a loop.
+ *
+ * @param[in] loop the loop
+ * @param[in] phi  a PHI node in the loop's header
+ * @return    true if a value of the PHI result's variable that is assigned in
+ *            the loop reaches the PHI node
+ */
+static bool loop_carried_phi(struct loop *loop, gimple phi)
+{
+  tree name = gimple_phi_result(phi);
+  tree var = SSA_NAME_VAR(name);
+  edge e;
+  edge_iterator ei;
+
+  FOR_EACH_EDGE(e, ei, loop->header->preds) {
+    tree arg = PHI_ARG_DEF_FROM_EDGE(phi, e);
+    if (flow_bb_inside_loop_p(loop, e->src) &&
+        (SSA_NAME == TREE_CODE(arg)) && (SSA_NAME_VAR(arg) == var) &&
+        (arg != name))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Find the real variables that are carried around a loop, before
+ * their formats are known.
+ *
+ * @details Used by mark_accumulators() to find running sums, which are
+ * chosen before the formats of the declared variables are set.
+ *
+ * @param[out] carried bitmap of the DECL_UIDs of the variables
+ */
+void find_loop_carried(bitmap carried)
+{
+  loop_iterator li;
+  struct loop *loop;
+  gimple_stmt_iterator gsi;
+
+  loop_optimizer_init(AVOID_CFG_MODIFICATIONS);
+  FOR_EACH_LOOP(li, loop, 0) {
+    for (gsi = gsi_start_phis(loop->header); !gsi_end_p(gsi);
+         gsi_next(&gsi)) {
+      gimple phi = gsi_stmt(gsi);
+      tree var = SSA_NAME_VAR(gimple_phi_result(phi));
+      if ((VAR_DECL == TREE_CODE(var)) &&
+          SCALAR_FLOAT_TYPE_P(TREE_TYPE(var)) && loop_carried_phi(loop, phi))
+        bitmap_set_bit(carried, DECL_UID(var));
+    }
+  }
+  loop_optimizer_finalize();
+}
+
+/**
+ * @brief Find the variables of the current function that are carried around
+ * a loop.
+ *
+ * @details Called after the formats of the declared variables are set.
+ * Variables with an fxfrmt or fxiter attribute keep the format that the
+ * attribute gives them. Function parameters are not included, since their
+ * format is fixed by the caller.
+ */
+void find_loop_vars()
+{
+  struct LOOP_VAR *lv, *tmp;
+  loop_iterator li;
+  struct loop *loop;
+  gimple_stmt_iterator gsi;
+  int count = 0;
+
+  LL_FOREACH_SAFE(loop_vars, lv, tmp) {
+    LL_DELETE(loop_vars, lv);
+    free(lv);
+  }
+  narrowing_passes = 0;
+  sweeping = false;
+
+  FXLOG(1, "  ===== Finding loop-carried variables =====\n");
+  loop_optimizer_init(AVOID_CFG_MODIFICATIONS);
+  FOR_EACH_LOOP(li, loop, 0) {
+    for (gsi = gsi_start_phis(loop->header); !gsi_end_p(gsi);
+         gsi_next(&gsi)) {
+      gimple phi = gsi_stmt(gsi);
+      tree name = gimple_phi_result(phi);
+      tree var = SSA_NAME_VAR(name);
+
+      if ((VAR_DECL != TREE_CODE(var)) ||
+          !SCALAR_FLOAT_TYPE_P(TREE_TYPE(var)) || is_loop_var(var) ||
+          !loop_carried_phi(loop, phi))
+        continue;
+      const struct SIF *fmt =
+          get_format_ptr(calc_hash_key(var, 0, NOT_AN_ARRAY));
+      if ((NULL == fmt) || fmt->has_attribute || fmt->iter || fmt->ptr_op)
+        continue;
+      lv = (struct LOOP_VAR *) xcalloc(1, sizeof(struct LOOP_VAR));
+      lv->var = var;
+      lv->name = name;
+      lv->loop = loop->num;
+      initialize_format(&lv->narrow);
+      LL_PREPEND(loop_vars, lv);
+      count++;
+      FXLOG(2, "  %s is carried around loop %d\n", loop_var_name(lv),
+            loop->num);
+    }
+  }
+  loop_optimizer_finalize();
+  FXLOG(1, "  %d loop-carried variables\n", count);
+}
+
+/**
+ * @brief Convert a bound to a real value.
+ *
+ * @param[in] x  the bound
+ * @param[in] bp number of bits to the right of the binary point
+ * @return    the real value
+ */
+static double bound_to_real(double_int x, int bp)
+{
+  return ldexp((double) double_int_to_shwi(x), -bp);
+}
+
+/**
+ * @brief Join one format into another.
+ *
+ * @details The join has the binary point of the format with fewer fraction
+ * bits, the larger number of integer bits, and a range that covers both.
+ *
+ * @param[in,out] fmt_p pointer to the format, replaced by the join
+ * @param[in]     other the other format
+ */
+static void join_formats(struct SIF *fmt_p, struct SIF other)
+{
+  int bp = fmt_p->F + fmt_p->E;
+  int other_bp = other.F + other.E;
+  int join_bp = MIN(bp, other_bp);
+  double_int max, min;
+
+  max = double_int_smax(align_bound(fmt_p->max, bp, join_bp, true),
+                        align_bound(other.max, other_bp, join_bp, true));
+  min = double_int_smin(align_bound(fmt_p->min, bp, join_bp, false),
+                        align_bound(other.min, other_bp, join_bp, false));
+  if (other_bp < bp) {
+    fmt_p->F = other.F;
+    fmt_p->E = other.E;
+  }
+  fmt_p->I = MAX(fmt_p->I, other.I);
+  fmt_p->S = fmt_p->size - fmt_p->I - fmt_p->F - fmt_p->E;
+  fmt_p->max = max;
+  fmt_p->min = min;
+  fmt_p->noise = MAX(fmt_p->noise, other.noise);
+}
+
+/**
+ * @brief Give a format enough integer bits for its range.
+ *
+ * @details Sign bits are used first. If there are too few, the binary point
+ * is moved right. A range that does not fit in the variable at all is
+ * saturated, as it would be at run time.
+ *
+ * @param[in]     lv    the loop-carried variable
+ * @param[in,out] fmt_p pointer to the format
+ */
+static void cover_range(struct LOOP_VAR *lv, struct SIF *fmt_p)
+{
+  int bp = fmt_p->F + fmt_p->E;
+  int need = ceil_log2_range(*fmt_p) - bp;
+
+  if (need > fmt_p->I) {
+    fmt_p->S -= need - fmt_p->I;
+    fmt_p->I = need;
+  }
+  if (fmt_p->S >= fmt_p->sgnd)
+    return;
+
+  int count = MIN(fmt_p->sgnd - fmt_p->S, bp);
+  fmt_p->S += count;
+  if (count <= fmt_p->E) {
+    fmt_p->E -= count;
+  } else {
+    fmt_p->F -= count - fmt_p->E;
+    fmt_p->E = 0;
+  }
+  fmt_p->max = align_bound(fmt_p->max, bp, bp - count, true);
+  fmt_p->min = align_bound(fmt_p->min, bp, bp - count, false);
+  if (fmt_p->S < fmt_p->sgnd) {
+    if (!lv->overflowed)
+      warning(0, G_("fxopt: range of %qs grows without bound in loop %d"),
+              loop_var_name(lv), lv->loop);
+    lv->overflowed = true;
+    fmt_p->I = fmt_p->size - fmt_p->sgnd;
+    fmt_p->S = fmt_p->sgnd;
+    fmt_p->max = double_int_smin(fmt_p->max, double_int_mask(fmt_p->I));
+    fmt_p->min = double_int_smax(fmt_p->min,
+                                 double_int_neg(double_int_mask(fmt_p->I)));
+  }
+}
+
+/**
+ * @brief Widen an upper bound to the largest value of its integer bits.
+ *
+ * @param[in] max the bound
+ * @return    the widened bound
+ */
+static double_int widen_max(double_int max)
+{
+  int bits = 0;
+
+  if (!double_int_positive_p(max))
+    return double_int_zero;
+  while (!double_int_zero_p(max)) {
+    max = double_int_rshift(max, 1, HOST_BITS_PER_DOUBLE_INT, LOGICAL);
+    bits++;
+  }
+  return double_int_mask(bits);
+}
+
+/**
+ * @brief Widen a lower bound to the smallest value of its integer bits.
+ *
+ * @param[in] min the bound
+ * @return    the widened bound
+ */
+static double_int widen_min(double_int min)
+{
+  if (!double_int_negative_p(min))
+    return double_int_zero;
+  return double_int_neg(widen_max(double_int_neg(min)));
+}
+
+/**
+ * @brief Extrapolate the limit of three growing upper bounds.
+ *
+ * @details If the steps between the bounds shrink, they are assumed to form a
+ * geometric series, whose sum gives the limit.
+ *
+ * @param[in] b0 the oldest bound
+ * @param[in] b1 the next bound
+ * @param[in] b2 the newest bound
+ * @return    the limit, or b2 if the steps do not shrink
+ */
+static double extrapolate(double b0, double b1, double b2)
+{
+  double d1 = b1 - b0;
+  double d2 = b2 - b1;
+
+  if ((d1 <= 0.0) || (d2 <= 0.0) || (d2 >= d1))
+    return b2;
+  double limit = b2 + d2 * (d2 / d1) / (1.0 - d2 / d1);
+  return limit + fabs(limit) * EXTRAPOLATION_MARGIN;
+}
+
+/**
+ * @brief Convert an extrapolated bound back to a double_int.
+ *
+ * @param[in] x     the real bound
+ * @param[in] bp    number of bits to the right of the binary point
+ * @param[in] up    round an upper bound up, else a lower bound down
+ * @param[in] bound the bound to use if x is too large to convert
+ * @return    the bound
+ */
+static double_int real_to_bound(double x, int bp, bool up, double_int bound)
+{
+  double scaled = ldexp(x, bp);
+
+  if (fabs(scaled) >= ldexp(1.0, HOST_BITS_PER_WIDE_INT - 2))
+    return bound;
+  return shwi_to_double_int((HOST_WIDE_INT) (up ? ceil(scaled) :
+                                             floor(scaled)));
+}
+
+/**
+ * @brief Widen the range of a loop-carried variable that keeps growing.
+ *
+ * @param[in]     lv    the loop-carried variable
+ * @param[in,out] fmt_p pointer to the joined format
+ */
+static void widen_range(struct LOOP_VAR *lv, struct SIF *fmt_p)
+{
+  int bp = fmt_p->F + fmt_p->E;
+  double hi = bound_to_real(fmt_p->max, bp);
+  double lo = bound_to_real(fmt_p->min, bp);
+  bool hi_grew = (lv->history > 0) && (hi > lv->hi[1]);
+  bool lo_grew = (lv->history > 0) && (lo < lv->lo[1]);
+
+  if (lv->expansions > WIDEN_DELAY) {
+    double_int max = hi_grew ? widen_max(fmt_p->max) : fmt_p->max;
+    double_int min = lo_grew ? widen_min(fmt_p->min) : fmt_p->min;
+    if (!lv->extrapolated && (lv->history == 2)) {
+      double limit;
+      lv->extrapolated = true;
+      limit = extrapolate(lv->hi[0], lv->hi[1], hi);
+      if (hi_grew && (limit > hi))
+        max = real_to_bound(limit, bp, true, max);
+      limit = -extrapolate(-lv->lo[0], -lv->lo[1], -lo);
+      if (lo_grew && (limit < lo))
+        min = real_to_bound(limit, bp, false, min);
+    }
+    fmt_p->max = max;
+    fmt_p->min = min;
+    lv->widened = true;
+    if (LOG_ENABLED(2)) {
+      fprintf(fxlog, "  Widened range of %s", loop_var_name(lv));
+      print_min_max(*fmt_p);
+    }
+  }
+  if (lv->history == 2) {
+    lv->hi[0] = lv->hi[1];
+    lv->lo[0] = lv->lo[1];
+  } else {
+    lv->history++;
+  }
+  lv->hi[lv->history - 1] = bound_to_real(fmt_p->max, bp);
+  lv->lo[lv->history - 1] = bound_to_real(fmt_p->min, bp);
+}
+
+/**
+ * @brief Replace the affine definition of a loop-carried variable with one
+ * for its range.
+ *
+ * @details The definition of a value assigned in the loop refers to the
+ * variable's value in the previous iteration, and would get longer with
+ * every pass.
+ *
+ * @param[in,out] fmt_p pointer to the format
+ */
+static void collapse_aa(struct SIF *fmt_p)
+{
+  if (!AFFINE)
+    return;
+  range_to_aa(fmt_p, fxctx->next_error_id++);
+}
+
+/**
+ * @brief Decide whether a value assigned to a loop-carried variable is
+ * stored.
+ *
+ * @details In the last pass the formats are final. During a narrowing pass
+ * the value is only collected, and the variable keeps its widened format
+ * until the pass is done.
+ *
+ * @param[in] var         the variable's declaration
+ * @param[in] result_frmt format of the value
+ * @return    true if the value must not be stored
+ */
+bool keep_loop_var(tree var, struct SIF result_frmt)
+{
+  struct LOOP_VAR *lv = find_loop_var(var);
+
+  if (NULL == lv)
+    return false;
+  if (fxctx->lastpass)
+    return true;
+  if (!lv->sweep)
+    return false;
+  result_frmt.aa = NULL;
+  if (!lv->seen) {
+    lv->narrow = result_frmt;
+    lv->seen = true;
+  } else {
+    join_formats(&lv->narrow, result_frmt);
+  }
+  return true;
+}
+
+/**
+ * @brief Join a value assigned to a loop-carried variable with the format
+ * already stored for it.
+ *
+ * @param[in]     var     the variable's declaration
+ * @param[in,out] fmt_p   pointer to the format of the value, replaced by the
+ *                        format to be stored
+ * @param[in]     var_fmt pointer to the format stored for the variable
+ * @return        nonzero if the stored format will change
+ */
+int join_loop_var(tree var, struct SIF *fmt_p, struct SIF *var_fmt)
+{
+  struct LOOP_VAR *lv = find_loop_var(var);
+  int changed;
+
+  if (lv->commit) {
+    lv->commit = false;
+    collapse_aa(fmt_p);
+    return 1;
+  }
+  if (!format_initialized(*var_fmt) ||
+      (double_int_scmp(var_fmt->max, var_fmt->min) == -1)) {
+    cover_range(lv, fmt_p);
+    collapse_aa(fmt_p);
+    return 0;
+  }
+  join_formats(fmt_p, *var_fmt);
+  if (INTERVAL && (range_compare(*fmt_p, *var_fmt) == 1)) {
+    lv->expansions++;
+    widen_range(lv, fmt_p);
+  }
+  cover_range(lv, fmt_p);
+  changed = (fmt_p->S != var_fmt->S) || (fmt_p->I != var_fmt->I) ||
+      (fmt_p->F != var_fmt->F) || (fmt_p->E != var_fmt->E);
+  if (INTERVAL && (range_compare(*fmt_p, *var_fmt) != 0))
+    changed = 1;
+  collapse_aa(fmt_p);
+  return changed;
+}
+
+/**
+ * @brief Align a value assigned to a loop-carried variable with the
+ * variable's format.
+ *
+ * @details The format is aligned by align_store_to_format(). On the last
+ * pass the shift it asks for is inserted after the statement that defines the
+ * value. A value with fewer fraction bits is not shifted, and moves the
+ * variable's binary point for the next pass.
+ *
+ * @param[in] gsi_p       statement iterator, points to the last statement
+ *                        made for the assignment
+ * @param[in] var_frmt    format stored for the variable
+ * @param[in] lhs         the SSA name that is assigned
+ * @param[in] result_frmt format of the value
+ * @return    format of the aligned value
+ */
+struct SIF loop_var_store(gimple_stmt_iterator * gsi_p, struct SIF var_frmt,
+                          tree lhs, struct SIF result_frmt)
+{
+  struct LOOP_VAR *lv = find_loop_var(lhs);
+
+  if ((NULL == lv) || (SSA_NAME != TREE_CODE(lhs)) ||
+      (lv->sweep && !fxctx->lastpass))
+    return result_frmt;
+
+  struct SIF aligned_frmt = result_frmt;
+  int bp_diff = align_store_to_format(&aligned_frmt, var_frmt);
+  if (bp_diff < 0)
+    return result_frmt;
+  if ((bp_diff > 0) && fxctx->lastpass) {
+    gimple def = SSA_NAME_DEF_STMT(lhs);
+    tree unaligned = make_rename_temp(TREE_TYPE(lhs), "_fx_unaligned0");
+    gimple new_stmt;
+    if (!is_gimple_assign(def) && !is_gimple_call(def)) {
+      error("fxopt: cannot align the value of a loop-carried variable");
+      return result_frmt;
+    }
+    gimple_set_lhs(def, unaligned);
+    update_stmt(def);
+    new_stmt = gimple_build_assign_with_ops(RSHIFT_EXPR, lhs, unaligned,
+                                            build_int_cst(integer_type_node,
+                                                          bp_diff));
+    if (def == gsi_stmt(*gsi_p)) {
+      gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+    } else {
+      gimple_stmt_iterator def_gsi = gsi_for_stmt(def);
+      gsi_insert_after(&def_gsi, new_stmt, GSI_SAME_STMT);
+    }
+    FXLOG_STMT(2, new_stmt);
+  }
+  FXLOG(2, "  Loop variable store (%2d/%2d/%2d/%2d)\n", aligned_frmt.S,
+        aligned_frmt.I, aligned_frmt.F, aligned_frmt.E);
+  return aligned_frmt;
+}
+
+/**
+ * @brief Find the latest format stored for a variable.
+ *
+ * @param[in] var the variable's declaration
+ * @return    pointer to the format, or NULL
+ */
+static const struct SIF *latest_format(tree var)
+{
+  const struct SIF *fmt = NULL;
+  int pass = fxctx->fxpass;
+
+  while ((NULL == fmt) && (pass >= 0))
+    fmt = get_format_ptr(calc_hash_key(var, pass--, NOT_AN_ARRAY));
+  return fmt;
+}
+
+/**
+ * @brief Narrow the formats of the loop-carried variables that were widened.
+ *
+ * @details Called when the passes have found formats for every statement. If
+ * a narrowing pass was just done, the narrower formats that it found are
+ * stored and their uses are revisited. Otherwise, if any variable was
+ * widened, another narrowing pass is started: every assignment to a widened
+ * variable is marked to be analyzed again.
+ *
+ * @return true if another pass is needed
+ */
+bool narrow_loop_vars()
+{
+  struct LOOP_VAR *lv;
+  bool changed = false;
+
+  if (sweeping) {
+    sweeping = false;
+    LL_FOREACH(loop_vars, lv) {
+      if (!lv->sweep)
+        continue;
+      lv->sweep = false;
+      const struct SIF *var_fmt = latest_format(lv->var);
+      if (!lv->seen || (NULL == var_fmt) ||
+          (range_compare(lv->narrow, *var_fmt) != -1))
+        continue;
+      lv->commit = true;
+      set_var_format(lv->name, lv->narrow);
+      revisit_var_uses(lv->name);
+      lv->expansions = lv->history = 0;
+      lv->extrapolated = false;
+      changed = true;
+      if (LOG_ENABLED(2)) {
+        fprintf(fxlog, "  Narrowed range of %s", loop_var_name(lv));
+        print_min_max(lv->narrow);
+      }
+    }
+    if (changed)
+      return true;
+  }
+  if (!INTERVAL || (narrowing_passes >= NARROWING))
+    return false;
+  LL_FOREACH(loop_vars, lv) {
+    if (lv->widened) {
+      lv->sweep = true;
+      lv->seen = false;
+      sweeping = true;
+    }
+  }
+  if (!sweeping)
+    return false;
+  narrowing_passes++;
+  FXLOG(1, "  ===== Narrowing pass %d =====\n", narrowing_passes);
+  LL_FOREACH(loop_vars, lv) {
+    if (lv->sweep)
+      revisit_var_defs(lv->var);
+  }
+  return true;
+}
+
+// vim:syntax=c.doxygen
@@ -0,0 +1,887 @@
+/**
+ * @file fxopt_math.c
+ *
+ * @brief  Functions for replacing math library calls with fixed-point kernels
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-14T10:21:07-0500
+ * @date Last modified: 2014-01-14T10:21:07-0500
+ *
+ * @details  A call to sqrt, sin, cos, exp, log or atan2 (or their float and
+ *           long double versions) in a converted function is analyzed like
+ *           any other operation. The format of the result is found from the
+ *           range of the argument and the range of the function over it, so
+ *           the result's range is known to the interval and affine analysis.
+ *           On the last pass the call is replaced by a kernel that is built
+ *           for the formats of the argument and the result:
+ *
+ *             - sqrt: the argument is normalized by counting its leading
+ *               zeros, then the reciprocal square root is refined from a
+ *               linear estimate by Newton-Raphson iterations
+ *             - sin, cos: if the argument can be as large as sqrt(2) it is
+ *               reduced to a multiple of pi/2 plus a remainder, and the
+ *               remainder is put into truncated Taylor polynomials; the
+ *               number of terms is the fewest for which the error bound is
+ *               less than an LSB of the result, over the remainder's range
+ *             - exp: the argument is reduced to k*ln(2) + r, the polynomial
+ *               for exp(r) is scaled by 2^k
+ *             - log: the argument is normalized to m * 2^e, with m in
+ *               [1, 2), and the bits of log2(m) are found one at a time by
+ *               squaring m
+ *             - atan2: the vector is rotated into the right half plane, and
+ *               then to the x axis by unrolled CORDIC iterations, one for
+ *               each bit of the result
+ *
+ *           Intermediate products use an integer type twice the size of the
+ *           result. The result is not saturated, so an argument outside the
+ *           function's domain, such as a negative value for sqrt or log,
+ *           gives a meaningless result.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+
+// math.h only defines these constants for some feature test macros
+#ifndef M_PI
+#  define M_PI   3.14159265358979323846
+#  define M_PI_2 1.57079632679489661923
+#  define M_PI_4 0.78539816339744830962
+#  define M_LN2  0.69314718055994530942
+#endif
+#ifndef M_SQRT2
+#  define M_SQRT2 1.41421356237309504880
+#endif
+
+/**
+ * @def   MAX_TERMS
+ * @brief Largest number of terms in a polynomial.
+ */
+#define MAX_TERMS 16
+
+/**
+ * @def   SQRT_SEED_BITS
+ * @brief Number of correct bits in the first estimate of a reciprocal
+ * square root.
+ */
+#define SQRT_SEED_BITS 3
+
+/**
+ * @brief The math functions that are replaced.
+ */
+enum FXMATH_FUNC {
+  MATH_NONE,
+  MATH_SQRT,
+  MATH_SIN,
+  MATH_COS,
+  MATH_EXP,
+  MATH_LOG,
+  MATH_ATAN2
+};
+
+static const char *math_name[] = { "", "sqrt", "sin", "cos", "exp", "log",
+  "atan2"
+};
+
+/**
+ * @brief Everything needed to insert the statements of a kernel.
+ */
+struct KERNEL {
+  gimple_stmt_iterator *gsi_p;  ///< the call being replaced
+  int n;                        ///< size of the result, in bits
+  tree stype;                   ///< signed type of the result
+  tree utype;                   ///< unsigned type of the same size
+  tree wtype;                   ///< signed type of twice the size
+  tree uwtype;                  ///< unsigned type of twice the size
+};
+
+/**
+ * @brief Find which math function a statement calls.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @return    the function, or MATH_NONE if it is not a call to one that is
+ *            replaced
+ */
+static enum FXMATH_FUNC math_function(gimple stmt)
+{
+  tree fndecl;
+
+  if (!is_gimple_call(stmt) || (gimple_call_lhs(stmt) == NULL_TREE))
+    return MATH_NONE;
+  fndecl = gimple_call_fndecl(stmt);
+  if ((fndecl == NULL_TREE) || (DECL_BUILT_IN_CLASS(fndecl) != BUILT_IN_NORMAL))
+    return MATH_NONE;
+  switch (DECL_FUNCTION_CODE(fndecl)) {
+    CASE_FLT_FN(BUILT_IN_SQRT):
+      return MATH_SQRT;
+    CASE_FLT_FN(BUILT_IN_SIN):
+      return MATH_SIN;
+    CASE_FLT_FN(BUILT_IN_COS):
+      return MATH_COS;
+    CASE_FLT_FN(BUILT_IN_EXP):
+      return MATH_EXP;
+    CASE_FLT_FN(BUILT_IN_LOG):
+      return MATH_LOG;
+    CASE_FLT_FN(BUILT_IN_ATAN2):
+      return MATH_ATAN2;
+    default:
+      return MATH_NONE;
+  }
+}
+
+/**
+ * @brief Predicate for a call to a math function that is replaced by a
+ * fixed-point kernel.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @return    true if the statement is such a call
+ */
+bool is_math_call(gimple stmt)
+{
+  return math_function(stmt) != MATH_NONE;
+}
+
+/**
+ * @brief Find the real range of a variable.
+ *
+ * @details If the range is not known, the range that the format can
+ * represent is used.
+ *
+ * @param[in]  s    pointer to ::SIF structure
+ * @param[out] lo_p set to the smallest value
+ * @param[out] hi_p set to the largest value
+ */
+static void real_range(struct SIF *s, double *lo_p, double *hi_p)
+{
+  int bp = s->F + s->E;
+
+  if (double_int_scmp(s->max, s->min) < 0) {   // range is undefined
+    *hi_p = ldexp(1.0, s->I);
+    *lo_p = s->sgnd ? -*hi_p : 0.0;
+  } else {
+    *hi_p = ldexp((double) double_int_to_shwi(s->max), -bp);
+    *lo_p = ldexp((double) double_int_to_shwi(s->min), -bp);
+  }
+}
+
+/**
+ * @brief Find the range of a math function's result.
+ *
+ * @param[in]  func       the function
+ * @param[in]  arg_frmt   ::SIF structures of the arguments
+ * @param[out] lo_p       set to the smallest value of the result
+ * @param[out] hi_p       set to the largest value of the result
+ */
+static void math_range(enum FXMATH_FUNC func, struct SIF arg_frmt[],
+                       double *lo_p, double *hi_p)
+{
+  double lo, hi;
+
+  real_range(&arg_frmt[0], &lo, &hi);
+  switch (func) {
+    case MATH_SQRT:
+      *lo_p = sqrt(MAX(lo, 0.0));
+      *hi_p = sqrt(MAX(hi, 0.0));
+      break;
+    case MATH_SIN:
+      if ((lo >= -M_PI_2) && (hi <= M_PI_2)) {
+        *lo_p = sin(lo);
+        *hi_p = sin(hi);
+      } else {
+        *lo_p = -1.0;
+        *hi_p = 1.0;
+      }
+      break;
+    case MATH_COS:
+      if ((lo >= -M_PI) && (hi <= M_PI)) {
+        *hi_p = ((lo <= 0.0) && (hi >= 0.0)) ? 1.0 : MAX(cos(lo), cos(hi));
+        *lo_p = MIN(cos(lo), cos(hi));
+      } else {
+        *lo_p = -1.0;
+        *hi_p = 1.0;
+      }
+      break;
+    case MATH_EXP:
+      *lo_p = exp(lo);
+      *hi_p = exp(hi);
+      break;
+    case MATH_LOG:
+      // the smallest positive value of the argument is one LSB
+      lo = MAX(lo, ldexp(1.0, -(arg_frmt[0].F + arg_frmt[0].E)));
+      hi = MAX(hi, lo);
+      *lo_p = log(lo);
+      *hi_p = log(hi);
+      break;
+    case MATH_ATAN2:
+      *lo_p = -M_PI;
+      *hi_p = M_PI;
+      break;
+    default:
+      *lo_p = *hi_p = 0.0;
+  }
+}
+
+/**
+ * @brief Build the format of a math function's result from its range.
+ *
+ * @details The result has one sign bit and as many integer bits as its range
+ * needs, with a small margin for the error of the kernel. The rest of the
+ * bits are fraction bits. The affine definition of the result is its center
+ * plus a new error term.
+ *
+ * @param[in] lhs_frmt ::SIF structure of the call's LHS
+ * @param[in] size     number of bits in the result
+ * @param[in] lo       smallest value of the result
+ * @param[in] hi       largest value of the result
+ * @return    ::SIF structure for the result
+ */
+static struct SIF math_result_format(struct SIF lhs_frmt, int size, double lo,
+                                     double hi)
+{
+  struct SIF result_frmt = lhs_frmt;
+  double peak = MAX(fabs(lo), fabs(hi)) * 1.001;
+
+  result_frmt.aa = NULL;
+  result_frmt.size = size;
+  result_frmt.sgnd = 1;
+  result_frmt.S = 1;
+  result_frmt.I = (peak > 0.0) ? MAX((int) floor(log2(peak)) + 1, 0) : 0;
+  result_frmt.F = size - 1 - result_frmt.I;
+  result_frmt.E = 0;
+  result_frmt.originalF = result_frmt.F;
+  result_frmt.shift = 0;
+  result_frmt.iv = 0;
+  if (result_frmt.F < 0) {
+    error("fxopt: range of a math function result is too large");
+    result_frmt.F = 0;
+    result_frmt.I = size - 1;
+  }
+  result_frmt.max =
+      shwi_to_double_int((HOST_WIDE_INT) ceil(ldexp(hi, result_frmt.F)));
+  result_frmt.min =
+      shwi_to_double_int((HOST_WIDE_INT) floor(ldexp(lo, result_frmt.F)));
+  if (AFFINE)
+    range_to_aa(&result_frmt, fxctx->next_error_id++);
+  result_frmt.noise = quantization_noise(result_frmt.F);
+  return result_frmt;
+}
+
+/**
+ * @brief Insert a statement with two operands before the call.
+ *
+ * @param[in] k    the kernel
+ * @param[in] code the operation
+ * @param[in] type type of the result
+ * @param[in] op1  first operand
+ * @param[in] op2  second operand, or NULL
+ * @return    the new result variable
+ */
+static tree insert_math_stmt(struct KERNEL *k, enum tree_code code, tree type,
+                             tree op1, tree op2)
+{
+  tree var = make_rename_temp(type, "_fx_math0");
+  gimple new_stmt = gimple_build_assign_with_ops(code, var, op1, op2);
+
+  gsi_insert_before(k->gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return var;
+}
+
+/**
+ * @brief Build an integer constant for a real value.
+ *
+ * @param[in] type   type of the constant
+ * @param[in] value  the real value
+ * @param[in] f_bits number of fraction bits
+ * @return    the constant, rounded to the nearest integer
+ */
+static tree real_cst(tree type, double value, int f_bits)
+{
+  return build_int_cst(type, (HOST_WIDE_INT) floor(ldexp(value, f_bits) + 0.5));
+}
+
+/**
+ * @brief Build the integer constant 2^bits.
+ */
+static tree power_of_two_cst(tree type, int bits)
+{
+  return double_int_to_tree(type, double_int_lshift(double_int_one, bits,
+                                                    HOST_BITS_PER_DOUBLE_INT,
+                                                    LOGICAL));
+}
+
+/**
+ * @brief Convert a value to another integer type.
+ *
+ * @details Constants are folded rather than converted by a statement.
+ */
+static tree convert_to(struct KERNEL *k, tree type, tree op)
+{
+  if (TREE_CODE(op) == INTEGER_CST)
+    return fold_convert(type, op);
+  if (TREE_TYPE(op) == type)
+    return op;
+  return insert_math_stmt(k, NOP_EXPR, type, op, NULL);
+}
+
+/**
+ * @brief Shift a value by a constant, left if the count is positive and
+ * right if it is negative.
+ */
+static tree shift_by(struct KERNEL *k, tree op, int count)
+{
+  if (count > 0)
+    return insert_math_stmt(k, LSHIFT_EXPR, TREE_TYPE(op), op,
+                            build_int_cst(integer_type_node, count));
+  if (count < 0)
+    return insert_math_stmt(k, RSHIFT_EXPR, TREE_TYPE(op), op,
+                            build_int_cst(integer_type_node, -count));
+  return op;
+}
+
+/**
+ * @brief Multiply two fixed-point values of the result's size.
+ *
+ * @details The product is done in the double-size type, then shifted right
+ * and truncated to the result's size.
+ *
+ * @param[in] k     the kernel
+ * @param[in] op1   first operand
+ * @param[in] op2   second operand
+ * @param[in] shift number of fraction bits to discard from the product
+ * @return    the product
+ */
+static tree fx_multiply(struct KERNEL *k, tree op1, tree op2, int shift)
+{
+  tree product = insert_math_stmt(k, MULT_EXPR, k->wtype,
+                                  convert_to(k, k->wtype, op1),
+                                  convert_to(k, k->wtype, op2));
+
+  product = shift_by(k, product, -shift);
+  return convert_to(k, k->stype, product);
+}
+
+/**
+ * @brief Evaluate a polynomial by Horner's rule.
+ *
+ * @param[in] k      the kernel
+ * @param[in] x      the variable, with f_bits fraction bits
+ * @param[in] coeff  the coefficients, lowest degree first
+ * @param[in] terms  number of coefficients, at least 2
+ * @param[in] f_bits number of fraction bits in every value
+ * @return    the value of the polynomial, with f_bits fraction bits
+ */
+static tree fx_polynomial(struct KERNEL *k, tree x, const double coeff[],
+                          int terms, int f_bits)
+{
+  tree p = real_cst(k->stype, coeff[terms - 1], f_bits);
+  int j;
+
+  for (j = terms - 2; j >= 0; j--) {
+    p = fx_multiply(k, p, x, f_bits);
+    p = insert_math_stmt(k, PLUS_EXPR, k->stype, p,
+                         real_cst(k->stype, coeff[j], f_bits));
+  }
+  return p;
+}
+
+/**
+ * @brief Find a mask that is all ones if a value is negative, else zero.
+ */
+static tree sign_mask(struct KERNEL *k, tree op)
+{
+  return insert_math_stmt(k, RSHIFT_EXPR, TREE_TYPE(op), op,
+                          build_int_cst(integer_type_node,
+                                        TYPE_PRECISION(TREE_TYPE(op)) - 1));
+}
+
+/**
+ * @brief Negate a value if a mask is all ones.
+ *
+ * @param[in] k    the kernel
+ * @param[in] op   the value, which may be a constant
+ * @param[in] mask zero or all ones, of the same type as the value
+ * @return    the value or its negation
+ */
+static tree negate_if(struct KERNEL *k, tree op, tree mask)
+{
+  tree t = insert_math_stmt(k, BIT_XOR_EXPR, TREE_TYPE(mask), mask, op);
+
+  return insert_math_stmt(k, MINUS_EXPR, TREE_TYPE(mask), t, mask);
+}
+
+/**
+ * @brief Multiply a value by 2^count, where the count is a variable that
+ * may be negative.
+ *
+ * @details Right shifts are limited to the size of the value, so a very
+ * negative count gives zero or -1 rather than an undefined shift.
+ */
+static tree scale_by_power(struct KERNEL *k, tree op, tree count)
+{
+  tree zero = build_int_cst(integer_type_node, 0);
+  tree left, right;
+
+  left = insert_math_stmt(k, MAX_EXPR, integer_type_node, count, zero);
+  right = insert_math_stmt(k, NEGATE_EXPR, integer_type_node, count, NULL);
+  right = insert_math_stmt(k, MAX_EXPR, integer_type_node, right, zero);
+  right = insert_math_stmt(k, MIN_EXPR, integer_type_node, right,
+                           build_int_cst(integer_type_node,
+                                         TYPE_PRECISION(TREE_TYPE(op)) - 1));
+  op = insert_math_stmt(k, LSHIFT_EXPR, TREE_TYPE(op), op, left);
+  return insert_math_stmt(k, RSHIFT_EXPR, TREE_TYPE(op), op, right);
+}
+
+/**
+ * @brief Reduce an argument by a multiple of a constant.
+ *
+ * @details Finds the nearest integer q to x/c, and the remainder x - q*c.
+ *
+ * @param[in]  k      the kernel
+ * @param[in]  x      the argument, with x_bits fraction bits
+ * @param[in]  x_bits number of fraction bits in the argument
+ * @param[in]  c      the constant
+ * @param[in]  f_bits number of fraction bits in the remainder
+ * @param[out] q_p    set to q, in the double-size type
+ * @return     the remainder, in the result's type
+ */
+static tree reduce_argument(struct KERNEL *k, tree x, int x_bits, double c,
+                            int f_bits, tree * q_p)
+{
+  int c_bits = k->n - 2;
+  tree xw = convert_to(k, k->wtype, x);
+  tree q, r;
+
+  q = insert_math_stmt(k, MULT_EXPR, k->wtype, xw,
+                       real_cst(k->wtype, 1.0 / c, c_bits));
+  q = insert_math_stmt(k, PLUS_EXPR, k->wtype, q,
+                       power_of_two_cst(k->wtype, x_bits + c_bits - 1));
+  q = shift_by(k, q, -(x_bits + c_bits));
+  r = insert_math_stmt(k, MULT_EXPR, k->wtype, q,
+                       real_cst(k->wtype, c, f_bits));
+  r = insert_math_stmt(k, MINUS_EXPR, k->wtype, shift_by(k, xw,
+                                                         f_bits - x_bits), r);
+  *q_p = q;
+  return convert_to(k, k->stype, r);
+}
+
+/**
+ * @brief Number of terms in a truncated Taylor series.
+ *
+ * @details Terms are added until the next one, at the largest magnitude of
+ * the variable, is less than half an LSB.
+ *
+ * @param[in] coeff  the coefficients, lowest degree first
+ * @param[in] step   increase in the degree from one coefficient to the next
+ * @param[in] first  degree of the first coefficient
+ * @param[in] x_max  largest magnitude of the variable
+ * @param[in] f_bits number of fraction bits in the result
+ * @return    number of terms
+ */
+static int series_terms(const double coeff[], int step, int first,
+                        double x_max, int f_bits)
+{
+  int terms = 1;
+
+  while ((terms < MAX_TERMS) &&
+         (fabs(coeff[terms]) * pow(x_max, first + step * terms) >=
+          ldexp(1.0, -(f_bits + 1))))
+    terms++;
+  return MAX(terms, 2);
+}
+
+/**
+ * @brief Build a kernel for sin or cos.
+ */
+static tree sin_cos_kernel(struct KERNEL *k, enum FXMATH_FUNC func, tree x,
+                           struct SIF *x_frmt, int result_bits)
+{
+  double sin_coeff[MAX_TERMS + 1], cos_coeff[MAX_TERMS + 1];
+  double lo, hi, r_max, factorial = 1.0;
+  int x_bits = x_frmt->F + x_frmt->E;
+  int f_bits = k->n - 2;
+  tree r, r2, s = NULL_TREE, c = NULL_TREE, q = NULL_TREE, result;
+  int j;
+
+  // Taylor coefficients, in powers of r^2
+  for (j = 0; j <= MAX_TERMS; j++) {
+    cos_coeff[j] = ((j & 1) ? -1.0 : 1.0) / factorial;
+    factorial *= 2 * j + 1;
+    sin_coeff[j] = ((j & 1) ? -1.0 : 1.0) / factorial;
+    factorial *= 2 * j + 2;
+  }
+  real_range(x_frmt, &lo, &hi);
+  r_max = MAX(fabs(lo), fabs(hi));
+  //
+  // r^2 has n-2 fraction bits, so it must be less than 2: a larger argument
+  //   is reduced to [-pi/4, pi/4] even if it is within [-pi/2, pi/2]
+  //
+  bool reduce = (r_max >= M_SQRT2);
+  if (reduce) {
+    r = reduce_argument(k, x, x_bits, M_PI_2, f_bits, &q);
+    q = convert_to(k, k->stype, q);
+    r_max = M_PI_4 * 1.01;
+  } else {
+    r = shift_by(k, convert_to(k, k->stype, x), f_bits - x_bits);
+  }
+  r2 = fx_multiply(k, r, r, f_bits);
+  if (reduce || (func == MATH_SIN)) {
+    s = fx_polynomial(k, r2, sin_coeff,
+                      series_terms(sin_coeff, 2, 1, r_max, result_bits),
+                      f_bits);
+    s = fx_multiply(k, s, r, f_bits);
+  }
+  if (reduce || (func == MATH_COS)) {
+    c = fx_polynomial(k, r2, cos_coeff,
+                      series_terms(cos_coeff, 2, 0, r_max, result_bits),
+                      f_bits);
+  }
+  if (reduce) {
+    //
+    // With x = r + q*pi/2, the quadrant q chooses sin(r) or cos(r), and
+    // whether to negate it
+    //
+    tree odd = insert_math_stmt(k, BIT_AND_EXPR, k->stype, q,
+                                build_int_cst(k->stype, 1));
+    tree swap = insert_math_stmt(k, NEGATE_EXPR, k->stype, odd, NULL);
+    tree diff = insert_math_stmt(k, BIT_XOR_EXPR, k->stype, s, c);
+    diff = insert_math_stmt(k, BIT_AND_EXPR, k->stype, diff, swap);
+    tree half = insert_math_stmt(k, RSHIFT_EXPR, k->stype, q,
+                                 build_int_cst(integer_type_node, 1));
+    tree negate;
+    if (func == MATH_SIN) {
+      result = insert_math_stmt(k, BIT_XOR_EXPR, k->stype, s, diff);
+      negate = half;
+    } else {
+      result = insert_math_stmt(k, BIT_XOR_EXPR, k->stype, c, diff);
+      negate = insert_math_stmt(k, BIT_XOR_EXPR, k->stype, half, q);
+    }
+    negate = insert_math_stmt(k, BIT_AND_EXPR, k->stype, negate,
+                              build_int_cst(k->stype, 1));
+    negate = insert_math_stmt(k, NEGATE_EXPR, k->stype, negate, NULL);
+    result = negate_if(k, result, negate);
+  } else {
+    result = (func == MATH_SIN) ? s : c;
+  }
+  return shift_by(k, result, result_bits - f_bits);
+}
+
+/**
+ * @brief Build a kernel for exp.
+ */
+static tree exp_kernel(struct KERNEL *k, tree x, struct SIF *x_frmt,
+                       int result_bits)
+{
+  double coeff[MAX_TERMS + 1], factorial = 1.0;
+  int x_bits = x_frmt->F + x_frmt->E;
+  int f_bits = k->n - 2;
+  tree r, q, e, count;
+  int j;
+
+  for (j = 0; j <= MAX_TERMS; j++) {
+    coeff[j] = 1.0 / factorial;
+    factorial *= j + 1;
+  }
+  //
+  // exp(x) = exp(r) * 2^q, where x = r + q*ln(2)
+  //
+  r = reduce_argument(k, x, x_bits, M_LN2, f_bits, &q);
+  e = fx_polynomial(k, r, coeff,
+                    series_terms(coeff, 1, 0, M_LN2 * 0.51, f_bits), f_bits);
+  count = convert_to(k, integer_type_node, q);
+  count = insert_math_stmt(k, PLUS_EXPR, integer_type_node, count,
+                           build_int_cst(integer_type_node,
+                                         result_bits - f_bits));
+  return scale_by_power(k, e, count);
+}
+
+/**
+ * @brief Build a kernel for log.
+ */
+static tree log_kernel(struct KERNEL *k, tree x, struct SIF *x_frmt,
+                       int result_bits)
+{
+  int n = k->n;
+  int x_bits = x_frmt->F + x_frmt->E;
+  int l_bits = MIN(result_bits + 2, n - 2);
+  int e_bits = ceil_log2(n + x_bits + 1) + 1;
+  int c_bits = MIN(2 * n - 1 - e_bits - l_bits, HOST_BITS_PER_WIDE_INT - 2);
+  tree clz_fn, clz_type, u, zeros, e, m, bits = NULL_TREE, l2;
+  int i;
+
+  clz_fn = clz_function(n, &clz_type);
+  if (clz_fn == NULL_TREE) {
+    error("fxopt: no function to count the leading zeros of a %d-bit value",
+          n);
+    return x;
+  }
+  //
+  // x = m * 2^e, with m in [1, 2) and n-1 fraction bits
+  //
+  u = convert_to(k, k->utype, x);
+  zeros = insert_clz(k->gsi_p, clz_fn, clz_type, u);
+  m = insert_math_stmt(k, LSHIFT_EXPR, k->utype, u, zeros);
+  e = insert_math_stmt(k, MINUS_EXPR, integer_type_node,
+                       build_int_cst(integer_type_node, n - 1 - x_bits),
+                       zeros);
+  //
+  // Each squaring of m doubles log2(m). If the square is 2 or more, the
+  // next bit of log2(m) is 1 and the square is halved.
+  //
+  m = convert_to(k, k->uwtype, m);
+  for (i = 0; i < l_bits; i++) {
+    tree square = insert_math_stmt(k, MULT_EXPR, k->uwtype, m, m);
+    square = shift_by(k, square, -(n - 1));
+    tree bit = insert_math_stmt(k, RSHIFT_EXPR, k->uwtype, square,
+                                build_int_cst(integer_type_node, n));
+    m = insert_math_stmt(k, RSHIFT_EXPR, k->uwtype, square, bit);
+    if (bits == NULL_TREE) {
+      bits = bit;
+    } else {
+      bits = shift_by(k, bits, 1);
+      bits = insert_math_stmt(k, BIT_IOR_EXPR, k->uwtype, bits, bit);
+    }
+  }
+  //
+  // log(x) = (e + log2(m)) * ln(2)
+  //
+  l2 = shift_by(k, convert_to(k, k->wtype, e), l_bits);
+  l2 = insert_math_stmt(k, PLUS_EXPR, k->wtype, l2,
+                        convert_to(k, k->wtype, bits));
+  l2 = insert_math_stmt(k, MULT_EXPR, k->wtype, l2,
+                        real_cst(k->wtype, M_LN2, c_bits));
+  l2 = shift_by(k, l2, result_bits - l_bits - c_bits);
+  return convert_to(k, k->stype, l2);
+}
+
+/**
+ * @brief Build a kernel for sqrt.
+ */
+static tree sqrt_kernel(struct KERNEL *k, tree x, struct SIF *x_frmt,
+                        int result_bits)
+{
+  int n = k->n;
+  int x_bits = x_frmt->F + x_frmt->E;
+  tree clz_fn, clz_type, u, zeros, odd, d, y, root, count;
+  int bits;
+
+  clz_fn = clz_function(n, &clz_type);
+  if (clz_fn == NULL_TREE) {
+    error("fxopt: no function to count the leading zeros of a %d-bit value",
+          n);
+    return x;
+  }
+  //
+  // x = D * 2^(n - zeros - x_bits), with D in [0.25, 1) and n fraction bits,
+  // where the exponent must be even. The leading zeros of sqrt(0) are
+  // counted for 1 instead, since clz of 0 is undefined, and D is then 0.
+  //
+  u = convert_to(k, k->utype, x);
+  zeros = insert_clz(k->gsi_p, clz_fn, clz_type,
+                     insert_math_stmt(k, MAX_EXPR, k->utype, u,
+                                      build_int_cst(k->utype, 1)));
+  odd = insert_math_stmt(k, BIT_XOR_EXPR, integer_type_node, zeros,
+                         build_int_cst(integer_type_node, (n - x_bits) & 1));
+  odd = insert_math_stmt(k, BIT_AND_EXPR, integer_type_node, odd,
+                         build_int_cst(integer_type_node, 1));
+  zeros = insert_math_stmt(k, MINUS_EXPR, integer_type_node, zeros, odd);
+  d = insert_math_stmt(k, LSHIFT_EXPR, k->utype, u, zeros);
+  d = convert_to(k, k->uwtype, d);
+  //
+  // y = 1/sqrt(D), with n-2 fraction bits, starts from 2.13 - 1.21 * D and
+  // is refined by y = y * (3 - D * y^2) / 2
+  //
+  y = insert_math_stmt(k, MULT_EXPR, k->uwtype, d,
+                       real_cst(k->uwtype, 1.21, n - 2));
+  y = shift_by(k, y, -n);
+  y = insert_math_stmt(k, MINUS_EXPR, k->uwtype,
+                       real_cst(k->uwtype, 2.13, n - 2), y);
+  for (bits = SQRT_SEED_BITS; bits < n - 1; bits = 2 * bits - 1) {
+    tree t = insert_math_stmt(k, MULT_EXPR, k->uwtype, y, y);
+    t = shift_by(k, t, -(n - 2));
+    t = insert_math_stmt(k, MULT_EXPR, k->uwtype, d, t);
+    t = shift_by(k, t, -n);
+    t = insert_math_stmt(k, MINUS_EXPR, k->uwtype,
+                         real_cst(k->uwtype, 3.0, n - 2), t);
+    y = insert_math_stmt(k, MULT_EXPR, k->uwtype, y, t);
+    y = shift_by(k, y, -(n - 1));
+  }
+  //
+  // sqrt(D) = D * y, with n-1 fraction bits, then scale by half of the
+  // exponent
+  //
+  root = insert_math_stmt(k, MULT_EXPR, k->uwtype, d, y);
+  root = shift_by(k, root, -(n - 1));
+  root = convert_to(k, k->stype, root);
+  count = insert_math_stmt(k, MINUS_EXPR, integer_type_node,
+                           build_int_cst(integer_type_node, n - x_bits),
+                           zeros);
+  count = insert_math_stmt(k, RSHIFT_EXPR, integer_type_node, count,
+                           build_int_cst(integer_type_node, 1));
+  count = insert_math_stmt(k, PLUS_EXPR, integer_type_node, count,
+                           build_int_cst(integer_type_node,
+                                         result_bits - (n - 1)));
+  return scale_by_power(k, root, count);
+}
+
+/**
+ * @brief Build a kernel for atan2.
+ */
+static tree atan2_kernel(struct KERNEL *k, tree y, struct SIF *y_frmt,
+                         tree x, struct SIF *x_frmt, int result_bits)
+{
+  int n = k->n;
+  int w = 2 * n;
+  int y_bits = y_frmt->F + y_frmt->E;
+  int x_bits = x_frmt->F + x_frmt->E;
+  int z_bits = MIN(w - 4, HOST_BITS_PER_WIDE_INT - 3);
+  int iterations = MIN(result_bits + 2, z_bits);
+  tree xw, yw, x_mask, y_mask, z;
+  int i;
+
+  //
+  // Align the binary points, with the operand that has fewer fraction bits
+  // shifted to the top of the double-size type, less two bits for the
+  // growth of the vector
+  //
+  if (x_bits <= y_bits) {
+    xw = shift_by(k, convert_to(k, k->wtype, x), n - 2);
+    yw = shift_by(k, convert_to(k, k->wtype, y), n - 2 - (y_bits - x_bits));
+  } else {
+    yw = shift_by(k, convert_to(k, k->wtype, y), n - 2);
+    xw = shift_by(k, convert_to(k, k->wtype, x), n - 2 - (x_bits - y_bits));
+  }
+  //
+  // A vector in the left half plane is rotated by pi
+  //
+  x_mask = sign_mask(k, xw);
+  y_mask = sign_mask(k, yw);
+  xw = negate_if(k, xw, x_mask);
+  yw = negate_if(k, yw, x_mask);
+  z = negate_if(k, real_cst(k->wtype, M_PI, z_bits), y_mask);
+  z = insert_math_stmt(k, BIT_AND_EXPR, k->wtype, z, x_mask);
+  //
+  // Each CORDIC iteration rotates the vector toward the x axis by
+  // atan(2^-i)
+  //
+  for (i = 0; i < iterations; i++) {
+    tree direction = sign_mask(k, yw);
+    tree xs = shift_by(k, xw, -i);
+    tree ys = shift_by(k, yw, -i);
+    xw = insert_math_stmt(k, PLUS_EXPR, k->wtype, xw,
+                          negate_if(k, ys, direction));
+    yw = insert_math_stmt(k, MINUS_EXPR, k->wtype, yw,
+                          negate_if(k, xs, direction));
+    z = insert_math_stmt(k, PLUS_EXPR, k->wtype, z,
+                         negate_if(k, real_cst(k->wtype, atan(ldexp(1.0, -i)),
+                                               z_bits), direction));
+  }
+  z = shift_by(k, z, result_bits - z_bits);
+  return convert_to(k, k->stype, z);
+}
+
+/**
+ * @brief Analyze a call to a math function and, on the last pass, replace it
+ * with a fixed-point kernel.
+ *
+ * @details The call is replaced by an assignment of the kernel's result to
+ * the call's LHS, at the position of the iterator.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * D.1984_6 = sqrtf (D.1983_5);
+ * D.2011_9 = sin (theta_3(D));
+ * D.2040_12 = atan2 (y_4(D), x_2(D));
+ * @endcode
+ *
+ * @param[in] gsi_p statement iterator, points to the call
+ * @return    SIF format struct for the result, uninitialized if the formats
+ *            of the arguments are not known yet
+ */
+struct SIF math_call(gimple_stmt_iterator * gsi_p)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  enum FXMATH_FUNC func = math_function(stmt);
+  int nargs = (func == MATH_ATAN2) ? 2 : 1;
+  struct SIF lhs_frmt, arg_frmt[2], result_frmt;
+  struct KERNEL k;
+  double lo, hi;
+  tree lhs = gimple_call_lhs(stmt);
+  tree args[2], result;
+  int i;
+
+  initialize_format(&result_frmt);
+  lhs_frmt = get_operand_format(stmt, 0, 0, NOPRINT);
+  for (i = 0; i < nargs; i++) {
+    // the call's arguments follow the function and static chain operands
+    arg_frmt[i] = get_operand_format(stmt, i + 3, 0, PRINT);
+    if (!format_initialized(arg_frmt[i]))
+      return result_frmt;
+  }
+  k.n = operand_word_size(lhs);
+  for (i = 0; i < nargs; i++) {
+    if (arg_frmt[i].size > k.n) {
+      error("fxopt: argument of %s is larger than its result",
+            math_name[func]);
+      return result_frmt;
+    }
+  }
+  math_range(func, arg_frmt, &lo, &hi);
+  result_frmt = math_result_format(lhs_frmt, k.n, lo, hi);
+  FXLOG(2, "  %s, result range %g to %g\n", math_name[func], lo, hi);
+  if (!fxctx->lastpass)
+    return result_frmt;
+
+  if ((func == MATH_LOG) && (arg_frmt[0].sgnd ||
+                             double_int_negative_p(arg_frmt[0].min) ||
+                             double_int_zero_p(arg_frmt[0].min)))
+    FXLOG(1, "  *** Argument of log may not be positive\n");
+  k.gsi_p = gsi_p;
+  k.stype = fxopt_integer_type(k.n);
+  k.utype = unsigned_type_for(k.stype);
+  k.wtype = fxopt_integer_type(2 * k.n);
+  k.uwtype = unsigned_type_for(k.wtype);
+  for (i = 0; i < nargs; i++)
+    args[i] = convert_to(&k, k.stype, gimple_call_arg(stmt, i));
+
+  switch (func) {
+    case MATH_SQRT:
+      result = sqrt_kernel(&k, args[0], &arg_frmt[0], result_frmt.F);
+      break;
+    case MATH_SIN:
+    case MATH_COS:
+      result = sin_cos_kernel(&k, func, args[0], &arg_frmt[0],
+                              result_frmt.F);
+      break;
+    case MATH_EXP:
+      result = exp_kernel(&k, args[0], &arg_frmt[0], result_frmt.F);
+      break;
+    case MATH_LOG:
+      result = log_kernel(&k, args[0], &arg_frmt[0], result_frmt.F);
+      break;
+    default:
+      result = atan2_kernel(&k, args[0], &arg_frmt[0], args[1],
+                            &arg_frmt[1], result_frmt.F);
+  }
+  //
+  // The call may have a virtual definition, for errno
+  //
+  if (gimple_vdef(stmt) != NULL_TREE)
+    unlink_stmt_vdef(stmt);
+  gimple new_stmt = gimple_build_assign_with_ops(NOP_EXPR, lhs, result, NULL);
+  gsi_replace(gsi_p, new_stmt, false);
+  FXLOG_STMT(2, new_stmt);
+  return result_frmt;
+}
+
+// vim:syntax=c.doxygen
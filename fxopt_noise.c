@@ -0,0 +1,326 @@
+/**
+ * @file fxopt_noise.c
+ *
+ * @brief  Functions for estimating quantization noise and choosing word sizes
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-09T09:12:40-0500
+ * @date Last modified: 2014-01-09T09:12:40-0500
+ *
+ * @details  Every time fraction bits are discarded, by a right shift or by
+ *           narrowing a result, the value picks up a quantization error. The
+ *           error is modeled as uniform white noise and its power (variance)
+ *           is carried along in the <tt>noise</tt> element of each ::SIF
+ *           format, and propagated through each operation. Comparing the
+ *           noise with the power of a full-scale signal in the variable's
+ *           range gives an estimate of its signal-to-quantization-noise ratio
+ *           (SQNR).
+ *
+ *           When an SQNR budget is given, the estimates are used to choose a
+ *           single- or double-precision multiplication for each product, and
+ *           to store local variables in 16-bit integers when that still meets
+ *           the budget. Each variable is checked against the budget on its
+ *           own. Since the noise of many variables can add up in the output,
+ *           the budget should include some margin.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+
+/**
+ * @def   SMALL_WORD_SIZE
+ * @brief Size of the integers that a variable may be reduced to.
+ */
+#define SMALL_WORD_SIZE 16
+
+/**
+ * @brief Power of the error from discarding fraction bits.
+ *
+ * @details The error is uniformly distributed over one LSB. When rounding, it
+ * has zero mean and a power of q^2/12. When truncating, it has a mean of
+ * -q/2 and a power of q^2/3.
+ *
+ * @param[in] f_bits number of fraction bits that are kept
+ * @return    noise power
+ */
+double quantization_noise(int f_bits)
+{
+  double q = ldexp(1.0, -f_bits);
+
+  if (ROUNDING)
+    return q * q / 12.0;
+  return q * q / 3.0;
+}
+
+/**
+ * @brief Largest magnitude that a variable can have.
+ *
+ * @details The range is used if it is known, else the largest value that the
+ * format can represent.
+ *
+ * @param[in] s pointer to ::SIF structure
+ * @return    magnitude, as a real value
+ */
+static double range_peak(struct SIF *s)
+{
+  double max, min;
+
+  if (double_int_scmp(s->max, s->min) < 0)      // range is undefined
+    return ldexp(1.0, s->I);
+  max = fabs((double) double_int_to_shwi(s->max));
+  min = fabs((double) double_int_to_shwi(s->min));
+  return ldexp(MAX(max, min), -(s->F + s->E));
+}
+
+/**
+ * @brief Power of a full-scale sinusoid in a variable's range.
+ *
+ * @param[in] s pointer to ::SIF structure
+ * @return    signal power
+ */
+double signal_power(struct SIF *s)
+{
+  double peak = range_peak(s);
+
+  return peak * peak / 2.0;
+}
+
+/**
+ * @brief Estimated signal-to-quantization-noise ratio of a variable.
+ *
+ * @param[in] s pointer to ::SIF structure
+ * @return    SQNR in dB, or HUGE_VAL if there is no quantization noise
+ */
+double format_sqnr(struct SIF *s)
+{
+  if (s->noise <= 0.0)
+    return HUGE_VAL;
+  return 10.0 * log10(signal_power(s) / s->noise);
+}
+
+/**
+ * @brief Largest noise power that a variable can have within the budget.
+ *
+ * @param[in] s pointer to ::SIF structure
+ * @return    noise power
+ */
+static double noise_budget(struct SIF *s)
+{
+  return signal_power(s) / pow(10.0, SQNR_TARGET / 10.0);
+}
+
+/**
+ * @brief Noise of an operand, including any fraction bits that its shift
+ * discards.
+ *
+ * @param[in] s pointer to ::SIF structure of the operand
+ * @return    noise power
+ */
+static double operand_noise(struct SIF *s)
+{
+  if (s->originalF > s->F)
+    return s->noise + quantization_noise(s->F + s->E);
+  return s->noise;
+}
+
+/**
+ * @brief Find the quantization noise in the result of an operation.
+ *
+ * @details The noise of each operand, plus the noise of any bits that are
+ * shifted out of it, is propagated to the result. Noise adds for addition
+ * and subtraction. For multiplication each operand's noise is scaled by the
+ * power of the other operand. For division the relative noise powers add.
+ * A minimum or maximum has the larger noise of its operands. Any other
+ * operation just copies the noise of its first operand.
+ *
+ * @param[in] code           the operation
+ * @param[in] oprnd_frmt     operand ::SIF structure array
+ * @param[in] num_operands   number of operands, including the result
+ * @param[in,out] result_frmt pointer to ::SIF structure for the result
+ */
+void propagate_noise(enum tree_code code, struct SIF oprnd_frmt[],
+                     int num_operands, struct SIF *result_frmt)
+{
+  double n1, n2, p1, p2;
+
+  if ((num_operands < 2) || !format_initialized(oprnd_frmt[1]))
+    return;
+  n1 = operand_noise(&oprnd_frmt[1]);
+  p1 = range_peak(&oprnd_frmt[1]);
+  if ((num_operands < 3) || !format_initialized(oprnd_frmt[2])) {
+    result_frmt->noise = n1;
+    return;
+  }
+  n2 = operand_noise(&oprnd_frmt[2]);
+  p2 = range_peak(&oprnd_frmt[2]);
+
+  switch (code) {
+    case PLUS_EXPR:
+    case MINUS_EXPR:
+      result_frmt->noise = n1 + n2;
+      break;
+    case MULT_EXPR:
+    case WIDEN_MULT_EXPR:
+      result_frmt->noise = (n1 * p2 * p2) + (n2 * p1 * p1) + (n1 * n2);
+      break;
+    case RDIV_EXPR:
+    case TRUNC_DIV_EXPR:
+      if ((p1 > 0.0) && (p2 > 0.0))
+        result_frmt->noise = signal_power(result_frmt) *
+            ((n1 / (p1 * p1)) + (n2 / (p2 * p2))) * 2.0;
+      else
+        result_frmt->noise = n1 + n2;
+      break;
+    case MIN_EXPR:
+    case MAX_EXPR:
+      result_frmt->noise = MAX(n1, n2);
+      break;
+    default:
+      result_frmt->noise = n1;
+  }
+}
+
+/**
+ * @brief Check whether a single-precision product meets the SQNR budget.
+ *
+ * @details A single-precision product must discard some of the fraction bits
+ * of its operands. The product of the two operands' peaks is used as the
+ * signal, since the format of the product is not known yet.
+ *
+ * @param[in] oprnd_frmt   operand ::SIF structure array
+ * @param[in] dropped_bits number of fraction bits that would be discarded
+ * @return    true if the budget is met
+ */
+bool single_mult_meets_budget(struct SIF oprnd_frmt[], int dropped_bits)
+{
+  struct SIF product;
+  double peak, noise;
+
+  initialize_format(&product);
+  propagate_noise(MULT_EXPR, oprnd_frmt, 3, &product);
+  noise = product.noise +
+      quantization_noise(oprnd_frmt[1].F + oprnd_frmt[2].F - dropped_bits);
+  peak = range_peak(&oprnd_frmt[1]) * range_peak(&oprnd_frmt[2]);
+  FXLOG(2, "  single-precision product SQNR %.1f dB\n",
+        10.0 * log10(peak * peak / 2.0 / noise));
+  return (peak * peak / 2.0) >= (noise * pow(10.0, SQNR_TARGET / 10.0));
+}
+
+/**
+ * @brief Predicate for a variable whose size may be reduced.
+ *
+ * @details Only local floating variables are candidates. Parameters, the
+ * return value, globals and pointer targets are part of the function's
+ * interface, and variables with an fxfrmt or fxword attribute already have
+ * the size the user chose.
+ *
+ * @param[in] var gcc tree for a variable declaration
+ * @return    true if the size may be reduced
+ */
+static bool may_resize(tree var)
+{
+  return (TREE_CODE(var) == VAR_DECL) && !is_global_var(var) &&
+      (TREE_CODE(TREE_TYPE(var)) != POINTER_TYPE) &&
+      (TREE_CODE(get_innermost_type(var)) == REAL_TYPE) &&
+      (lookup_attribute("fxfrmt", DECL_ATTRIBUTES(var)) == NULL_TREE) &&
+      (lookup_attribute("fxword", DECL_ATTRIBUTES(var)) == NULL_TREE);
+}
+
+/**
+ * @brief Number of bits a variable needs to meet the SQNR budget.
+ *
+ * @details The variable keeps its sign and integer bits, and as many
+ * fraction bits as are needed so that the added quantization noise keeps the
+ * total noise within the budget.
+ *
+ * @param[in] s pointer to ::SIF structure
+ * @return    number of bits, or the current size if no bits can be spared
+ */
+static int required_bits(struct SIF *s)
+{
+  double spare = noise_budget(s) - s->noise;
+  int f_bits;
+
+  if (spare <= 0.0)
+    return s->size;
+  f_bits = (int) ceil(-0.5 * log2(spare * (ROUNDING ? 12.0 : 3.0)));
+  f_bits = MAX(f_bits, 0);
+  if (f_bits > s->F)
+    return s->size;
+  return s->sgnd + s->I + f_bits;
+}
+
+/**
+ * @brief Reduce the size of the local variables that need fewer bits.
+ *
+ * @details Called after the formats of a function have been resolved. Every
+ * format of a candidate variable, in every pass and for every array element,
+ * must fit in the smaller size. The chosen size is recorded as an fxword
+ * attribute, so the analysis must be repeated for it to take effect.
+ *
+ * @return true if any variable was given a smaller size
+ */
+bool choose_word_sizes()
+{
+  tree var;
+  referenced_var_iterator rvi;
+  bool resized = false;
+
+  FXLOG(1, "  ===== Choosing word sizes for %g dB SQNR =====\n", SQNR_TARGET);
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    if (!may_resize(var))
+      continue;
+    int uid = DECL_UID(var);
+    int needed = 0;
+    int size = var_word_size(var);
+    struct SIF *s;
+    for (s = seek_var_format(UID_TO_KEY(uid));
+         (s != NULL) && (KEY_TO_UID(s->id) == uid); s = next_var_format(s)) {
+      if (format_initialized(*s))
+        needed = MAX(needed, required_bits(s));
+    }
+    if ((needed > 0) && (needed <= SMALL_WORD_SIZE)
+        && (SMALL_WORD_SIZE < size)) {
+      FXLOG(1, "  %s needs %d bits, reduced to %d\n",
+            DECL_NAME(var) ? IDENTIFIER_POINTER(DECL_NAME(var)) : "temp",
+            needed, SMALL_WORD_SIZE);
+      set_word_size(var, SMALL_WORD_SIZE);
+      resized = true;
+    }
+  }
+  return resized;
+}
+
+/**
+ * @brief Restore the sizes chosen for a function's variables when its formats
+ * are read from the cache.
+ *
+ * @details The cached formats were found with the reduced sizes, so the
+ * variables must be given the same fxword attributes that
+ * choose_word_sizes() gave them.
+ */
+void restore_word_sizes()
+{
+  tree var;
+  referenced_var_iterator rvi;
+
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    if (!may_resize(var))
+      continue;
+    struct SIF *s = seek_var_format(UID_TO_KEY(DECL_UID(var)));
+    if ((s != NULL) && (KEY_TO_UID(s->id) == (int) DECL_UID(var))
+        && (s->size != var_word_size(var)))
+      set_word_size(var, s->size);
+  }
+}
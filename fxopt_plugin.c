@@ -33,17 +33,10 @@
  */
 #define BINARY_PT(x) (oprnd_frmt[(x)].F+oprnd_frmt[(x)].E)
 /**
- * @var   lastpass
- * @brief Set to true when all formats are resolved and code can be generated.
+ * @var   fxctx
+ * @brief The analysis state of the function currently being processed.
  */
-int lastpass = 0;
-/**
- * @var   fxpass
- * @brief Counts number of passes through the function in attempt to resolve
- *   all formats.
- */
-int fxpass = 0;
-
+struct FXOPT_CONTEXT *fxctx = NULL;
 //
 // global variables to indicate which optimizations have been selected
 //
@@ -54,15 +47,128 @@ int ROUNDING = 0;
 int POSITIVE = 0;
 int DBL_PRECISION_MULTS = 0;
 int CONST_DIV_TO_MULT = 0;
+int ACCUMULATE = 0;
+//
+// cost of a multiplication, in shifts and adds, when multiplications by
+// constants are replaced by shifts and adds; zero to keep the multiplications
+//
+int CSD_MULT_COST = 0;
+//
+// remove redundant shifts and move loop-invariant shifts out of loops
+//
+int SHARE_SHIFTS = 0;
+//
+// replace division by a variable with multiplication by its reciprocal
+//
+int RECIPROCAL_DIV = 0;
+//
+// bound a variable in the branches of a comparison with a real constant
+//
+int BRANCH_RANGES = 0;
+//
+// give all of the elements of an array one format, so that every element
+//   needs the same shifts and loops over the array may be vectorized
+//
+int UNIFORM = 0;
+//
+// number of times the range of a loop-carried variable may grow before it is
+//   widened, and the number of passes that narrow widened ranges again
+//
+int WIDEN_DELAY = 3;
+int NARROWING = 2;
+//
+// maximum number of terms in an affine definition, zero for no limit
+//
+int AFFINE_MAX_TERMS = 0;
+//
+// directory for cached format solutions, NULL if there is no cache
+//
+char *FORMAT_CACHE_DIR = NULL;
+//
+// report counters and phase times when gcc finishes
+//
+int STATS = 0;
+//
+// number of bits in the integers that replace floats, zero for a long
+//
+int WORD_SIZE = 0;
+//
+// signal-to-quantization-noise ratio to be met, in dB, zero for none
+//
+double SQNR_TARGET = 0.0;
+//
+// insert calls that record the range of each real variable instead of
+// converting, or use the ranges recorded in a profile, enlarged by a margin
+// in percent
+//
+int PROFILE_GENERATE = 0;
+int PROFILE_USE = 0;
+int PROFILE_MARGIN = 10;
+//
+// file of the formats passed across function calls, NULL if they are not
+//   passed, and the difference in integer bits between call sites at which
+//   a function is cloned, zero to never clone
+//
+char *IPA_SUMMARY_FILE = NULL;
+int IPA_CLONE_BITS = 4;
+//
+// diagnostic output: the verbosity level, the log, and the file for the
+// "///" format annotations (NULL to put them in the log)
+//
+int VERBOSE = 0;
+FILE *fxlog = NULL;
+FILE *fxformats = NULL;
+
+/**
+ * @def   LOG_BUFFER_SIZE
+ * @brief Size of the output buffer for a log file.
+ */
+#define LOG_BUFFER_SIZE (1 << 16)
 
 int plugin_is_GPL_compatible;
 
+/**
+ * @brief Find the integer parameter of an attribute.
+ *
+ * @param[in]  args the attribute's parameters
+ * @param[out] value the value of the first parameter
+ * @return     true if the first parameter is an integer constant
+ */
+static bool attribute_int_arg(tree args, HOST_WIDE_INT * value)
+{
+  tree arg = TREE_VALUE(args);
+
+  if ((arg == NULL_TREE) || (TREE_CODE(arg) != INTEGER_CST) ||
+      !host_integerp(arg, 0))
+    return false;
+  *value = tree_low_cst(arg, 0);
+  return true;
+}
+
 // Attribute handler callback
+//
+// The parameters of fxword and fxblock are checked here, so that the passes
+//   can read them without checking again
+//
 
 static tree
 handle_user_attribute(tree * node, tree name, tree args,
                       int flags, bool * no_add_attrs)
 {
+  HOST_WIDE_INT value;
+
+  if (is_attribute_p("fxword", name)) {
+    if (!attribute_int_arg(args, &value) ||
+        ((value != 8) && (value != 16) && (value != 32) && (value != 64))) {
+      error("fxopt: fxword attribute requires 8, 16, 32 or 64");
+      *no_add_attrs = true;
+    }
+  } else if (is_attribute_p("fxblock", name) && (args != NULL_TREE)) {
+    if (!attribute_int_arg(args, &value) || (value < 0) || (value >= 64)) {
+      error("fxopt: fxblock attribute requires 0 to 63 guard bits");
+      *no_add_attrs = true;
+    }
+  }
   return NULL_TREE;
 }
 
@@ -83,6 +189,20 @@ static struct attribute_spec frmt_attr =
 //
 static struct attribute_spec iter_attr =
     { "fxiter", 0, 0, false, false, false, handle_user_attribute };
+//
+// The fxword attribute gives the number of bits in the integer that replaces
+//   a floating variable. On a function it applies to the return value and to
+//   every floating variable in the function that has no fxword attribute.
+//
+static struct attribute_spec word_attr =
+    { "fxword", 1, 1, false, false, false, handle_user_attribute };
+//
+// The fxblock attribute gives the elements of a local array one exponent that
+//   is found at run time, each time the array is passed to fxblock_normalize().
+//   The optional parameter is the number of guard bits to leave, default 1.
+//
+static struct attribute_spec block_attr =
+    { "fxblock", 0, 1, false, false, false, handle_user_attribute };
 
 
 /// Register the fxopt attributes so gcc will recognize them
@@ -95,16 +215,65 @@ static void register_attributes(void *event_data, void *data)
 {
   register_attribute(&frmt_attr);
   register_attribute(&iter_attr);
+  register_attribute(&word_attr);
+  register_attribute(&block_attr);
 }
 
 
 /**
- * @brief The main function that is invoked for fxopt
- * @details 
+ * @brief Give a record the format found for its declared variable.
+ * @details Only a record whose format has not been initialized, e.g. by an
+ * initial value, is changed. The affine definition of a variable with a
+ * declared range refers to the record's own <tt>id</tt>, which for a run of
+ * array elements is the id of its first element.
  *
- * @return boolean, success or failure
+ * @param[in,out] fmt      the record, a single variable or a run
+ * @param[in]     decl_fmt the declared format, without an affine definition
+ * @param[in]     x0       the midpoint of the declared range
+ * @param[in]     x1       the half-width of the declared range
  */
-static unsigned int execute_fxopt_plugin(void)
+static void set_declared_format(struct SIF *fmt, const struct SIF *decl_fmt,
+                                double_int x0, double_int x1)
+{
+  int bp = decl_fmt->F + decl_fmt->E;
+
+  if (format_initialized(*fmt))
+    return;
+  fmt->attrS = fmt->S = decl_fmt->S;
+  fmt->attrI = fmt->I = decl_fmt->I;
+  fmt->attrF = fmt->F = decl_fmt->F;
+  fmt->attrE = fmt->E = decl_fmt->E;
+  fmt->attrmax = fmt->max = decl_fmt->max;
+  fmt->attrmin = fmt->min = decl_fmt->min;
+  if (decl_fmt->has_attribute || decl_fmt->iter) {
+    if (!double_int_zero_p(x0))
+      append_aa_var(&(fmt->aa), 0, x0, bp);
+    if (!double_int_zero_p(x1))
+      append_aa_var(&(fmt->aa), fmt->id, x1, bp);
+  }
+  fmt->has_attribute = decl_fmt->has_attribute;
+  fmt->ptr_op = decl_fmt->ptr_op;  // not boolean, an integer
+  fmt->size = decl_fmt->size;
+  fmt->sgnd = decl_fmt->sgnd;
+  fmt->shift = 0;
+  fmt->iv = 0;
+  fmt->alias = 0;
+  fmt->iter = decl_fmt->iter;
+}
+
+
+/**
+ * @brief Find the formats of a function's variables and convert it.
+ * @details The formats are found in the current context, which must be
+ * empty. If the word sizes of some variables are reduced to meet the SQNR
+ * target then the function is not converted, because its formats must be
+ * found again with the new sizes.
+ *
+ * @param[in] cache_key the function's key in the format cache
+ * @param[in] resized   true if the word sizes have already been chosen
+ * @return    true if the function was converted
+ */
+static bool convert_function(uint64_t cache_key, bool resized)
 {
   gimple_stmt_iterator gsi;
   gimple stmt;
@@ -113,7 +282,10 @@ static unsigned int execute_fxopt_plugin(void)
   referenced_var_iterator rvi;
   struct SIF *new_format_p = NULL;
 
-  fprintf(stderr, "  ===== Setting formats of declared vars =====\n");
+  fxtimer_push(PHASE_DECLARED_VARS);
+  FXLOG(1, "  ===== Setting formats of declared vars =====\n");
+  find_block_arrays();
+  find_aggregates();
   FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
     int iter, has_attr, is_ptr, s_bits, i_bits, f_bits, low_bound, high_bound,
         elements, element_size, i;
@@ -176,6 +348,14 @@ static unsigned int execute_fxopt_plugin(void)
           TREE_INT_CST_LOW(TYPE_MAX_VALUE(TYPE_DOMAIN(var->common.type)));
     }
     //
+    // A struct or an array of arrays has a format for each of its real
+    //   fields and elements, numbered by aggregate_leaf()
+    //
+    if (is_aggregate(var)) {
+      low_bound = 0;
+      high_bound = aggregate_leaves(var) - 1;
+    }
+    //
     // The is_ptr field gets the size of the data being referenced, before
     //   any conversion from real to integer. We need this to fix the stride
     //   for pointer references later.
@@ -204,9 +384,13 @@ static unsigned int execute_fxopt_plugin(void)
       tree initial = DECL_INITIAL(var); // a constant or constructor tree
       new_format_p = find_var_format(calc_hash_key(var, 0, NOT_AN_ARRAY));
       if (TREE_CODE(initial) == REAL_CST) {
-        convert_real_constant(initial, new_format_p);
+        convert_real_constant(initial, var_word_size(var), new_format_p);
       } else if (TREE_CODE(initial) == INTEGER_CST) {
         int_constant_format(initial, new_format_p);
+      } else if ((TREE_CODE(initial) == CONSTRUCTOR) && is_aggregate(var)) {
+        aggregate_constructor(var, initial, false);
+      } else if ((TREE_CODE(initial) == CONSTRUCTOR) && UNIFORM) {
+        uniform_constructor(initial, var_word_size(var), false, new_format_p);
       } else if (TREE_CODE(initial) == CONSTRUCTOR) {
         unsigned HOST_WIDE_INT ix;
         tree field, val;
@@ -214,23 +398,23 @@ static unsigned int execute_fxopt_plugin(void)
           i = TREE_INT_CST_LOW(field);  // index into the vector
           new_format_p = find_var_format(calc_hash_key(var, 0, i));
           if (TREE_CODE(val) == REAL_CST) {
-            convert_real_constant(val, new_format_p);
+            convert_real_constant(val, var_word_size(var), new_format_p);
           } else if (TREE_CODE(val) == INTEGER_CST) {
             int_constant_format(val, new_format_p);
           } else {
-            fprintf(stderr, " *** Unexpected initial constructor element\n");
+            FXLOG(1, " *** Unexpected initial constructor element\n");
           }
         }
       } else {
-        fprintf(stderr, " *** Unexpected initial value tree\n");
+        FXLOG(1, " *** Unexpected initial value tree\n");
       }
     }
     //
     // If there was not an initial value, set the variable's format here
     //
     elements = high_bound - low_bound + 1;
-    if (TREE_CODE(innertype) == REAL_TYPE) {
-      element_size = TREE_INT_CST_LOW(TYPE_SIZE(REAL_TO_INTEGER_TYPE));
+    if ((TREE_CODE(innertype) == REAL_TYPE) || is_aggregate(var)) {
+      element_size = var_word_size(var);
     } else if ((TREE_CODE(TREE_TYPE(var)) == POINTER_TYPE) ||
                (TREE_CODE(TREE_TYPE(var)) == REFERENCE_TYPE)) {
       if (TREE_CODE(TREE_TYPE(TREE_TYPE(var))) == ARRAY_TYPE) {
@@ -243,10 +427,28 @@ static unsigned int execute_fxopt_plugin(void)
       element_size =
           DECL_SIZE(var) ? (TREE_INT_CST_LOW(DECL_SIZE(var)) / elements) : 0;
     } else {
-      fprintf(stderr, " *** Can't compute element size!\n");
+      FXLOG(1, " *** Can't compute element size!\n");
     }
 
     int is_signed = TYPE_UNSIGNED(innertype) ? 0 : 1;
+    //
+    // A variable that was seen in the profile gets a format for its measured
+    //   range, which takes the place of an fxfrmt attribute
+    //
+    if (PROFILE_USE && (! has_attr) && (TREE_CODE(innertype) == REAL_TYPE) &&
+        (! is_ptr) &&
+        profiled_format(var, element_size, &s_bits, &i_bits, &f_bits, &max,
+                        &min))
+      has_attr = 1;
+    //
+    // A parameter without an attribute gets a format for the ranges that
+    //   were passed to it at its call sites
+    //
+    if (IPA_SUMMARY_FILE && (! has_attr) && (TREE_CODE(var) == PARM_DECL) &&
+        (TREE_CODE(innertype) == REAL_TYPE) && (! is_ptr) &&
+        ipa_param_format(var, element_size, &s_bits, &i_bits, &f_bits, &max,
+                         &min))
+      has_attr = 1;
     if ((! has_attr) && iter) { // assumed format for iterative variables
       s_bits = 1;
       i_bits = 0;
@@ -258,10 +460,10 @@ static unsigned int execute_fxopt_plugin(void)
     // in the transcript. This is useful for generating the fixed-point
     // C program.
     //
-    if ((TREE_CODE(var) == PARM_DECL) && has_attr) {
-      fprintf(stderr, "/// %sF %d\n", IDENTIFIER_POINTER(DECL_NAME(var)),
+    if ((TREE_CODE(var) == PARM_DECL) && has_attr && !resized) {
+      FXFORMAT("/// %sF %d\n", IDENTIFIER_POINTER(DECL_NAME(var)),
           f_bits);
-      fprintf(stderr, "/// %sE %d\n", IDENTIFIER_POINTER(DECL_NAME(var)),
+      FXFORMAT("/// %sE %d\n", IDENTIFIER_POINTER(DECL_NAME(var)),
           e_bits);
     }
     //
@@ -291,36 +493,56 @@ static unsigned int execute_fxopt_plugin(void)
                                           HOST_BITS_PER_DOUBLE_INT, ARITH);
       double_int x1 = double_int_rshift(double_int_sub(max, min), 1,
                                            HOST_BITS_PER_DOUBLE_INT, ARITH);
-      int bp = f_bits + e_bits;
-      for (i = low_bound; i < NOT_AN_ARRAY; i++) {
-        if ((i > high_bound) || (low_bound == high_bound))
-          i = NOT_AN_ARRAY; // hack!
-        new_format_p = find_var_format(calc_hash_key(var, 0, i));
-        if (!format_initialized(*new_format_p)) {
-          new_format_p->attrS = new_format_p->S = s_bits;
-          new_format_p->attrI = new_format_p->I = i_bits;
-          new_format_p->attrF = new_format_p->F = f_bits;
-          new_format_p->attrE = new_format_p->E = e_bits;
-          new_format_p->attrmax = new_format_p->max = max;
-          new_format_p->attrmin = new_format_p->min = min;
-          if (has_attr || iter) {
-            if (!double_int_zero_p(x0))
-              append_aa_var(&(new_format_p->aa), 0, x0, bp);
-            if (!double_int_zero_p(x1))
-              append_aa_var(&(new_format_p->aa), new_format_p->id, x1, bp);
+      struct SIF decl_fmt;
+      initialize_format(&decl_fmt);
+      decl_fmt.S = s_bits;
+      decl_fmt.I = i_bits;
+      decl_fmt.F = f_bits;
+      decl_fmt.E = e_bits;
+      decl_fmt.max = max;
+      decl_fmt.min = min;
+      decl_fmt.has_attribute = has_attr;
+      decl_fmt.ptr_op = is_ptr;
+      decl_fmt.size = element_size;
+      decl_fmt.sgnd = is_signed;
+      decl_fmt.iter = iter;
+      //
+      // The elements of an array that were not given a format by an initial
+      //   value share one run record per gap between those that were, so a
+      //   large table costs a few records rather than one per element
+      //
+      if ((low_bound != high_bound) &&
+          !((UNIFORM || is_block_array(var)) && !is_aggregate(var))) {
+        fxkey_t end_key = calc_hash_key(var, 0, high_bound) + 1;
+        int next;
+        for (i = low_bound; i <= high_bound; i = next) {
+          fxkey_t key = calc_hash_key(var, 0, i);
+          struct SIF *run_p = seek_var_format(key);
+          if ((NULL == run_p) || (run_p->id >= end_key)) {
+            next = high_bound + 1;
+          } else if (run_p->id > key) {
+            next = i + (int) (run_p->id - key);
+          } else {              // a record already covers the element
+            next = i + (int) (run_p->id + run_p->elements - key);
+            if (!format_initialized(*run_p)) {
+              next = i + 1;
+              set_declared_format(edit_var_format(key), &decl_fmt, x0, x1);
+            }
+            continue;
           }
-          new_format_p->has_attribute = has_attr;
-          new_format_p->ptr_op = is_ptr;  // not boolean, an integer
-          new_format_p->size = element_size;
-          new_format_p->sgnd = is_signed;
-          new_format_p->shift = 0;
-          new_format_p->iv = 0;
-          new_format_p->alias = 0;
-          new_format_p->iter = iter;
+          new_format_p = add_run_format(key, next - i);
+          set_declared_format(new_format_p, &decl_fmt, x0, x1);
         }
       }
+      new_format_p = find_var_format(calc_hash_key(var, 0, NOT_AN_ARRAY));
+      set_declared_format(new_format_p, &decl_fmt, x0, x1);
     }                           // if element_size > 0
   }                             // for each VAR
+  //
+  // Array elements that were given identical formats share one record
+  //
+  compact_var_formats();
+  find_loop_vars();
 
   //
   //   Look for conditional statements. If the conditional has a RHS
@@ -328,12 +550,22 @@ static unsigned int execute_fxopt_plugin(void)
   //   variable as an induction variable and set has_attribute to force this
   //   format to be used for all SSA_NAMES associated with the var
   //
-  fprintf(stderr, "  ===== Marking induction variables =====\n");
+  fxtimer_pop(PHASE_DECLARED_VARS);
+  fxtimer_push(PHASE_INDUCTION_VARS);
+  FXLOG(1, "  ===== Marking induction variables =====\n");
   FOR_EACH_BB(bb) {
     for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
       stmt = gsi_stmt(gsi);
       if (gimple_code(stmt) == GIMPLE_COND) {
-        if (SSA_NAME == TREE_CODE(gimple_cond_lhs(stmt))) {
+        //
+        // A comparison of real values is converted with the other statements
+        //
+        bool is_real = SCALAR_FLOAT_TYPE_P(TREE_TYPE(gimple_cond_lhs(stmt)));
+        gimple_set_plf(stmt, GF_PLF_1, false);
+        gimple_set_plf(stmt, GF_PLF_2, is_real);
+        if (is_real) {
+          FXLOG(2, "  Real-valued GIMPLE_COND\n");
+        } else if (SSA_NAME == TREE_CODE(gimple_cond_lhs(stmt))) {
           var = SSA_NAME_VAR(gimple_cond_lhs(stmt));
           if (INTEGER_CST == TREE_CODE(gimple_cond_rhs(stmt))) {
             new_format_p = find_var_format(calc_hash_key(var, 0, NOT_AN_ARRAY));
@@ -342,16 +574,16 @@ static unsigned int execute_fxopt_plugin(void)
             new_format_p->iv = 1;
             new_format_p->size = varsize;
           } else {
-            fprintf(stderr, "RHS of a GIMPLE_COND not an integer!\n");
+            FXLOG(1, "RHS of a GIMPLE_COND not an integer!\n");
           }
         } else {
-          fprintf(stderr, "LHS of a GIMPLE_COND not an SSA_NAME!\n");
+          FXLOG(1, "LHS of a GIMPLE_COND not an SSA_NAME!\n");
         }
       }
     }
   }
 
-  fprintf(stderr, "  ===== Marking induction variable statements =====\n");
+  FXLOG(1, "  ===== Marking induction variable statements =====\n");
   FOR_EACH_BB(bb) {
     for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
       stmt = gsi_stmt(gsi);
@@ -382,7 +614,7 @@ static unsigned int execute_fxopt_plugin(void)
       }
     }
   }
-  fprintf(stderr, "  ===== Marking induction variable statements 2 =====\n");
+  FXLOG(1, "  ===== Marking induction variable statements 2 =====\n");
   FOR_EACH_BB(bb) {
     for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
       stmt = gsi_stmt(gsi);
@@ -404,13 +636,13 @@ static unsigned int execute_fxopt_plugin(void)
           if (oprnd_frmt[1].iv) {
             oprnd_frmt[0].iv = 1;
 
-            fprintf(stderr, "  ========== Changed iv =====\n");
+            FXLOG(2, "  ========== Changed iv =====\n");
             set_var_format(oprnd_tree[0], oprnd_frmt[0]);
           }
         }
         if (oprnd_frmt[0].iv) {
           gimple_set_plf(stmt, GF_PLF_1, true);
-          fprintf(stderr, "  ========== Changed PLF =====\n");
+          FXLOG(2, "  ========== Changed PLF =====\n");
         } else {
           gimple_set_plf(stmt, GF_PLF_1, false);
         }
@@ -418,10 +650,28 @@ static unsigned int execute_fxopt_plugin(void)
     }
   }
 
-  lastpass = 0;
+  //
+  // If the formats of an identical function were saved earlier, restore
+  // them and go directly to the last pass
+  //
+  fxtimer_pop(PHASE_INDUCTION_VARS);
+  fxctx->lastpass = 0;
+  if (FORMAT_CACHE_DIR && !resized) {
+    fxtimer_push(PHASE_FORMAT_CACHE);
+    if (load_cached_formats(cache_key)) {
+      fxctx->lastpass = 1;
+      COUNT_STAT(cache_hits);
+      if (SQNR_TARGET)
+        restore_word_sizes();
+    }
+    fxtimer_pop(PHASE_FORMAT_CACHE);
+  }
   do {  // until lastpass
-    if (lastpass) {
-      fprintf(stderr, "  ===== Beginning lastpass =====\n");
+    enum FXOPT_PHASE phase =
+        fxctx->lastpass ? PHASE_REWRITE : PHASE_FORMAT_PASSES;
+    fxtimer_push(phase);
+    if (fxctx->lastpass) {
+      FXLOG(1, "  ===== Beginning lastpass =====\n");
       FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
         //
         // If the variable has an initial value, convert it from real to integer
@@ -431,7 +681,14 @@ static unsigned int execute_fxopt_plugin(void)
           tree initial = DECL_INITIAL(var);
           new_format_p = find_var_format(calc_hash_key(var, 0, NOT_AN_ARRAY));
           if (TREE_CODE(initial) == REAL_CST) {
-            DECL_INITIAL(var) = convert_real_constant(initial, new_format_p);
+            DECL_INITIAL(var) = convert_real_constant(initial,
+                                                      var_word_size(var),
+                                                      new_format_p);
+          } else if ((TREE_CODE(initial) == CONSTRUCTOR) && is_aggregate(var)) {
+            aggregate_constructor(var, initial, true);
+          } else if ((TREE_CODE(initial) == CONSTRUCTOR) && UNIFORM) {
+            uniform_constructor(initial, var_word_size(var), true,
+                                new_format_p);
           } else if (TREE_CODE(initial) == CONSTRUCTOR) {
             VEC(constructor_elt, gc) * element_vec = CONSTRUCTOR_ELTS(initial);
             unsigned HOST_WIDE_INT ix;
@@ -442,12 +699,13 @@ static unsigned int execute_fxopt_plugin(void)
               new_format_p = find_var_format(calc_hash_key(var, 0, i));
               if (TREE_CODE(val) == REAL_CST) {
                 element_vec->base.vec[i].value =
-                    convert_real_constant(val, new_format_p);
+                    convert_real_constant(val, var_word_size(var),
+                                          new_format_p);
               }
             }
             innertype = get_innermost_type(var);
             if (TREE_CODE(innertype) == REAL_TYPE)
-              innertype = REAL_TO_INTEGER_TYPE;
+              innertype = fxopt_integer_type(var_word_size(var));
           }
         }
         // convert the TYPE of the var from float to integer
@@ -465,7 +723,7 @@ static unsigned int execute_fxopt_plugin(void)
     // calculating an induction variable and should not be converted to
     // fixed-point
     //
-    fprintf(stderr, "  ===== Marking statements not visited =====\n");
+    FXLOG(2, "  ===== Marking statements not visited =====\n");
     FOR_EACH_BB(bb) {
       for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
         stmt = gsi_stmt(gsi);
@@ -473,6 +731,7 @@ static unsigned int execute_fxopt_plugin(void)
         gimple_set_visited(stmt, gimple_plf(stmt, GF_PLF_1));
       }
     }
+    begin_revisits();
     restore_attributes();
 
     int undefined_result_format;        // at least one format still undefined
@@ -484,40 +743,43 @@ static unsigned int execute_fxopt_plugin(void)
     // The former is a success condition, the latter is a fail condition
     //
     do {
-      fxpass++;
-      if (fxpass >= MAX_PASSES)
+      fxctx->fxpass++;
+      COUNT_STAT(passes);
+      if (fxctx->fxpass >= MAX_PASSES)
         fatal_error("fxopt: Too many passes\n");
 
-      fprintf(stderr, "  ===== Starting pass %d =====\n", fxpass);
+      FXLOG(1, "  ===== Starting pass %d =====\n", fxctx->fxpass);
       undefined_result_format = 0;
       statements_updated = 0;
       int bbnumber = 0;
       //
-      // If the format of an iterated variable changed on the last iteration
-      //   of the loop, revisit all statements. This is not elegant...better
-      //   to find the actual statements affected by a new format and revisit
-      //   them only.
+      // Only statements whose "visited" bit is clear are analyzed. The bit
+      //   is cleared by revisit_var_uses() for the statements that use a
+      //   variable whose format changed, which also puts their blocks on the
+      //   worklist, so each pass after the first works through just the
+      //   blocks with affected statements rather than the whole function
       //
-      if (formats_changed)
-        FOR_EACH_BB(bb) {
-          for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
-            stmt = gsi_stmt(gsi);
-            gimple_set_visited(stmt, gimple_plf(stmt, GF_PLF_1));
-          }
-        }
       formats_changed = 0;
-      FOR_EACH_BB(bb) {
-        bbnumber++;
-        fprintf(stderr, "  ======= Starting basic block %d =====\n", bbnumber);
+      begin_revisit_pass();
+      while ((bb = next_revisit_block()) != NULL) {
+        bool unresolved = false;        // a statement is left unvisited
+        bbnumber = bb->index;
+        FXLOG(2, "  ======= Starting basic block %d =====\n", bbnumber);
 
         for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
           stmt = gsi_stmt(gsi);
-          print_gimple_stmt(stderr, stmt, 2, 0);
+          FXLOG_STMT(2, stmt);
 
           if (is_gimple_assign(stmt) && (!(gimple_visited_p(stmt)))) {
             gimple new_stmt;
             struct SIF result_frmt;
+            COUNT_STAT(statements);
             initialize_format(&result_frmt);
+            //
+            // Affine terms created while analyzing the statement are only
+            // needed until its result format has been stored
+            //
+            begin_aa_scratch();
 
             // 
             // Get the trees for all operands, get the format of the LHS,
@@ -542,7 +804,10 @@ static unsigned int execute_fxopt_plugin(void)
             // Change floating expressions to integer expressions, then get
             // the code and class for the right hand side
             // 
+            enum tree_code orig_rhs_code = gimple_assign_rhs_code(stmt);
             real_expr_to_integer(stmt);
+            if (fxctx->lastpass)
+              block_scaling(&gsi, oprnd_frmt);
             enum tree_code rhs_code = gimple_assign_rhs_code(stmt);
 
             switch (rhs_code) {
@@ -572,6 +837,7 @@ static unsigned int execute_fxopt_plugin(void)
                 result_frmt = nop(&gsi, oprnd_frmt, oprnd_tree);
                 break;
               case ARRAY_REF:
+              case COMPONENT_REF:
                 result_frmt = array_ref(&gsi, oprnd_frmt, oprnd_tree);
                 break;
               case MEM_REF:
@@ -585,6 +851,10 @@ static unsigned int execute_fxopt_plugin(void)
               case MULT_EXPR:
                 result_frmt = multiplication(&gsi, oprnd_frmt, oprnd_tree);
                 break;
+              case MIN_EXPR:
+              case MAX_EXPR:
+                result_frmt = min_max(&gsi, oprnd_frmt, oprnd_tree);
+                break;
               case RDIV_EXPR:
               case TRUNC_DIV_EXPR:
                 result_frmt = division(&gsi, oprnd_frmt, oprnd_tree);
@@ -593,16 +863,28 @@ static unsigned int execute_fxopt_plugin(void)
                 // 
                 // The GIMPLE statement was either trivial or unknown.
                 // 
-                fprintf(stderr, "*** Found a gimple assign statement ***\n");
+                FXLOG(2, "*** Found a gimple assign statement ***\n");
                 enum gimple_rhs_class xclass = get_gimple_rhs_class(rhs_code);
-                fprintf(stderr, "RHS TREE CLASS: %s   CODE: %s\n",
-                        TREE_CODE_CLASS_STRING(xclass),
-                        tree_code_name[rhs_code]);
+                FXLOG(2, "RHS TREE CLASS: %s   CODE: %s\n",
+                      TREE_CODE_CLASS_STRING(xclass),
+                      tree_code_name[rhs_code]);
             }
+            //
+            // A store to one element of an array is aligned with the format
+            //   shared by all of its elements
+            //
+            if (format_initialized(result_frmt) &&
+                (((TREE_CODE(oprnd0_tree) == ARRAY_REF) &&
+                  (TREE_CODE(TREE_OPERAND(oprnd0_tree, 0)) == VAR_DECL) &&
+                  (UNIFORM || is_block_array(TREE_OPERAND(oprnd0_tree, 0)))) ||
+                 is_shared_ref(oprnd0_tree)))
+              result_frmt = uniform_store(&gsi, oprnd_frmt, oprnd_tree,
+                                          result_frmt);
             ///////////////////////////////////////////////////////////////
             //  Done analyzing an assignment statement 
             ///////////////////////////////////////////////////////////////
             if (format_initialized(result_frmt)) {
+              propagate_noise(rhs_code, oprnd_frmt, num_operands, &result_frmt);
               // 
               // Now construct and insert any necessary shift operations. This
               // section is executed after each GIMPLE arithmetic operator is
@@ -614,18 +896,18 @@ static unsigned int execute_fxopt_plugin(void)
               // 
               int i;
               for (i = 1; i < num_operands; i++) {
-                if (!lastpass)
+                if (!fxctx->lastpass)
                   break;
                 tree current_oprnd_tree = oprnd_tree[i];
                 char var_name[32];
                 if (oprnd_frmt[i].shift != 0) {
                   check_shift(oprnd_frmt[i]);
-                  if (!oprnd_frmt[1].ptr_op) {
+                  if (!oprnd_frmt[1].ptr_op && LOG_ENABLED(2)) {
                     if (oprnd_frmt[i].shift > 0)
-                      fprintf(stderr, "  OP%d >>%-2d", i, oprnd_frmt[i].shift);
+                      fprintf(fxlog, "  OP%d >>%-2d", i, oprnd_frmt[i].shift);
                     else
-                      fprintf(stderr, "  OP%d <<%-2d", i, -oprnd_frmt[i].shift);
-                    fprintf(stderr, " (%2d/%2d/%2d/%2d)", oprnd_frmt[i].S,
+                      fprintf(fxlog, "  OP%d <<%-2d", i, -oprnd_frmt[i].shift);
+                    fprintf(fxlog, " (%2d/%2d/%2d/%2d)", oprnd_frmt[i].S,
                             oprnd_frmt[i].I, oprnd_frmt[i].F, oprnd_frmt[i].E);
                     print_min_max(oprnd_frmt[i]);
                   }
@@ -720,10 +1002,13 @@ static unsigned int execute_fxopt_plugin(void)
                     } else {
                       shift_expr = RSHIFT_EXPR;
                       //
-                      // Only round if the shift will cause F bits to be lost
+                      // Only round if the shift will cause F bits to be lost.
+                      // Terms added to an accumulator are not rounded, since
+                      // the sum is rounded when it leaves the accumulator.
                       //
                       if (ROUNDING
-                          && (oprnd_frmt[i].originalF > oprnd_frmt[i].F)) {
+                          && (oprnd_frmt[i].originalF > oprnd_frmt[i].F)
+                          && !is_accumulator(oprnd0_tree)) {
                         //
                         // Check to see if rounding this operand could cause an
                         // overflow. If so, and if guarding is enabled, then do
@@ -740,7 +1025,7 @@ static unsigned int execute_fxopt_plugin(void)
                           //
                           sprintf(var_name, "_fx_guard%d", i);
                           tree guarded_var =
-                              make_rename_temp(long_long_integer_type_node,
+                              make_rename_temp(TREE_TYPE(var_to_shift),
                                                var_name);
                           new_stmt =
                               gimple_build_assign_with_ops(RSHIFT_EXPR,
@@ -748,7 +1033,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                            var_to_shift,
                                                            build_one_cst
                                                            (integer_type_node));
-                          print_gimple_stmt(stderr, new_stmt, 2, 0);
+                          FXLOG_STMT(2, new_stmt);
                           gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
                           var_to_shift = guarded_var;
                           oprnd_frmt[i].S++;
@@ -790,7 +1075,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                              sign_bit_var,
                                                              var_to_shift,
                                                              sign_shift_cst);
-                            print_gimple_stmt(stderr, new_stmt, 2, 0);
+                            FXLOG_STMT(2, new_stmt);
                             gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
                             // Now we add the rounding_const and sign_bit_var
                             sprintf(var_name, "_fx_sround%d", i);
@@ -802,7 +1087,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                              s_round_var,
                                                              sign_bit_var,
                                                              rounding_const);
-                            print_gimple_stmt(stderr, new_stmt, 2, 0);
+                            FXLOG_STMT(2, new_stmt);
                             //gimple_set_visited(new_stmt, true);
                             gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
                             // Add the adjusted round value to op
@@ -834,7 +1119,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                              var_to_shift,
                                                              rounding_const);
                           }
-                          print_gimple_stmt(stderr, new_stmt, 2, 0);
+                          FXLOG_STMT(2, new_stmt);
                           gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
                           var_to_shift = rounded_var;
                         }       // shift > 0 after guarding
@@ -850,7 +1135,7 @@ static unsigned int execute_fxopt_plugin(void)
                           gimple_build_assign_with_ops(shift_expr, shift_var,
                                                        var_to_shift,
                                                        shift_constant);
-                      print_gimple_stmt(stderr, new_stmt, 2, 0);
+                      FXLOG_STMT(2, new_stmt);
                       gsi_insert_before(&gsi, new_stmt, GSI_SAME_STMT);
                       current_oprnd_tree = shift_var;
                     }
@@ -864,6 +1149,19 @@ static unsigned int execute_fxopt_plugin(void)
                   gimple_set_modified(stmt, true);
                 }
               }
+              //
+              // With the operands in place, a division by a variable can be
+              // replaced by a multiplication by its reciprocal, computed to
+              // the precision of the quotient. Only a division that was real
+              //   is replaced; an integer division in the source is kept
+              //
+              if (fxctx->lastpass && RECIPROCAL_DIV &&
+                  (orig_rhs_code == RDIV_EXPR) &&
+                  (gimple_assign_rhs_code(stmt) == TRUNC_DIV_EXPR) &&
+                  !TREE_CONSTANT(gimple_assign_rhs2(stmt))) {
+                reciprocal_divide(&gsi, ceil_log2_range(result_frmt));
+                stmt = gsi_stmt(gsi);
+              }
               // 
               // //////// Assign a format to the result variable //////////
               // 
@@ -873,32 +1171,32 @@ static unsigned int execute_fxopt_plugin(void)
               // 
               tree result_var = oprnd_tree[0];
               if (result_frmt.size > oprnd_frmt[0].size) {
+                int extension = result_frmt.size - oprnd_frmt[0].size;
                 //
                 // Replace the original LHS with a wider variable
                 //
                 tree wider_var; // need this name in scope later
-                if (lastpass) {
+                if (fxctx->lastpass) {
                   wider_var =
-                      make_rename_temp(long_long_integer_type_node,
+                      make_rename_temp(fxopt_integer_type(result_frmt.size),
                                        "_fx_wide0");
                   gimple_set_op(stmt, 0, wider_var);
                   gimple_set_modified(stmt, true);
                   update_stmt(stmt);
-                  print_gimple_stmt(stderr, stmt, 2, 0);
+                  FXLOG_STMT(2, stmt);
                   result_var = wider_var;
                 }
 
                 if (ROUNDING && GUARDING && (result_frmt.S == 1)) {
-                  if (lastpass) {
+                  if (fxctx->lastpass) {
                     tree guarded_var =
-                        make_rename_temp(long_long_integer_type_node,
-                                         "_fx_guard0");
+                        make_rename_temp(TREE_TYPE(wider_var), "_fx_guard0");
                     new_stmt =
                         gimple_build_assign_with_ops(RSHIFT_EXPR, guarded_var,
                                                      result_var,
                                                      build_one_cst
                                                      (integer_type_node));
-                    print_gimple_stmt(stderr, new_stmt, 2, 0);
+                    FXLOG_STMT(2, new_stmt);
                     gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
                     result_var = guarded_var;
                   }
@@ -911,13 +1209,28 @@ static unsigned int execute_fxopt_plugin(void)
                 // 
                 // Explicitly cast the new wider LHS to the width of the
                 // original LHS. Shift right so there remains just 1 sign bit in
-                // the lower half of the double-precision result
+                // the part of the wider result that fits in the LHS, unless
+                // there are already enough sign bits to discard
                 // 
-                result_frmt.shift = oprnd_frmt[0].size - result_frmt.S + 1;
+                result_frmt.shift = MAX(extension - result_frmt.S + 1, 0);
+                //
+                // A double-precision product that loses its whole low half
+                // can use a high-part multiply, unless it must be saturated
+                // or its rounding constant is adjusted for saturation
+                //
+                bool high_part = fxctx->lastpass &&
+                    (gimple_assign_rhs_code(stmt) == WIDEN_MULT_EXPR) &&
+                    (result_frmt.shift == extension) &&
+                    !oprnd_frmt[0].has_attribute && !oprnd_frmt[0].ptr_op &&
+                    !(format_initialized(oprnd_frmt[0]) &&
+                      (oprnd_frmt[0].I < result_frmt.I));
 
-                if (result_frmt.shift > 0) {
+                if (high_part) {
+                  result_var = high_part_product(&gsi, result_frmt, result_var,
+                                                 TREE_TYPE(oprnd0_tree));
+                } else if (result_frmt.shift > 0) {
                   // don't round if there are enough empty bits
-                  if (ROUNDING && lastpass) {
+                  if (ROUNDING && fxctx->lastpass) {
                     tree rounded_var =
                         make_rename_temp(TREE_TYPE(wider_var), "_fx_round0");
                     // shift_constant is (1 << n-1) for n-bit shift
@@ -954,7 +1267,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                        sign_bit_var,
                                                        result_var,
                                                        sign_shifting_const);
-                      print_gimple_stmt(stderr, new_stmt, 2, 0);
+                      FXLOG_STMT(2, new_stmt);
                       gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
                       // Now we add the rounding_const and the sign_bit_var
                       tree s_round_var = make_rename_temp(TREE_TYPE(wider_var),
@@ -965,7 +1278,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                        sign_bit_var,
                                                        rounding_const);
                       gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
-                      print_gimple_stmt(stderr, new_stmt, 2, 0);
+                      FXLOG_STMT(2, new_stmt);
                       // Add the adjusted round value to op
                       new_stmt =
                           gimple_build_assign_with_ops(PLUS_EXPR, rounded_var,
@@ -978,7 +1291,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                        rounding_const);
                     }
                     gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
-                    print_gimple_stmt(stderr, new_stmt, 2, 0);
+                    FXLOG_STMT(2, new_stmt);
                     result_var = rounded_var;
                   }             // end of rounding
                   //
@@ -1001,22 +1314,32 @@ static unsigned int execute_fxopt_plugin(void)
                     && ((oprnd_frmt[0].I != result_frmt.I)
                         || (oprnd_frmt[0].ptr_op
                             && (result_frmt.S != oprnd_frmt[0].S)))) {
-                  fprintf(stderr, " !! Second call to apply_fxfrmt\n");
+                  FXLOG(1, " !! Second call to apply_fxfrmt\n");
                   result_frmt =
                       apply_fxfrmt(&gsi, oprnd_frmt, oprnd_tree,
                                    result_frmt, &result_var);
                 }
                 //
-                // Do the actual cast to the original, smaller size
+                // Do the actual cast to the original, smaller size. A cast
+                // can't be stored directly to memory, so a narrow array
+                // element or pointer target gets a temporary first.
                 //
-                //FIXME fails if original stmt was not a NOP??
-                if (lastpass) {
+                if (fxctx->lastpass) {
+                  tree narrow_var = oprnd0_tree;
+                  if (!is_gimple_reg(oprnd0_tree))
+                    narrow_var = make_rename_temp(TREE_TYPE(oprnd0_tree),
+                                                  "_fx_narrow0");
                   new_stmt =
                       gimple_build_assign_with_ops(CONVERT_EXPR,
-                                                   oprnd0_tree, result_var,
+                                                   narrow_var, result_var,
                                                    NULL);
                   gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
-                  print_gimple_stmt(stderr, new_stmt, 2, 0);
+                  FXLOG_STMT(2, new_stmt);
+                  if (narrow_var != oprnd0_tree) {
+                    new_stmt = gimple_build_assign(oprnd0_tree, narrow_var);
+                    gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
+                    FXLOG_STMT(2, new_stmt);
+                  }
                 }
                 //
                 // The result now fits in the LHS operand
@@ -1024,11 +1347,15 @@ static unsigned int execute_fxopt_plugin(void)
                 //
                 result_frmt = new_range(result_frmt);
                 result_frmt.size = oprnd_frmt[0].size;
-                result_frmt.S = 1;
+                if (result_frmt.shift > 0)
+                  result_frmt.S = 1;
+                else
+                  result_frmt.S -= extension;
                 if (result_frmt.shift > result_frmt.E) {
                   result_frmt.F =
                       result_frmt.F + result_frmt.E - result_frmt.shift;
                   result_frmt.E = 0;
+                  result_frmt.noise += quantization_noise(result_frmt.F);
                 } else {
                   result_frmt.E -= result_frmt.shift;
                 }
@@ -1043,13 +1370,13 @@ static unsigned int execute_fxopt_plugin(void)
                 if (oprnd_frmt[0].has_attribute
                     && ((oprnd_frmt[0].I != result_frmt.I)
                         || (oprnd_frmt[0].S != result_frmt.S))) {
-                  if (lastpass) {
+                  if (fxctx->lastpass) {
                     tree unsat_var =
                         make_rename_temp(TREE_TYPE(oprnd0_tree), "_fx_unsat0");
                     gimple_set_op(stmt, 0, unsat_var);
                     gimple_set_modified(stmt, true);
                     update_stmt(stmt);
-                    print_gimple_stmt(stderr, stmt, 2, 0);
+                    FXLOG_STMT(2, stmt);
                     result_var = unsat_var;
                   }
 
@@ -1057,9 +1384,10 @@ static unsigned int execute_fxopt_plugin(void)
                       apply_fxfrmt(&gsi, oprnd_frmt, oprnd_tree, result_frmt,
                                    &result_var);
 
-                  if (lastpass && (oprnd0_tree != result_var)) {
+                  if (fxctx->lastpass && (oprnd0_tree != result_var)) {
                     if ((rhs_code == SSA_NAME) || (rhs_code == CONVERT_EXPR) ||
-                        (rhs_code == ARRAY_REF)) {
+                        (rhs_code == ARRAY_REF) ||
+                        (rhs_code == COMPONENT_REF)) {
                       new_stmt =
                           gimple_build_assign_with_ops(rhs_code, oprnd0_tree,
                                                        result_var, NULL);
@@ -1069,7 +1397,7 @@ static unsigned int execute_fxopt_plugin(void)
                                                        result_var, NULL);
                     }
                     gsi_insert_after(&gsi, new_stmt, GSI_NEW_STMT);
-                    print_gimple_stmt(stderr, new_stmt, 2, 0);
+                    FXLOG_STMT(2, new_stmt);
                   }
                 }               // oprnd0 has fxfrmt attribute, must saturate
               }                 // result and oprnd0 are same size
@@ -1081,6 +1409,7 @@ static unsigned int execute_fxopt_plugin(void)
                 result_frmt.aa = new_aa;
                 result_frmt.max = aa_max(result_frmt.aa);
                 result_frmt.min = aa_min(result_frmt.aa);
+                count_aa_list(result_frmt.aa);
               }
 
               // 
@@ -1088,96 +1417,328 @@ static unsigned int execute_fxopt_plugin(void)
               // 
               if (gimple_modified_p(stmt)) {
                 update_stmt(stmt);
-                print_gimple_stmt(stderr, stmt, 2, 0);
-              }
-              if (result_frmt.alias) {
-                fprintf(stderr, "  RSLT @");
-              } else if (result_frmt.ptr_op) {
-                fprintf(stderr, "  RSLT *");
-              } else {
-                fprintf(stderr, "  RSLT  ");
+                FXLOG_STMT(2, stmt);
               }
-              fprintf(stderr, "(%2d/%2d/%2d/%2d)",
-                      result_frmt.S, result_frmt.I, result_frmt.F,
-                      result_frmt.E);
-              if (result_frmt.sgnd) {
-                fprintf(stderr, "s ");
-              } else {
-                fprintf(stderr, "u ");
-              }
-              if (AFFINE) {
-                print_aa_list(result_frmt.aa);
+              if (LOG_ENABLED(2)) {
+                if (result_frmt.alias) {
+                  fprintf(fxlog, "  RSLT @");
+                } else if (result_frmt.ptr_op) {
+                  fprintf(fxlog, "  RSLT *");
+                } else {
+                  fprintf(fxlog, "  RSLT  ");
+                }
+                fprintf(fxlog, "(%2d/%2d/%2d/%2d)",
+                        result_frmt.S, result_frmt.I, result_frmt.F,
+                        result_frmt.E);
+                if (result_frmt.sgnd) {
+                  fprintf(fxlog, "s ");
+                } else {
+                  fprintf(fxlog, "u ");
+                }
+                if (AFFINE) {
+                  print_aa_list(result_frmt.aa);
+                }
+                if (INTERVAL)
+                  print_min_max(result_frmt);
+                else
+                  fprintf(fxlog, "\n");
               }
-              if (INTERVAL)
-                print_min_max(result_frmt);
-              else
-                fprintf(stderr, "\n");
 
               statements_updated++;
             }                   // result format is initialized
             else {
               undefined_result_format++;
-              fprintf(stderr, "  RESULT is uninitialized\n");
+              FXLOG(2, "  RESULT is uninitialized\n");
             }                   // result format is not initialized
             //
+            // A value assigned to a variable that is carried around a loop
+            //   is aligned with the format of the variable
+            //
+            if (format_initialized(result_frmt) && is_loop_var(oprnd0_tree))
+              result_frmt = loop_var_store(&gsi, oprnd_frmt[0], oprnd0_tree,
+                                           result_frmt);
+            //
             // If there was a problem setting the LHS format, and the
             // LHS is a variable that is used iteratively, try again
             //
-            if (set_var_format(oprnd0_tree, result_frmt) && oprnd_frmt[0].iter)
-            {
+            int lhs_changed = format_initialized(result_frmt) &&
+                format_changed(oprnd_frmt[0], result_frmt);
+            if (set_var_format(oprnd0_tree, result_frmt) &&
+                (oprnd_frmt[0].iter || is_loop_var(oprnd0_tree))) {
               statements_updated++;
               undefined_result_format++;
               formats_changed++;
+              lhs_changed = 1;
             }                   // LHS format changed
+            //
+            // A resolved statement need not be analyzed again unless one of
+            //   its operands changes. If the LHS format changed then the
+            //   statements that use it must be revisited.
+            //
+            if (format_initialized(result_frmt) && !has_variable_index(stmt))
+              gimple_set_visited(stmt, true);
+            if (lhs_changed)
+              revisit_var_uses(oprnd0_tree);
             delete_aa_list(&(result_frmt.aa));
             for (i = 0; i < num_operands; i++) {
               if (0xdead == oprnd_frmt[i].id) 
                 delete_aa_list(&(oprnd_frmt[i].aa));
             }
+            end_aa_scratch();
           }                     // an assign statement
-          fprintf(stderr, "-------------------------------- %d %d\n",
-                    bbnumber, fxpass);
+          else if (is_math_call(stmt) && !gimple_visited_p(stmt)) {
+            //
+            // A call to a math function gets the format of its result from
+            //   the range of the function, and on the last pass is replaced
+            //   by a fixed-point kernel
+            //
+            tree lhs = gimple_call_lhs(stmt);
+            struct SIF lhs_frmt = get_operand_format(stmt, 0, 0, NOPRINT);
+            struct SIF result_frmt;
+            COUNT_STAT(statements);
+            begin_aa_scratch();
+            result_frmt = math_call(&gsi);
+            stmt = gsi_stmt(gsi);
+            if (format_initialized(result_frmt)) {
+              statements_updated++;
+              if (is_loop_var(lhs))
+                result_frmt = loop_var_store(&gsi, lhs_frmt, lhs, result_frmt);
+              if (set_var_format(lhs, result_frmt) ||
+                  format_changed(lhs_frmt, result_frmt)) {
+                formats_changed++;
+                revisit_var_uses(lhs);
+                if (is_loop_var(lhs))
+                  undefined_result_format++;
+              }
+              gimple_set_visited(stmt, true);
+            } else {
+              undefined_result_format++;
+              FXLOG(2, "  RESULT is uninitialized\n");
+            }
+            delete_aa_list(&(result_frmt.aa));
+            end_aa_scratch();
+          }                     // a math function call
+          else if (is_ipa_call(stmt) && !gimple_visited_p(stmt)) {
+            //
+            // A call to another function passes the ranges of its arguments
+            //   to the callee. If the callee has been converted, the
+            //   arguments are shifted to its parameters and the result gets
+            //   the format of its return value.
+            //
+            tree lhs = gimple_call_lhs(stmt);
+            struct SIF lhs_frmt;
+            struct SIF result_frmt;
+            COUNT_STAT(statements);
+            begin_aa_scratch();
+            initialize_format(&lhs_frmt);
+            if (lhs != NULL_TREE)
+              lhs_frmt = get_operand_format(stmt, 0, 0, NOPRINT);
+            if (ipa_call(&gsi, &result_frmt)) {
+              statements_updated++;
+              gimple_set_visited(stmt, true);
+              if (format_initialized(result_frmt)) {
+                if (is_loop_var(lhs))
+                  result_frmt = loop_var_store(&gsi, lhs_frmt, lhs,
+                                               result_frmt);
+                if (set_var_format(lhs, result_frmt) ||
+                    format_changed(lhs_frmt, result_frmt)) {
+                  formats_changed++;
+                  revisit_var_uses(lhs);
+                  if (is_loop_var(lhs))
+                    undefined_result_format++;
+                }
+              }
+            } else {
+              undefined_result_format++;
+              FXLOG(2, "  ARGUMENTS are uninitialized\n");
+            }
+            delete_aa_list(&(result_frmt.aa));
+            end_aa_scratch();
+          }                     // a call to another function
+          else if (is_real_condition(stmt) && !gimple_visited_p(stmt)) {
+            //
+            // A comparison has no result, but its operands must be aligned
+            //
+            COUNT_STAT(statements);
+            begin_aa_scratch();
+            if (condition(&gsi)) {
+              statements_updated++;
+              gimple_set_visited(stmt, true);
+            } else {
+              undefined_result_format++;
+              FXLOG(2, "  OPERANDS are uninitialized\n");
+            }
+            end_aa_scratch();
+          }                     // a real comparison
+          else if (!gimple_visited_p(stmt)) {
+            // nothing to analyze, so the block is not walked again for it
+            gimple_set_visited(stmt, true);
+          }
+          FXLOG(2, "-------------------------------- %d %d\n",
+                  bbnumber, fxctx->fxpass);
           if (gimple_code(stmt) == GIMPLE_RETURN) {
             tree return_val = gimple_return_retval(stmt);
             if (return_val != NULL_TREE) {
               if (SSA_NAME == TREE_CODE(return_val)) {
-                if (lastpass) {
+                if (fxctx->lastpass) {
                   tree return_var_tree = SSA_NAME_VAR(return_val);
                   struct SIF *var_fmt;
                   var_fmt = find_var_format(calc_hash_key(return_var_tree,
-                                                         fxpass, NOT_AN_ARRAY));
+                                                          fxctx->fxpass,
+                                                          NOT_AN_ARRAY));
                   if (format_initialized(*var_fmt)) {
-                    fprintf(stderr, "/// RETURNS %2d\n", var_fmt->S);
-                    fprintf(stderr, "/// RETURNI %2d\n", var_fmt->I);
-                    fprintf(stderr, "/// RETURNF %2d\n", var_fmt->F);
-                    fprintf(stderr, "/// RETURNE %2d\n", var_fmt->E);
+                    if (IPA_SUMMARY_FILE)
+                      record_return_format(var_fmt);
+                    FXFORMAT("/// RETURNS %2d\n", var_fmt->S);
+                    FXFORMAT("/// RETURNI %2d\n", var_fmt->I);
+                    FXFORMAT("/// RETURNF %2d\n", var_fmt->F);
+                    FXFORMAT("/// RETURNE %2d\n", var_fmt->E);
+                    if (SQNR_TARGET)
+                      FXLOG(1, "  return value SQNR %.1f dB\n",
+                            format_sqnr(var_fmt));
                   }
                 }
               } else {
-                fprintf(stderr, "  Unexpected non-void return type");
+                FXLOG(1, "  Unexpected non-void return type");
               }
             }                   // non-void return value
           }                     // return statement
+          if (!gimple_visited_p(gsi_stmt(gsi)))
+            unresolved = true;
         }                       // each statement
+        if (unresolved)
+          keep_revisit_block();
         //
         // Make the min/max of pointer variables be consistent, and convert
         // their AA lists to a simple range.
         //
-        fprintf(stderr, "  End of a basic block\n");
+        FXLOG(2, "  End of a basic block\n");
+        fxtimer_push(PHASE_PTR_CONSISTENCY);
         force_ptr_consistency();
-      }                         // each bb
-    } while (undefined_result_format && statements_updated);
+        fxtimer_pop(PHASE_PTR_CONSISTENCY);
+      }                         // each block on the worklist
+      //
+      // When every format is found, the ranges of loop-carried variables
+      //   that were widened may be narrowed by more passes
+      //
+    } while ((undefined_result_format && statements_updated) ||
+             (!undefined_result_format && !fxctx->lastpass &&
+              narrow_loop_vars()));
+    end_revisits();
 
     if (undefined_result_format)
       error("fxopt: couldn't resolve all formats");
-    lastpass++;
-  } while (lastpass < 2);
+    else if (!fxctx->lastpass) {
+      //
+      // Once the word sizes have been chosen they are kept, even if the
+      // formats found with the new sizes would allow more reductions
+      //
+      if (SQNR_TARGET && !resized && choose_word_sizes()) {
+        fxtimer_pop(phase);
+        return false;
+      }
+      if (FORMAT_CACHE_DIR) {
+        fxtimer_push(PHASE_FORMAT_CACHE);
+        save_cached_formats(cache_key);
+        fxtimer_pop(PHASE_FORMAT_CACHE);
+      }
+    }
+    fxtimer_pop(phase);
+    fxctx->lastpass++;
+  } while (fxctx->lastpass < 2);
+
+  insert_block_normalization();
+  if (CSD_MULT_COST) {
+    fxtimer_push(PHASE_REWRITE);
+    rewrite_constant_mults();
+    fxtimer_pop(PHASE_REWRITE);
+  }
+  if (SHARE_SHIFTS) {
+    fxtimer_push(PHASE_REWRITE);
+    share_shifts();
+    fxtimer_pop(PHASE_REWRITE);
+  }
+  return true;
+}
+
+/**
+ * @brief The main function that is invoked for fxopt
+ * @details 
+ *
+ * @return boolean, success or failure
+ */
+static unsigned int execute_fxopt_plugin(void)
+{
+  struct FXOPT_CONTEXT context;
+  uint64_t cache_key = 0;
+  bool resized = false;
+
+  begin_fxopt_context(&context);
+  COUNT_STAT(functions);
+  FXFORMAT("/// FUNCTION %s\n",
+           IDENTIFIER_POINTER(DECL_NAME(current_function_decl)));
+  if (PROFILE_GENERATE) {
+    instrument_function();
+    end_fxopt_context();
+    return 0;
+  }
+  if (BRANCH_RANGES) {
+    fxtimer_push(PHASE_DECLARED_VARS);
+    refine_branch_ranges();
+    fxtimer_pop(PHASE_DECLARED_VARS);
+  }
+  if (FORMAT_CACHE_DIR) {
+    fxtimer_push(PHASE_FORMAT_CACHE);
+    cache_key = function_cache_key();
+    fxtimer_pop(PHASE_FORMAT_CACHE);
+  }
+  if (IPA_SUMMARY_FILE)
+    begin_function_summary();
+  if (ACCUMULATE) {
+    fxtimer_push(PHASE_DECLARED_VARS);
+    FXLOG(1, "  ===== Finding sum-of-products chains =====\n");
+    mark_accumulators();
+    fxtimer_pop(PHASE_DECLARED_VARS);
+  }
+  //
+  // If variables were given smaller word sizes to meet the SQNR target, start
+  // over with a new context and find their formats again
+  //
+  while (!convert_function(cache_key, resized)) {
+    end_fxopt_context();
+    begin_fxopt_context(&context);
+    resized = true;
+  }
+  if (IPA_SUMMARY_FILE)
+    end_function_summary();
 
-  print_var_formats();
-  delete_all_formats();
+  if (LOG_ENABLED(1))
+    print_var_formats();
+  end_fxopt_context();
   return 0;
 }
 
+/**
+ * @brief Report the statistics, if requested, and close the log and format
+ * annotation files when gcc finishes.
+ *
+ * @param event_data not used
+ * @param data       not used
+ */
+static void finish_fxopt_plugin(void *event_data, void *data)
+{
+  if (STATS)
+    print_fxopt_stats(stderr);
+  if (IPA_SUMMARY_FILE)
+    save_ipa_summaries(IPA_SUMMARY_FILE);
+  if (fxlog && (fxlog != stderr))
+    fclose(fxlog);
+  fxlog = stderr;
+  if (fxformats)
+    fclose(fxformats);
+  fxformats = NULL;
+}
+
 /**
   @brief A require function for plugins.
 
@@ -1197,7 +1758,7 @@ static struct gimple_opt_pass pass_fxopt_plugin = {
    NULL,                        ///<  sub 
    NULL,                        ///<  next 
    0,                           ///<  static_pass_number 
-   0,                           ///<  tv_id 
+   TV_PLUGIN_RUN,               ///<  tv_id 
    PROP_cfg | PROP_ssa,         ///<  properties_required 
    0,                           ///<  properties_provided 
    0,                           ///<  properties_destroyed 
@@ -1227,11 +1788,46 @@ int plugin_init(struct plugin_name_args *plugin_info,
   int ref_instance_number = 0;
   int i;
 
+// 
+// Process the logging arguments first, so that the messages for the other
+// arguments go to the right place.
+//
+  fxlog = stderr;
+  for (i = 0; i < argc; ++i) {
+    if (!strcmp(argv[i].key, "verbose")) {
+      if (argv[i].value)
+        VERBOSE = strtol(argv[i].value, NULL, 0);
+      else
+        VERBOSE = 1;
+    } else if (!strcmp(argv[i].key, "log")) {
+      FILE *log_file = NULL;
+      if (argv[i].value)
+        log_file = fopen(argv[i].value, "w");
+      if (log_file) {
+        setvbuf(log_file, NULL, _IOFBF, LOG_BUFFER_SIZE);
+        fxlog = log_file;
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-log requires a writable file name",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "formats")) {
+      if (argv[i].value)
+        fxformats = fopen(argv[i].value, "w");
+      if (NULL == fxformats)
+        warning
+            (0, "option -fplugin-arg-%s-formats requires a writable file name",
+             plugin_name);
+    }
+  }
+
 // 
 // Process the plugin arguments.
 //
   for (i = 0; i < argc; ++i) {
-    if (!strcmp(argv[i].key, "ref-pass-name")) {
+    if (!strcmp(argv[i].key, "verbose") || !strcmp(argv[i].key, "log") ||
+        !strcmp(argv[i].key, "formats")) {
+      continue;                 // already processed
+    } else if (!strcmp(argv[i].key, "ref-pass-name")) {
       if (argv[i].value)
         ref_pass_name = argv[i].value;
       else
@@ -1247,33 +1843,163 @@ int plugin_init(struct plugin_name_args *plugin_info,
              plugin_name);
     } else if (!strcmp(argv[i].key, "round")) {
       ROUNDING = 1;
-      fprintf(stderr, "fxopt: rounding enabled\n");
+      FXLOG(1, "fxopt: rounding enabled\n");
     } else if (!strcmp(argv[i].key, "round-positive")) {
       ROUNDING = 1;
       POSITIVE = 1;
-      fprintf(stderr, "fxopt: positive rounding enabled\n");
+      FXLOG(1, "fxopt: positive rounding enabled\n");
     } else if (!strcmp(argv[i].key, "guard")) {
       GUARDING = 1;
-      fprintf(stderr, "fxopt: guarding enabled\n");
+      FXLOG(1, "fxopt: guarding enabled\n");
     } else if (!strcmp(argv[i].key, "dpmult")) {
       DBL_PRECISION_MULTS = 1;
-      fprintf(stderr, "fxopt: double-precision multiplication enabled\n");
+      FXLOG(1, "fxopt: double-precision multiplication enabled\n");
     } else if (!strcmp(argv[i].key, "div2mult")) {
       CONST_DIV_TO_MULT = 1;
-      fprintf(stderr,
-              "fxopt: constant division converted to multiplication\n");
+      FXLOG(1, "fxopt: constant division converted to multiplication\n");
+    } else if (!strcmp(argv[i].key, "accumulate")) {
+      ACCUMULATE = 1;
+      FXLOG(1, "fxopt: wide accumulators for sums of products\n");
+    } else if (!strcmp(argv[i].key, "csd")) {
+      CSD_MULT_COST = argv[i].value ? strtol(argv[i].value, NULL, 0) : 4;
+      if (CSD_MULT_COST > 0)
+        FXLOG(1, "fxopt: constant multiplications cost %d shifts and adds\n",
+              CSD_MULT_COST);
+      else {
+        CSD_MULT_COST = 0;
+        warning
+            (0, "option -fplugin-arg-%s-csd requires a positive cost",
+             plugin_name);
+      }
+    } else if (!strcmp(argv[i].key, "share-shifts")) {
+      SHARE_SHIFTS = 1;
+      FXLOG(1, "fxopt: redundant and loop-invariant shifts removed\n");
+    } else if (!strcmp(argv[i].key, "recip")) {
+      RECIPROCAL_DIV = 1;
+      FXLOG(1, "fxopt: division by a variable uses a reciprocal\n");
+    } else if (!strcmp(argv[i].key, "branch-ranges")) {
+      BRANCH_RANGES = 1;
+      FXLOG(1, "fxopt: bounding variables in branches of comparisons\n");
+    } else if (!strcmp(argv[i].key, "uniform")) {
+      UNIFORM = 1;
+      FXLOG(1, "fxopt: one format for all elements of an array\n");
+    } else if (!strcmp(argv[i].key, "profile-generate")) {
+      PROFILE_GENERATE = 1;
+      FXLOG(1, "fxopt: inserting calls to record variable ranges\n");
+    } else if (!strcmp(argv[i].key, "profile-use")) {
+      if (argv[i].value) {
+        PROFILE_USE = load_profile(argv[i].value);
+        if (PROFILE_USE)
+          FXLOG(1, "fxopt: variable ranges from profile %s\n",
+                argv[i].value);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-profile-use requires a file name",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "profile-margin")) {
+      int margin = argv[i].value ? strtol(argv[i].value, NULL, 0) : -1;
+      if (margin >= 0) {
+        PROFILE_MARGIN = margin;
+        FXLOG(1, "fxopt: profiled ranges enlarged by %d%%\n", PROFILE_MARGIN);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-profile-margin requires a percentage",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "ipa")) {
+      if (argv[i].value) {
+        IPA_SUMMARY_FILE = argv[i].value;
+        load_ipa_summaries(IPA_SUMMARY_FILE);
+        FXLOG(1, "fxopt: formats passed across calls through %s\n",
+              IPA_SUMMARY_FILE);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-ipa requires a file name",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "ipa-clone")) {
+      int bits = argv[i].value ? strtol(argv[i].value, NULL, 0) : -1;
+      if (bits >= 0) {
+        IPA_CLONE_BITS = bits;
+        FXLOG(1, "fxopt: functions cloned for call sites %d bits apart\n",
+              IPA_CLONE_BITS);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-ipa-clone requires a number of bits",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "widen-delay")) {
+      int delay = argv[i].value ? strtol(argv[i].value, NULL, 0) : -1;
+      if (delay >= 0) {
+        WIDEN_DELAY = delay;
+        FXLOG(1, "fxopt: loop ranges widened after growing %d times\n",
+              WIDEN_DELAY);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-widen-delay requires a count",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "narrowing")) {
+      int passes = argv[i].value ? strtol(argv[i].value, NULL, 0) : -1;
+      if (passes >= 0) {
+        NARROWING = passes;
+        FXLOG(1, "fxopt: %d passes narrow widened loop ranges\n", NARROWING);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-narrowing requires a count",
+             plugin_name);
     } else if (!strcmp(argv[i].key, "interval")) {
       INTERVAL = 1;
-      fprintf(stderr, "fxopt: using interval arithmetic\n");
+      FXLOG(1, "fxopt: using interval arithmetic\n");
     } else if (!strcmp(argv[i].key, "affine")) {
       AFFINE = 1;
       INTERVAL = 1;
-      fprintf(stderr, "fxopt: using affine arithmetic\n");
+      FXLOG(1, "fxopt: using affine arithmetic\n");
+    } else if (!strcmp(argv[i].key, "cache")) {
+      if (argv[i].value) {
+        FORMAT_CACHE_DIR = argv[i].value;
+        FXLOG(1, "fxopt: caching formats in %s\n", FORMAT_CACHE_DIR);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-cache requires a directory name",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "sqnr")) {
+      double target = argv[i].value ? strtod(argv[i].value, NULL) : 0.0;
+      if (target > 0.0) {
+        SQNR_TARGET = target;
+        FXLOG(1, "fxopt: word sizes chosen for %g dB SQNR\n", SQNR_TARGET);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-sqnr requires a positive number of dB",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "word")) {
+      int bits = argv[i].value ? strtol(argv[i].value, NULL, 0) : 0;
+      if ((bits == 8) || (bits == 16) || (bits == 32) || (bits == 64)) {
+        WORD_SIZE = bits;
+        FXLOG(1, "fxopt: floats replaced by %d-bit integers\n", WORD_SIZE);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-word requires 8, 16, 32 or 64",
+             plugin_name);
+    } else if (!strcmp(argv[i].key, "stats")) {
+      STATS = 1;
+      FXLOG(1, "fxopt: statistics enabled\n");
+    } else if (!strcmp(argv[i].key, "affine-max-terms")) {
+      if (argv[i].value && (strtol(argv[i].value, NULL, 0) >= 2)) {
+        AFFINE_MAX_TERMS = strtol(argv[i].value, NULL, 0);
+        FXLOG(1, "fxopt: affine definitions limited to %d terms\n",
+              AFFINE_MAX_TERMS);
+      } else
+        warning
+            (0, "option -fplugin-arg-%s-affine-max-terms requires integer >= 2",
+             plugin_name);
     } else
       warning(0, G_("plugin %qs: unrecognized argument %qs ignored"),
               plugin_name, argv[i].key);
   }
 
+  //
+  // The statistics are part of gcc's own time report
+  //
+  if (time_report)
+    STATS = 1;
+
   if (!ref_pass_name) {
     error("plugin %qs requires a reference pass name", plugin_name);
     return 1;
@@ -1289,5 +2015,15 @@ int plugin_init(struct plugin_name_args *plugin_info,
 
   register_callback(plugin_name, PLUGIN_ATTRIBUTES, register_attributes,
                     NULL);
+
+  //
+  // Functions are cloned for their call sites before any of them is
+  //   converted
+  //
+  if (IPA_SUMMARY_FILE && IPA_CLONE_BITS)
+    register_callback(plugin_name, PLUGIN_ALL_IPA_PASSES_START,
+                      clone_by_format_class, NULL);
+
+  register_callback(plugin_name, PLUGIN_FINISH, finish_fxopt_plugin, NULL);
   return 0;
 }
@@ -11,13 +11,10 @@
 #  include "tree-pass.h"
 #  include "tree-flow.h"
 #  include "intl.h"
+#  include "flags.h"
 #  include "math.h"
-#  include "uthash.h"
 #  include "stdint.h"
 
-extern int lastpass;
-extern int fxpass;
-
 extern int INTERVAL;
 extern int AFFINE;
 extern int GUARDING;
@@ -25,9 +22,47 @@ extern int ROUNDING;
 extern int POSITIVE;
 extern int DBL_PRECISION_MULTS;
 extern int CONST_DIV_TO_MULT;
+extern int ACCUMULATE;
+extern int CSD_MULT_COST;
+extern int SHARE_SHIFTS;
+extern int RECIPROCAL_DIV;
+extern int BRANCH_RANGES;
+extern int AFFINE_MAX_TERMS;
+extern char *FORMAT_CACHE_DIR;
+extern int STATS;
+extern double SQNR_TARGET;
+extern int PROFILE_GENERATE;
+extern int PROFILE_USE;
+extern int PROFILE_MARGIN;
+extern int UNIFORM;
+extern int WIDEN_DELAY;
+extern int NARROWING;
+extern char *IPA_SUMMARY_FILE;
+extern int IPA_CLONE_BITS;
+
+extern int VERBOSE;
+extern FILE *fxlog;
+extern FILE *fxformats;
 
-#  define REAL_TO_INTEGER_TYPE  long_integer_type_node
-//#define REAL_TO_INTEGER_TYPE  short_integer_type_node
+// Diagnostic output is only produced if the verbosity level is high enough.
+// The level is checked before any arguments are evaluated, so disabled
+// logging costs a single comparison.
+#  define LOG_ENABLED(level) (VERBOSE >= (level))
+#  define FXLOG(level, ...) \
+  do { if (LOG_ENABLED(level)) fprintf(fxlog, __VA_ARGS__); } while (0)
+#  define FXLOG_STMT(level, stmt) \
+  do { if (LOG_ENABLED(level)) print_gimple_stmt(fxlog, (stmt), 2, 0); } \
+  while (0)
+// The "///" format annotations go to their own file, if one was given, or
+// else to the log
+#  define FXFORMAT(...) \
+  do { if (fxformats) fprintf(fxformats, __VA_ARGS__); \
+       else FXLOG(1, __VA_ARGS__); } while (0)
+
+// Floating-point variables are replaced by integers of WORD_SIZE bits, or of
+// the size given by an fxword attribute on the variable or its function. A
+// WORD_SIZE of zero means the size of a long.
+extern int WORD_SIZE;
 
 // for double_int_lshift and double_int_rshift
 #  define ARITH   true
@@ -39,19 +74,26 @@ extern int CONST_DIV_TO_MULT;
 #  define ADD     true
 #  define SUB     false
 
-// These should be powers of 2, their product <= 2^16
-#  define MAX_PASSES  256     // passes through a BB require to resolve all
-#  define MAX_ELEMENTS  256   // elements in an array
+// The hash key for a ::SIF format packs the UID (upper 32 bits), the pass
+// number and the array index into 64 bits, so that the keys sort by UID,
+// then pass, then index
+typedef int64_t fxkey_t;
+
+#  define PASS_BITS     12
+#  define ELEMENT_BITS  20
+#  define MAX_PASSES    (1 << PASS_BITS)    // passes to resolve all formats
+#  define MAX_ELEMENTS  (1 << ELEMENT_BITS) // elements in an array
 
 #  define NOT_AN_ARRAY (MAX_ELEMENTS - 1) // marks a non-array variable
 
-#  define UID_TO_KEY(x) ((x) * MAX_ELEMENTS * MAX_PASSES)
-#  define UID_PASS_TO_KEY(x,y) ((x) * MAX_ELEMENTS * MAX_PASSES + (y))
-#  define UID_IDX_TO_KEY(x,y) ((((x) * MAX_ELEMENTS) + (y)) * MAX_PASSES)
-#  define UID_PASS_IDX_TO_KEY(x,y,z) (((((x) * MAX_PASSES) + (z)) * MAX_ELEMENTS) + (y))
-#  define KEY_TO_UID(x)  ((x) / ( MAX_ELEMENTS * MAX_PASSES ))
-#  define KEY_TO_PASS(x)  ((x) % MAX_PASSES )
-#  define KEY_TO_IDX(x)  (((x) / MAX_PASSES ) % MAX_ELEMENTS )
+#  define UID_TO_KEY(x) (((fxkey_t) (x)) << (PASS_BITS + ELEMENT_BITS))
+#  define UID_PASS_TO_KEY(x,y) \
+  (UID_TO_KEY(x) | (((fxkey_t) (y)) << ELEMENT_BITS))
+#  define UID_IDX_TO_KEY(x,y) (UID_TO_KEY(x) | (fxkey_t) (y))
+#  define UID_PASS_IDX_TO_KEY(x,y,z) (UID_PASS_TO_KEY((x),(y)) | (fxkey_t) (z))
+#  define KEY_TO_UID(x)  ((int) ((x) >> (PASS_BITS + ELEMENT_BITS)))
+#  define KEY_TO_PASS(x) ((int) (((x) >> ELEMENT_BITS) & (MAX_PASSES - 1)))
+#  define KEY_TO_IDX(x)  ((int) ((x) & (MAX_ELEMENTS - 1)))
 
 #  define PRECISION(x) ((x).I+(x).F+(x).E+(x).sgnd)
 #  define INFO_BITS(x) (oprnd_frmt[(x)].I+oprnd_frmt[(x)].F)
@@ -81,7 +123,7 @@ extern int CONST_DIV_TO_MULT;
 
  */ 
 struct AA {
-  int id;              ///< Hash key of variable
+  fxkey_t id;          ///< Hash key of variable
   double_int coeff;    ///< Coefficient for this variable
   uint32_t bp;         ///< Coefficient binary point location, 0 = true integer
   struct AA *next;     ///< Pointer to next variable structure
@@ -95,12 +137,13 @@ struct AA {
   The <tt>id</tt> value is generated from the GIMPLE variable UID for the
   underlying variable (ignoring the version number for an SSA name, if
   applicable), concatenated with the array index (for array elements), and
-  the pass number. There are a few special values for the <tt>id</tt>:
+  the pass number, see ::fxkey_t. There are a few special values for the
+  <tt>id</tt>:
     - A UID value of zero indicates that the variable is an error term that
       was created as part of an affine estimate of the result of a non-affine
       arithmetic operation. The remaining bits in the id are just a unique
       integer value.
-    - An array index value of all one bits (e.g. <tt>0xFF</tt>) signifies
+    - An array index value of all one bits (<tt>0xFFFFF</tt>) signifies
       that the variable is not a member of an array.
     - A pass number of zero indicates a variable definition created before
       processing any GIMPLE statements.
@@ -113,8 +156,8 @@ struct AA {
   If <tt>min</tt> is greater than <tt>max</tt> then the range is undefined.
  */ 
 struct SIF {
-  int id;             //!< Hash key
-  int alias;          /*!< If this variable is an alias of another
+  fxkey_t id;         //!< Hash key
+  fxkey_t alias;      /*!< If this variable is an alias of another
                           variable, such as a pointer that takes its value from
                           another pointer then the id of the other variable is
                           stored here. If this variable is not an alias, this
@@ -142,9 +185,69 @@ struct SIF {
   int attrE;          ///< E value assigned by an fxfrmt attribute, if any.
   double_int attrmax; ///< Range max value assigned by fxfrmt attribute, if any.
   double_int attrmin; ///< Range min value assigned by fxfrmt attribute, if any.
-  UT_hash_handle hh;  ///< Required by uthash functions
+  int elements;       /*!< Number of consecutive array elements, starting at
+                           the one in the id, that share this format. */
+  double noise;       /*!< Power of the quantization noise in the value, in
+                           real units. */
 };
 
+/**
+  @brief The analysis state of one function.
+  @details Everything that the range analysis and the format search learn
+  about a function is kept here, rather than in globals, so that it can be
+  set up fresh for each function and discarded when the function has been
+  converted. The option flags are not part of the context because they are
+  fixed for the whole translation unit when the plugin is initialized.
+ */
+struct FXOPT_CONTEXT {
+  int fxpass;                 /*!< Counts number of passes through the
+                                   function in attempt to resolve all
+                                   formats. */
+  int lastpass;               /*!< Set to true when all formats are resolved
+                                   and code can be generated. */
+  int next_error_id;          /*!< ID number for the next unique affine error
+                                   term. It must be incremented after it is
+                                   used. */
+  struct FMT_STORE *formats;  ///< The function's ::SIF formats
+  struct AA_ARENAS *arenas;   ///< The function's ::AA terms
+  struct REVISITS *revisits;  ///< Statements to analyze again, if any
+};
+
+extern struct FXOPT_CONTEXT *fxctx;
+
+/**
+  @brief The phases of the conversion that are timed separately.
+ */
+enum FXOPT_PHASE {
+  PHASE_DECLARED_VARS,        ///< Formats of declared variables
+  PHASE_INDUCTION_VARS,       ///< Marking induction variables
+  PHASE_FORMAT_CACHE,         ///< Hashing, loading and saving cached formats
+  PHASE_FORMAT_PASSES,        ///< Passes that search for the formats
+  PHASE_PTR_CONSISTENCY,      ///< force_ptr_consistency()
+  PHASE_REWRITE,              ///< The last pass, that converts the code
+  NUM_FXOPT_PHASES
+};
+
+/**
+  @brief Counters for the cost of the conversion.
+  @details These are only kept if statistics were requested, and are summed
+  over all of the functions in the translation unit.
+ */
+struct FXOPT_STATS {
+  long functions;             ///< Functions converted
+  long cache_hits;            ///< Functions whose formats were cached
+  long passes;                ///< Passes through the functions
+  long statements;            ///< Assignment statements analyzed
+  long lookups;               ///< Searches of the format store
+  long aa_terms;              ///< Affine terms allocated
+  int peak_aa_terms;          ///< Longest affine definition of a result
+  long phase_time[NUM_FXOPT_PHASES];  ///< Run time in microseconds
+};
+
+extern struct FXOPT_STATS fxstats;
+
+#  define COUNT_STAT(counter) do { if (STATS) fxstats.counter++; } while (0)
+
 /* from gimple-pretty-print.c */
 void print_gimple_stmt (FILE *, gimple, int, int);
 
@@ -154,8 +257,10 @@ extern void error (const char *, ...);
 extern bool warning (int, const char *, ...);
 
 /* from fxopt_affine.c */
-void append_aa_var(struct AA **aa_list_p, int var_key, double_int coeff, int bp);
-struct AA *search_aa_var(struct AA *aa_list_p, int var_key);
+void append_aa_var(struct AA **aa_list_p, fxkey_t var_key, double_int coeff,
+                   int bp);
+bool rename_aa_var(struct AA **aa_list_p, fxkey_t old_key, fxkey_t new_key);
+struct AA *search_aa_var(struct AA *aa_list_p, fxkey_t var_key);
 void print_aa_element(struct AA *aa_elt_p);
 void print_aa_list(struct AA *aa_list_p);
 void delete_aa_list(struct AA **aa_list_pp);
@@ -166,12 +271,18 @@ double_int aa_max(struct AA *aa_list_p);
 double_int aa_min(struct AA *aa_list_p);
 struct AA *shift_aa_list(struct SIF op_fmt, int k);
 struct AA *new_aa_list(struct SIF op_fmt);
+double_int aligned_aa_coeff(struct AA *aa_elt_p, int org_bp);
 struct AA *copy_aa_list(struct AA *aa_src_list_p);
 struct AA *affine_assign(struct AA *aa_src_list_p, bool add);
 struct AA *affine_add(struct SIF op_fmt[], bool add);
 struct AA *affine_multiply(struct AA *op1, struct AA *op2);
+void condense_aa_list(struct AA **aa_list_p);
 struct AA *affine_square(struct AA *op1);
 struct AA *affine_divide(struct AA *numerator, struct AA *denominator);
+void begin_aa_scratch();
+void end_aa_scratch();
+void delete_all_aa();
+struct AA_ARENAS *new_aa_arenas();
 
 /* from fxopt_range.c */
 bool double_int_positive_p(double_int dblint);
@@ -197,15 +308,113 @@ struct SIF new_range_mul(struct SIF oprnd_frmt[], struct SIF result_frmt);
 struct SIF new_range_div(struct SIF oprnd_frmt[], struct SIF result_frmt);
 struct SIF int_const_to_range(tree int_const, struct SIF result_frmt);
 
+/* from fxopt_cache.c */
+uint64_t function_cache_key();
+void save_cached_formats(uint64_t key);
+bool load_cached_formats(uint64_t key);
+
+/* from fxopt_csd.c */
+void rewrite_constant_mults();
+
+/* from fxopt_shifts.c */
+void share_shifts();
+
+/* from fxopt_recip.c */
+tree clz_function(int n, tree * arg_type_p);
+tree insert_clz(gimple_stmt_iterator * gsi_p, tree fn, tree arg_type,
+                tree uop);
+bool reciprocal_divide(gimple_stmt_iterator * gsi_p, int result_bits);
+
+/* from fxopt_math.c */
+bool is_math_call(gimple stmt);
+struct SIF math_call(gimple_stmt_iterator * gsi_p);
+
+/* from fxopt_cond.c */
+bool is_real_condition(gimple stmt);
+bool condition(gimple_stmt_iterator * gsi_p);
+void refine_branch_ranges();
+
+/* from fxopt_profile.c */
+bool load_profile(const char *file_name);
+bool profiled_range(tree var, double *lo_p, double *hi_p);
+bool profiled_format(tree var, int size, int *s_bits, int *i_bits,
+                     int *f_bits, double_int * max_p, double_int * min_p);
+void instrument_function();
+
+/* from fxopt_block.c */
+bool is_block_array(tree var);
+void find_block_arrays();
+void block_scaling(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[]);
+void insert_block_normalization();
+
+/* from fxopt_loops.c */
+bool is_loop_var(tree operand);
+void find_loop_carried(bitmap carried);
+void find_loop_vars();
+bool keep_loop_var(tree var, struct SIF result_frmt);
+int join_loop_var(tree var, struct SIF *fmt_p, struct SIF *var_fmt);
+struct SIF loop_var_store(gimple_stmt_iterator * gsi_p, struct SIF var_frmt,
+                          tree lhs, struct SIF result_frmt);
+bool narrow_loop_vars();
+
+/* from fxopt_aggregate.c */
+void find_aggregates();
+bool is_aggregate(tree var);
+int aggregate_leaves(tree var);
+bool is_aggregate_ref(tree operand);
+bool is_shared_ref(tree operand);
+tree aggregate_leaf(tree operand, int *index_p);
+void aggregate_constructor(tree var, tree initial, bool replace);
+void convert_aggregate_to_integer(tree var);
+
+/* from fxopt_ipa.c */
+void load_ipa_summaries(const char *file_name);
+void save_ipa_summaries(const char *file_name);
+bool ipa_param_range(tree var, double *min_p, double *max_p);
+bool ipa_param_format(tree var, int size, int *s_bits, int *i_bits,
+                      int *f_bits, double_int * max_p, double_int * min_p);
+void record_return_format(struct SIF *var_fmt);
+void begin_function_summary();
+void end_function_summary();
+bool is_ipa_call(gimple stmt);
+bool ipa_call(gimple_stmt_iterator * gsi_p, struct SIF *result_p);
+HOST_WIDE_INT ipa_call_signature(gimple stmt);
+void clone_by_format_class(void *event_data, void *data);
+
+/* from fxopt_noise.c */
+double quantization_noise(int f_bits);
+double signal_power(struct SIF *s);
+double format_sqnr(struct SIF *s);
+void propagate_noise(enum tree_code code, struct SIF oprnd_frmt[],
+                     int num_operands, struct SIF *result_frmt);
+bool single_mult_meets_budget(struct SIF oprnd_frmt[], int dropped_bits);
+bool choose_word_sizes();
+void restore_word_sizes();
+
+/* from fxopt_stats.c */
+void fxtimer_push(enum FXOPT_PHASE phase);
+void fxtimer_pop(enum FXOPT_PHASE phase);
+void count_aa_list(struct AA *aa_list_p);
+void print_fxopt_stats(FILE * file);
+
 /* from fxopt_utils.c */
-int calc_hash_key(tree var_tree, int version, int index);
-void add_var_format(int var_id);
-struct SIF *get_format_ptr(int var_id);
-struct SIF *find_var_format(int var_id);
+fxkey_t calc_hash_key(tree var_tree, int version, int index);
+void add_var_format(fxkey_t var_id);
+struct SIF *add_run_format(fxkey_t var_id, int elements);
+const struct SIF *get_format_ptr(fxkey_t var_id);
+struct SIF *edit_var_format(fxkey_t var_id);
+struct SIF element_format(const struct SIF *run_fmt, int index);
+struct SIF *find_var_format(fxkey_t var_id);
+struct SIF *seek_var_format(fxkey_t var_id);
+struct SIF *first_var_format();
+struct SIF *next_var_format(struct SIF *s);
+void compact_var_formats();
 void copy_format(struct SIF *src, struct SIF *dest);
 void copy_SIF(struct SIF *src, struct SIF *dest);
 void delete_var_format(struct SIF *var_format);
 void delete_all_formats();
+void begin_fxopt_context(struct FXOPT_CONTEXT *ctx);
+void end_fxopt_context();
 void force_ptr_consistency();
 void initialize_format(struct SIF *op_fmt);
 float real_max(struct SIF *op_fmt);
@@ -215,16 +424,41 @@ void print_one_format(struct SIF *op_fmt);
 void print_format(struct SIF op_fmt);
 void restore_attributes();
 void real_expr_to_integer(gimple stmt);
+bool is_fx_temp(tree var);
+struct pointer_set_t *single_value_temps();
+tree fxopt_integer_type(int bits);
+int var_word_size(tree var);
+void set_word_size(tree var, int bits);
+int operand_word_size(tree operand);
 void convert_real_var_to_integer(tree var);
 void convert_real_func_to_integer(tree decl);
 void invert_constant_operand(gimple stmt, int opnumber);
-tree convert_real_constant(tree real_cst, struct SIF *op_fmt);
+tree convert_real_constant(tree real_cst, int size, struct SIF *op_fmt);
+void uniform_constructor(tree initial, int size, bool replace,
+                         struct SIF *op_fmt_p);
 void int_constant_format(tree integer_cst, struct SIF *op_fmt);
+void range_to_aa(struct SIF *fmt_p, fxkey_t id);
+double_int align_bound(double_int x, int from_bp, int to_bp, bool up);
+int align_store_to_format(struct SIF *value_p, struct SIF var_frmt);
 int set_var_format(tree operand, struct SIF op_fmt);
+int format_changed(struct SIF old_frmt, struct SIF new_frmt);
+int has_variable_index(gimple stmt);
+void begin_revisits();
+void end_revisits();
+void begin_revisit_pass();
+basic_block next_revisit_block();
+void keep_revisit_block();
+void revisit_stmt(gimple stmt);
+void revisit_var_uses(tree operand);
+void revisit_var_defs(tree var);
 void shift_right(struct SIF oprnd_frmt[], tree oprnd_tree[], int opnumber,
                  int count);
 void shift_left(struct SIF oprnd_frmt[], tree oprnd_tree[], int opnumber,
                 int count);
+void widen_operand(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                   tree oprnd_tree[], int opnumber, int size);
+int match_operand_sizes(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                        tree oprnd_tree[]);
 int format_initialized(struct SIF oprnd_frmt);
 void check_shift(struct SIF oprnd_frmt);
 int abs_tree_log2(tree int_const);
@@ -237,6 +471,8 @@ struct SIF get_operand_format(gimple stmt, int op_number,
 struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
                         struct SIF oprnd_frmt[], tree oprnd_tree[],
                         struct SIF result_frmt, tree * result_var_p);
+tree high_part_product(gimple_stmt_iterator * gsi_p, struct SIF result_frmt,
+                       tree wide_var, tree narrow_type);
 
 
 /* from fxopt_stmts.c */
@@ -244,13 +480,19 @@ struct SIF nop(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                tree oprnd_tree[]);
 struct SIF array_ref(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                tree oprnd_tree[]);
+struct SIF uniform_store(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                         tree oprnd_tree[], struct SIF result_frmt);
 struct SIF pointer_math(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                         tree oprnd_tree[]);
 struct SIF addition(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                     tree oprnd_tree[]);
+struct SIF min_max(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                   tree oprnd_tree[]);
 struct SIF multiplication(gimple_stmt_iterator * gsi_p,
                           struct SIF oprnd_frmt[], tree oprnd_tree[]);
 struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                     tree oprnd_tree[]);
+bool is_accumulator(tree var);
+void mark_accumulators();
 
 #endif
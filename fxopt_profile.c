@@ -0,0 +1,337 @@
+/**
+ * @file fxopt_profile.c
+ *
+ * @brief  Functions for finding variable ranges from a profiling run
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-16T13:40:18-0500
+ * @date Last modified: 2014-01-16T13:40:18-0500
+ *
+ * @details  The interval and affine analyses give ranges that are always
+ *           safe but are often much larger than the values that a function
+ *           actually sees, especially for the variables of feedback loops
+ *           that would otherwise need an fxiter attribute. A range can
+ *           instead be measured, in two builds:
+ *
+ *             1. With -fplugin-arg-fxopt-profile-generate the functions are
+ *                not converted. A call to __fxopt_profile(), in fxprofile.c,
+ *                is inserted after every assignment to a real variable, and
+ *                the smallest and largest values of each variable are
+ *                written to a profile file when the program exits.
+ *             2. With -fplugin-arg-fxopt-profile-use=FILE each real variable
+ *                that was seen in the profile and has no fxfrmt attribute
+ *                is given a format for the measured range, enlarged by the
+ *                margin given by -fplugin-arg-fxopt-profile-margin. The
+ *                format is treated like an fxfrmt attribute, so any value
+ *                outside it is saturated.
+ *
+ *           Variables are identified by the name of their function and by
+ *           their format key, from calc_hash_key(), so the profile must be
+ *           made from the same source with the same compiler options. The
+ *           name of the variable is written too, and a range whose name
+ *           does not match the variable with its key is reported and not
+ *           used, since the profile is then out of date. Each line of the
+ *           profile is
+ * @code
+ *           function variable key min max count
+ * @endcode
+ *           where a variable may appear in more than one line, when the
+ *           profiling program was run more than once. Compiler temporaries
+ *           are not profiled: their keys are not the same in the profiling
+ *           build, which adds declarations of its own, and they have no
+ *           name that would show it.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "utlist.h"
+
+/**
+ * @def   PROFILE_FUNCTION
+ * @brief Name of the run-time function that records a value.
+ */
+#define PROFILE_FUNCTION "__fxopt_profile"
+
+/**
+ * @brief The measured range of one variable, or one array element.
+ */
+struct PROFILE_RANGE {
+  char *function;               ///< name of the variable's function
+  char *variable;               ///< name of the variable
+  fxkey_t key;                  ///< format key of the variable
+  double min;                   ///< smallest value seen
+  double max;                   ///< largest value seen
+  long count;                   ///< number of values seen
+  bool reported;                ///< the name was found not to match
+  struct PROFILE_RANGE *next;
+};
+
+/**
+ * @brief All of the ranges read from the profile.
+ */
+static struct PROFILE_RANGE *profile_ranges = NULL;
+
+/**
+ * @brief Predicate for a variable that is recorded in the profile.
+ *
+ * @details Only variables declared in the source are recorded, since their
+ * keys are the same whether or not the function is being profiled.
+ */
+static bool profiled_var_p(tree var)
+{
+  return (DECL_NAME(var) != NULL_TREE) && !DECL_ARTIFICIAL(var);
+}
+
+/**
+ * @brief Name of a variable in the profile.
+ */
+static const char *profile_var_name(tree var)
+{
+  return IDENTIFIER_POINTER(DECL_NAME(var));
+}
+
+/**
+ * @brief Read a profile file.
+ *
+ * @details Lines for the same variable are merged. A line that cannot be
+ * read is reported and skipped.
+ *
+ * @param[in] file_name name of the profile file
+ * @return    true if the file was read
+ */
+bool load_profile(const char *file_name)
+{
+  FILE *profile_file = fopen(file_name, "r");
+  char line[512], function[256], variable[256];
+  long long key;
+  double min, max;
+  long count;
+  int line_number = 0, ranges = 0;
+  struct PROFILE_RANGE *r;
+
+  if (NULL == profile_file) {
+    warning(0, G_("fxopt: cannot read profile %qs"), file_name);
+    return false;
+  }
+  while (fgets(line, sizeof(line), profile_file) != NULL) {
+    line_number++;
+    if (sscanf(line, "%255s %255s %lld %lg %lg %ld", function, variable,
+               &key, &min, &max, &count) != 6 || (min > max)) {
+      warning(0, G_("fxopt: ignoring line %d of profile %qs"), line_number,
+              file_name);
+      continue;
+    }
+    LL_FOREACH(profile_ranges, r) {
+      if ((r->key == (fxkey_t) key) && !strcmp(r->function, function) &&
+          !strcmp(r->variable, variable))
+        break;
+    }
+    if (r == NULL) {
+      r = (struct PROFILE_RANGE *) xmalloc(sizeof(struct PROFILE_RANGE));
+      r->function = xstrdup(function);
+      r->variable = xstrdup(variable);
+      r->key = (fxkey_t) key;
+      r->min = min;
+      r->max = max;
+      r->count = 0;
+      r->reported = false;
+      LL_PREPEND(profile_ranges, r);
+      ranges++;
+    }
+    r->min = MIN(r->min, min);
+    r->max = MAX(r->max, max);
+    r->count += count;
+  }
+  fclose(profile_file);
+  FXLOG(1, "fxopt: %d ranges read from profile %s\n", ranges, file_name);
+  return true;
+}
+
+/**
+ * @brief Find the measured range of a variable in the current function.
+ *
+ * @details For an array, the range covers every element that was seen. A
+ * range recorded for the key of the variable under another name is reported
+ * and skipped. A compiler temporary has no profiled range.
+ *
+ * @param[in]  var  gcc tree for the variable declaration
+ * @param[out] lo_p set to the smallest value seen
+ * @param[out] hi_p set to the largest value seen
+ * @return     true if the variable was seen in the profile
+ */
+bool profiled_range(tree var, double *lo_p, double *hi_p)
+{
+  const char *function = IDENTIFIER_POINTER(DECL_NAME(current_function_decl));
+  const char *name;
+  struct PROFILE_RANGE *r;
+  bool found = false;
+
+  if (!profiled_var_p(var))
+    return false;
+  name = profile_var_name(var);
+  LL_FOREACH(profile_ranges, r) {
+    if ((KEY_TO_UID(r->key) != (int) DECL_UID(var)) ||
+        strcmp(r->function, function))
+      continue;
+    if (strcmp(r->variable, name)) {
+      if (!r->reported)
+        warning(0, G_("fxopt: profile range of %qs in %qs was recorded for "
+                      "%qs, ignoring it"), name, function, r->variable);
+      r->reported = true;
+      continue;
+    }
+    if (!found) {
+      *lo_p = r->min;
+      *hi_p = r->max;
+      found = true;
+    } else {
+      *lo_p = MIN(*lo_p, r->min);
+      *hi_p = MAX(*hi_p, r->max);
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief Find a variable's format from its measured range.
+ *
+ * @details The range is enlarged on both sides by the margin, as a fraction
+ * of its largest magnitude. The format has one sign bit, as many integer bits
+ * as the enlarged range needs, and the rest of the bits for the fraction.
+ *
+ * @param[in]  var    gcc tree for the variable declaration
+ * @param[in]  size   number of bits in the variable
+ * @param[out] s_bits set to the number of sign bits
+ * @param[out] i_bits set to the number of integer bits
+ * @param[out] f_bits set to the number of fraction bits
+ * @param[out] max_p  set to the largest value, with f_bits fraction bits
+ * @param[out] min_p  set to the smallest value, with f_bits fraction bits
+ * @return     true if the variable was seen in the profile
+ */
+bool profiled_format(tree var, int size, int *s_bits, int *i_bits,
+                     int *f_bits, double_int * max_p, double_int * min_p)
+{
+  double lo, hi, margin;
+
+  if (!profiled_range(var, &lo, &hi))
+    return false;
+  margin = MAX(fabs(lo), fabs(hi)) * PROFILE_MARGIN / 100.0;
+  lo -= margin;
+  hi += margin;
+  *s_bits = 1;
+  *i_bits = 0;
+  if (MAX(fabs(lo), fabs(hi)) >= 1.0)
+    *i_bits = (int) floor(log2(MAX(fabs(lo), fabs(hi)))) + 1;
+  *f_bits = size - *s_bits - *i_bits;
+  if (*f_bits < 0) {
+    warning(0, G_("fxopt: profiled range of %qs does not fit in %d bits"),
+            IDENTIFIER_POINTER(DECL_NAME(var)), size);
+    return false;
+  }
+  *max_p = shwi_to_double_int((HOST_WIDE_INT) floor(ldexp(hi, *f_bits)));
+  *min_p = shwi_to_double_int((HOST_WIDE_INT) ceil(ldexp(lo, *f_bits)));
+  FXLOG(2, "  %s profiled from %g to %g\n",
+        DECL_NAME(var) ? IDENTIFIER_POINTER(DECL_NAME(var)) : "(temp)",
+        lo, hi);
+  return true;
+}
+
+/**
+ * @brief Insert a call that records the value of a variable.
+ *
+ * @param[in] gsi_p    iterator, the call is inserted after its statement
+ * @param[in] fn       declaration of the run-time function
+ * @param[in] function string constant with the function's name
+ * @param[in] var      the variable
+ * @param[in] key      format key of the variable
+ * @param[in] value    the real value
+ */
+static void insert_profile_call(gimple_stmt_iterator * gsi_p, tree fn,
+                                tree function, tree var, fxkey_t key,
+                                tree value)
+{
+  const char *name = profile_var_name(var);
+  tree dvalue = make_rename_temp(double_type_node, "_fx_prof0");
+  gimple new_stmt = gimple_build_assign_with_ops(NOP_EXPR, dvalue, value,
+                                                 NULL);
+
+  gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+  new_stmt = gimple_build_call(fn, 4, function,
+                               build_string_literal(strlen(name) + 1, name),
+                               build_int_cst(long_long_integer_type_node,
+                                             key), dvalue);
+  gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+  FXLOG_STMT(2, new_stmt);
+}
+
+/**
+ * @brief Insert calls that record the value of every real variable when it
+ * is assigned.
+ *
+ * @details Called instead of the conversion when a profile is being made.
+ * Scalar variables and array elements with a constant index are recorded,
+ * except for compiler temporaries.
+ */
+void instrument_function()
+{
+  const char *name = IDENTIFIER_POINTER(DECL_NAME(current_function_decl));
+  tree fn_type, fn, function;
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  int calls = 0;
+
+  FXLOG(1, "  ===== Inserting profile calls =====\n");
+  fn_type = build_function_type_list(void_type_node, const_ptr_type_node,
+                                     const_ptr_type_node,
+                                     long_long_integer_type_node,
+                                     double_type_node, NULL_TREE);
+  fn = build_fn_decl(PROFILE_FUNCTION, fn_type);
+  // the call touches no memory that the function can see
+  DECL_IS_NOVOPS(fn) = 1;
+  TREE_NOTHROW(fn) = 1;
+  function = build_string_literal(strlen(name) + 1, name);
+
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      if (!is_gimple_assign(stmt) || stmt_ends_bb_p(stmt))
+        continue;
+      tree lhs = gimple_assign_lhs(stmt);
+      if (!SCALAR_FLOAT_TYPE_P(TREE_TYPE(lhs)))
+        continue;
+      if ((TREE_CODE(lhs) == SSA_NAME) && profiled_var_p(SSA_NAME_VAR(lhs))) {
+        insert_profile_call(&gsi, fn, function, SSA_NAME_VAR(lhs),
+                            calc_hash_key(SSA_NAME_VAR(lhs), 0, NOT_AN_ARRAY),
+                            lhs);
+        calls++;
+      } else if ((TREE_CODE(lhs) == ARRAY_REF) &&
+                 (TREE_CODE(TREE_OPERAND(lhs, 0)) == VAR_DECL) &&
+                 profiled_var_p(TREE_OPERAND(lhs, 0)) &&
+                 host_integerp(TREE_OPERAND(lhs, 1), 0) &&
+                 (tree_low_cst(TREE_OPERAND(lhs, 1), 0) < NOT_AN_ARRAY) &&
+                 gimple_assign_single_p(stmt) &&
+                 is_gimple_val(gimple_assign_rhs1(stmt))) {
+        insert_profile_call(&gsi, fn, function, TREE_OPERAND(lhs, 0),
+                            calc_hash_key(TREE_OPERAND(lhs, 0), 0,
+                                          tree_low_cst(TREE_OPERAND(lhs, 1),
+                                                       0)),
+                            gimple_assign_rhs1(stmt));
+        calls++;
+      }
+    }
+  }
+  FXLOG(1, "  %d profile calls inserted\n", calls);
+}
+
+// vim:syntax=c.doxygen
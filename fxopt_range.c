@@ -50,7 +50,7 @@
 
 /**
  * @brief Print a gcc double_int
- * @details Print a gcc double_int to stderr, in hexadecimal, using the
+ * @details Print a gcc double_int to the log, in hexadecimal, using the
  *   appropriate number of characters for the precision of the double_int
  *
  * @param[in] val       double_int to be printed
@@ -59,13 +59,13 @@
 void print_double(double_int val, int precision)
 {
   if (precision > HOST_BITS_PER_WIDE_INT)
-    fprintf(stderr, PRINT_DOUBLE_HEX, UHWI val.high, UHWI val.low);
+    fprintf(fxlog, PRINT_DOUBLE_HEX, UHWI val.high, UHWI val.low);
   else if (precision > 32)
-    fprintf(stderr, PRINT_DOUBLE_HEX_LOW, UHWI val.low);
+    fprintf(fxlog, PRINT_DOUBLE_HEX_LOW, UHWI val.low);
   else if (precision > 16)
-    fprintf(stderr, PRINT_DOUBLE_HEX_32, UH32 val.low);
+    fprintf(fxlog, PRINT_DOUBLE_HEX_32, UH32 val.low);
   else
-    fprintf(stderr, PRINT_DOUBLE_HEX_16, (unsigned int) (val.low & 0xFFFF));
+    fprintf(fxlog, PRINT_DOUBLE_HEX_16, (unsigned int) (val.low & 0xFFFF));
 }
 
 
@@ -193,11 +193,13 @@ double_int new_max(struct SIF op_fmt)
       double_int aa_max = new_aa_max(op_fmt);
       if ((double_int_scmp(maxval, aa_max))
           && (double_int_scmp(double_int_neg(maxval), aa_max))) {
-        fprintf(stderr, "  !!!!!!! aa max [");
-        print_double(aa_max, op_fmt.size);
-        fprintf(stderr, "] interval max [");
-        print_double(maxval, op_fmt.size);
-        fprintf(stderr, "]\n");
+        if (LOG_ENABLED(2)) {
+          fprintf(fxlog, "  !!!!!!! aa max [");
+          print_double(aa_max, op_fmt.size);
+          fprintf(fxlog, "] interval max [");
+          print_double(maxval, op_fmt.size);
+          fprintf(fxlog, "]\n");
+        }
         maxval = aa_max;
       }
     }
@@ -319,7 +321,7 @@ void check_range(struct SIF op_fmt)
       warning(0, G_("Minimum value too big for operand size"));
 
     if (pessimistic_format(op_fmt))
-      fprintf(stderr, "  *** Result format is pessimistic ***\n");
+      FXLOG(2, "  *** Result format is pessimistic ***\n");
 
   }
 }
@@ -328,7 +330,7 @@ void check_range(struct SIF op_fmt)
  * @brief Print a range's min and max as floating-point and hexadecimal values.
  * 
  * @details Apply any pending shift operations and then convert the double_ints
- * to floating-point values. The values are printed to stderr and followed by
+ * to floating-point values. The values are printed to the log and followed by
  * a linefeed.
  * 
  * @param[in] op_fmt SIF struct containing range to print
@@ -341,17 +343,17 @@ void print_min_max(struct SIF op_fmt)
     double_int minval = new_min(op_fmt);
     HOST_WIDE_INT scale = 1ULL << (op_fmt.F + op_fmt.E);
     if (double_int_fits_in_shwi_p(minval) && double_int_fits_in_shwi_p(maxval)) {
-      fprintf(stderr, "  [%+5.3f,%+5.3f]",
+      fprintf(fxlog, "  [%+5.3f,%+5.3f]",
               ((float) double_int_to_shwi(minval) / scale),
               ((float) double_int_to_shwi(maxval) / scale));
     }
-    fprintf(stderr, " [");
+    fprintf(fxlog, " [");
     print_double(minval, op_fmt.size);
-    fprintf(stderr, ",");
+    fprintf(fxlog, ",");
     print_double(maxval, op_fmt.size);
-    fprintf(stderr, "]");
+    fprintf(fxlog, "]");
   }
-  fprintf(stderr, "\n");
+  fprintf(fxlog, "\n");
 }
 
 /**
@@ -710,7 +712,7 @@ struct SIF new_range_mul(struct SIF oprnd_frmt[], struct SIF result_frmt)
  *
  * @details Any pending shifts are applied to the operands, and they
  * are sign-extended. If the range of the divisor includes zero then a
- * divide-by-zero error is possible: warning message is send to stderr and the
+ * divide-by-zero error is possible: warning message is sent to the log and the
  * min/max values of the result are set to the limits of the result's format. If
  * divide-by-zero is not possible, use a brute force approach and calculate the
  * four possible results of dividing the min and max dividend by the min and max
@@ -750,7 +752,7 @@ struct SIF new_range_div(struct SIF oprnd_frmt[], struct SIF result_frmt)
 
     if (double_int_zero_p(min2) || double_int_zero_p(max2) ||
         (double_int_positive_p(max2) && double_int_negative_p(min2))) {
-      fprintf(stderr, "  *** Divide by zero possible! *** \n");
+      FXLOG(1, "  *** Divide by zero possible! *** \n");
       new_frmt.max = double_int_mask(new_frmt.size - 1);
       new_frmt.min = double_int_not(new_frmt.max);
     } else {
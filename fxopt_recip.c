@@ -0,0 +1,313 @@
+/**
+ * @file fxopt_recip.c
+ *
+ * @brief  Functions for replacing division by a variable with a reciprocal
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-13T09:48:25-0500
+ * @date Last modified: 2014-01-13T09:48:25-0500
+ *
+ * @details  A fixed-point division by a variable is an integer division,
+ *           which is slow or is done by a library call on many targets. It
+ *           can instead be done by finding the reciprocal of the divisor and
+ *           multiplying by it.
+ *
+ *           The magnitude of the divisor is normalized, by counting its
+ *           leading zeros, to a value D in [0.5, 1). The reciprocal X = 1/D
+ *           starts from the linear estimate 48/17 - 32/17 * D, which is
+ *           correct to about 4 bits, and each Newton-Raphson iteration
+ *           X = X * (2 - D * X) doubles the number of correct bits. The
+ *           number of iterations is the smallest that gives as many bits as
+ *           the quotient has, according to its range, but at least one: the
+ *           estimate is larger than 1/D for part of [0.5, 1), while a
+ *           Newton-Raphson step never leaves X above 1/D. The quotient is the
+ *           product of the dividend and the reciprocal, shifted right by the
+ *           normalization. It may be one or two LSBs smaller in magnitude
+ *           than the quotient from an integer division, so it is corrected
+ *           by adding one, at most twice, while (q + 1) * d is no larger than
+ *           the dividend. The result is then exactly the truncated quotient.
+ *
+ *           Only divisions that were real in the source are replaced. An
+ *           integer division keeps its own C semantics.
+ *
+ *           The arithmetic is done on the magnitudes in unsigned types, with
+ *           products in a type that has twice as many bits, so no signed
+ *           overflow can occur. The sign is restored at the end.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+
+/**
+ * @def   SEED_BITS
+ * @brief Number of correct bits in the first estimate of the reciprocal.
+ */
+#define SEED_BITS 4
+
+/**
+ * @brief Insert a statement with two operands before the division.
+ *
+ * @param[in] gsi_p pointer to the division's gimple_stmt_iterator
+ * @param[in] code  the operation
+ * @param[in] type  type of the result
+ * @param[in] name  name of the result variable
+ * @param[in] op1   first operand
+ * @param[in] op2   second operand, or NULL
+ * @return    the new result variable
+ */
+static tree insert_recip_stmt(gimple_stmt_iterator * gsi_p,
+                              enum tree_code code, tree type,
+                              const char *name, tree op1, tree op2)
+{
+  tree var = make_rename_temp(type, name);
+  gimple new_stmt = gimple_build_assign_with_ops(code, var, op1, op2);
+
+  gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return var;
+}
+
+/**
+ * @brief Find the magnitude of a signed operand, as an unsigned value.
+ *
+ * @param[in]  gsi_p  pointer to the division's gimple_stmt_iterator
+ * @param[in]  op     the signed operand
+ * @param[in]  utype  unsigned type of the same size
+ * @param[out] mask_p set to a variable that is all ones if the operand is
+ *                    negative, else zero
+ * @return     the magnitude
+ */
+static tree insert_magnitude(gimple_stmt_iterator * gsi_p, tree op, tree utype,
+                             tree * mask_p)
+{
+  int n = TYPE_PRECISION(utype);
+  tree sign, uop;
+
+  sign = insert_recip_stmt(gsi_p, RSHIFT_EXPR, TREE_TYPE(op), "_fx_signbit0",
+                           op, build_int_cst(integer_type_node, n - 1));
+  *mask_p = insert_recip_stmt(gsi_p, NOP_EXPR, utype, "_fx_umask0", sign,
+                              NULL);
+  uop = insert_recip_stmt(gsi_p, NOP_EXPR, utype, "_fx_uop0", op, NULL);
+  uop = insert_recip_stmt(gsi_p, BIT_XOR_EXPR, utype, "_fx_uop0", uop,
+                          *mask_p);
+  return insert_recip_stmt(gsi_p, MINUS_EXPR, utype, "_fx_mag0", uop,
+                           *mask_p);
+}
+
+/**
+ * @brief Find a function that counts the leading zeros of an unsigned value.
+ *
+ * @details Uses the smallest of the __builtin_clz functions whose argument is
+ * big enough.
+ *
+ * @param[in]  n          number of bits in the value
+ * @param[out] arg_type_p set to the type of the function's argument
+ * @return     the function declaration, or NULL_TREE if there is none
+ */
+tree clz_function(int n, tree * arg_type_p)
+{
+  enum built_in_function fn[] = { BUILT_IN_CLZ, BUILT_IN_CLZL,
+    BUILT_IN_CLZLL
+  };
+  tree arg_type[] = { unsigned_type_node, long_unsigned_type_node,
+    long_long_unsigned_type_node
+  };
+  unsigned i;
+
+  for (i = 0; i < sizeof(fn) / sizeof(fn[0]); i++) {
+    if (((int) TYPE_PRECISION(arg_type[i]) >= n)
+        && (built_in_decls[fn[i]] != NULL_TREE)) {
+      *arg_type_p = arg_type[i];
+      return built_in_decls[fn[i]];
+    }
+  }
+  return NULL_TREE;
+}
+
+/**
+ * @brief Count the leading zeros of an unsigned value.
+ *
+ * @details The statements are inserted before the current statement.
+ *
+ * @param[in] gsi_p    pointer to the gimple_stmt_iterator
+ * @param[in] fn       the function found by clz_function()
+ * @param[in] arg_type the type of the function's argument
+ * @param[in] uop      the unsigned value, which must not be zero
+ * @return    an int variable with the count
+ */
+tree insert_clz(gimple_stmt_iterator * gsi_p, tree fn, tree arg_type,
+                tree uop)
+{
+  int extra = TYPE_PRECISION(arg_type) - TYPE_PRECISION(TREE_TYPE(uop));
+  tree arg = uop;
+  tree count = make_rename_temp(integer_type_node, "_fx_clz0");
+  gimple call;
+
+  if (extra != 0)
+    arg = insert_recip_stmt(gsi_p, NOP_EXPR, arg_type, "_fx_clzarg0", uop,
+                            NULL);
+  call = gimple_build_call(fn, 1, arg);
+  gimple_call_set_lhs(call, count);
+  gsi_insert_before(gsi_p, call, GSI_SAME_STMT);
+  FXLOG_STMT(2, call);
+  if (extra != 0)
+    count = insert_recip_stmt(gsi_p, MINUS_EXPR, integer_type_node,
+                              "_fx_clz0", count,
+                              build_int_cst(integer_type_node, extra));
+  return count;
+}
+
+/**
+ * @brief Find the number of Newton-Raphson iterations for a quotient.
+ *
+ * @details There is always at least one iteration, so that the reciprocal is
+ * not larger than 1/D, as the linear estimate may be.
+ *
+ * @param[in] result_bits number of bits in the magnitude of the quotient
+ * @param[in] size        number of bits in the operands
+ * @return    number of iterations
+ */
+static int reciprocal_iterations(int result_bits, int size)
+{
+  int k = 1;
+
+  while (((SEED_BITS << k) <= result_bits) && ((SEED_BITS << k) < size - 1))
+    k++;
+  return k;
+}
+
+/**
+ * @brief Replace a division by a variable with a multiplication by the
+ * divisor's reciprocal.
+ *
+ * @details Called on the last pass, after the operands of the division have
+ * been shifted. The statements that find the quotient are inserted before
+ * the division, which becomes a copy of the quotient. If the operands are too
+ * big for the products to be done in an integer type, the division is not
+ * changed.
+ *
+ * @param[in] gsi_p       pointer to the division's gimple_stmt_iterator
+ * @param[in] result_bits number of bits in the magnitude of the quotient, as
+ *                        found by the range analysis
+ * @return    true if the division was replaced
+ */
+bool reciprocal_divide(gimple_stmt_iterator * gsi_p, int result_bits)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree type = TREE_TYPE(gimple_assign_rhs1(stmt));
+  int n = TYPE_PRECISION(type);
+  int k, iterations;
+  tree clz_fn, clz_type;
+
+  if (!INTEGRAL_TYPE_P(type) || (n > HOST_BITS_PER_WIDE_INT) ||
+      ((2 * n > (int) TYPE_PRECISION(long_long_integer_type_node)) &&
+       ((int128_integer_type_node == NULL_TREE) ||
+        (2 * n > (int) TYPE_PRECISION(int128_integer_type_node)))))
+    return false;
+  clz_fn = clz_function(n, &clz_type);
+  if (clz_fn == NULL_TREE)
+    return false;
+
+  tree utype = unsigned_type_for(type);
+  tree wtype = unsigned_type_for(fxopt_integer_type(2 * n));
+  tree num_mask, den_mask;
+  tree num = insert_magnitude(gsi_p, gimple_assign_rhs1(stmt), utype,
+                              &num_mask);
+  tree den = insert_magnitude(gsi_p, gimple_assign_rhs2(stmt), utype,
+                              &den_mask);
+  tree zeros = insert_clz(gsi_p, clz_fn, clz_type, den);
+
+  iterations = reciprocal_iterations(result_bits, n);
+  FXLOG(2, "  Division replaced by reciprocal, %d-bit quotient, "
+        "%d iterations\n", result_bits, iterations);
+  //
+  // d is the normalized divisor, D * 2^n, and x is the reciprocal,
+  // X * 2^(n-1). The constant 48/17 is reduced modulo 2, since only the
+  // low n bits of the estimate are kept and the estimate is less than 2.
+  //
+  tree d = insert_recip_stmt(gsi_p, LSHIFT_EXPR, utype, "_fx_norm0", den,
+                             zeros);
+  tree dw = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_norm0", d, NULL);
+  tree c1 = build_int_cstu(utype, (unsigned HOST_WIDE_INT)
+                           ldexp(14.0 / 17.0, n - 1));
+  tree c2 = build_int_cstu(wtype, (unsigned HOST_WIDE_INT)
+                           ldexp(16.0 / 17.0, n));
+  tree n_bits = build_int_cst(integer_type_node, n);
+  tree t = insert_recip_stmt(gsi_p, MULT_EXPR, wtype, "_fx_recipw0", dw, c2);
+  t = insert_recip_stmt(gsi_p, RSHIFT_EXPR, wtype, "_fx_recipw0", t, n_bits);
+  t = insert_recip_stmt(gsi_p, NOP_EXPR, utype, "_fx_recip0", t, NULL);
+  tree x = insert_recip_stmt(gsi_p, MINUS_EXPR, utype, "_fx_recip0", c1, t);
+  tree xw = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_recipw0", x, NULL);
+
+  for (k = 0; k < iterations; k++) {
+    // e = (2 - D * X) * 2^(n-1)
+    tree p = insert_recip_stmt(gsi_p, MULT_EXPR, wtype, "_fx_recipw0", dw,
+                               xw);
+    p = insert_recip_stmt(gsi_p, RSHIFT_EXPR, wtype, "_fx_recipw0", p,
+                          n_bits);
+    p = insert_recip_stmt(gsi_p, NOP_EXPR, utype, "_fx_recip0", p, NULL);
+    tree e = insert_recip_stmt(gsi_p, NEGATE_EXPR, utype, "_fx_recip0", p,
+                               NULL);
+    e = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_recipw0", e, NULL);
+    // X = X * (2 - D * X)
+    xw = insert_recip_stmt(gsi_p, MULT_EXPR, wtype, "_fx_recipw0", xw, e);
+    xw = insert_recip_stmt(gsi_p, RSHIFT_EXPR, wtype, "_fx_recipw0", xw,
+                           build_int_cst(integer_type_node, n - 1));
+  }
+  //
+  // The divisor is D * 2^(n - zeros), so the quotient is the product of the
+  // dividend and x, shifted right by 2n - 1 - zeros
+  //
+  tree q = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_quotw0", num, NULL);
+  q = insert_recip_stmt(gsi_p, MULT_EXPR, wtype, "_fx_quotw0", q, xw);
+  tree shift = insert_recip_stmt(gsi_p, MINUS_EXPR, integer_type_node,
+                                 "_fx_qshift0",
+                                 build_int_cst(integer_type_node, 2 * n - 1),
+                                 zeros);
+  q = insert_recip_stmt(gsi_p, RSHIFT_EXPR, wtype, "_fx_quotw0", q, shift);
+  //
+  // After an iteration the reciprocal is never too large, so the quotient
+  // is at most two LSBs too small: add one while (q + 1) * den <= num
+  //
+  tree numw = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_numw0", num,
+                                NULL);
+  tree denw = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_denw0", den,
+                                NULL);
+  for (k = 0; k < 2; k++) {
+    tree next = insert_recip_stmt(gsi_p, PLUS_EXPR, wtype, "_fx_quotw0", q,
+                                  build_int_cstu(wtype, 1));
+    tree p = insert_recip_stmt(gsi_p, MULT_EXPR, wtype, "_fx_recipw0", next,
+                               denw);
+    tree fits = insert_recip_stmt(gsi_p, LE_EXPR, boolean_type_node,
+                                  "_fx_qfix0", p, numw);
+    fits = insert_recip_stmt(gsi_p, NOP_EXPR, wtype, "_fx_quotw0", fits,
+                             NULL);
+    q = insert_recip_stmt(gsi_p, PLUS_EXPR, wtype, "_fx_quotw0", q, fits);
+  }
+  q = insert_recip_stmt(gsi_p, NOP_EXPR, utype, "_fx_quot0", q, NULL);
+  //
+  // Negate the quotient if exactly one operand is negative
+  //
+  tree sign = insert_recip_stmt(gsi_p, BIT_XOR_EXPR, utype, "_fx_umask0",
+                                num_mask, den_mask);
+  q = insert_recip_stmt(gsi_p, BIT_XOR_EXPR, utype, "_fx_quot0", q, sign);
+  q = insert_recip_stmt(gsi_p, MINUS_EXPR, utype, "_fx_quot0", q, sign);
+
+  gimple_assign_set_rhs_with_ops(gsi_p, NOP_EXPR, q, NULL);
+  update_stmt(gsi_stmt(*gsi_p));
+  FXLOG_STMT(2, gsi_stmt(*gsi_p));
+  return true;
+}
+
+// vim:syntax=c.doxygen
@@ -0,0 +1,347 @@
+/**
+ * @file fxopt_shifts.c
+ *
+ * @brief  Functions for removing redundant shifts from a converted function
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-10T15:37:12-0500
+ * @date Last modified: 2014-01-10T15:37:12-0500
+ *
+ * @details  The conversion inserts new statements to shift, round and
+ *           saturate each operand as it is needed, so when a value is used
+ *           by several statements with the same format, the same shift is
+ *           inserted for each of them. When the value does not change inside
+ *           a loop, the shift is also repeated on every iteration.
+ *
+ *           After the conversion, the statements that the plugin inserted are
+ *           visited in dominator order. A statement whose operation and
+ *           operands are the same as those of an earlier statement that
+ *           dominates it is removed, and its result is replaced by the
+ *           earlier result. This is done for each step of a shift, so a
+ *           rounded shift is shared only if the rounding is also the same.
+ *           Before that, a statement whose operands are all defined outside
+ *           a loop is moved to the preheader of the outermost such loop.
+ *
+ *           The inserted statements are not in SSA form until the pass
+ *           finishes, so an inserted variable is only treated as a value if
+ *           it is assigned exactly once, as found by single_value_temps().
+ *           Others, such as the block exponent of an fxblock array, change
+ *           between their uses.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+#include "cfgloop.h"
+#include "pointer-set.h"
+#include "utlist.h"
+
+/**
+ * @brief An inserted statement that may be reused by later statements.
+ */
+struct SHIFT_VALUE {
+  gimple stmt;                  ///< the statement that computes the value
+  struct SHIFT_VALUE *next;
+};
+
+/**
+ * @brief State of the walk over the dominator tree.
+ */
+struct SHIFT_WALK {
+  struct pointer_set_t *single;         ///< inserted variables with one value
+  struct pointer_map_t *replacement;    ///< removed variable -> earlier one
+  struct pointer_map_t *def_bb;         ///< inserted variable -> its block
+  struct SHIFT_VALUE *values;           ///< statements that may be reused
+  int shared;                   ///< statements whose value was reused
+  int hoisted;                  ///< statements moved out of loops
+};
+
+/**
+ * @brief Predicate for an inserted statement that may be shared or moved.
+ *
+ * @details Only operations that have no side effects and cannot trap, and
+ * that assign an inserted variable that holds one value, are candidates.
+ *
+ * @param[in] stmt a GIMPLE statement
+ * @param[in] walk state of the walk
+ * @return    true if the statement is a candidate
+ */
+static bool is_shift_candidate(gimple stmt, struct SHIFT_WALK *walk)
+{
+  if (!is_gimple_assign(stmt) ||
+      !pointer_set_contains(walk->single, gimple_assign_lhs(stmt)))
+    return false;
+  switch (gimple_assign_rhs_code(stmt)) {
+    case RSHIFT_EXPR:
+    case LSHIFT_EXPR:
+    case PLUS_EXPR:
+    case MINUS_EXPR:
+    case NEGATE_EXPR:
+    case NOP_EXPR:
+    case CONVERT_EXPR:
+    case MIN_EXPR:
+    case MAX_EXPR:
+    case GT_EXPR:
+    case INTEGER_CST:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Replace a removed variable by the one that holds the same value.
+ *
+ * @details Callback for walk_tree().
+ */
+static tree substitute_temp(tree * tp, int *walk_subtrees, void *data)
+{
+  void **slot;
+
+  if (TREE_CODE(*tp) == VAR_DECL) {
+    slot = pointer_map_contains((struct pointer_map_t *) data, *tp);
+    if (slot != NULL)
+      *tp = (tree) * slot;
+  }
+  if (TYPE_P(*tp))
+    *walk_subtrees = 0;
+  return NULL_TREE;
+}
+
+/**
+ * @brief Predicate for an operand whose value is the same everywhere in a loop.
+ *
+ * @param[in] op    gcc tree for the operand
+ * @param[in] loop  the loop
+ * @param[in] walk  state of the walk
+ * @return    true if the operand is invariant
+ */
+static bool operand_invariant_p(tree op, struct loop *loop,
+                                struct SHIFT_WALK *walk)
+{
+  void **slot;
+
+  if (op == NULL_TREE || is_gimple_min_invariant(op))
+    return true;
+  if (TREE_CODE(op) == SSA_NAME) {
+    basic_block bb = gimple_bb(SSA_NAME_DEF_STMT(op));
+    return (bb == NULL) || !flow_bb_inside_loop_p(loop, bb);
+  }
+  slot = pointer_map_contains(walk->def_bb, op);
+  return (slot != NULL) &&
+      !flow_bb_inside_loop_p(loop, (basic_block) * slot);
+}
+
+/**
+ * @brief Move an inserted statement out of the loops in which its operands
+ * do not change.
+ *
+ * @param[in,out] gsi_p pointer to the statement's iterator, which is moved to
+ *                      the next statement if the statement is moved
+ * @param[in,out] walk  state of the walk
+ * @return        true if the statement was moved
+ */
+static bool hoist_invariant(gimple_stmt_iterator * gsi_p,
+                            struct SHIFT_WALK *walk)
+{
+  gimple stmt = gsi_stmt(*gsi_p);
+  struct loop *loop, *target = NULL;
+  unsigned i;
+
+  for (loop = gimple_bb(stmt)->loop_father; loop_outer(loop) != NULL;
+       loop = loop_outer(loop)) {
+    for (i = 1; i < gimple_num_ops(stmt); i++) {
+      if (!operand_invariant_p(gimple_op(stmt, i), loop, walk))
+        break;
+    }
+    if (i < gimple_num_ops(stmt))
+      break;
+    target = loop;
+  }
+  if (target == NULL)
+    return false;
+
+  FXLOG(2, "  Moving out of loop %d: ", target->num);
+  FXLOG_STMT(2, stmt);
+  gsi_remove(gsi_p, false);
+  gsi_insert_on_edge_immediate(loop_preheader_edge(target), stmt);
+  walk->hoisted++;
+  return true;
+}
+
+/**
+ * @brief Find an earlier statement that computes the same value.
+ *
+ * @param[in] stmt a candidate statement
+ * @param[in] walk state of the walk
+ * @return    the earlier statement, or NULL if there is none
+ */
+static gimple find_shift_value(gimple stmt, struct SHIFT_WALK *walk)
+{
+  struct SHIFT_VALUE *v;
+  unsigned i;
+
+  LL_FOREACH(walk->values, v) {
+    if ((gimple_assign_rhs_code(v->stmt) != gimple_assign_rhs_code(stmt)) ||
+        (gimple_num_ops(v->stmt) != gimple_num_ops(stmt)) ||
+        (TREE_TYPE(gimple_assign_lhs(v->stmt)) !=
+         TREE_TYPE(gimple_assign_lhs(stmt))))
+      continue;
+    for (i = 1; i < gimple_num_ops(stmt); i++) {
+      if (!operand_equal_p(gimple_op(v->stmt, i), gimple_op(stmt, i), 0))
+        break;
+    }
+    if ((i == gimple_num_ops(stmt)) &&
+        dominated_by_p(CDI_DOMINATORS, gimple_bb(stmt), gimple_bb(v->stmt)))
+      return v->stmt;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Predicate for an operand whose value is known from its name.
+ *
+ * @details Constants, SSA names and the inserted variables that are assigned
+ * once can be compared by name. Any other variable may be changed between two
+ * statements that use it.
+ *
+ * @param[in] op   gcc tree for the operand
+ * @param[in] walk state of the walk
+ * @return    true if the operand is a value
+ */
+static bool is_value_operand(tree op, struct SHIFT_WALK *walk)
+{
+  return (op == NULL_TREE) || is_gimple_min_invariant(op) ||
+      (TREE_CODE(op) == SSA_NAME) || pointer_set_contains(walk->single, op);
+}
+
+/**
+ * @brief Remember an inserted statement so that later statements can reuse
+ * its value.
+ *
+ * @details If an equivalent statement has already been seen, the variable of
+ * the new one is replaced by the earlier variable in the statements that
+ * follow.
+ *
+ * @param[in]     stmt a candidate statement
+ * @param[in,out] walk state of the walk
+ * @return        true if an earlier statement computes the same value
+ */
+static bool record_shift_value(gimple stmt, struct SHIFT_WALK *walk)
+{
+  gimple earlier = find_shift_value(stmt, walk);
+  struct SHIFT_VALUE *v;
+
+  *pointer_map_insert(walk->def_bb, gimple_assign_lhs(stmt)) =
+      (void *) gimple_bb(stmt);
+  if (earlier != NULL) {
+    FXLOG(2, "  Reusing value of ");
+    FXLOG_STMT(2, earlier);
+    *pointer_map_insert(walk->replacement, gimple_assign_lhs(stmt)) =
+        (void *) gimple_assign_lhs(earlier);
+    return true;
+  }
+  v = (struct SHIFT_VALUE *) xmalloc(sizeof(struct SHIFT_VALUE));
+  v->stmt = stmt;
+  LL_PREPEND(walk->values, v);
+  return false;
+}
+
+/**
+ * @brief Share or move the inserted statements of a block, then of the
+ * blocks that it dominates.
+ *
+ * @param[in]     bb   the basic block
+ * @param[in,out] walk state of the walk
+ */
+static void share_shifts_in_block(basic_block bb, struct SHIFT_WALK *walk)
+{
+  gimple_stmt_iterator gsi;
+  basic_block son;
+  unsigned i;
+
+  for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi);) {
+    gimple stmt = gsi_stmt(gsi);
+    bool modified = false, values = true;
+    for (i = 0; i < gimple_num_ops(stmt); i++) {
+      tree old_op = gimple_op(stmt, i);
+      if (old_op == NULL_TREE)
+        continue;
+      walk_tree(gimple_op_ptr(stmt, i), substitute_temp, walk->replacement,
+                NULL);
+      modified |= (gimple_op(stmt, i) != old_op);
+      if (i > 0)
+        values &= is_value_operand(gimple_op(stmt, i), walk);
+    }
+    if (modified)
+      update_stmt(stmt);
+    if (!values || !is_shift_candidate(stmt, walk)) {
+      gsi_next(&gsi);
+      continue;
+    }
+    if (hoist_invariant(&gsi, walk)) {
+      // A moved statement that turns out to be redundant is left in the
+      // preheader, unused, for dead code elimination to remove
+      if (record_shift_value(stmt, walk))
+        walk->shared++;
+      continue;
+    }
+    if (record_shift_value(stmt, walk)) {
+      gsi_remove(&gsi, true);
+      walk->shared++;
+      continue;
+    }
+    gsi_next(&gsi);
+  }
+
+  for (son = first_dom_son(CDI_DOMINATORS, bb); son != NULL;
+       son = next_dom_son(CDI_DOMINATORS, son))
+    share_shifts_in_block(son, walk);
+}
+
+/**
+ * @brief Remove redundant shifts and move loop-invariant shifts out of loops.
+ *
+ * @details Called after the function has been converted to fixed-point. Only
+ * the statements that the plugin inserted are changed.
+ */
+void share_shifts()
+{
+  struct SHIFT_WALK walk;
+  struct SHIFT_VALUE *v, *tmp;
+
+  FXLOG(1, "  ===== Sharing shifts =====\n");
+  loop_optimizer_init(LOOPS_NORMAL);
+  calculate_dominance_info(CDI_DOMINATORS);
+
+  walk.single = single_value_temps();
+  walk.replacement = pointer_map_create();
+  walk.def_bb = pointer_map_create();
+  walk.values = NULL;
+  walk.shared = 0;
+  walk.hoisted = 0;
+  share_shifts_in_block(ENTRY_BLOCK_PTR, &walk);
+  FXLOG(1, "  %d statements shared, %d moved out of loops\n",
+        walk.shared, walk.hoisted);
+
+  LL_FOREACH_SAFE(walk.values, v, tmp) {
+    LL_DELETE(walk.values, v);
+    free(v);
+  }
+  pointer_set_destroy(walk.single);
+  pointer_map_destroy(walk.replacement);
+  pointer_map_destroy(walk.def_bb);
+  loop_optimizer_finalize();
+}
+
+// vim:syntax=c.doxygen
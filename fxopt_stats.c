@@ -0,0 +1,153 @@
+/**
+ * @file fxopt_stats.c
+ *
+ * @brief  Functions for measuring the cost of the fxopt pass
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-08T14:21:09-0500
+ * @date Last modified: 2014-01-08T14:21:09-0500
+ *
+ * @details  The time spent in each phase of the conversion is measured with a
+ *           small stack of phase timers, in the same way that gcc's own
+ *           timevars are pushed and popped, so that the time for a nested
+ *           phase is not also charged to the phase that contains it. The
+ *           event counters are kept in ::fxstats. Everything is accumulated
+ *           over the whole translation unit and reported when gcc finishes,
+ *           and nothing is measured unless the report was requested.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include "fxopt_plugin.h"
+
+/**
+ * @var   fxstats
+ * @brief Counters and phase times for the translation unit.
+ */
+struct FXOPT_STATS fxstats;
+
+/**
+ * @brief Names of the phases, in the order of ::FXOPT_PHASE
+ */
+static const char *phase_name[NUM_FXOPT_PHASES] = {
+  "declared variables",
+  "induction variables",
+  "format cache",
+  "format passes",
+  "pointer consistency",
+  "final rewrite"
+};
+
+/**
+ * @def   MAX_PHASE_DEPTH
+ * @brief Maximum nesting of phase timers.
+ */
+#define MAX_PHASE_DEPTH 8
+
+static enum FXOPT_PHASE phase_stack[MAX_PHASE_DEPTH];
+static int phase_depth = 0;
+static long phase_start = 0;    ///< Run time when the top phase resumed
+
+/**
+ * @brief Start timing a phase.
+ *
+ * @details The phase that was running is suspended until the new phase ends.
+ *
+ * @param[in] phase the phase that is beginning
+ */
+void fxtimer_push(enum FXOPT_PHASE phase)
+{
+  long now;
+
+  if (!STATS)
+    return;
+  if (phase_depth >= MAX_PHASE_DEPTH)
+    fatal_error("fxopt: phase timers nested too deeply");
+  now = get_run_time();
+  if (phase_depth > 0)
+    fxstats.phase_time[phase_stack[phase_depth - 1]] += now - phase_start;
+  phase_stack[phase_depth++] = phase;
+  phase_start = now;
+}
+
+/**
+ * @brief Stop timing a phase and resume the phase that contains it.
+ *
+ * @param[in] phase the phase that is ending, which must be the last one that
+ *                  was started
+ */
+void fxtimer_pop(enum FXOPT_PHASE phase)
+{
+  long now;
+
+  if (!STATS)
+    return;
+  if ((phase_depth == 0) || (phase_stack[phase_depth - 1] != phase))
+    fatal_error("fxopt: phase timer for %s ended out of order",
+                phase_name[phase]);
+  now = get_run_time();
+  fxstats.phase_time[phase] += now - phase_start;
+  phase_depth--;
+  phase_start = now;
+}
+
+/**
+ * @brief Record the length of an affine definition, if it is the longest seen.
+ *
+ * @param[in] aa_list_p pointer to the head of an AA list
+ */
+void count_aa_list(struct AA *aa_list_p)
+{
+  int length = 0;
+
+  if (!STATS)
+    return;
+  for (; NULL != aa_list_p; aa_list_p = aa_list_p->next)
+    length++;
+  if (length > fxstats.peak_aa_terms)
+    fxstats.peak_aa_terms = length;
+}
+
+/**
+ * @brief Print the counters and phase times.
+ *
+ * @param[in] file where the report is written
+ */
+void print_fxopt_stats(FILE * file)
+{
+  long total = 0;
+  int phase;
+
+  for (phase = 0; phase < NUM_FXOPT_PHASES; phase++)
+    total += fxstats.phase_time[phase];
+
+  fprintf(file, "\nfxopt statistics:\n");
+  fprintf(file, " %-28s: %10ld\n", "functions converted",
+          fxstats.functions);
+  fprintf(file, " %-28s: %10ld\n", "functions from format cache",
+          fxstats.cache_hits);
+  fprintf(file, " %-28s: %10ld\n", "format passes", fxstats.passes);
+  fprintf(file, " %-28s: %10ld\n", "statements visited",
+          fxstats.statements);
+  fprintf(file, " %-28s: %10ld\n", "format lookups", fxstats.lookups);
+  fprintf(file, " %-28s: %10ld\n", "affine terms created",
+          fxstats.aa_terms);
+  fprintf(file, " %-28s: %10d\n", "longest affine definition",
+          fxstats.peak_aa_terms);
+  for (phase = 0; phase < NUM_FXOPT_PHASES; phase++) {
+    fprintf(file, " %-28s: %7.2f (%2.0f%%) usr\n", phase_name[phase],
+            fxstats.phase_time[phase] / 1.0e6,
+            total ? (100.0 * fxstats.phase_time[phase]) / total : 0.0);
+  }
+  fprintf(file, " %-28s: %7.2f\n", "TOTAL", total / 1.0e6);
+}
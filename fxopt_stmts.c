@@ -77,8 +77,13 @@ struct SIF nop(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
   result_frmt = oprnd_frmt[0];
   result_frmt.shift = 0;
   result_frmt.aa = NULL;
+  //
+  // A narrow RHS is extended to the size of the LHS. A wide RHS keeps its
+  // size and is narrowed when the result is assigned.
+  //
+  result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
 
-  if (oprnd_frmt[0].size == oprnd_frmt[1].size) {
+  if (oprnd_frmt[0].size <= oprnd_frmt[1].size) {
     if (gimple_assign_cast_p(stmt) ||
         (oprnd_frmt[0].sgnd == oprnd_frmt[1].sgnd) ||
         (oprnd_frmt[0].sgnd && (oprnd_frmt[1].ptr_op != 0)
@@ -149,7 +154,7 @@ struct SIF nop(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
   if ((TREE_CODE(TREE_TYPE(oprnd_tree[1])) == ARRAY_TYPE) &&
       (gimple_assign_rhs_code(stmt) == VAR_DECL)) {
     if (NEGATE_EXPR == gimple_assign_rhs_code(stmt))
-      fprintf(stderr, "  YIKES, a negated array!\n");
+      FXLOG(1, "  YIKES, a negated array!\n");
     int low_bound =
         TREE_INT_CST_LOW(TYPE_MIN_VALUE
                          (TYPE_DOMAIN(oprnd_tree[1]->common.type)));
@@ -179,9 +184,9 @@ struct SIF nop(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
         delete_aa_list(&(op_fmt->aa));
         op_fmt->aa = copy_aa_list(result_frmt.aa);
 
-        fprintf(stderr, "     [%2d]  (%2d/%2d/%2d/%2d)  [%+5.3f,%+5.3f]\n",
-                index, op_fmt->S, op_fmt->I, op_fmt->F, op_fmt->E,
-                real_min(op_fmt), real_max(op_fmt));
+        FXLOG(2, "     [%2d]  (%2d/%2d/%2d/%2d)  [%+5.3f,%+5.3f]\n",
+              index, op_fmt->S, op_fmt->I, op_fmt->F, op_fmt->E,
+              real_min(op_fmt), real_max(op_fmt));
       }
     }
   }
@@ -227,6 +232,7 @@ struct SIF array_ref(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
   //
   result_frmt = oprnd_frmt[0];  // shallow copy
   result_frmt.aa = NULL;        // don't let copy_SIF trash op0 aa list
+  result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
   copy_SIF(&oprnd_frmt[1], &result_frmt);
   //
   // If store to memory, try to do trivial fixes to preserve the pointer
@@ -291,15 +297,52 @@ struct SIF array_ref(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
         delete_aa_list(&(op_fmt->aa));
         op_fmt->aa = copy_aa_list(result_frmt.aa);
 
-        fprintf(stderr, "     [%2d]  (%2d/%2d/%2d/%2d)  [%+5.3f,%+5.3f]\n",
-                index, op_fmt->S, op_fmt->I, op_fmt->F, op_fmt->E,
-                real_min(op_fmt), real_max(op_fmt));
+        FXLOG(2, "     [%2d]  (%2d/%2d/%2d/%2d)  [%+5.3f,%+5.3f]\n",
+              index, op_fmt->S, op_fmt->I, op_fmt->F, op_fmt->E,
+              real_min(op_fmt), real_max(op_fmt));
       }
     }
   }
   return result_frmt;
 }
 
+/**
+ * @brief Align a value stored to an array element with the array's format.
+ *
+ * @details Used when all elements of an array share one format, so that the
+ * loads and stores of every element need the same shifts and a loop over the
+ * array may be vectorized. The format is aligned by align_store_to_format(),
+ * and the shift it asks for is made on the stored operand. A value that needs
+ * more integer bits than the array is stored as is, and widens the array's
+ * format for the next pass.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * tmp[i_3] = D.1989_16;
+ * coef[2] = 5.0e-1;
+ * @endcode
+ *
+ * @param[in] gsi_p statement iterator, points to statement being processed
+ * @param[in,out] oprnd_frmt array of SIF format structs for all operands
+ * @param[in,out] oprnd_tree array of gcc trees for the operands
+ * @param[in] result_frmt SIF format struct for the value being stored
+ * @return    SIF format struct for the result
+ */
+struct SIF uniform_store(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                         tree oprnd_tree[], struct SIF result_frmt)
+{
+  if (gimple_num_ops(gsi_stmt(*gsi_p)) != 2)
+    return result_frmt;
+
+  int count = align_store_to_format(&result_frmt, oprnd_frmt[0]);
+  if (count < 0)
+    return result_frmt;
+  shift_right(oprnd_frmt, oprnd_tree, 1, count);
+  FXLOG(2, "  Uniform array store (%2d/%2d/%2d/%2d)\n", result_frmt.S,
+        result_frmt.I, result_frmt.F, result_frmt.E);
+  return result_frmt;
+}
+
 /**
  * @brief Process statements that include pointer arithmetic.
  * 
@@ -379,7 +422,7 @@ struct SIF pointer_math(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
   }
 
   if (shift != 0)
-    fprintf(stderr, "  Pointer stride will be shifted %d\n", shift);
+    FXLOG(2, "  Pointer stride will be shifted %d\n", shift);
 
   return result_frmt;
 }
@@ -417,6 +460,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
     oprnd_frmt[2] = get_operand_format(stmt, 2, 0, PRINT);
     if (format_initialized(oprnd_frmt[2])) {
       oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
+      oprnd_frmt[1].size = oprnd_frmt[2].size;
       oprnd_frmt[1].S =
           oprnd_frmt[2].size - oprnd_frmt[1].I - oprnd_frmt[1].F -
           oprnd_frmt[1].E;
@@ -427,6 +471,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
     oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
     if (format_initialized(oprnd_frmt[1])) {
       oprnd_frmt[2] = get_operand_format(stmt, 2, 0, PRINT);
+      oprnd_frmt[2].size = oprnd_frmt[1].size;
       oprnd_frmt[2].S =
           oprnd_frmt[1].size - oprnd_frmt[2].I - oprnd_frmt[2].F -
           oprnd_frmt[2].E;
@@ -449,6 +494,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
   //
   result_frmt = oprnd_frmt[0];
   result_frmt.aa = NULL;
+  result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
   //
   // Need at least two sign bits for signed addition, at least one for unsigned
   // (oprnd_frmt.sgnd = 1 for signed, so the minimum number of sign bits is 
@@ -456,11 +502,11 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
   //
   int min_s_bits = oprnd_frmt[0].sgnd + 1;
   if (oprnd_frmt[1].S < min_s_bits) {
-    fprintf(stderr, "  OP1 needs another sign bit\n");
+    FXLOG(2, "  OP1 needs another sign bit\n");
     shift_right(oprnd_frmt, oprnd_tree, 1, 1);
   }
   if (oprnd_frmt[2].S < min_s_bits) {
-    fprintf(stderr, "  OP2 needs another sign bit\n");
+    FXLOG(2, "  OP2 needs another sign bit\n");
     shift_right(oprnd_frmt, oprnd_tree, 2, 1);
   }
   // 
@@ -499,7 +545,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
         || rounding_may_overflow(oprnd_frmt[2])) {
       // Need one more sign bit in both operands to allow for overflow
       // from rounding.
-      fprintf(stderr, "  Rounding may overflow, add another sign bit\n");
+      FXLOG(2, "  Rounding may overflow, add another sign bit\n");
       shift_right(oprnd_frmt, oprnd_tree, 1, 1);
       shift_right(oprnd_frmt, oprnd_tree, 2, 1);
     }
@@ -508,7 +554,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
   result_frmt.I = MAX(oprnd_frmt[1].I, oprnd_frmt[2].I) + 1;
   result_frmt.F = MAX(oprnd_frmt[1].F, oprnd_frmt[2].F);
   result_frmt.E =
-      oprnd_frmt[0].size - result_frmt.S - result_frmt.I - result_frmt.F;
+      result_frmt.size - result_frmt.S - result_frmt.I - result_frmt.F;
   struct SIF temp_frmt;
   initialize_format(&temp_frmt);
   if (gimple_assign_rhs_code(stmt) == MINUS_EXPR)
@@ -516,10 +562,10 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
   else
     temp_frmt = new_range_add(oprnd_frmt, result_frmt);
   if (pessimistic_format(temp_frmt) && (! oprnd_frmt[0].ptr_op)) {
-    fprintf(stderr,
-            "  *** Pessimistic addition axiom, ");
+    FXLOG(2,
+          "  *** Pessimistic addition axiom, ");
     if ((oprnd_frmt[1].shift > 0) && (oprnd_frmt[1].shift > 0)) {
-      fprintf(stderr, "giving back a right shift *** \n");
+      FXLOG(2, "giving back a right shift *** \n");
       result_frmt.I -= 1;
       if ((LOST_F_BITS(1) > 0) || (LOST_F_BITS(2) > 0)) 
         result_frmt.F += 1;
@@ -528,7 +574,7 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
       shift_left(oprnd_frmt, oprnd_tree, 1, 1);
       shift_left(oprnd_frmt, oprnd_tree, 2, 1);
     } else {
-      fprintf(stderr, "converting an I to S in result *** \n");
+      FXLOG(2, "converting an I to S in result *** \n");
       result_frmt.S += 1;
       result_frmt.I -= 1;
     }
@@ -545,6 +591,133 @@ struct SIF addition(gimple_stmt_iterator *gsi_p, struct SIF oprnd_frmt[],
   return result_frmt;
 }
 
+/**
+ * @brief Process minimum and maximum statements.
+ *
+ * @details The binary points of the operands are aligned as for addition,
+ * but the result cannot be larger in magnitude than the larger operand, so
+ * no sign bit is added. The range of the result is the minimum (or maximum)
+ * of the operands' ranges, and integer bits that the narrower range does not
+ * need become sign bits. When one operand is always the result, the result
+ * keeps that operand's affine definition; otherwise the result gets a new
+ * error term. These statements come from the source and from the bounds
+ * placed on a variable in a branch of a comparison.
+ *
+ * Examples of GIMPLE statements processed by this function:
+ * @code
+ * _fx_edge0 = MIN_EXPR <x_3, 1.5e+0>;
+ * D.2016_14 = MAX_EXPR <D.2015_13, lo_5(D)>;
+ * @endcode
+ *
+ * @param[in] gsi_p statement iterator, points to statement being processed
+ * @param[in,out] oprnd_frmt array of SIF format structs for all operands
+ * @param[in,out] oprnd_tree array of gcc trees for the operands
+ * @return    SIF format struct for the result
+ */
+struct SIF min_max(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                   tree oprnd_tree[])
+{
+  struct SIF result_frmt;
+  initialize_format(&result_frmt);
+
+  gimple stmt = gsi_stmt(*gsi_p);
+  bool is_min = (gimple_assign_rhs_code(stmt) == MIN_EXPR);
+
+  //
+  // A constant gets the size of the other operand, as for addition
+  //
+  if (TREE_CONSTANT(oprnd_tree[1])) {
+    oprnd_frmt[2] = get_operand_format(stmt, 2, 0, PRINT);
+    if (!format_initialized(oprnd_frmt[2]))
+      return result_frmt;
+    oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
+    oprnd_frmt[1].size = oprnd_frmt[2].size;
+    oprnd_frmt[1].S = oprnd_frmt[2].size - oprnd_frmt[1].I -
+        oprnd_frmt[1].F - oprnd_frmt[1].E;
+  } else if (TREE_CONSTANT(oprnd_tree[2])) {
+    oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
+    if (!format_initialized(oprnd_frmt[1]))
+      return result_frmt;
+    oprnd_frmt[2] = get_operand_format(stmt, 2, 0, PRINT);
+    oprnd_frmt[2].size = oprnd_frmt[1].size;
+    oprnd_frmt[2].S = oprnd_frmt[1].size - oprnd_frmt[2].I -
+        oprnd_frmt[2].F - oprnd_frmt[2].E;
+  } else {
+    if (!format_initialized(oprnd_frmt[1]))
+      oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
+    if (!format_initialized(oprnd_frmt[2]))
+      oprnd_frmt[2] = get_operand_format(stmt, 2, 0, PRINT);
+    if ((!format_initialized(oprnd_frmt[1]))
+        || (!format_initialized(oprnd_frmt[2])))
+      return result_frmt;
+  }
+  result_frmt = oprnd_frmt[0];
+  result_frmt.aa = NULL;
+  result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
+  //
+  // Align binary points, using redundant sign bits before shifting right
+  //
+  int min_s_bits = oprnd_frmt[0].sgnd;
+  int hi = (BINARY_PT(1) > BINARY_PT(2)) ? 1 : 2;
+  int lo = 3 - hi;
+  if (BINARY_PT(hi) > BINARY_PT(lo)) {
+    if (oprnd_frmt[lo].S > min_s_bits)
+      shift_left(oprnd_frmt, oprnd_tree, lo,
+                 MIN(oprnd_frmt[lo].S - min_s_bits,
+                     BINARY_PT(hi) - BINARY_PT(lo)));
+    if (BINARY_PT(hi) > BINARY_PT(lo))
+      shift_right(oprnd_frmt, oprnd_tree, hi, BINARY_PT(hi) - BINARY_PT(lo));
+  }
+  result_frmt.S = MIN(oprnd_frmt[1].S, oprnd_frmt[2].S);
+  result_frmt.I = MAX(oprnd_frmt[1].I, oprnd_frmt[2].I);
+  result_frmt.F = MAX(oprnd_frmt[1].F, oprnd_frmt[2].F);
+  result_frmt.E =
+      result_frmt.size - result_frmt.S - result_frmt.I - result_frmt.F;
+  //
+  // The result is one operand whenever its range is entirely on the chosen
+  // side of the other operand's range
+  //
+  double_int max1 = new_max(oprnd_frmt[1]), min1 = new_min(oprnd_frmt[1]);
+  double_int max2 = new_max(oprnd_frmt[2]), min2 = new_min(oprnd_frmt[2]);
+  int only = 0;
+  if (is_min) {
+    if (double_int_scmp(max1, min2) <= 0)
+      only = 1;
+    else if (double_int_scmp(max2, min1) <= 0)
+      only = 2;
+    result_frmt.max = (double_int_scmp(max1, max2) < 0) ? max1 : max2;
+    result_frmt.min = (double_int_scmp(min1, min2) < 0) ? min1 : min2;
+  } else {
+    if (double_int_scmp(min1, max2) >= 0)
+      only = 1;
+    else if (double_int_scmp(min2, max1) >= 0)
+      only = 2;
+    result_frmt.max = (double_int_scmp(max1, max2) > 0) ? max1 : max2;
+    result_frmt.min = (double_int_scmp(min1, min2) > 0) ? min1 : min2;
+  }
+  if (AFFINE) {
+    if (only) {
+      result_frmt.aa = new_aa_list(oprnd_frmt[only]);
+    } else {
+      range_to_aa(&result_frmt, fxctx->next_error_id++);
+    }
+  }
+  //
+  // Integer bits that the range of the result does not need are sign bits
+  //
+  int spare = pessimistic_format(result_frmt);
+  if (spare > 0) {
+    spare = MIN(spare, result_frmt.I);
+    FXLOG(2, "  *** Range of %s needs %d fewer I bits ***\n",
+          is_min ? "minimum" : "maximum", spare);
+    result_frmt.S += spare;
+    result_frmt.I -= spare;
+  }
+  fix_aa_bp(result_frmt);
+  check_range(result_frmt);
+  return result_frmt;
+}
+
 /**
  * @brief Process multiplication statements.
  *
@@ -585,6 +758,7 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
       //
       result_frmt = oprnd_frmt[0];
       result_frmt.aa = NULL;
+      result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
       /**
        * Special case of operand is a constant == 2^K:
        * Will cause a "virtual shift" of other RHS operand, moving binary
@@ -610,8 +784,8 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
         }
         if (k > (oprnd_frmt[1].F + oprnd_frmt[1].E))
           error("fxopt: multiply by 2^K, K too big");
-        fprintf(stderr, "  virtual shift, binary point moved %d bits\n", k);
-        if (lastpass) {
+        FXLOG(2, "  virtual shift, binary point moved %d bits\n", k);
+        if (fxctx->lastpass) {
           if (tree_int_cst_sign_bit(oprnd_tree[2])) {
             // constant is -2^k, must negate 
             new_stmt =
@@ -624,7 +798,7 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
                                              oprnd_tree[1], NULL);
           }
           //gimple_set_visited(new_stmt, true);
-          print_gimple_stmt(stderr, new_stmt, 2, 0);
+          FXLOG_STMT(2, new_stmt);
           gsi_replace(gsi_p, new_stmt, false);
           oprnd_tree[2] = NULL;
         }
@@ -664,9 +838,9 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
           fraction_zeros = MIN(fraction_zeros, oprnd_frmt[2].I);
         }
         if (fraction_zeros) {
-          fprintf(stderr,
-                  "  *** Zeros right of b.p., %d I bits changed to S bits in RSLT\n",
-                  fraction_zeros);
+          FXLOG(2,
+                "  *** Zeros right of b.p., %d I bits changed to S bits in RSLT\n",
+                fraction_zeros);
         }
         /**
          * If the double precision multiply is enabled, double the operand
@@ -687,10 +861,22 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
         struct SIF tmp_fmt = new_range_mul(oprnd_frmt, result_frmt);
         int new_frmt_info_bits = ceil_log2_range(tmp_fmt);
         delete_aa_list(&(tmp_fmt.aa));
-        if (DBL_PRECISION_MULTS) {
-          if ((!INTERVAL && (oprnds_info_bits > result_info_bits))
-              || (INTERVAL && (new_frmt_info_bits > result_info_bits))) {
-            result_frmt.size = 2 * oprnd_frmt[0].size;
+        int excess_bits = (INTERVAL ? new_frmt_info_bits : oprnds_info_bits)
+            - result_info_bits;
+        /*
+         * With an SQNR target, a double-precision multiply is only used when
+         * the noise from discarding the excess bits would miss the target.
+         */
+        bool double_mult = (DBL_PRECISION_MULTS || SQNR_TARGET)
+            && (excess_bits > 0);
+        if (double_mult && SQNR_TARGET
+            && single_mult_meets_budget(oprnd_frmt, excess_bits)) {
+          FXLOG(2, "  *** Single-precision multiply meets SQNR target ***\n");
+          double_mult = false;
+        }
+        if (double_mult || (DBL_PRECISION_MULTS && (excess_bits <= 0))) {
+          if (double_mult) {
+            result_frmt.size = 2 * result_frmt.size;
             result_info_bits =
                 result_frmt.size - result_frmt.sgnd + fraction_zeros;
             oprnd_frmt[1].S += oprnd_frmt[1].size;
@@ -700,11 +886,11 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
             //
             // Do implicit cast of RHS to double size of LHS
             //
-            if (lastpass)
+            if (fxctx->lastpass)
               gimple_assign_set_rhs_code(gsi_stmt(*gsi_p), WIDEN_MULT_EXPR);
           } else {
-            fprintf(stderr,
-                    "  *** Double-precision multiply unnecessary ***\n");
+            FXLOG(2,
+                  "  *** Double-precision multiply unnecessary ***\n");
           }
         } else {
           /**
@@ -745,18 +931,18 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
             // Sometimes we get an unexpected empty bit when shifting
             // a constant right. Give back an info bit.
             //
-            fprintf(stderr, "  *** Overoptimized, ");
+            FXLOG(2, "  *** Overoptimized, ");
             if ((INFO_BITS(1) < INFO_BITS(2)) && (LOST_F_BITS(1) > 0)) {
-              fprintf(stderr, "shifting op1 left, info bits\n");
+              FXLOG(2, "shifting op1 left, info bits\n");
               shift_left(oprnd_frmt, oprnd_tree, 1, 1);
             } else if (LOST_F_BITS(2) > 0) {
-              fprintf(stderr, "shifting op2 left\n");
+              FXLOG(2, "shifting op2 left\n");
               shift_left(oprnd_frmt, oprnd_tree, 2, 1);
             } else if (LOST_F_BITS(1) > 0) {
-              fprintf(stderr, "shifting op1 left\n");
+              FXLOG(2, "shifting op1 left\n");
               shift_left(oprnd_frmt, oprnd_tree, 1, 1);
             } else {
-              fprintf(stderr, "no lost info bits to return\n");
+              FXLOG(2, "no lost info bits to return\n");
             }
 
           }                     // over optimized
@@ -786,14 +972,14 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
         tmp_fmt = new_range_mul(oprnd_frmt, result_frmt);
         if ((INTERVAL && max_is_mnn(tmp_fmt))
             || ((!INTERVAL) && ROUNDING && (result_sign_bits == 1))) {
-          fprintf(stderr, "  *** Adding a sign bit to prevent MNN *** \n");
+          FXLOG(2, "  *** Adding a sign bit to prevent MNN *** \n");
           if ((INFO_BITS(1) > INFO_BITS(2))
               && ((oprnd_frmt[1].F + oprnd_frmt[1].E) > 0))
             shift_right(oprnd_frmt, oprnd_tree, 1, 1);
           else if ((oprnd_frmt[2].F + oprnd_frmt[2].E) > 0)
             shift_right(oprnd_frmt, oprnd_tree, 2, 1);
           else
-            fprintf(stderr, "  *** FAILED to add a sign bit *** \n");
+            FXLOG(1, "  *** FAILED to add a sign bit *** \n");
         }
         delete_aa_list(&(tmp_fmt.aa));
         // 
@@ -813,25 +999,25 @@ struct SIF multiplication(gimple_stmt_iterator *gsi_p,
         tmp_fmt = new_range_mul(oprnd_frmt, result_frmt);
         if ((pessimistic_format(tmp_fmt) >
              fraction_zeros) && (result_frmt.I > 0)) {
-          fprintf(stderr, "  *** Pessimistic multiplication axiom, ");
+          FXLOG(2, "  *** Pessimistic multiplication axiom, ");
           //
           // Try to give back a fraction bit, but if impossible then convert
           // an integer bit to a redundant sign bit
           //
           if ((INFO_BITS(1) < INFO_BITS(2)) && (oprnd_frmt[1].shift > 0)) {
-            fprintf(stderr, "shifting op1 left, info bits\n");
+            FXLOG(2, "shifting op1 left, info bits\n");
             shift_left(oprnd_frmt, oprnd_tree, 1, 1);
             result_frmt.F += 1;
           } else if (oprnd_frmt[2].shift > 0) {
-            fprintf(stderr, "shifting op2 left\n");
+            FXLOG(2, "shifting op2 left\n");
             shift_left(oprnd_frmt, oprnd_tree, 2, 1);
             result_frmt.F += 1;
           } else if (oprnd_frmt[1].shift > 0) {
-            fprintf(stderr, "shifting op1 left\n");
+            FXLOG(2, "shifting op1 left\n");
             shift_left(oprnd_frmt, oprnd_tree, 1, 1);
             result_frmt.F += 1;
           } else {
-            fprintf(stderr, "converting I to S in result\n");
+            FXLOG(2, "converting I to S in result\n");
             result_frmt.S += 1;
           }
           result_frmt.I -= 1;
@@ -890,7 +1076,7 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
     invert_constant_operand(stmt, 2);
     gimple_assign_set_rhs_code(stmt, MULT_EXPR);
     update_stmt(stmt);
-    print_gimple_stmt(stderr, stmt, 2, 0);
+    FXLOG_STMT(2, stmt);
     result_frmt = multiplication(gsi_p, oprnd_frmt, oprnd_tree);
   } else {
     oprnd_frmt[1] = get_operand_format(stmt, 1, 0, PRINT);
@@ -902,6 +1088,7 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
         //
         result_frmt = oprnd_frmt[0];
         result_frmt.aa = NULL;
+        result_frmt.size = match_operand_sizes(gsi_p, oprnd_frmt, oprnd_tree);
         //
         // Special case of operand is 2^K
         // Will cause a "virtual shift" of other RHS operand
@@ -927,8 +1114,8 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
           if ((k + oprnd_frmt[1].F + oprnd_frmt[1].E) < 0)
             error("fxopt: divide by 2^(-K), K too big");
 
-          fprintf(stderr, "  virtual shift, binary point moved %d bits\n", k);
-          if (lastpass) {
+          FXLOG(2, "  virtual shift, binary point moved %d bits\n", k);
+          if (fxctx->lastpass) {
             if (tree_int_cst_sign_bit(oprnd_tree[2])) {
               // constant is -2^k, must negate 
               new_stmt =
@@ -940,7 +1127,7 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                   gimple_build_assign_with_ops(NOP_EXPR, oprnd_tree[0],
                                                oprnd_tree[1], NULL);
             }
-            print_gimple_stmt(stderr, new_stmt, 2, 0);
+            FXLOG_STMT(2, new_stmt);
             gsi_replace(gsi_p, new_stmt, false);
             oprnd_tree[2] = NULL;
           }
@@ -975,9 +1162,9 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
             oprnd_frmt[1].F =
                 oprnd_frmt[1].size - oprnd_frmt[1].S - oprnd_frmt[1].I;
             oprnd_frmt[1].E = 0;
-            fprintf(stderr, "  OP1 cast to (%2d/%2d/%2d/%2d)\n",
-                    oprnd_frmt[1].S, oprnd_frmt[1].I, oprnd_frmt[1].F,
-                    oprnd_frmt[1].E);
+            FXLOG(2, "  OP1 cast to (%2d/%2d/%2d/%2d)\n",
+                  oprnd_frmt[1].S, oprnd_frmt[1].I, oprnd_frmt[1].F,
+                  oprnd_frmt[1].E);
           }
           // 
           // Right-justify the divisor, discarding empty bits
@@ -995,7 +1182,7 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                  (oprnd_frmt[1].F + oprnd_frmt[1].I) / 2);
             shiftconst = MIN(shiftconst, oprnd_frmt[2].F);
             shift_right(oprnd_frmt, oprnd_tree, 2, shiftconst);
-            fprintf(stderr, "  OP2 heuristically adjusted for division\n");
+            FXLOG(2, "  OP2 heuristically adjusted for division\n");
           }
           // 
           // The denominator must not have more fraction bits than the
@@ -1005,9 +1192,9 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
             int shift = oprnd_frmt[2].F - oprnd_frmt[1].F;
             if (shift > 0) {
               shift_right(oprnd_frmt, oprnd_tree, 2, shift);
-              fprintf(stderr, "  OP2 truncated to (%2d/%2d/%2d/%2d)\n",
-                      oprnd_frmt[2].S, oprnd_frmt[2].I, oprnd_frmt[2].F,
-                      oprnd_frmt[2].E);
+              FXLOG(2, "  OP2 truncated to (%2d/%2d/%2d/%2d)\n",
+                    oprnd_frmt[2].S, oprnd_frmt[2].I, oprnd_frmt[2].F,
+                    oprnd_frmt[2].E);
             } else {
               error("fxopt plugin FAILED to process a division");
               return result_frmt;
@@ -1018,8 +1205,8 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
           // bits in the denominator must be less than the size of the LHS.
           // The only option is to discard denominator fraction bits
           // 
-          if ((oprnd_frmt[1].I + oprnd_frmt[2].F) >= oprnd_frmt[0].size) {
-            int shift = oprnd_frmt[0].size - oprnd_frmt[1].I + 1;
+          if ((oprnd_frmt[1].I + oprnd_frmt[2].F) >= result_frmt.size) {
+            int shift = result_frmt.size - oprnd_frmt[1].I + 1;
             if ((shift > 0) & (shift <= oprnd_frmt[2].F)) {
               shift_right(oprnd_frmt, oprnd_tree, 2, shift);
             } else {
@@ -1047,7 +1234,7 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
                 result_frmt.I + result_frmt.F + result_frmt.E -
                 ceil_log2_range(result_frmt);
             extraI = MIN(result_frmt.I, extraI);
-            fprintf(stderr, "  %d I bits changed to S bits\n", extraI);
+            FXLOG(2, "  %d I bits changed to S bits\n", extraI);
             result_frmt.S += extraI;
             result_frmt.I -= extraI;
           }                       // axioms are pessimistic
@@ -1056,8 +1243,8 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
           // If so, convert an I bit to an S bit for greater range
           //
           if (max_is_mnn(result_frmt)) {
-            fprintf(stderr,
-                    "  *** 1 S bit changed to I to prevent MNN *** \n");
+            FXLOG(2,
+                  "  *** 1 S bit changed to I to prevent MNN *** \n");
             result_frmt.S -= 1;
             result_frmt.I += 1;
           }
@@ -1069,3 +1256,266 @@ struct SIF division(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
   check_range(result_frmt);
   return result_frmt;
 }
+
+/**
+ * @brief Predicate for a variable that is a wide accumulator.
+ *
+ * @param[in] var gcc tree for a variable declaration or an SSA name
+ * @return    true if the variable was marked by mark_accumulators()
+ */
+bool is_accumulator(tree var)
+{
+  if (TREE_CODE(var) == SSA_NAME)
+    var = SSA_NAME_VAR(var);
+  return DECL_P(var) &&
+      (lookup_attribute("fxacc", DECL_ATTRIBUTES(var)) != NULL_TREE);
+}
+
+/**
+ * @brief Predicate for a statement that extends a sum-of-products chain.
+ *
+ * @details A product always starts a chain. A sum or difference extends a
+ * chain if either of its operands is already part of one.
+ *
+ * @param[in] stmt  a GIMPLE assignment statement
+ * @param[in] chain bitmap of the UIDs of the variables already in a chain
+ * @return    true if the result belongs to a chain
+ */
+static bool extends_chain(gimple stmt, bitmap chain)
+{
+  enum tree_code code = gimple_assign_rhs_code(stmt);
+  int i;
+
+  if (code == MULT_EXPR)
+    return true;
+  if ((code != PLUS_EXPR) && (code != MINUS_EXPR))
+    return false;
+  for (i = 1; i < 3; i++) {
+    tree op = gimple_op(stmt, i);
+    if ((TREE_CODE(op) == SSA_NAME) &&
+        bitmap_bit_p(chain, DECL_UID(SSA_NAME_VAR(op))))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Predicate for a definition of a running sum.
+ *
+ * @details A running sum starts with a copy of a constant or another value,
+ * and is then only added to. It is never a product, since the product of a
+ * wide sum would not fit.
+ *
+ * @param[in] stmt  an assignment to the running sum
+ * @param[in] chain bitmap of the DECL_UIDs of the accumulators found so far
+ * @return    true if the statement starts or extends the sum
+ */
+static bool extends_running_sum(gimple stmt, bitmap chain)
+{
+  if (gimple_assign_single_p(stmt))
+    return (TREE_CODE(gimple_assign_rhs1(stmt)) == REAL_CST) ||
+        (TREE_CODE(gimple_assign_rhs1(stmt)) == SSA_NAME);
+  return (gimple_assign_rhs_code(stmt) != MULT_EXPR) &&
+      extends_chain(stmt, chain);
+}
+
+/**
+ * @brief Find the local variables that may be kept as wide running sums.
+ *
+ * @details A running sum is a local real variable that is carried around a
+ * loop, is assigned a sum somewhere, has no format or size attribute, and
+ * whose address is not taken. Every PHI node of the variable must merge only
+ * values of the variable itself, so that all of them can be made wide
+ * together.
+ *
+ * @param[out] sums bitmap of the DECL_UIDs of the variables
+ */
+static void find_running_sums(bitmap sums)
+{
+  bitmap carried = BITMAP_ALLOC(NULL);
+  bitmap added = BITMAP_ALLOC(NULL);
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  tree var;
+  referenced_var_iterator rvi;
+  unsigned i;
+
+  find_loop_carried(carried);
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple stmt = gsi_stmt(gsi);
+      if (is_gimple_assign(stmt) &&
+          (TREE_CODE(gimple_assign_lhs(stmt)) == SSA_NAME) &&
+          ((gimple_assign_rhs_code(stmt) == PLUS_EXPR) ||
+           (gimple_assign_rhs_code(stmt) == MINUS_EXPR)))
+        bitmap_set_bit(added,
+                       DECL_UID(SSA_NAME_VAR(gimple_assign_lhs(stmt))));
+    }
+  }
+  bitmap_and_into(carried, added);
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    if ((TREE_CODE(var) == VAR_DECL) && bitmap_bit_p(carried, DECL_UID(var)) &&
+        !is_global_var(var) && is_gimple_reg(var) &&
+        !TREE_THIS_VOLATILE(var) &&
+        (lookup_attribute("fxfrmt", DECL_ATTRIBUTES(var)) == NULL_TREE) &&
+        (lookup_attribute("fxiter", DECL_ATTRIBUTES(var)) == NULL_TREE))
+      bitmap_set_bit(sums, DECL_UID(var));
+  }
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_phis(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      gimple phi = gsi_stmt(gsi);
+      var = SSA_NAME_VAR(gimple_phi_result(phi));
+      for (i = 0; i < gimple_phi_num_args(phi); i++) {
+        tree arg = gimple_phi_arg_def(phi, i);
+        if ((TREE_CODE(arg) != SSA_NAME) || (SSA_NAME_VAR(arg) != var))
+          bitmap_clear_bit(sums, DECL_UID(var));
+      }
+    }
+  }
+  BITMAP_FREE(carried);
+  BITMAP_FREE(added);
+}
+
+/**
+ * @brief Find the temporaries of sum-of-products chains and make them wide.
+ *
+ * @details In a chain such as
+ * @code
+ * D.2021_74 = c1 * x0_38;
+ * D.2023_76 = c2 * x1_40;
+ * D.2024_77 = D.2021_74 + D.2023_76;
+ * y_78 = D.2024_77 + D.2026_79;
+ * @endcode
+ * every product and partial sum would normally be narrowed, with a shift and
+ * usually a rounding, before it is added to the next term. Instead, the
+ * compiler temporaries that hold the products and partial sums are given
+ * twice the usual number of bits. The products are then exact, the terms are
+ * aligned in the wide accumulator, and the result is shifted and rounded only
+ * once, when the final sum is stored in a narrow variable.
+ *
+ * A temporary is an accumulator if every use is as an operand of an addition
+ * or subtraction, and every definition is a product or a sum that has an
+ * accumulator operand. A running sum in a loop, such as
+ * @code
+ * # sum_1 = PHI <sum_3(2), sum_7(4)>
+ * D.2031_6 = D.2029_4 * D.2030_5;
+ * sum_7 = D.2031_6 + sum_1;
+ * ...
+ * D.2032_8 = sum_1;
+ * @endcode
+ * is an accumulator too when it is found by find_running_sums(), every
+ * definition starts or adds to the sum, and every use outside the sum is a
+ * copy to a register, where the sum is narrowed. The accumulators get an
+ * fxword attribute with their size, and an fxacc attribute to mark them.
+ */
+void mark_accumulators()
+{
+  bitmap used_elsewhere = BITMAP_ALLOC(NULL);
+  bitmap chain = BITMAP_ALLOC(NULL);
+  bitmap bad_def = BITMAP_ALLOC(NULL);
+  bitmap sums = BITMAP_ALLOC(NULL);
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  gimple stmt;
+  ssa_op_iter iter;
+  tree op, var;
+  referenced_var_iterator rvi;
+  bool changed;
+  unsigned i;
+
+  //
+  // Find the variables that are used anywhere except as an operand of an
+  // addition or subtraction, including as a PHI argument. A running sum may
+  // also be merged by its own PHI nodes, and copied to a register.
+  //
+  find_running_sums(sums);
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_phis(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      stmt = gsi_stmt(gsi);
+      if (bitmap_bit_p(sums, DECL_UID(SSA_NAME_VAR(gimple_phi_result(stmt)))))
+        continue;
+      for (i = 0; i < gimple_phi_num_args(stmt); i++) {
+        op = gimple_phi_arg_def(stmt, i);
+        if (TREE_CODE(op) == SSA_NAME)
+          bitmap_set_bit(used_elsewhere, DECL_UID(SSA_NAME_VAR(op)));
+      }
+    }
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      stmt = gsi_stmt(gsi);
+      if (is_gimple_assign(stmt) &&
+          ((gimple_assign_rhs_code(stmt) == PLUS_EXPR) ||
+           (gimple_assign_rhs_code(stmt) == MINUS_EXPR)))
+        continue;
+      if (gimple_assign_copy_p(stmt) &&
+          (TREE_CODE(gimple_assign_lhs(stmt)) == SSA_NAME) &&
+          (TREE_CODE(gimple_assign_rhs1(stmt)) == SSA_NAME) &&
+          bitmap_bit_p(sums,
+                       DECL_UID(SSA_NAME_VAR(gimple_assign_rhs1(stmt)))))
+        continue;
+      FOR_EACH_SSA_TREE_OPERAND(op, stmt, iter, SSA_OP_USE)
+          bitmap_set_bit(used_elsewhere, DECL_UID(SSA_NAME_VAR(op)));
+    }
+  }
+  //
+  // Grow the chains until no more temporaries can be added. A temporary is
+  // only added when all of its definitions extend a chain.
+  //
+  do {
+    changed = false;
+    bitmap_clear(bad_def);
+    FOR_EACH_BB(bb) {
+      for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+        stmt = gsi_stmt(gsi);
+        if (!is_gimple_assign(stmt) ||
+            (TREE_CODE(gimple_assign_lhs(stmt)) != SSA_NAME))
+          continue;
+        var = SSA_NAME_VAR(gimple_assign_lhs(stmt));
+        if (bitmap_bit_p(sums, DECL_UID(var)) ?
+            !extends_running_sum(stmt, chain) : !extends_chain(stmt, chain))
+          bitmap_set_bit(bad_def, DECL_UID(var));
+      }
+    }
+    FOR_EACH_BB(bb) {
+      for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+        stmt = gsi_stmt(gsi);
+        if (!is_gimple_assign(stmt) ||
+            (TREE_CODE(gimple_assign_lhs(stmt)) != SSA_NAME))
+          continue;
+        var = SSA_NAME_VAR(gimple_assign_lhs(stmt));
+        if ((TREE_CODE(var) == VAR_DECL) &&
+            (DECL_ARTIFICIAL(var) || bitmap_bit_p(sums, DECL_UID(var))) &&
+            !is_global_var(var) &&
+            (TREE_CODE(TREE_TYPE(var)) == REAL_TYPE) &&
+            !bitmap_bit_p(used_elsewhere, DECL_UID(var)) &&
+            !bitmap_bit_p(bad_def, DECL_UID(var)) &&
+            bitmap_set_bit(chain, DECL_UID(var)))
+          changed = true;
+      }
+    }
+  } while (changed);
+  //
+  // Make the accumulators wide, if there is an integer type that is big
+  // enough
+  //
+  FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
+    if ((TREE_CODE(var) != VAR_DECL) || !bitmap_bit_p(chain, DECL_UID(var)) ||
+        is_accumulator(var) ||
+        (lookup_attribute("fxword", DECL_ATTRIBUTES(var)) != NULL_TREE))
+      continue;
+    int size = 2 * var_word_size(var);
+    if ((size > 2 * HOST_BITS_PER_WIDE_INT) ||
+        ((size > (int) TYPE_PRECISION(long_long_integer_type_node)) &&
+         (int128_integer_type_node == NULL_TREE)))
+      continue;
+    FXLOG(2, "  %s is a %d-bit accumulator\n",
+          DECL_NAME(var) ? IDENTIFIER_POINTER(DECL_NAME(var)) : "temp", size);
+    set_word_size(var, size);
+    DECL_ATTRIBUTES(var) = tree_cons(get_identifier("fxacc"), NULL_TREE,
+                                     DECL_ATTRIBUTES(var));
+  }
+
+  BITMAP_FREE(used_elsewhere);
+  BITMAP_FREE(chain);
+  BITMAP_FREE(bad_def);
+  BITMAP_FREE(sums);
+}
@@ -22,37 +22,8 @@
  */
    
 #include "fxopt_plugin.h"
+#include "pointer-set.h"
    
-/**
- * @brief  Sorting function for variable ::SIF definitions.
- *
- * @details The ID values of two ::SIF definitions are compared to determine
- * how the ::SIF definitions are sorted. ::SIF definitions with smaller GIMPLE
- * UID values precede ::SIF definitions with higher UID values. ::SIF definitions
- * with the same UID value are sorted by the array index. ::SIF definitions with
- * the same UID and the same index are sorted by pass number.
- *
- * A negative return value indicates that ::SIF definition <tt>a</tt> should
- * precede ::SIF definition <tt>b</tt>, while a return value greater than zero
- * indicates that ::SIF definition <tt>b</tt> should precede ::SIF definition
- * <tt>a</tt>. This function should never return a value of zero because two
- * ::SIF definitions must never have the same ID value.
- *
- * This function is strictly for cosmetic purposes and is used when printing
- * all of the variables' ::SIF definitions.
- *
- * @param[in] a pointer to ::SIF structure
- * @param[in] b pointer to ::SIF structure
- * @return    comparison result     
- */
-int id_sort(struct SIF *a, struct SIF *b) {
-  if (KEY_TO_UID(a->id) != KEY_TO_UID(b->id))
-    return (KEY_TO_UID(a->id) - KEY_TO_UID(b->id));
-  else if (KEY_TO_IDX(a->id) != KEY_TO_IDX(b->id))
-    return (KEY_TO_IDX(a->id) - KEY_TO_IDX(b->id));
-  else 
-    return (KEY_TO_PASS(a->id) - KEY_TO_PASS(b->id));
-}
 /**
  * @brief Calculate the hash key for the ::SIF formats.
  *
@@ -65,7 +36,7 @@ int id_sort(struct SIF *a, struct SIF *b) {
  * @param[in] index    index value for array elements
  * @return             the calculated unique hash key
  */
-int calc_hash_key(tree var_tree, int pass, int index)
+fxkey_t calc_hash_key(tree var_tree, int pass, int index)
 {
   var_tree = get_operand_decl(var_tree);
   if ((TREE_CODE(var_tree) == VAR_DECL)
@@ -77,7 +48,7 @@ int calc_hash_key(tree var_tree, int pass, int index)
       error("fxopt: Array index is too large or is negative");
     if ((pass >= MAX_PASSES) || (pass < 0))
       error("fxopt: Pass number is too large or is negative");
-    int key = UID_PASS_IDX_TO_KEY(DECL_UID(var_tree),pass,index);
+    fxkey_t key = UID_PASS_IDX_TO_KEY(DECL_UID(var_tree),pass,index);
     return key;
   } else {
     error("fxopt: calc_hash_key parameter not a DECL");
@@ -86,31 +57,405 @@ int calc_hash_key(tree var_tree, int pass, int index)
 }
 
 /**
- * @brief Pointer to the hash table for the variables' ::SIF formats.
+ * @brief Number of ::SIF structures allocated at a time.
+ */
+#define SIF_BLOCK_SIZE 256
+
+/**
+ * @brief A block of ::SIF structures.
+ * @details ::SIF structures are carved out of blocks rather than allocated
+ * one at a time, and all of the blocks are freed together when the function
+ * has been processed.
+ */
+struct SIF_BLOCK {
+  struct SIF_BLOCK *next;          ///< Next block in the chain
+  int used;                        ///< Number of structures handed out
+  struct SIF fmt[SIF_BLOCK_SIZE];  ///< The ::SIF structures
+};
+
+/**
+ * @brief A run of array elements that share one ::SIF format.
+ * @details The run covers elements <tt>lo</tt> through
+ * <tt>lo + fmt->elements - 1</tt>. The <tt>id</tt> of the shared format is
+ * the key of element <tt>lo</tt>.
+ */
+struct FMT_RUN {
+  int lo;            ///< Index of the first element in the run
+  struct SIF *fmt;   ///< The shared format
+};
+
+/**
+ * @brief The ::SIF formats of one variable in one pass.
+ * @details The runs are kept sorted by element index. A scalar has a single
+ * run for the NOT_AN_ARRAY index.
+ */
+struct FMT_PASS {
+  struct FMT_RUN *runs;  ///< Runs of element formats
+  int num_runs;          ///< Number of runs in use
+  int max_runs;          ///< Number of runs allocated
+};
+
+/**
+ * @brief The ::SIF formats of one declared variable.
+ * @details There is one slab for each DECL_UID that has at least one format,
+ * with an entry for each pass up to the highest pass that has been used.
+ */
+struct FMT_SLAB {
+  struct FMT_PASS *pass;  ///< Per-pass formats
+  int passes;             ///< Number of passes allocated
+};
+
+/**
+ * @brief The ::SIF format store of one function.
+ * @details The store is indexed by DECL_UID, and is reached through the
+ * <tt>formats</tt> member of the current ::FXOPT_CONTEXT.
+ */
+struct FMT_STORE {
+  struct FMT_SLAB *slabs;        ///< Per-variable formats, by DECL_UID
+  int num_slabs;                 ///< Number of entries allocated in slabs
+  struct SIF_BLOCK *sif_blocks;  ///< Chain of blocks holding the formats
+  int vars;                      /*!< Counter for number of defined
+                                      variables, just for diagnostics. */
+};
+
+/**
+ * @brief Allocate a ::SIF structure from the current block.
+ * @return pointer to an uninitialized ::SIF structure
+ */
+static struct SIF *alloc_var_format()
+{
+  struct FMT_STORE *store = fxctx->formats;
+  if ((NULL == store->sif_blocks) ||
+      (store->sif_blocks->used == SIF_BLOCK_SIZE)) {
+    struct SIF_BLOCK *block;
+    block = (struct SIF_BLOCK *) xmalloc(sizeof(struct SIF_BLOCK));
+    block->used = 0;
+    block->next = store->sif_blocks;
+    store->sif_blocks = block;
+  }
+  return &(store->sif_blocks->fmt[store->sif_blocks->used++]);
+}
+
+/**
+ * @brief Copy the shared format of a run for a different element.
+ *
+ * @details The new format is a copy of the run's format with a new
+ * <tt>id</tt> and number of elements. Any term of the affine definition that
+ * refers to the run's own <tt>id</tt> is changed to refer to the new one.
+ *
+ * @param[in] run_fmt  the run's shared ::SIF structure
+ * @param[in] var_id   the hash key of the first element of the new format
+ * @param[in] elements number of elements sharing the new format
+ * @return    pointer to the new ::SIF structure
+ */
+static struct SIF *copy_run_format(struct SIF *run_fmt, fxkey_t var_id,
+                                   int elements)
+{
+  struct SIF *s = alloc_var_format();
+
+  *s = *run_fmt;
+  s->id = var_id;
+  s->elements = elements;
+  s->aa = copy_aa_list(run_fmt->aa);
+  rename_aa_var(&s->aa, run_fmt->id, var_id);
+  return s;
+}
+
+/**
+ * @brief Insert a run into the formats of one pass.
+ *
+ * @param[in,out] p   the formats of the pass
+ * @param[in]     pos position of the new run
+ * @param[in]     lo  index of the first element in the run
+ * @param[in]     fmt the run's format
+ */
+static void insert_run(struct FMT_PASS *p, int pos, int lo, struct SIF *fmt)
+{
+  if (p->num_runs == p->max_runs) {
+    p->max_runs = (p->max_runs > 0) ? (2 * p->max_runs) : 4;
+    p->runs = (struct FMT_RUN *) xrealloc(p->runs,
+                                  p->max_runs * sizeof(struct FMT_RUN));
+  }
+  memmove(&(p->runs[pos + 1]), &(p->runs[pos]),
+          (p->num_runs - pos) * sizeof(struct FMT_RUN));
+  p->runs[pos].lo = lo;
+  p->runs[pos].fmt = fmt;
+  p->num_runs++;
+}
+
+/**
+ * @brief How format_slot() may change the format store.
+ */
+enum SLOT_ACCESS {
+  SLOT_READ,     ///< change nothing, an element may get its run's slot
+  SLOT_WRITE,    ///< split a run so that the element has its own slot
+  SLOT_CREATE    ///< as SLOT_WRITE, and allocate a slot that is missing
+};
+
+/**
+ * @brief Find the slot in the format store for a hash key.
+ *
+ * @details Decodes the hash key into its UID, pass and array index and
+ * returns the address of the corresponding entry in the format store. If the
+ * element is part of a run that shares its format with other elements then
+ * a read returns the slot of the whole run, which costs only the search.
+ * A write splits the run so that the element gets a format of its own,
+ * since the caller may modify it.
+ *
+ * With SLOT_CREATE any missing parts of the store are allocated, else NULL
+ * is returned when the slot does not exist. The returned pointer is only
+ * valid until the next call that creates a slot or splits a run.
+ *
+ * @param[in] var_id the calculated unique hash key for the variable
+ * @param[in] access what may be changed to find the slot
+ * @return    pointer to the slot, or NULL
+ */
+static struct SIF **format_slot(fxkey_t var_id, enum SLOT_ACCESS access)
+{
+  int create = (SLOT_CREATE == access);
+  struct FMT_STORE *store = fxctx->formats;
+  int uid = KEY_TO_UID(var_id);
+  int pass = KEY_TO_PASS(var_id);
+  int idx = KEY_TO_IDX(var_id);
+  struct FMT_SLAB *slab;
+  struct FMT_PASS *p;
+  int lo, hi, mid;
+
+  COUNT_STAT(lookups);
+  if (uid >= store->num_slabs) {
+    if (!create)
+      return NULL;
+    int n = (store->num_slabs > 0) ? store->num_slabs : 64;
+    while (n <= uid)
+      n *= 2;
+    store->slabs = (struct FMT_SLAB *) xrealloc(store->slabs,
+                                                n * sizeof(struct FMT_SLAB));
+    memset(store->slabs + store->num_slabs, 0,
+           (n - store->num_slabs) * sizeof(struct FMT_SLAB));
+    store->num_slabs = n;
+  }
+  slab = &(store->slabs[uid]);
+  if (pass >= slab->passes) {
+    if (!create)
+      return NULL;
+    slab->pass = (struct FMT_PASS *) xrealloc(slab->pass,
+                                     (pass + 1) * sizeof(struct FMT_PASS));
+    memset(slab->pass + slab->passes, 0,
+           (pass + 1 - slab->passes) * sizeof(struct FMT_PASS));
+    slab->passes = pass + 1;
+  }
+  p = &(slab->pass[pass]);
+  //
+  // Binary search for the last run that starts at or below the index
+  //
+  lo = 0;
+  hi = p->num_runs;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (p->runs[mid].lo <= idx)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo > 0) {
+    struct FMT_RUN *run = &(p->runs[lo - 1]);
+    if (NULL == run->fmt) {   // a deleted format
+      if (run->lo == idx)
+        return create ? &(run->fmt) : NULL;
+    } else if (idx < run->lo + run->fmt->elements) {
+      int elements = run->fmt->elements;
+      if ((elements == 1) || (SLOT_READ == access))
+        return &(run->fmt);
+      //
+      // Split the run around the element
+      //
+      struct SIF *run_fmt = run->fmt;
+      int run_lo = run->lo;
+      int pos = lo - 1;
+      if (idx + 1 < run_lo + elements)
+        insert_run(p, pos + 1, idx + 1,
+                   copy_run_format(run_fmt, var_id + 1,
+                                   run_lo + elements - idx - 1));
+      if (idx > run_lo) {
+        run_fmt->elements = idx - run_lo;
+        insert_run(p, pos + 1, idx, copy_run_format(run_fmt, var_id, 1));
+        pos++;
+      } else {
+        run_fmt->elements = 1;
+      }
+      return &(p->runs[pos].fmt);
+    }
+  }
+  if (!create)
+    return NULL;
+  insert_run(p, lo, idx, NULL);
+  return &(p->runs[lo].fmt);
+}
+
+/**
+ * @brief Find the first ::SIF format at or after a hash key.
+ *
+ * @details The store is ordered by UID, then pass number, then array index,
+ * which is the numerical order of the hash keys. A run of elements that share
+ * one format is returned once; its <tt>elements</tt> count tells how many
+ * elements it covers. The shared format must not be modified through this
+ * pointer unless the change applies to every element of the run.
+ *
+ * @param[in] var_id the hash key to start from
+ * @return    pointer to the ::SIF struct, or NULL if there are no more
  */
-struct SIF *var_formats = NULL;
+struct SIF *seek_var_format(fxkey_t var_id)
+{
+  struct FMT_STORE *store = fxctx->formats;
+  int uid = KEY_TO_UID(var_id);
+  int pass = KEY_TO_PASS(var_id);
+  int idx = KEY_TO_IDX(var_id);
+  int lo, hi, mid;
+
+  for (; uid < store->num_slabs; uid++, pass = 0, idx = 0) {
+    struct FMT_SLAB *slab = &(store->slabs[uid]);
+    for (; pass < slab->passes; pass++, idx = 0) {
+      struct FMT_PASS *p = &(slab->pass[pass]);
+      //
+      // Binary search for the first run that starts above the index, the
+      // run before it may still cover the index
+      //
+      lo = 0;
+      hi = p->num_runs;
+      while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (p->runs[mid].lo <= idx)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      if ((lo > 0) && (NULL != p->runs[lo - 1].fmt) &&
+          (idx < p->runs[lo - 1].lo + p->runs[lo - 1].fmt->elements))
+        lo--;
+      for (; lo < p->num_runs; lo++) {
+        if (NULL != p->runs[lo].fmt)
+          return p->runs[lo].fmt;
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Get the first ::SIF format in the store.
+ * @return pointer to the ::SIF struct, or NULL if the store is empty
+ */
+struct SIF *first_var_format()
+{
+  return seek_var_format(0);
+}
+
+/**
+ * @brief Get the ::SIF format that follows another in the store.
+ * @details See seek_var_format() for the order of the formats.
+ *
+ * @param[in] s pointer to the current ::SIF structure
+ * @return    pointer to the next ::SIF struct, or NULL if there are no more
+ */
+struct SIF *next_var_format(struct SIF *s)
+{
+  return seek_var_format(s->id + s->elements);
+}
+
+/**
+ * @brief Predicate for array element formats that can share one record.
+ * @details Two formats can be merged into a run if they are identical apart
+ * from their <tt>id</tt>, and their affine definitions are identical apart
+ * from a term that refers to the element itself.
+ *
+ * @param[in] a pointer to ::SIF structure
+ * @param[in] b pointer to ::SIF structure
+ * @return    true if the formats can share one record
+ */
+static int same_run_format(struct SIF *a, struct SIF *b)
+{
+  struct AA *aa_a, *aa_b;
+
+  if ((a->S != b->S) || (a->I != b->I) || (a->F != b->F) || (a->E != b->E) ||
+      (a->originalF != b->originalF) || (a->size != b->size) ||
+      (a->shift != b->shift) || (a->ptr_op != b->ptr_op) ||
+      (a->sgnd != b->sgnd) || (a->iv != b->iv) || (a->iter != b->iter) ||
+      (a->alias != 0) || (b->alias != 0) ||
+      (a->has_attribute != b->has_attribute) ||
+      (a->attrS != b->attrS) || (a->attrI != b->attrI) ||
+      (a->attrF != b->attrF) || (a->attrE != b->attrE) ||
+      !double_int_equal_p(a->max, b->max) ||
+      !double_int_equal_p(a->min, b->min) ||
+      !double_int_equal_p(a->attrmax, b->attrmax) ||
+      !double_int_equal_p(a->attrmin, b->attrmin) || (a->noise != b->noise))
+    return 0;
+  for (aa_a = a->aa, aa_b = b->aa; (aa_a != NULL) && (aa_b != NULL);
+       aa_a = aa_a->next, aa_b = aa_b->next) {
+    if ((aa_a->bp != aa_b->bp) ||
+        !double_int_equal_p(aa_a->coeff, aa_b->coeff))
+      return 0;
+    if ((aa_a->id != aa_b->id) &&
+        ((aa_a->id != a->id) || (aa_b->id != b->id)))
+      return 0;
+  }
+  return (aa_a == NULL) && (aa_b == NULL);
+}
+
 /**
- * @brief Counter for number of defined variables, just for diagnostics.
+ * @brief Merge adjacent array elements that have the same format.
+ *
+ * @details Consecutive elements of an array whose formats differ only in
+ * their identity are merged into a single run, so that a large table with a
+ * uniform format costs one record. The format of a single element is split
+ * out again by format_slot() whenever it is changed.
  */
-static int vars = 0;
+void compact_var_formats()
+{
+  struct FMT_STORE *store = fxctx->formats;
+  int uid, pass, i, j;
+
+  for (uid = 0; uid < store->num_slabs; uid++) {
+    struct FMT_SLAB *slab = &(store->slabs[uid]);
+    for (pass = 0; pass < slab->passes; pass++) {
+      struct FMT_PASS *p = &(slab->pass[pass]);
+      if (p->num_runs < 2)
+        continue;
+      for (i = 0, j = 1; j < p->num_runs; j++) {
+        struct FMT_RUN *run = &(p->runs[i]);
+        struct FMT_RUN *next = &(p->runs[j]);
+        if ((NULL != run->fmt) && (NULL != next->fmt) &&
+            (next->lo == run->lo + run->fmt->elements) &&
+            (next->lo + next->fmt->elements - 1 < NOT_AN_ARRAY) &&
+            same_run_format(run->fmt, next->fmt)) {
+          run->fmt->elements += next->fmt->elements;
+          delete_aa_list(&(next->fmt->aa));
+          next->fmt->id = 0xbad;
+        } else {
+          p->runs[++i] = *next;
+        }
+      }
+      p->num_runs = i + 1;
+    }
+  }
+}
 
 /**
- * @brief Add a new variable to the ::SIF format hash.
+ * @brief Add a new variable to the ::SIF format store.
  * 
- * @details Given the hash key for a variable, create a new hash table entry
+ * @details Given the hash key for a variable, create a new store entry
  * for the variable and initialize the structure elements.
  * 
  * @param[in] var_id the calculated unique hash key for the variable
  */
-void add_var_format(int var_id)
+void add_var_format(fxkey_t var_id)
 {
   struct SIF *s;
   int uid = KEY_TO_UID(var_id);
   if (uid == 0)
     return; // an affine error term, not a real variable
 
-  vars++;
-  s = (struct SIF *) xmalloc(sizeof(struct SIF));
+  fxctx->formats->vars++;
+  s = alloc_var_format();
   initialize_format(s);
   s->id = var_id;
   //
@@ -118,10 +463,9 @@ void add_var_format(int var_id)
   // pass count is 0 and the array index is ignored. If found, copy the
   // format information from that variable's format.
   //
-  int declid = UID_IDX_TO_KEY(uid, NOT_AN_ARRAY);
+  fxkey_t declid = UID_IDX_TO_KEY(uid, NOT_AN_ARRAY);
   if (var_id != declid) {
-    struct SIF *declfmt;
-    HASH_FIND_INT(var_formats, &declid, declfmt);
+    const struct SIF *declfmt = get_format_ptr(declid);
     if (NULL != declfmt) {
       s->size = declfmt->size;
       s->sgnd = declfmt->sgnd;
@@ -137,73 +481,203 @@ void add_var_format(int var_id)
       s->iter = declfmt->iter;
     }
   }
-  HASH_ADD_INT(var_formats, id, s);
+  *format_slot(var_id, SLOT_CREATE) = s;
+}
+
+/**
+ * @brief Add a run of array elements with one shared format to the store.
+ *
+ * @details The new ::SIF structure is initialized and covers
+ * <tt>elements</tt> consecutive elements starting at the one in
+ * <tt>var_id</tt>. None of those elements may already have a format.
+ *
+ * @param[in] var_id   hash key of the first element in the run
+ * @param[in] elements number of elements that share the format
+ * @return    pointer to the new ::SIF structure
+ */
+struct SIF *add_run_format(fxkey_t var_id, int elements)
+{
+  struct SIF *s = alloc_var_format();
+
+  initialize_format(s);
+  s->id = var_id;
+  s->elements = elements;
+  *format_slot(var_id, SLOT_CREATE) = s;
+  return s;
 }
 
 
 /**
- * @brief Get a pointer to a ::SIF, given its hash key.
+ * @brief Get a pointer to a ::SIF, given its hash key, for reading.
  *
- * @details Given a variable ID, look for the hash table entry (::SIF struct)
+ * @details Given a variable ID, look for the store entry (::SIF struct)
  * for that variable. If found, return a pointer to the ::SIF. Else, return
- * NULL.
+ * NULL. For an element of a run of array elements the shared format of the
+ * run is returned, whose <tt>id</tt> is the key of the run's first element;
+ * element_format() gives the element's own view of it.
  *  
  * @param[in] var_id variable ID (hash key) of interest
  * @return    pointer to the ::SIF struct for the variable
  */
-struct SIF *get_format_ptr(int var_id)
+const struct SIF *get_format_ptr(fxkey_t var_id)
 {
-  struct SIF *s;
-  HASH_FIND_INT(var_formats, &var_id, s);
+  struct SIF **slot = format_slot(var_id, SLOT_READ);
+  return (NULL == slot) ? NULL : *slot;
+}
+
+/**
+ * @brief Get a pointer to a ::SIF, given its hash key, for changing it.
+ *
+ * @details Like get_format_ptr(), except that an element of a run of array
+ * elements is first given a format of its own.
+ *
+ * @param[in] var_id variable ID (hash key) of interest
+ * @return    pointer to the ::SIF struct for the variable, or NULL
+ */
+struct SIF *edit_var_format(fxkey_t var_id)
+{
+  struct SIF **slot = format_slot(var_id, SLOT_WRITE);
+  return (NULL == slot) ? NULL : *slot;
+}
+
+/**
+ * @brief The format of one element of a run, as if it were stored alone.
+ *
+ * @details The copy has the element's <tt>id</tt>, and a term of the affine
+ * definition that refers to the run's own <tt>id</tt> is changed to refer to
+ * the element. A format that is not a run is copied unchanged.
+ *
+ * @param[in] run_fmt the shared ::SIF structure, from get_format_ptr()
+ * @param[in] index   array index of the element
+ * @return    ::SIF structure of the element
+ */
+struct SIF element_format(const struct SIF *run_fmt, int index)
+{
+  struct SIF s = *run_fmt;
+
+  if (run_fmt->elements == 1)
+    return s;
+  s.id = UID_PASS_IDX_TO_KEY(KEY_TO_UID(run_fmt->id),
+                             KEY_TO_PASS(run_fmt->id), index);
+  s.elements = 1;
+  if ((s.id != run_fmt->id) && search_aa_var(run_fmt->aa, run_fmt->id)) {
+    s.aa = copy_aa_list(run_fmt->aa);
+    rename_aa_var(&s.aa, run_fmt->id, s.id);
+  }
   return s;
 }
 
 /**
  * @brief Find/create a pointer to a ::SIF, given its hash key.
  *
- * @details Given a variable ID, look for the hash table entry (::SIF struct)
+ * @details Given a variable ID, look for the store entry (::SIF struct)
  * for that variable. If found, return a pointer to the ::SIF. Else, create a
- * new ::SIF struct entry and return a pointer to it.
+ * new ::SIF struct entry and return a pointer to it. An element of a run of
+ * array elements is given a format of its own, since the caller may change
+ * it.
  *
  * @param[in] var_id variable ID (hash key) of interest
  * @return    pointer to the ::SIF struct for the variable
  */
-struct SIF *find_var_format(int var_id)
+struct SIF *find_var_format(fxkey_t var_id)
 {
-  struct SIF *s;
-  HASH_FIND_INT(var_formats, &var_id, s);
+  struct SIF *s = edit_var_format(var_id);
   if (NULL == s) {
     add_var_format(var_id);
-    HASH_FIND_INT(var_formats, &var_id, s);
+    s = edit_var_format(var_id);
   }
   return s;
 }
 
 /**
  * @brief Delete the ::SIF definition for a variable.
- * @details Removes the ::SIF struct from the <tt>var_formats</tt> hash table,
- * deletes the linked list for its affine definition, and frees the memory
- * that was allocated for those structures.
+ * @details Removes the ::SIF struct, or the run of array elements that share
+ * it, from the format store and deletes the
+ * linked list for its affine definition. The memory for the ::SIF struct is
+ * reclaimed by delete_all_formats().
  *
  * @param[in] var_format pointer to ::SIF structure
  */
 void delete_var_format(struct SIF *var_format)
 {
+  struct FMT_STORE *store = fxctx->formats;
+  int uid = KEY_TO_UID(var_format->id);
+  int pass = KEY_TO_PASS(var_format->id);
+  int i;
+
   delete_aa_list(&(var_format->aa));
-  HASH_DEL(var_formats, var_format);
-  free(var_format);
+  //
+  // Look for the run by its format, so that a run of elements sharing the
+  // format is removed as a whole rather than split
+  //
+  if ((uid < store->num_slabs) && (pass < store->slabs[uid].passes)) {
+    struct FMT_PASS *p = &(store->slabs[uid].pass[pass]);
+    for (i = 0; i < p->num_runs; i++) {
+      if (p->runs[i].fmt == var_format) {
+        p->runs[i].fmt = NULL;
+        break;
+      }
+    }
+  }
+  var_format->id = 0xbad;
 }
 
 /**
  * @brief Deletes all variable data structures.
- * @details Removes the ::SIF and ::AA structures for all variables.
+ * @details Frees the whole format store for the function, the blocks
+ * holding all of the ::SIF structures, and all of the ::AA terms at once.
  */
 void delete_all_formats()
 {
-  struct SIF *current_var_format, *tmp;
-  HASH_ITER(hh, var_formats, current_var_format, tmp) {
-    delete_var_format(current_var_format);
+  struct FMT_STORE *store = fxctx->formats;
+  int uid, pass;
+  for (uid = 0; uid < store->num_slabs; uid++) {
+    for (pass = 0; pass < store->slabs[uid].passes; pass++)
+      free(store->slabs[uid].pass[pass].runs);
+    free(store->slabs[uid].pass);
   }
+  free(store->slabs);
+  store->slabs = NULL;
+  store->num_slabs = 0;
+  while (NULL != store->sif_blocks) {
+    struct SIF_BLOCK *block = store->sif_blocks->next;
+    free(store->sif_blocks);
+    store->sif_blocks = block;
+  }
+  delete_all_aa();
+}
+
+/**
+ * @brief Start the analysis of a function.
+ * @details The context is cleared and given an empty format store, and is
+ * made the current context for all of the analysis functions.
+ *
+ * @param[out] ctx the context for the function
+ */
+void begin_fxopt_context(struct FXOPT_CONTEXT *ctx)
+{
+  ctx->fxpass = 0;
+  ctx->lastpass = 0;
+  ctx->next_error_id = 1;
+  ctx->formats = (struct FMT_STORE *) xcalloc(1, sizeof(struct FMT_STORE));
+  ctx->arenas = new_aa_arenas();
+  ctx->revisits = NULL;
+  fxctx = ctx;
+}
+
+/**
+ * @brief Finish the analysis of a function.
+ * @details All of the formats of the current context are deleted and there
+ * is no longer a current context.
+ */
+void end_fxopt_context()
+{
+  delete_all_formats();
+  free(fxctx->formats);
+  fxctx->formats = NULL;
+  free(fxctx->arenas);
+  fxctx->arenas = NULL;
+  fxctx = NULL;
 }
 
 /**
@@ -224,13 +698,14 @@ void initialize_format(struct SIF *s)
   s->min = double_int_one;
   s->has_attribute = s->ptr_op = s->iv = 0;
   s->alias = s->iter = 0;
+  s->elements = 1;
+  s->noise = 0.0;
   s->aa = NULL;
 }
 
 /**
  * @brief Make a copy of a variable specification.
- * @details Everything is copied except the variable's id value and the special
- * fields needed to maintain the hash tree.
+ * @details Everything is copied except the variable's id value.
  *
  * @param[in] src pointer to ::SIF structure
  * @param[in,out] dest pointer to ::SIF structure
@@ -239,7 +714,7 @@ void copy_format(struct SIF *src, struct SIF *dest)
 {
   // DO NOT copy the alias element
   if (dest == src) {
-    fprintf(stderr, "trying to copy a format to itself\n");
+    FXLOG(1, "trying to copy a format to itself\n");
     return;
   }
   dest->S = src->S;
@@ -262,6 +737,7 @@ void copy_format(struct SIF *src, struct SIF *dest)
   dest->ptr_op = src->ptr_op;
   dest->iv = src->iv;
   dest->iter = src->iter;
+  dest->noise = src->noise;
   if (dest->aa != src->aa) {
     delete_aa_list(&(dest->aa));
     dest->aa = copy_aa_list(src->aa);
@@ -279,7 +755,7 @@ void copy_format(struct SIF *src, struct SIF *dest)
 void copy_SIF(struct SIF *src, struct SIF *dest)
 {
   if (dest == src) {
-    fprintf(stderr, "trying to copy a SIF to itself\n");
+    FXLOG(1, "trying to copy a SIF to itself\n");
     return;
   }
   dest->S = src->S;
@@ -289,6 +765,7 @@ void copy_SIF(struct SIF *src, struct SIF *dest)
   dest->max = src->max;
   dest->min = src->min;
   dest->iv = src->iv;
+  dest->noise = src->noise;
   if (dest->aa != src->aa) {
     delete_aa_list(&(dest->aa));
     dest->aa = copy_aa_list(src->aa);
@@ -320,13 +797,13 @@ float real_min(struct SIF *op_fmt)
 }
 
 /**
- * @brief Remove unimportant variables from the ::SIF hash table.
+ * @brief Remove unimportant variables from the ::SIF format store.
  * @details Before printing the fixed-point information about all of the
- * variables we delete the hash table entries for variables that are not
+ * variables we delete the store entries for variables that are not
  * important.
  *
  * This is done by iterating through gcc's list of declared variables, not by
- * iterating through the ::SIF hash table. Information for induction variables
+ * iterating through the ::SIF format store. Information for induction variables
  * is discarded, as is that of any variable where the fixed-point format is
  * undefined. If there is an entry for a version of a variable (meaning that
  * it has an array index and/or a non-zero pass number) then compare the SIF
@@ -344,51 +821,50 @@ void cleanup_formats()
   referenced_var_iterator rvi;
   struct SIF *var_fmt;     //< points to SIF struct for declared variable
   struct SIF *vers_fmt;    //< points to ::SIF struct for a version of variable
-  struct SIF *is_array;    //< a fake pointer, tests for arrays
-  int i, j, key, elements;
+  const struct SIF *is_array;   //< a fake pointer, tests for arrays
+  fxkey_t key, next_key;
+  int elements;
 
   FOR_EACH_REFERENCED_VAR(cfun, var, rvi) {
     key = calc_hash_key(var, 0, NOT_AN_ARRAY);
-    HASH_FIND_INT(var_formats, &key, var_fmt);
+    var_fmt = edit_var_format(key);
     if (NULL != var_fmt) {
       key = calc_hash_key(var, 0, 0);
-      HASH_FIND_INT(var_formats, &key, is_array);
+      is_array = get_format_ptr(key);
       if (is_array)
         elements = MAX_ELEMENTS;
       else
         elements = 1;
-      for (i = 0; i < MAX_PASSES; i++) {
-        for (j = 0; j < elements; j++) {
-          key = calc_hash_key(var, i, j);
-          HASH_FIND_INT(var_formats, &key, vers_fmt);
-          if ((NULL != vers_fmt) && (var_fmt != vers_fmt)) {
+      //
+      // Visit every version of the variable that is in the store
+      //
+      for (vers_fmt = seek_var_format(UID_TO_KEY(DECL_UID(var)));
+           (NULL != vers_fmt) && (KEY_TO_UID(vers_fmt->id) == DECL_UID(var));
+           vers_fmt = seek_var_format(next_key)) {
+        next_key = vers_fmt->id + vers_fmt->elements;
+        if (KEY_TO_IDX(vers_fmt->id) < elements) {
+          if (var_fmt != vers_fmt) {
             if ((var_fmt->iv) || (!format_initialized(*vers_fmt))) {
-              delete_aa_list(&(vers_fmt->aa));
-              HASH_DEL(var_formats, vers_fmt);
-              free(vers_fmt);
+              delete_var_format(vers_fmt);
             } else if (format_initialized(*var_fmt)) {
               if ((var_fmt->S != vers_fmt->S) || (var_fmt->I != vers_fmt->I) ||
                   (var_fmt->F != vers_fmt->F) || (var_fmt->E != vers_fmt->E)) {
                 var_fmt->iv = 1;        // use iv as a "don't print" flag
                 if (!var_fmt->has_attribute) {
-                  delete_aa_list(&(vers_fmt->aa));
-                  HASH_DEL(var_formats, vers_fmt);
-                  free(vers_fmt);
+                  delete_var_format(vers_fmt);
                 }
               } else {
-                delete_aa_list(&(vers_fmt->aa));
-                HASH_DEL(var_formats, vers_fmt);
-                free(vers_fmt);
+                delete_var_format(vers_fmt);
               }
             } else {
               copy_format(vers_fmt, var_fmt);
               // don't delete aa list, shallow copy to var_fmt
-              HASH_DEL(var_formats, vers_fmt);
-              free(vers_fmt);
+              vers_fmt->aa = NULL;
+              delete_var_format(vers_fmt);
             }
           }                     // if vers_fmt is initialized
-        }                       // for each element of var
-      }                         // for each pass through the BB
+        }                       // if an element of var
+      }                         // for each version of var
       if (((var_fmt->iv) || (!format_initialized(*var_fmt)))
           && (!var_fmt->alias)) {
         if (PARM_DECL == TREE_CODE(var)) {
@@ -421,16 +897,14 @@ void cleanup_formats()
                     G_("Inconsistent format of pointer %s"),
                     IDENTIFIER_POINTER(DECL_NAME(var_tree)));
           } else {
-            fprintf(stderr, "Inconsistent format of pointer %c%4u\n",
-                    TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
-                    DECL_UID(var_tree));
+            FXLOG(1, "Inconsistent format of pointer %c%4u\n",
+                  TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
+                  DECL_UID(var_tree));
           }
           var_fmt->S = var_fmt->I = var_fmt->F = var_fmt->iv = 0;
           var_fmt->E = var_fmt->size;
         } else {
-          delete_aa_list(&(var_fmt->aa));
-          HASH_DEL(var_formats, var_fmt);
-          free(var_fmt);
+          delete_var_format(var_fmt);
         }
       }
     }                           // if var_fmt is not NULL
@@ -453,23 +927,25 @@ void force_ptr_consistency()
   struct SIF *s;
   struct SIF *ss;
   double_int max, min, aamax, aamin, x0, x1;
-  int uid, j, bp, key, index;
+  int uid, bp, index;
+  fxkey_t key;
 
-  for (s = var_formats; s != NULL; s = (struct SIF *) (s->hh.next)) {
+  for (s = first_var_format(); s != NULL; s = next_var_format(s)) {
     //
     // Look for aliased variables that were modified in this pass, push
     // the new range information to the target
     //
-    if ((s->alias) && (KEY_TO_PASS(s->id) == fxpass) && (NULL != s->aa)) {
+    if ((s->alias) && (KEY_TO_PASS(s->id) == fxctx->fxpass) &&
+        (NULL != s->aa)) {
       index = KEY_TO_IDX(s->id);
       //
       // Look for the target in this pass
       //
-      key = UID_PASS_IDX_TO_KEY(KEY_TO_UID(s->alias), fxpass, index);
-      ss = get_format_ptr(key);
+      key = UID_PASS_IDX_TO_KEY(KEY_TO_UID(s->alias), fxctx->fxpass, index);
+      ss = edit_var_format(key);
       if (NULL == ss) {
         add_var_format(key);
-        ss = get_format_ptr(key);
+        ss = edit_var_format(key);
         if (ss->has_attribute) {
           ss->S = ss->attrS;
           ss->I = ss->attrI;
@@ -484,7 +960,7 @@ void force_ptr_consistency()
       //
       bp = s->F + s->E;
       if (bp != (ss->F + ss->E))
-        fprintf(stderr, "  Inconsistent binary point locations");
+        FXLOG(1, "  Inconsistent binary point locations");
 
       ss->max = double_int_smax(s->max, ss->max);
       ss->min = double_int_smin(s->min, ss->min);
@@ -496,7 +972,7 @@ void force_ptr_consistency()
       x1 = double_int_rshift(double_int_sub(aamax, aamin), 1,
                              HOST_BITS_PER_DOUBLE_INT, ARITH);
 
-      key = UID_PASS_IDX_TO_KEY(KEY_TO_UID(ss->id), fxpass, index);
+      key = UID_PASS_IDX_TO_KEY(KEY_TO_UID(ss->id), fxctx->fxpass, index);
       delete_aa_list(&(ss->aa));
       if (!double_int_zero_p(x0))
         append_aa_var(&(ss->aa), 0, x0, bp);
@@ -506,31 +982,29 @@ void force_ptr_consistency()
     }                           // found an aliased variable in this pass
   }                             // all formats
 
-  HASH_SORT(var_formats, id_sort);
   uid = 0;
-  for (s = var_formats; s != 0; s = (struct SIF *) (s->hh.next)) {
+  for (s = first_var_format(); s != NULL; s = next_var_format(s)) {
     //
     // If the uid has changed and the saved uid is nonzero then we have
     // been accumulating the min and max for the saved uid. Store them
     // in the formats for every index of that uid in this pass
     //
     if ((0 != uid) && (KEY_TO_UID(s->id) != uid)) {
-      for (j = 0; j < MAX_ELEMENTS; j++) {
-        key = UID_PASS_IDX_TO_KEY(uid, fxpass, j);
-        HASH_FIND_INT(var_formats, &key, ss);
-        if (NULL != ss) {
-          ss->max = max;
-          ss->min = min;
-          x0 = double_int_rshift(double_int_add(aamax, aamin), 1,
-                                 HOST_BITS_PER_DOUBLE_INT, ARITH);
-          x1 = double_int_rshift(double_int_sub(aamax, aamin), 1,
-                                 HOST_BITS_PER_DOUBLE_INT, ARITH);
-          delete_aa_list(&(ss->aa));
-          if (!double_int_zero_p(x0))
-            append_aa_var(&(ss->aa), 0, x0, bp);
-          if (!double_int_zero_p(x1))
-            append_aa_var(&(ss->aa), key, x1, bp);
-        }
+      for (ss = seek_var_format(UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, 0));
+           (NULL != ss) && (KEY_TO_UID(ss->id) == uid) &&
+           (KEY_TO_PASS(ss->id) == fxctx->fxpass); ss = next_var_format(ss)) {
+        key = ss->id;
+        ss->max = max;
+        ss->min = min;
+        x0 = double_int_rshift(double_int_add(aamax, aamin), 1,
+                               HOST_BITS_PER_DOUBLE_INT, ARITH);
+        x1 = double_int_rshift(double_int_sub(aamax, aamin), 1,
+                               HOST_BITS_PER_DOUBLE_INT, ARITH);
+        delete_aa_list(&(ss->aa));
+        if (!double_int_zero_p(x0))
+          append_aa_var(&(ss->aa), 0, x0, bp);
+        if (!double_int_zero_p(x1))
+          append_aa_var(&(ss->aa), key, x1, bp);
       }
       uid = 0;
       max = double_int_zero;
@@ -541,7 +1015,7 @@ void force_ptr_consistency()
     //
     // This variable is a pointer that we've already seen, in this pass
     //
-    if ((KEY_TO_UID(s->id) == uid) && (KEY_TO_PASS(s->id) == fxpass)) {
+    if ((KEY_TO_UID(s->id) == uid) && (KEY_TO_PASS(s->id) == fxctx->fxpass)) {
       if (NOT_AN_ARRAY != KEY_TO_IDX(s->id)) {
         max = double_int_smax(max, s->max);
         min = double_int_smin(min, s->min);
@@ -550,9 +1024,10 @@ void force_ptr_consistency()
       }
       //
       // Look for pointer variables that were modified in this pass
-      // Since the hash is sorted, this must be the lowest index 
+      // Since the store is ordered, this must be the lowest index 
       //
-    } else if ((s->ptr_op) && !(s->alias) && (KEY_TO_PASS(s->id) == fxpass)) {
+    } else if ((s->ptr_op) && !(s->alias) &&
+               (KEY_TO_PASS(s->id) == fxctx->fxpass)) {
       uid = KEY_TO_UID(s->id);
       max = s->max;
       min = s->min;
@@ -564,23 +1039,22 @@ void force_ptr_consistency()
 }
 
 /**
- * @brief Print formats of ::SIF hash table variables used in this pass.
- * @details Sort them by id first, just for cosmetic reasons. Don't print
+ * @brief Print formats of ::SIF store variables used in this pass.
+ * @details The store is ordered by UID and array index. Don't print
  * if the SIF format is undefined.
  */
 void print_var_formats()
 {
   struct SIF *s;
 
-  HASH_SORT(var_formats, id_sort);
-  for (s = var_formats; s != NULL; s = (struct SIF *) (s->hh.next)) {
-    if (format_initialized(*s) && (fxpass == KEY_TO_PASS(s->id)))
+  for (s = first_var_format(); s != NULL; s = next_var_format(s)) {
+    if (format_initialized(*s) && (fxctx->fxpass == KEY_TO_PASS(s->id)))
       print_one_format(s);
   }
 }
 
 /**
- * @brief Print the S, I, F, and E values for one ::SIF hash table entry.
+ * @brief Print the S, I, F, and E values for one ::SIF store entry.
  *
  * @param[in] s pointer to ::SIF structure
  */
@@ -593,31 +1067,33 @@ void print_one_format(struct SIF *s)
   int idx = KEY_TO_IDX(s->id);
   tree var_tree = referenced_var_lookup(cfun, uid);
   if (s->alias != 0) {
-    fprintf(stderr, "//@(%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
+    fprintf(fxlog, "//@(%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
   }
   else if (s->iv) {
-    fprintf(stderr, "// (%2d/%2d/--/--)", s->S, s->I);
+    fprintf(fxlog, "// (%2d/%2d/--/--)", s->S, s->I);
   } else {
-    fprintf(stderr, "// (%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
+    fprintf(fxlog, "// (%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
   }
   if (s->has_attribute != 0)
-    fprintf(stderr, "=");
+    fprintf(fxlog, "=");
   else
-    fprintf(stderr, " ");
+    fprintf(fxlog, " ");
   if (s->ptr_op != 0)
-    fprintf(stderr, "*");
+    fprintf(fxlog, "*");
   else
-    fprintf(stderr, " ");
+    fprintf(fxlog, " ");
   if (DECL_NAME(var_tree)) {
-    fprintf(stderr, "%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
+    fprintf(fxlog, "%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
   } else {
-    fprintf(stderr, "%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
+    fprintf(fxlog, "%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
             DECL_UID(var_tree));
   }
-  if (idx != NOT_AN_ARRAY)
-    fprintf(stderr, "[%2d]", idx);
+  if (s->elements > 1)
+    fprintf(fxlog, "[%2d..%2d]", idx, idx + s->elements - 1);
+  else if (idx != NOT_AN_ARRAY)
+    fprintf(fxlog, "[%2d]", idx);
 
-  fprintf(stderr, "\n");
+  fprintf(fxlog, "\n");
 }
 
 /**
@@ -636,43 +1112,45 @@ void print_one_aa_format(struct SIF *s)
   int pass = KEY_TO_PASS(s->id);
   tree var_tree = referenced_var_lookup(cfun, uid);
   if (s->alias != 0) {
-    fprintf(stderr, "//@(%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
+    fprintf(fxlog, "//@(%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
   }
   else if (s->iv) {
-    fprintf(stderr, "// (%2d/%2d/--/--)", s->S, s->I);
+    fprintf(fxlog, "// (%2d/%2d/--/--)", s->S, s->I);
   } else {
-    fprintf(stderr, "// (%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
+    fprintf(fxlog, "// (%2d/%2d/%2d/%2d)", s->S, s->I, s->F, s->E);
   }
   if (s->has_attribute != 0)
-    fprintf(stderr, "=");
+    fprintf(fxlog, "=");
   else
-    fprintf(stderr, " ");
+    fprintf(fxlog, " ");
   if (s->ptr_op != 0)
-    fprintf(stderr, "*");
+    fprintf(fxlog, "*");
   else
-    fprintf(stderr, " ");
+    fprintf(fxlog, " ");
   if (DECL_NAME(var_tree)) {
-    fprintf(stderr, "%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
+    fprintf(fxlog, "%s", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
   } else {
-    fprintf(stderr, "%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
+    fprintf(fxlog, "%c%4u", TREE_CODE(var_tree) == CONST_DECL ? 'C' : 'D',
             DECL_UID(var_tree));
   }
-  if (idx != NOT_AN_ARRAY)
-    fprintf(stderr, "[%2d]", idx);
+  if (s->elements > 1)
+    fprintf(fxlog, "[%2d..%2d]", idx, idx + s->elements - 1);
+  else if (idx != NOT_AN_ARRAY)
+    fprintf(fxlog, "[%2d]", idx);
 
-  fprintf(stderr, "#%d", pass);
+  fprintf(fxlog, "#%d", pass);
   if ((s->alias != 0) && (s->alias != s->id)) {
     tree var_tree = referenced_var_lookup(cfun, KEY_TO_UID(s->alias));
     if (NULL != var_tree) 
-      fprintf(stderr, "->%s = ", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
+      fprintf(fxlog, "->%s = ", IDENTIFIER_POINTER(DECL_NAME(var_tree)));
     else
-      fprintf(stderr, "->?????? = ");
+      fprintf(fxlog, "->?????? = ");
     print_aa_list(s->aa);
-    fprintf(stderr, "\n");
+    fprintf(fxlog, "\n");
   } else {
-    fprintf(stderr, " = ");
+    fprintf(fxlog, " = ");
     print_aa_list(s->aa);
-    fprintf(stderr, "\n");
+    fprintf(fxlog, "\n");
   }
 }
 
@@ -684,14 +1162,14 @@ void print_one_aa_format(struct SIF *s)
 void print_format(struct SIF op_fmt)
 {
   if (op_fmt.iv)
-    fprintf(stderr, "(%2d/%2d/--/--)", op_fmt.S, op_fmt.I);
+    fprintf(fxlog, "(%2d/%2d/--/--)", op_fmt.S, op_fmt.I);
   else
-    fprintf(stderr, "(%2d/%2d/%2d/%2d)", op_fmt.S, op_fmt.I, op_fmt.F,
+    fprintf(fxlog, "(%2d/%2d/%2d/%2d)", op_fmt.S, op_fmt.I, op_fmt.F,
             op_fmt.E);
   if (op_fmt.sgnd) {
-    fprintf(stderr, "s");
+    fprintf(fxlog, "s");
   } else {
-    fprintf(stderr, "u");
+    fprintf(fxlog, "u");
   }
   print_min_max(op_fmt);
 }
@@ -707,7 +1185,7 @@ void print_format(struct SIF op_fmt)
 void restore_attributes()
 {
   struct SIF *s;
-  for (s = var_formats; s != NULL; s = (struct SIF *) (s->hh.next)) {
+  for (s = first_var_format(); s != NULL; s = next_var_format(s)) {
     if (s->has_attribute != 0) {
       s->S = s->attrS;
       s->I = s->attrI;
@@ -745,7 +1223,7 @@ void restore_attributes()
  */
 void real_expr_to_integer(gimple stmt)
 {
-  if (! lastpass) return;
+  if (! fxctx->lastpass) return;
 
   enum tree_code stmt_rhs_code = gimple_assign_rhs_code(stmt);
   switch (stmt_rhs_code) {
@@ -764,6 +1242,153 @@ void real_expr_to_integer(gimple stmt)
   update_stmt(stmt);
 }
 
+/**
+ * @brief Predicate for a variable that was created by the plugin.
+ *
+ * @param[in] var gcc tree
+ * @return    true if the variable is one of the _fx_ temporaries
+ */
+bool is_fx_temp(tree var)
+{
+  return (TREE_CODE(var) == VAR_DECL) && (DECL_NAME(var) != NULL_TREE) &&
+      !strncmp(IDENTIFIER_POINTER(DECL_NAME(var)), "_fx_", 4);
+}
+
+/**
+ * @brief Find the plugin's temporaries that hold one value.
+ *
+ * @details The _fx_ temporaries are not renamed into SSA form until the pass
+ * finishes, so a temporary only has the same value wherever it is used if it
+ * is a register that is assigned once in the function. The block exponents
+ * of fxblock arrays, for one, are assigned many times.
+ *
+ * @return set of the temporaries, which the caller destroys
+ */
+struct pointer_set_t *single_value_temps()
+{
+  struct pointer_set_t *once = pointer_set_create();
+  struct pointer_set_t *more = pointer_set_create();
+  struct pointer_set_t *single = pointer_set_create();
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      tree lhs = gimple_get_lhs(gsi_stmt(gsi));
+      if (lhs && is_fx_temp(lhs) && pointer_set_insert(once, lhs))
+        pointer_set_insert(more, lhs);
+    }
+  }
+  FOR_EACH_BB(bb) {
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      tree lhs = gimple_get_lhs(gsi_stmt(gsi));
+      if (lhs && is_fx_temp(lhs) && is_gimple_reg(lhs) &&
+          !pointer_set_contains(more, lhs))
+        pointer_set_insert(single, lhs);
+    }
+  }
+  pointer_set_destroy(once);
+  pointer_set_destroy(more);
+  return single;
+}
+
+/**
+ * @brief Find the signed integer type with a given number of bits.
+ *
+ * @details A long is preferred when more than one standard type has the right
+ * size, since that was the type always used before the word size could be
+ * chosen.
+ *
+ * @param[in] bits number of bits in the integer
+ * @return    gcc tree for the integer type
+ */
+tree fxopt_integer_type(int bits)
+{
+  tree candidates[] = { long_integer_type_node, integer_type_node,
+    short_integer_type_node, signed_char_type_node,
+    long_long_integer_type_node, int128_integer_type_node
+  };
+  unsigned i;
+
+  for (i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    if ((candidates[i] != NULL_TREE)
+        && (TYPE_PRECISION(candidates[i]) == (unsigned) bits))
+      return candidates[i];
+  }
+  error("fxopt: there is no %d-bit integer type", bits);
+  return long_integer_type_node;
+}
+
+/**
+ * @brief Find the number of bits in the integer that replaces a floating
+ * variable.
+ *
+ * @details The size is taken from the first of these that is found:
+ *
+ *   - an fxword attribute on the variable
+ *   - an fxword attribute on the function being converted
+ *   - the -fplugin-arg-fxopt-word option
+ *   - the size of a long
+ *
+ * @param[in] var gcc tree for a variable declaration, or NULL_TREE for the
+ *                size used by the current function
+ * @return    number of bits
+ */
+int var_word_size(tree var)
+{
+  tree attr = NULL_TREE;
+
+  if ((var != NULL_TREE) && DECL_P(var))
+    attr = lookup_attribute("fxword", DECL_ATTRIBUTES(var));
+  if ((attr == NULL_TREE) && (current_function_decl != NULL_TREE))
+    attr = lookup_attribute("fxword",
+                            DECL_ATTRIBUTES(current_function_decl));
+  if (attr != NULL_TREE)
+    return TREE_INT_CST_LOW(TREE_VALUE(TREE_VALUE(attr)));
+  if (WORD_SIZE)
+    return WORD_SIZE;
+  return TYPE_PRECISION(long_integer_type_node);
+}
+
+/**
+ * @brief Give a variable an fxword attribute.
+ *
+ * @details Used when the plugin itself chooses the size of a variable. The
+ * new attribute is found before any that the variable already had.
+ *
+ * @param[in,out] var  gcc tree for a variable declaration
+ * @param[in]     bits number of bits
+ */
+void set_word_size(tree var, int bits)
+{
+  tree args = build_tree_list(NULL_TREE,
+                              build_int_cst(integer_type_node, bits));
+
+  DECL_ATTRIBUTES(var) = tree_cons(get_identifier("fxword"), args,
+                                   DECL_ATTRIBUTES(var));
+}
+
+/**
+ * @brief Find the number of bits in an operand after conversion.
+ *
+ * @details Integer operands keep their own size. Floating operands get the
+ * size of the integer that will replace their underlying variable.
+ *
+ * @param[in] operand gcc tree for an operand, or NULL_TREE
+ * @return    number of bits
+ */
+int operand_word_size(tree operand)
+{
+  tree type;
+
+  if ((operand == NULL_TREE) || TREE_CONSTANT(operand))
+    return var_word_size(NULL_TREE);
+  type = get_innermost_type(operand);
+  if (INTEGRAL_TYPE_P(type))
+    return TYPE_PRECISION(type);
+  return var_word_size(get_operand_decl(operand));
+}
+
 /**
  * @brief Convert floating variables to integers.
  * @details This function changes only the type of the variable, not its value.
@@ -780,8 +1405,12 @@ void real_expr_to_integer(gimple stmt)
  *     the size of each array element. The mode, constant, and public
  *     parameters for the array are configured.
  *
- * @note The specific integer type used to replace floating types is defined
- * by REAL_TO_INTEGER_TYPE.
+ *   - If the var is a struct or an array of arrays found by
+ *     find_aggregates(), it gets an integer copy of its type from
+ *     convert_aggregate_to_integer(), since the type may be shared.
+ *
+ * @note The specific integer type used to replace floating types is found
+ * by var_word_size().
  *
  * @param[in, out] var gcc tree for a variable
  */
@@ -789,69 +1418,75 @@ void convert_real_var_to_integer(tree var)
 {
   tree orig_inner_type = get_innermost_type(var);
 
+  if (is_aggregate(var)) {
+    convert_aggregate_to_integer(var);
+    return;
+  }
+
   if (REAL_TYPE == TREE_CODE(orig_inner_type)) {
+    tree int_type = fxopt_integer_type(var_word_size(var));
     int constant = orig_inner_type->base.constant_flag;
     if (TREE_CODE(var) == PARM_DECL) {
-      DECL_ARG_TYPE(var) = REAL_TO_INTEGER_TYPE;
+      DECL_ARG_TYPE(var) = int_type;
     }
     if ((TREE_CODE(var) == VAR_DECL) || (TREE_CODE(var) == PARM_DECL)
         || (TREE_CODE(var) == RESULT_DECL)) {
       if (POINTER_TYPE == TREE_CODE(TREE_TYPE(var))) {
         tree base_var = TREE_TYPE(TREE_TYPE(var));
         if (REAL_TYPE == TREE_CODE(base_var)) {
-          TREE_TYPE(TREE_TYPE(var)) = REAL_TO_INTEGER_TYPE;
+          TREE_TYPE(TREE_TYPE(var)) = int_type;
         } else if (ARRAY_TYPE == TREE_CODE(base_var)) {
           int elements =
               TREE_INT_CST_LOW(TYPE_SIZE(base_var)) /
               TREE_INT_CST_LOW(TYPE_SIZE(orig_inner_type));
           int type_size =
-              elements * TREE_INT_CST_LOW(TYPE_SIZE(REAL_TO_INTEGER_TYPE));
+              elements * TREE_INT_CST_LOW(TYPE_SIZE(int_type));
           int type_size_unit =
               elements *
-              TREE_INT_CST_LOW(TYPE_SIZE_UNIT(REAL_TO_INTEGER_TYPE));
+              TREE_INT_CST_LOW(TYPE_SIZE_UNIT(int_type));
           TYPE_SIZE(base_var) = build_int_cst(integer_type_node, type_size);
           TYPE_SIZE_UNIT(base_var) =
               build_int_cst(integer_type_node, type_size_unit);
           base_var->type.mode = mode_for_size(type_size, MODE_INT, 0);
-          TREE_TYPE(base_var) = REAL_TO_INTEGER_TYPE;
+          TREE_TYPE(base_var) = int_type;
           TREE_TYPE(base_var)->base.constant_flag =
               orig_inner_type->base.constant_flag;
           TREE_TYPE(base_var)->base.public_flag =
               orig_inner_type->base.public_flag;
         } else {
-          fprintf(stderr, " Trying to convert pointer to unknown real DECL.\n");
+          FXLOG(1, " Trying to convert pointer to unknown real DECL.\n");
         }
       } else if (ARRAY_TYPE == TREE_CODE(TREE_TYPE(var))) {
         int elements =
             TREE_INT_CST_LOW(DECL_SIZE(var)) /
             TREE_INT_CST_LOW(TYPE_SIZE(orig_inner_type));
         int decl_size =
-            elements * TREE_INT_CST_LOW(TYPE_SIZE(REAL_TO_INTEGER_TYPE));
+            elements * TREE_INT_CST_LOW(TYPE_SIZE(int_type));
         int decl_size_unit =
             elements *
-            TREE_INT_CST_LOW(TYPE_SIZE_UNIT(REAL_TO_INTEGER_TYPE));
+            TREE_INT_CST_LOW(TYPE_SIZE_UNIT(int_type));
         DECL_SIZE(var) = build_int_cst(integer_type_node, decl_size);
         DECL_SIZE_UNIT(var) =
             build_int_cst(integer_type_node, decl_size_unit);
         DECL_MODE(var) = mode_for_size(decl_size, MODE_INT, 0);
-        TREE_TYPE(TREE_TYPE(var)) = REAL_TO_INTEGER_TYPE;
+        TREE_TYPE(TREE_TYPE(var)) = int_type;
         TREE_TYPE(TREE_TYPE(var))->base.constant_flag =
             orig_inner_type->base.constant_flag;
         TREE_TYPE(TREE_TYPE(var))->base.public_flag =
             orig_inner_type->base.public_flag;
       } else if (TREE_TYPE(var) == orig_inner_type) {
-        DECL_SIZE(var) = TYPE_SIZE(REAL_TO_INTEGER_TYPE);
-        DECL_SIZE_UNIT(var) = TYPE_SIZE_UNIT(REAL_TO_INTEGER_TYPE);
-        DECL_MODE(var) = TYPE_MODE(REAL_TO_INTEGER_TYPE);
-        TREE_TYPE(var) = REAL_TO_INTEGER_TYPE;
+        DECL_SIZE(var) = TYPE_SIZE(int_type);
+        DECL_SIZE_UNIT(var) = TYPE_SIZE_UNIT(int_type);
+        DECL_MODE(var) = TYPE_MODE(int_type);
+        TREE_TYPE(var) = int_type;
         TREE_TYPE(var)->base.constant_flag = constant;
         TREE_TYPE(var)->base.public_flag =
             orig_inner_type->base.public_flag;
       } else {
-        fprintf(stderr, " Trying to convert unknown real DECL.\n");
+        FXLOG(1, " Trying to convert unknown real DECL.\n");
       }
     } else {
-      fprintf(stderr, " Trying to convert unknown real var to integer.\n");
+      FXLOG(1, " Trying to convert unknown real var to integer.\n");
     }
   }
 }
@@ -867,13 +1502,17 @@ void convert_real_func_to_integer(tree decl)
 {
   function_args_iterator args_iter;
   tree *an_arg;
+  tree parm = DECL_ARGUMENTS(decl);
 
   FOREACH_FUNCTION_ARGS_PTR(TREE_TYPE(decl), an_arg, args_iter) {
     if (TREE_CODE(*an_arg) == REAL_TYPE)
-      *an_arg = REAL_TO_INTEGER_TYPE;
+      *an_arg = fxopt_integer_type(var_word_size(parm));
+    if (parm != NULL_TREE)
+      parm = TREE_CHAIN(parm);
   }
   if (SCALAR_FLOAT_TYPE_P(TREE_TYPE(TREE_TYPE(decl)))) {
-    TREE_TYPE(TREE_TYPE(decl)) = REAL_TO_INTEGER_TYPE;
+    TREE_TYPE(TREE_TYPE(decl)) =
+        fxopt_integer_type(var_word_size(DECL_RESULT(decl)));
   }
 }
 
@@ -923,9 +1562,10 @@ void invert_constant_operand(gimple stmt, int opnumber)
  * `real_to_integer` function calls.
  *
  * @param[in] real_const a GIMPLE REAL_VALUE_TYPE
+ * @param[in] size       number of bits in the integer constant
  * @return    ::SIF structure for the constant
  */
-struct SIF get_format_real_value_type(REAL_VALUE_TYPE real_const)
+struct SIF get_format_real_value_type(REAL_VALUE_TYPE real_const, int size)
 {
   REAL_VALUE_TYPE scaled_real, rounded_real;
   HOST_WIDE_INT integer_constant;
@@ -937,7 +1577,7 @@ struct SIF get_format_real_value_type(REAL_VALUE_TYPE real_const)
     op_fmt.I = 1;
   else
     op_fmt.I = MAX(real_exponent(&real_const), 0);
-  op_fmt.size = TREE_INT_CST_LOW(TYPE_SIZE(REAL_TO_INTEGER_TYPE));
+  op_fmt.size = size;
   op_fmt.sgnd = op_fmt.S = 1;
   op_fmt.F = op_fmt.size - op_fmt.S - op_fmt.I;
 
@@ -947,6 +1587,14 @@ struct SIF get_format_real_value_type(REAL_VALUE_TYPE real_const)
   real_ldexp(&scaled_real, &real_const, op_fmt.F);
   real_round(&rounded_real, VOIDmode, &scaled_real);
   integer_constant = real_to_integer(&rounded_real);
+  // 
+  // A constant that had to be rounded carries half an LSB of error, which is
+  // rounding noise at the full precision of the constant.
+  // 
+  if (!real_identical(&rounded_real, &scaled_real)) {
+    double q = ldexp(1.0, -op_fmt.F);
+    op_fmt.noise = q * q / 12.0;
+  }
 
   op_fmt.E = MIN(op_fmt.F, ctz_hwi(integer_constant));
   op_fmt.F -= op_fmt.E;
@@ -971,17 +1619,18 @@ struct SIF get_format_real_value_type(REAL_VALUE_TYPE real_const)
  *
  * @details Also modifies the operand format structure passed as a parameter.
  *
- * @note The type used for the integer constant tree is specified by
- * `REAL_TO_INTEGER_TYPE`.
+ * @note The integer constant tree is a signed integer with `size` bits, which
+ * should be the size of the operation that uses it.
  *
  * @todo This function is sometimes called without using the return value.
  * That's a memory leak that should be eliminated.
  *
  * @param[in] real_cst gcc tree for the real constant
+ * @param[in] size     number of bits in the integer constant
  * @param[in,out] op_fmt_p pointer to ::SIF structure for the operand
  * @return    gcc tree for the integer (fixed-point) constant
  */
-tree convert_real_constant(tree real_cst, struct SIF *op_fmt_p)
+tree convert_real_constant(tree real_cst, int size, struct SIF *op_fmt_p)
 {
   REAL_VALUE_TYPE real_const;
   tree integer_constant;
@@ -989,7 +1638,7 @@ tree convert_real_constant(tree real_cst, struct SIF *op_fmt_p)
   initialize_format(&temp_fmt);
 
   real_const = TREE_REAL_CST(real_cst);
-  temp_fmt = get_format_real_value_type(real_const);
+  temp_fmt = get_format_real_value_type(real_const, size);
   op_fmt_p->S = temp_fmt.S;
   op_fmt_p->I = temp_fmt.I;
   op_fmt_p->F = temp_fmt.F;
@@ -999,12 +1648,172 @@ tree convert_real_constant(tree real_cst, struct SIF *op_fmt_p)
   op_fmt_p->min = temp_fmt.min;
   op_fmt_p->max = temp_fmt.max;
   op_fmt_p->aa = temp_fmt.aa;
+  op_fmt_p->noise = temp_fmt.noise;
 
-  integer_constant = double_int_to_tree(REAL_TO_INTEGER_TYPE,op_fmt_p->max);
+  integer_constant = double_int_to_tree(fxopt_integer_type(size),
+                                        op_fmt_p->max);
 
   return integer_constant;
 }
 
+/**
+ * @brief Convert the real elements of an array's initial value to integers
+ * with one binary point.
+ *
+ * @details Used when all elements of an array share one format. The format
+ * has one sign bit and enough integer bits for the element of largest
+ * magnitude, and its range covers every element. The elements are replaced by
+ * their integer values only if `replace` is true, in the last pass.
+ *
+ * @param[in,out] initial gcc tree for the CONSTRUCTOR of the initial value
+ * @param[in] size        number of bits in each element
+ * @param[in] replace     true to replace the real elements
+ * @param[in,out] op_fmt_p pointer to ::SIF structure for the array
+ */
+void uniform_constructor(tree initial, int size, bool replace,
+                         struct SIF *op_fmt_p)
+{
+  VEC(constructor_elt, gc) * element_vec = CONSTRUCTOR_ELTS(initial);
+  unsigned HOST_WIDE_INT ix;
+  tree field, val;
+  int i_bits = 1;
+  bool first = true;
+
+  FOR_EACH_CONSTRUCTOR_ELT(element_vec, ix, field, val) {
+    if (TREE_CODE(val) == REAL_CST) {
+      struct SIF temp_fmt = get_format_real_value_type(TREE_REAL_CST(val),
+                                                       size);
+      i_bits = MAX(i_bits, temp_fmt.I);
+      delete_aa_list(&(temp_fmt.aa));
+    }
+  }
+  op_fmt_p->sgnd = op_fmt_p->S = 1;
+  op_fmt_p->I = i_bits;
+  op_fmt_p->F = size - op_fmt_p->S - op_fmt_p->I;
+  op_fmt_p->E = 0;
+  op_fmt_p->size = size;
+  op_fmt_p->min = op_fmt_p->max = double_int_zero;
+
+  FOR_EACH_CONSTRUCTOR_ELT(element_vec, ix, field, val) {
+    REAL_VALUE_TYPE scaled_real, rounded_real;
+    double_int element;
+    if (TREE_CODE(val) != REAL_CST)
+      continue;
+    real_ldexp(&scaled_real, &TREE_REAL_CST(val), op_fmt_p->F);
+    real_round(&rounded_real, VOIDmode, &scaled_real);
+    element = shwi_to_double_int(real_to_integer(&rounded_real));
+    if (first) {
+      op_fmt_p->min = op_fmt_p->max = element;
+      first = false;
+    } else {
+      op_fmt_p->max = double_int_smax(op_fmt_p->max, element);
+      op_fmt_p->min = double_int_smin(op_fmt_p->min, element);
+    }
+    if (replace)
+      element_vec->base.vec[ix].value =
+          double_int_to_tree(fxopt_integer_type(size), element);
+  }
+
+  delete_aa_list(&(op_fmt_p->aa));
+  range_to_aa(op_fmt_p, op_fmt_p->id);
+}
+
+/**
+ * @brief Give a format the affine definition of its range.
+ *
+ * @details The definition is the center of the range plus one error term
+ * whose coefficient is half the width of the range, rounded up so that the
+ * definition covers the whole range. Used where a value is known only by its
+ * range, or where its definition would otherwise keep growing. The list that
+ * the format had is not freed, since it may belong to the caller.
+ *
+ * @param[in,out] fmt_p pointer to the format
+ * @param[in]     id    ID of the error term, the variable's own ID for a
+ *                      value that is the same every pass, else a new one
+ */
+void range_to_aa(struct SIF *fmt_p, fxkey_t id)
+{
+  double_int x0 = double_int_rshift(double_int_add(fmt_p->max, fmt_p->min),
+                                    1, HOST_BITS_PER_DOUBLE_INT, ARITH);
+  double_int x1 = double_int_sub(fmt_p->max, x0);
+  int bp = fmt_p->F + fmt_p->E;
+
+  fmt_p->aa = NULL;
+  if (!double_int_zero_p(x0))
+    append_aa_var(&fmt_p->aa, 0, x0, bp);
+  if (!double_int_zero_p(x1))
+    append_aa_var(&fmt_p->aa, id, x1, bp);
+}
+
+/**
+ * @brief Move a bound to a different binary point.
+ *
+ * @param[in] x       the bound
+ * @param[in] from_bp number of bits to the right of the binary point now
+ * @param[in] to_bp   number of bits to the right of the new binary point
+ * @param[in] up      round an upper bound up, else a lower bound down
+ * @return    the bound with the new binary point
+ */
+double_int align_bound(double_int x, int from_bp, int to_bp, bool up)
+{
+  if (to_bp >= from_bp)
+    return double_int_lshift(x, to_bp - from_bp, HOST_BITS_PER_DOUBLE_INT,
+                             ARITH);
+  if (up)
+    x = double_int_add(x, double_int_mask(from_bp - to_bp));
+  return double_int_rshift(x, from_bp - to_bp, HOST_BITS_PER_DOUBLE_INT,
+                           ARITH);
+}
+
+/**
+ * @brief Align the format of a value that is stored to a variable with the
+ * variable's format.
+ *
+ * @details Used where every value stored to a variable should have the same
+ * format, so that the variable's format is not changed by the store. A value
+ * with more fraction bits than the variable is shifted right to the
+ * variable's binary point; the range is rounded outward and the affine
+ * definition is rebuilt from it. A value with fewer fraction bits is not
+ * shifted. Either way its redundant sign bits are counted as integer bits, up
+ * to the integer bits of the variable. The caller makes the shift.
+ *
+ * @param[in,out] value_p pointer to the format of the value
+ * @param[in]     var_frmt format of the variable
+ * @return        number of bits the value must be shifted right, or -1 if the
+ *                variable's format is unknown, is a pointer, or has another
+ *                size
+ */
+int align_store_to_format(struct SIF *value_p, struct SIF var_frmt)
+{
+  if (!format_initialized(var_frmt) || var_frmt.ptr_op ||
+      (var_frmt.size != value_p->size))
+    return -1;
+
+  int bp = value_p->F + value_p->E;
+  int count = bp - (var_frmt.F + var_frmt.E);
+  if (count > 0) {
+    value_p->S += count;
+    if (count <= value_p->E) {
+      value_p->E -= count;
+    } else {
+      value_p->F -= count - value_p->E;
+      value_p->E = 0;
+    }
+    value_p->max = align_bound(value_p->max, bp, bp - count, true);
+    value_p->min = align_bound(value_p->min, bp, bp - count, false);
+    value_p->aa = NULL;
+    if (AFFINE)
+      range_to_aa(value_p, fxctx->next_error_id++);
+  } else {
+    count = 0;
+  }
+  if (value_p->I < var_frmt.I) {
+    value_p->S -= var_frmt.I - value_p->I;
+    value_p->I = var_frmt.I;
+  }
+  return count;
+}
+
 /**
  * @brief Determine the fixed-point format for an integer constant.
  *
@@ -1069,7 +1878,8 @@ struct SIF get_inverted_operand_format(gimple stmt, int op_number)
 
   real_arithmetic(&inv_const, RDIV_EXPR, &dconst1, &real_const);
 
-  op_fmt = get_format_real_value_type(inv_const);
+  op_fmt = get_format_real_value_type(inv_const,
+                                      operand_word_size(gimple_op(stmt, 0)));
 
   return op_fmt;
 }
@@ -1089,6 +1899,8 @@ tree get_innermost_type(tree vardecl)
   while (TREE_TYPE(innertype) != NULL) {
     if (ARRAY_REF == TREE_CODE(innertype) || MEM_REF == TREE_CODE(innertype)) {
       innertype = TREE_OPERAND(innertype, 0);
+    } else if (COMPONENT_REF == TREE_CODE(innertype)) {
+      innertype = TREE_OPERAND(innertype, 1);   // the FIELD_DECL
     } else if (SSA_NAME == TREE_CODE(innertype)) {
       innertype = SSA_NAME_VAR(innertype);
     } else {
@@ -1119,8 +1931,11 @@ tree get_operand_decl(tree operand)
         || (SSA_NAME == TREE_CODE(operand))) {
       var = operand;
     } else if ((ARRAY_REF == TREE_CODE(operand))
+               || (COMPONENT_REF == TREE_CODE(operand))
                || (MEM_REF == TREE_CODE(operand))) {
       var = TREE_OPERAND(operand, 0);
+      while ((ARRAY_REF == TREE_CODE(var)) || (COMPONENT_REF == TREE_CODE(var)))
+        var = TREE_OPERAND(var, 0);
       if (MEM_REF == TREE_CODE(var)) {
         var = TREE_OPERAND(var, 0);
       }
@@ -1141,7 +1956,7 @@ tree get_operand_decl(tree operand)
  *
  * @details Given a statement gimple, an operand number, and possibly the
  * element number for an array, return the ::SIF format for the operand If
- * parameter print is true, pretty print the format to stderr
+ * parameter print is true, pretty print the format to the log
  *
  * @param[in] stmt           gimple statement being processed
  * @param[in] op_number      operand number being retrieved
@@ -1165,12 +1980,17 @@ struct SIF get_operand_format(gimple stmt, int op_number,
 
   if (TREE_CONSTANT(operand)) {
     if (REAL_CST == TREE_CODE(operand)) {
-      if (lastpass) {
-        gimple_set_op(stmt, op_number, convert_real_constant(operand, &op_fmt));
+      //
+      // A real constant gets the size of the statement's result
+      //
+      int size = operand_word_size(gimple_op(stmt, 0));
+      if (fxctx->lastpass) {
+        gimple_set_op(stmt, op_number,
+                      convert_real_constant(operand, size, &op_fmt));
         update_stmt(stmt);
-        print_gimple_stmt(stderr, stmt, 2, 0);
+        FXLOG_STMT(2, stmt);
       } else {
-        convert_real_constant(operand, &op_fmt);
+        convert_real_constant(operand, size, &op_fmt);
       }
     } else if (INTEGER_CST == TREE_CODE(operand)) {
       int_constant_format(operand, &op_fmt);
@@ -1186,6 +2006,11 @@ struct SIF get_operand_format(gimple stmt, int op_number,
       TREE_TYPE(operand) = TREE_TYPE(var);
     } else if (VAR_DECL == TREE_CODE(operand)) {
       var = operand;
+    } else if (is_aggregate_ref(operand)) {
+      // a struct field or an element of a nested array has its own format
+      var = aggregate_leaf(operand, &index);
+      // operand tree must have same type as the converted leaf
+      TREE_TYPE(operand) = inner_type;
     } else if (ARRAY_REF == TREE_CODE(operand)) {
       // find the declaration of the underlying variable
       var = TREE_OPERAND(operand, 0);
@@ -1195,7 +2020,7 @@ struct SIF get_operand_format(gimple stmt, int op_number,
       } else if (SSA_NAME == TREE_CODE(index_var)) {
         index_var = SSA_NAME_VAR(index_var);
         uid = DECL_UID(index_var);
-        struct SIF *idx_fmt = get_format_ptr(
+        struct SIF *idx_fmt = edit_var_format(
             UID_PASS_IDX_TO_KEY(uid,0,NOT_AN_ARRAY));
         index = idx_fmt->shift;
         if (op_number > 0) {
@@ -1218,6 +2043,8 @@ struct SIF get_operand_format(gimple stmt, int op_number,
           error("fxopt: get_operand_format: Error getting array index");
         }
       }
+      if (UNIFORM || is_block_array(var))
+        index = NOT_AN_ARRAY;   // all elements share one format
       if ((VAR_DECL != TREE_CODE(var)) && (PARM_DECL != TREE_CODE(var))) {
         error
             ("fxopt: get_operand_format: Error getting array operand VAR_DECL/PARM_DECL");
@@ -1231,10 +2058,10 @@ struct SIF get_operand_format(gimple stmt, int op_number,
           tree array_tree = TREE_TYPE(TREE_TYPE(var));
           TREE_TYPE(array_tree) = strip_array_types(TREE_TYPE(array_tree));
           if (TREE_CODE(inner_type) != TREE_CODE(TREE_TYPE(array_tree))) {
-            fprintf(stderr, "Error setting array type!\n");
+            FXLOG(1, "Error setting array type!\n");
           }
         } else {
-          fprintf(stderr, "Do something with pointer type!\n");
+          FXLOG(1, "Do something with pointer type!\n");
         }
       } else {
         error("fxopt: Error setting array element type");
@@ -1258,10 +2085,10 @@ struct SIF get_operand_format(gimple stmt, int op_number,
     //
     // Try to fetch a format for this exact operand, pass, and index.
     //
-    struct SIF *op_fmt_p = NULL;
+    const struct SIF *op_fmt_p = NULL;
     uid = DECL_UID(var);        // only variable declarations have a UID
-    int var_key = UID_PASS_IDX_TO_KEY(uid, fxpass, index);
-    HASH_FIND_INT(var_formats, &var_key, op_fmt_p);
+    fxkey_t var_key = UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, index);
+    op_fmt_p = get_format_ptr(var_key);
 
     //
     // If the operand is on the RHS and is aliased then we need to get
@@ -1272,15 +2099,15 @@ struct SIF get_operand_format(gimple stmt, int op_number,
     //   using the index for the current operand (needed for ARRAY_REF)
     //
     if (op_number > 0) {
-      struct SIF *var_fmt_p = NULL;
-      var_key = UID_PASS_IDX_TO_KEY(uid, fxpass, NOT_AN_ARRAY);
-      HASH_FIND_INT(var_formats, &var_key, var_fmt_p);
+      const struct SIF *var_fmt_p = NULL;
+      var_key = UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, NOT_AN_ARRAY);
+      var_fmt_p = get_format_ptr(var_key);
       if ((var_fmt_p != NULL) && (var_fmt_p->ptr_op) && (var_fmt_p->alias)) {
         int alias_uid = KEY_TO_UID(var_fmt_p->alias);
-        pass = fxpass;
+        pass = fxctx->fxpass;
         do {
           var_key = UID_PASS_IDX_TO_KEY(alias_uid, pass, index);
-          HASH_FIND_INT(var_formats, &var_key, var_fmt_p);
+          var_fmt_p = get_format_ptr(var_key);
           if (var_fmt_p != NULL) {
             op_fmt_p = var_fmt_p;
           }
@@ -1294,30 +2121,30 @@ struct SIF get_operand_format(gimple stmt, int op_number,
     //   needs to be updated so that the aa list points to the current
     //   SIF format
     //
-    if ((op_fmt_p == NULL) && (fxpass > 0) && (PARM_DECL == TREE_CODE(var))) {
-      op_fmt_p = find_var_format(UID_PASS_IDX_TO_KEY(uid, fxpass, index));
+    if ((op_fmt_p == NULL) && (fxctx->fxpass > 0) &&
+        (PARM_DECL == TREE_CODE(var))) {
+      struct SIF *parm_fmt_p =
+          find_var_format(UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, index));
       struct SIF *prev_fmt_p =
-          find_var_format(UID_PASS_IDX_TO_KEY(uid, (fxpass - 1), index));
-      copy_SIF(prev_fmt_p, op_fmt_p);
-      if (op_fmt_p->aa) {
-        if (op_fmt_p->aa->id == UID_PASS_IDX_TO_KEY(uid, (fxpass - 1), index))
-          op_fmt_p->aa->id = op_fmt_p->id;
-        else if (op_fmt_p->aa->next->id ==
-                 UID_PASS_IDX_TO_KEY(uid, (fxpass - 1), index))
-          op_fmt_p->aa->next->id = op_fmt_p->id;
-        else
-          fprintf(stderr, "  !!!!! Unexpected id\n");
+          find_var_format(UID_PASS_IDX_TO_KEY(uid, (fxctx->fxpass - 1), index));
+      copy_SIF(prev_fmt_p, parm_fmt_p);
+      if (parm_fmt_p->aa) {
+        if (!rename_aa_var(&parm_fmt_p->aa,
+                           UID_PASS_IDX_TO_KEY(uid, (fxctx->fxpass - 1), index),
+                           parm_fmt_p->id))
+          FXLOG(1, "  !!!!! Unexpected id\n");
       }
+      op_fmt_p = parm_fmt_p;
     }
     //
     // Else, try to find the operand in an earlier pass
     //
-    if ((op_fmt_p == NULL) && (fxpass > 0)) {
-      pass = fxpass;
+    if ((op_fmt_p == NULL) && (fxctx->fxpass > 0)) {
+      pass = fxctx->fxpass;
       do {
         pass--;
         var_key = UID_PASS_IDX_TO_KEY(uid, pass, index);
-        HASH_FIND_INT(var_formats, &var_key, op_fmt_p);
+        op_fmt_p = get_format_ptr(var_key);
         if (op_fmt_p != NULL) {
         }
       } while ((pass >= 0) && (op_fmt_p == NULL));
@@ -1326,14 +2153,14 @@ struct SIF get_operand_format(gimple stmt, int op_number,
     // Else, try to find the operand without an index
     //
     if ((op_fmt_p == NULL) && (index > 0)) {
-      var_key = UID_PASS_IDX_TO_KEY(uid, fxpass, NOT_AN_ARRAY);
-      HASH_FIND_INT(var_formats, &var_key, op_fmt_p);
-      if ((op_fmt_p == NULL) && (fxpass > 0)) {
-        pass = fxpass;
+      var_key = UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, NOT_AN_ARRAY);
+      op_fmt_p = get_format_ptr(var_key);
+      if ((op_fmt_p == NULL) && (fxctx->fxpass > 0)) {
+        pass = fxctx->fxpass;
         do {
           pass--;
           var_key = UID_PASS_IDX_TO_KEY(uid, pass, index);
-          HASH_FIND_INT(var_formats, &var_key, op_fmt_p);
+          op_fmt_p = get_format_ptr(var_key);
           if (op_fmt_p != NULL) {
           }
         } while ((pass >= 0) && (op_fmt_p == NULL));
@@ -1343,21 +2170,21 @@ struct SIF get_operand_format(gimple stmt, int op_number,
 
     if (op_fmt_p != NULL) {
       delete_aa_list(&(op_fmt.aa));
-      op_fmt = *op_fmt_p;
+      op_fmt = element_format(op_fmt_p, index);
       //
       // If a pointer on the LHS still doesn't have an initialized format,
       // try to use the operand in this pass without an index
       //
       if (!format_initialized(op_fmt) && (op_fmt.ptr_op != 0) &&
                                          (op_number == 0)) {
-        var_key = UID_PASS_IDX_TO_KEY(uid, fxpass, NOT_AN_ARRAY);
+        var_key = UID_PASS_IDX_TO_KEY(uid, fxctx->fxpass, NOT_AN_ARRAY);
         if (var_key != op_fmt.id) {
-          HASH_FIND_INT(var_formats, &var_key, op_fmt_p);
+          op_fmt_p = get_format_ptr(var_key);
           if (op_fmt_p != NULL) {
             op_fmt = *op_fmt_p;
             if (op_fmt_p->alias != 0) {
               op_fmt.alias = UID_PASS_IDX_TO_KEY(KEY_TO_UID(op_fmt_p->alias),
-                                               fxpass, index);
+                                               fxctx->fxpass, index);
             }
           }
         }
@@ -1397,23 +2224,23 @@ struct SIF get_operand_format(gimple stmt, int op_number,
     //
     // If desired, print the operand's format
     //
-    if (print) {
+    if (print && LOG_ENABLED(2)) {
       if (op_fmt.alias != 0) {
-        fprintf(stderr, "  OP%d  @", op_number);
+        fprintf(fxlog, "  OP%d  @", op_number);
       } else if (op_fmt.ptr_op != 0) {
-        fprintf(stderr, "  OP%d  *", op_number);
+        fprintf(fxlog, "  OP%d  *", op_number);
       } else {
-        fprintf(stderr, "  OP%d   ", op_number);
+        fprintf(fxlog, "  OP%d   ", op_number);
       }
       if (op_fmt.iv)
-        fprintf(stderr, "(%2d/%2d/--/--)", op_fmt.S, op_fmt.I);
+        fprintf(fxlog, "(%2d/%2d/--/--)", op_fmt.S, op_fmt.I);
       else
-        fprintf(stderr, "(%2d/%2d/%2d/%2d)", op_fmt.S, op_fmt.I, op_fmt.F,
+        fprintf(fxlog, "(%2d/%2d/%2d/%2d)", op_fmt.S, op_fmt.I, op_fmt.F,
                 op_fmt.E);
       if (op_fmt.sgnd) {
-        fprintf(stderr, "s ");
+        fprintf(fxlog, "s ");
       } else {
-        fprintf(stderr, "u ");
+        fprintf(fxlog, "u ");
       }
       if (AFFINE) {
         print_aa_list(op_fmt.aa);
@@ -1421,7 +2248,7 @@ struct SIF get_operand_format(gimple stmt, int op_number,
       if (INTERVAL)
         print_min_max(op_fmt);
       else
-        fprintf(stderr, "\n");
+        fprintf(fxlog, "\n");
     }
   }                             // found some kind of format to use
 
@@ -1472,6 +2299,8 @@ int set_var_format(tree operand, struct SIF result_frmt)
   } else if ((PARM_DECL == TREE_CODE(operand))
              || (VAR_DECL == TREE_CODE(operand))) {
     var = operand;
+  } else if (is_aggregate_ref(operand)) {
+    var = aggregate_leaf(operand, &index);
   } else if (ARRAY_REF == TREE_CODE(operand)) {
     var = TREE_OPERAND(operand, 0);
     tree index_var = TREE_OPERAND(operand, 1);
@@ -1481,9 +2310,9 @@ int set_var_format(tree operand, struct SIF result_frmt)
       index_var = SSA_NAME_VAR(index_var);
       int uid = DECL_UID(index_var);
       struct SIF *idx_fmt =
-          get_format_ptr(UID_PASS_IDX_TO_KEY(uid, 0, NOT_AN_ARRAY));
+          edit_var_format(UID_PASS_IDX_TO_KEY(uid, 0, NOT_AN_ARRAY));
       index = idx_fmt->shift;
-      fprintf(stderr, "  Using index %d\n", index);
+      FXLOG(2, "  Using index %d\n", index);
       idx_fmt->shift = idx_fmt->shift + 1;
       if (idx_fmt->shift > (int) double_int_to_uhwi(idx_fmt->max))
         idx_fmt->shift = 0;
@@ -1500,6 +2329,8 @@ int set_var_format(tree operand, struct SIF result_frmt)
         error("fxopt: set_var_format: Error getting array index");
       }
     }
+    if (UNIFORM || is_block_array(var))
+      index = NOT_AN_ARRAY;     // all elements share one format
   } else if (MEM_REF == TREE_CODE(operand)) {
     var = TREE_OPERAND(operand, 0);
     if (SSA_NAME == TREE_CODE(var)) {
@@ -1512,27 +2343,35 @@ int set_var_format(tree operand, struct SIF result_frmt)
     error("fxopt: Error setting operand VAR_DECL/PARM_DECL");
   }
   //
-  // Get a pointer to the hash table entry for this var. Note that this
+  // Get a pointer to the store entry for this var. Note that this
   // is a pointer to the actual variable under operand 0, not to an alias
   //
   if (result_frmt.iv)
-    var_fmt = get_format_ptr(calc_hash_key(var, 0, NOT_AN_ARRAY));
+    var_fmt = edit_var_format(calc_hash_key(var, 0, NOT_AN_ARRAY));
   else
-    var_fmt = get_format_ptr(calc_hash_key(var, fxpass, index));
+    var_fmt = edit_var_format(calc_hash_key(var, fxctx->fxpass, index));
   if (NULL == var_fmt) {
-    add_var_format(calc_hash_key(var, fxpass, index));
-    var_fmt = get_format_ptr(calc_hash_key(var, fxpass, index));
-    struct SIF *prior_var_fmt;
-    prior_var_fmt = get_format_ptr(calc_hash_key(var, (fxpass - 1), index));
-    if (NULL != prior_var_fmt)
-      copy_format(prior_var_fmt, var_fmt);
+    add_var_format(calc_hash_key(var, fxctx->fxpass, index));
+    var_fmt = edit_var_format(calc_hash_key(var, fxctx->fxpass, index));
+    //
+    // Statements are only revisited when their operands change, so the most
+    //   recent format of this variable may be from any earlier pass
+    //
+    const struct SIF *prior_var_fmt = NULL;
+    int pass = fxctx->fxpass;
+    while ((NULL == prior_var_fmt) && (--pass >= 0))
+      prior_var_fmt = get_format_ptr(calc_hash_key(var, pass, index));
+    if (NULL != prior_var_fmt) {
+      struct SIF prior_fmt = element_format(prior_var_fmt, index);
+      copy_format(&prior_fmt, var_fmt);
+    }
   }
   //
   // If the operand is aliased, adjust the alias for the index of the LHS
   //
   if ((result_frmt.alias != 0) && (result_frmt.alias != var_fmt->id)) {
     result_frmt.alias = UID_PASS_IDX_TO_KEY(KEY_TO_UID(result_frmt.alias),
-                                            fxpass, index);
+                                            fxctx->fxpass, index);
   }
   //
   // Do some error checking
@@ -1564,9 +2403,43 @@ int set_var_format(tree operand, struct SIF result_frmt)
       result_frmt.max = range_max(result_frmt, *var_fmt);
       result_frmt.min = range_min(result_frmt, *var_fmt);
     }
+    result_frmt.noise = MAX(result_frmt.noise, var_fmt->noise);
   }
   //
-  // Store the desired format info in the hash table
+  // When all elements of an array share one format, a store to one element
+  //   must not narrow the range of the others
+  //
+  else if (((UNIFORM && (ARRAY_REF == TREE_CODE(operand))) ||
+            is_shared_ref(operand)) && format_initialized(*var_fmt)) {
+    if (INTERVAL) {
+      result_frmt.max = range_max(result_frmt, *var_fmt);
+      result_frmt.min = range_min(result_frmt, *var_fmt);
+    }
+    result_frmt.noise = MAX(result_frmt.noise, var_fmt->noise);
+  }
+  //
+  // A variable that is carried around a loop keeps the join of all of the
+  //   values assigned to it, widened so that the passes end
+  //
+  else if (is_loop_var(var)) {
+    if (keep_loop_var(var, result_frmt))
+      return 0;
+    errors = join_loop_var(var, &result_frmt, var_fmt);
+  }
+  //
+  // The elements of a block are normalized at run time to fill the format of
+  //   its fxfrmt attribute, whatever values are stored in them
+  //
+  if (is_block_array(var) && var_fmt->has_attribute) {
+    result_frmt.S = var_fmt->attrS;
+    result_frmt.I = var_fmt->attrI;
+    result_frmt.F = var_fmt->attrF;
+    result_frmt.E = var_fmt->attrE;
+    result_frmt.max = var_fmt->attrmax;
+    result_frmt.min = var_fmt->attrmin;
+  }
+  //
+  // Store the desired format info in the format store
   //
   copy_SIF(&result_frmt, var_fmt);
   var_fmt->shift = 0;
@@ -1575,6 +2448,366 @@ int set_var_format(tree operand, struct SIF result_frmt)
   return errors;
 }
 
+/**
+ * @brief Predicate for a change in a variable's format.
+ * @details Compares the SIFE values, and the range when interval arithmetic
+ * is in use, of the format previously stored for a variable with a newly
+ * calculated format.
+ *
+ * @param[in] old_frmt the ::SIF structure previously stored
+ * @param[in] new_frmt the newly calculated ::SIF structure
+ * @return    true if the formats differ
+ */
+int format_changed(struct SIF old_frmt, struct SIF new_frmt)
+{
+  if ((old_frmt.S != new_frmt.S) || (old_frmt.I != new_frmt.I) ||
+      (old_frmt.F != new_frmt.F) || (old_frmt.E != new_frmt.E))
+    return 1;
+  if (INTERVAL && ((!double_int_equal_p(old_frmt.max, new_frmt.max)) ||
+                   (!double_int_equal_p(old_frmt.min, new_frmt.min))))
+    return 1;
+  return 0;
+}
+
+/**
+ * @brief Predicate for an array operand with a variable index.
+ * @details The element of an array that is referenced with an SSA_NAME index
+ * is chosen by stepping the <tt>shift</tt> counter of the index variable each
+ * time the statement is analyzed, so such a statement must be revisited on
+ * every pass. That is not needed when all elements share one format, or for
+ * a nested array, whose variably indexed levels share one format.
+ *
+ * @param[in] stmt gimple statement being processed
+ * @return    true if any operand is an ARRAY_REF with a non-constant index
+ */
+int has_variable_index(gimple stmt)
+{
+  unsigned int i;
+  if (UNIFORM)
+    return 0;
+  for (i = 0; i < gimple_num_ops(stmt); i++) {
+    tree op = gimple_op(stmt, i);
+    if ((op != NULL_TREE) && (ARRAY_REF == TREE_CODE(op)) &&
+        (SSA_NAME == TREE_CODE(TREE_OPERAND(op, 1))) && !is_aggregate_ref(op))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief The uses of one declared variable, found by begin_revisits().
+ */
+struct VAR_USES {
+  tree *names;          ///< SSA names of the variable
+  int num_names;        ///< Number of SSA names
+  int max_names;        ///< Number of SSA names allocated
+  gimple *stmts;        ///< Statements that name the declaration itself
+  int num_stmts;        ///< Number of statements
+  int max_stmts;        ///< Number of statements allocated
+};
+
+/**
+ * @brief The worklist of the statements to be analyzed again.
+ *
+ * @details A statement to be analyzed again has its "visited" bit cleared,
+ * and its basic block is put on the worklist. The blocks are kept in the
+ * order that FOR_EACH_BB visits them, by their position in that order, so
+ * the statements are analyzed in the same order as a walk of the function.
+ * A block after the one being analyzed is analyzed later in the same pass,
+ * any other block in the next pass. The worklist belongs to the current
+ * ::FXOPT_CONTEXT from begin_revisits() until end_revisits().
+ */
+struct REVISITS {
+  struct pointer_map_t *uses;   ///< declaration -> ::VAR_USES
+  gimple *indirect;             ///< statements that dereference a pointer
+  int num_indirect;             ///< Number of such statements
+  int max_indirect;             ///< Number of such statements allocated
+  basic_block *order;           ///< blocks by position
+  int *position;                ///< position of each block, by its index
+  bitmap this_pass;             ///< positions to analyze in this pass
+  bitmap next_pass;             ///< positions to analyze in the next pass
+  int current;                  ///< position of the block being analyzed
+};
+
+/**
+ * @brief Add a statement to an array of statements, unless it was just added.
+ */
+static void add_use_stmt(gimple ** stmts_p, int *num_p, int *max_p,
+                         gimple stmt)
+{
+  if ((*num_p > 0) && ((*stmts_p)[*num_p - 1] == stmt))
+    return;
+  if (*num_p == *max_p) {
+    *max_p = (*max_p > 0) ? (2 * *max_p) : 4;
+    *stmts_p = (gimple *) xrealloc(*stmts_p, *max_p * sizeof(gimple));
+  }
+  (*stmts_p)[(*num_p)++] = stmt;
+}
+
+/**
+ * @brief Find the uses of a declaration, adding an empty entry if needed.
+ */
+static struct VAR_USES *var_uses(tree var)
+{
+  void **slot = pointer_map_insert(fxctx->revisits->uses, var);
+
+  if (NULL == *slot)
+    *slot = xcalloc(1, sizeof(struct VAR_USES));
+  return (struct VAR_USES *) *slot;
+}
+
+/**
+ * @brief The statement whose operands are being indexed, and whether it
+ * dereferences a pointer.
+ */
+struct USE_WALK {
+  gimple stmt;
+  bool indirect;
+};
+
+/**
+ * @brief Record a declaration named by a statement operand.
+ *
+ * @details Callback for walk_tree(). SSA names are not recorded, since their
+ * uses are kept by gcc.
+ */
+static tree record_var_use(tree * tp, int *walk_subtrees, void *data)
+{
+  struct USE_WALK *walk = (struct USE_WALK *) data;
+  struct VAR_USES *u;
+
+  if (TYPE_P(*tp)) {
+    *walk_subtrees = 0;
+    return NULL_TREE;
+  }
+  switch (TREE_CODE(*tp)) {
+    case VAR_DECL:
+    case PARM_DECL:
+    case RESULT_DECL:
+      u = var_uses(*tp);
+      add_use_stmt(&u->stmts, &u->num_stmts, &u->max_stmts, walk->stmt);
+      break;
+    case MEM_REF:
+      walk->indirect = true;
+      break;
+    default:
+      break;
+  }
+  return NULL_TREE;
+}
+
+/**
+ * @brief Index the uses of every declared variable, and put every basic
+ * block on the worklist for the next pass.
+ *
+ * @details Called before the passes that find the formats. The SSA names of
+ * each variable are listed once here, rather than by searching all of the
+ * SSA names whenever the variable's format changes. No SSA names or blocks
+ * are made until end_revisits() is called.
+ */
+void begin_revisits()
+{
+  basic_block bb;
+  gimple_stmt_iterator gsi;
+  struct USE_WALK walk;
+  unsigned int i;
+  int n = 0;
+  struct REVISITS *r;
+
+  r = (struct REVISITS *) xcalloc(1, sizeof(struct REVISITS));
+  fxctx->revisits = r;
+  r->uses = pointer_map_create();
+  r->order = (basic_block *) xmalloc(n_basic_blocks * sizeof(basic_block));
+  r->position = (int *) xmalloc(last_basic_block * sizeof(int));
+  r->this_pass = BITMAP_ALLOC(NULL);
+  r->next_pass = BITMAP_ALLOC(NULL);
+  r->current = -1;
+  FOR_EACH_BB(bb) {
+    r->position[bb->index] = n;
+    r->order[n] = bb;
+    bitmap_set_bit(r->next_pass, n++);
+    for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); gsi_next(&gsi)) {
+      walk.stmt = gsi_stmt(gsi);
+      walk.indirect = false;
+      for (i = 0; i < gimple_num_ops(walk.stmt); i++) {
+        if (gimple_op(walk.stmt, i) != NULL_TREE)
+          walk_tree(gimple_op_ptr(walk.stmt, i), record_var_use, &walk, NULL);
+      }
+      if (walk.indirect)
+        add_use_stmt(&r->indirect, &r->num_indirect, &r->max_indirect,
+                     walk.stmt);
+    }
+  }
+  for (i = 1; i < num_ssa_names; i++) {
+    tree name = ssa_name(i);
+    struct VAR_USES *u;
+    if ((name == NULL_TREE) || !is_gimple_reg(name))
+      continue;
+    u = var_uses(SSA_NAME_VAR(name));
+    if (u->num_names == u->max_names) {
+      u->max_names = (u->max_names > 0) ? (2 * u->max_names) : 4;
+      u->names = (tree *) xrealloc(u->names, u->max_names * sizeof(tree));
+    }
+    u->names[u->num_names++] = name;
+  }
+}
+
+/**
+ * @brief Free the uses of one declaration.
+ *
+ * @details Callback for pointer_map_traverse().
+ */
+static bool free_var_uses(const void *key, void **value, void *data)
+{
+  struct VAR_USES *u = (struct VAR_USES *) *value;
+
+  free(u->names);
+  free(u->stmts);
+  free(u);
+  return true;
+}
+
+/**
+ * @brief Free the index of uses and the worklist.
+ */
+void end_revisits()
+{
+  struct REVISITS *r = fxctx->revisits;
+
+  pointer_map_traverse(r->uses, free_var_uses, NULL);
+  pointer_map_destroy(r->uses);
+  free(r->indirect);
+  free(r->order);
+  free(r->position);
+  BITMAP_FREE(r->this_pass);
+  BITMAP_FREE(r->next_pass);
+  free(r);
+  fxctx->revisits = NULL;
+}
+
+/**
+ * @brief Start a pass, with the blocks that were put on the worklist for it.
+ */
+void begin_revisit_pass()
+{
+  struct REVISITS *r = fxctx->revisits;
+
+  bitmap_ior_into(r->this_pass, r->next_pass);
+  bitmap_clear(r->next_pass);
+  r->current = -1;
+}
+
+/**
+ * @brief Take the next basic block to be analyzed in this pass.
+ *
+ * @return the block, or NULL when the pass is finished
+ */
+basic_block next_revisit_block()
+{
+  struct REVISITS *r = fxctx->revisits;
+  int pos;
+
+  if (bitmap_empty_p(r->this_pass))
+    return NULL;
+  pos = bitmap_first_set_bit(r->this_pass);
+  bitmap_clear_bit(r->this_pass, pos);
+  r->current = pos;
+  return r->order[pos];
+}
+
+/**
+ * @brief Analyze the current basic block again in the next pass, since it
+ * has statements whose formats were not found.
+ */
+void keep_revisit_block()
+{
+  bitmap_set_bit(fxctx->revisits->next_pass, fxctx->revisits->current);
+}
+
+/**
+ * @brief Mark a statement to be analyzed again.
+ *
+ * @details The "visited" bit is cleared, unless pass local flag 1 marks the
+ * statement as calculating an induction variable, and its block is put on
+ * the worklist.
+ *
+ * @param[in] stmt a GIMPLE statement
+ */
+void revisit_stmt(gimple stmt)
+{
+  struct REVISITS *r = fxctx->revisits;
+  basic_block bb = gimple_bb(stmt);
+  int pos;
+
+  gimple_set_visited(stmt, gimple_plf(stmt, GF_PLF_1));
+  if (gimple_visited_p(stmt) || (NULL == bb) ||
+      (bb->index < NUM_FIXED_BLOCKS))
+    return;
+  pos = r->position[bb->index];
+  bitmap_set_bit((pos > r->current) ? r->this_pass : r->next_pass, pos);
+}
+
+/**
+ * @brief Mark the statements that use a variable to be revisited.
+ *
+ * @details All SSA names of a declared variable share a single ::SIF format,
+ * so when that format changes every statement that uses any of those SSA
+ * names must be analyzed again, and so must every statement that names the
+ * declaration itself. The next pass then only revisits the affected
+ * statements rather than the whole function.
+ *
+ * A variable that is not a GIMPLE register (an array, a pointer target) may
+ * also be reached through a pointer, so the statements that dereference a
+ * pointer are revisited as well.
+ *
+ * @param[in] operand the LHS operand's gcc tree
+ */
+void revisit_var_uses(tree operand)
+{
+  gimple use_stmt;
+  imm_use_iterator imm_iter;
+  void **slot;
+  int i;
+
+  tree var = get_operand_decl(operand);
+  slot = pointer_map_contains(fxctx->revisits->uses, var);
+  if (slot != NULL) {
+    struct VAR_USES *u = (struct VAR_USES *) *slot;
+    for (i = 0; i < u->num_names; i++) {
+      FOR_EACH_IMM_USE_STMT(use_stmt, imm_iter, u->names[i]) {
+        revisit_stmt(use_stmt);
+      }
+    }
+    for (i = 0; i < u->num_stmts; i++)
+      revisit_stmt(u->stmts[i]);
+  }
+  if ((SSA_NAME != TREE_CODE(operand)) || !is_gimple_reg(var)) {
+    for (i = 0; i < fxctx->revisits->num_indirect; i++)
+      revisit_stmt(fxctx->revisits->indirect[i]);
+  }
+}
+
+/**
+ * @brief Mark the statements that assign a variable to be revisited.
+ *
+ * @param[in] var the variable's declaration
+ */
+void revisit_var_defs(tree var)
+{
+  void **slot = pointer_map_contains(fxctx->revisits->uses, var);
+  struct VAR_USES *u;
+  int i;
+
+  if (NULL == slot)
+    return;
+  u = (struct VAR_USES *) *slot;
+  for (i = 0; i < u->num_names; i++) {
+    gimple def_stmt = SSA_NAME_DEF_STMT(u->names[i]);
+    if (gimple_code(def_stmt) != GIMPLE_PHI)
+      revisit_stmt(def_stmt);
+  }
+}
+
 /**
  * @brief Update the F and E values for a shifted constant.
  * @details As a constant is shifted it is possible that new empty bits will
@@ -1597,7 +2830,9 @@ void fix_f_e_bits(struct SIF oprnd_frmt[], tree oprnd_tree[], int opnumber)
     // get the full constant value, unshifted
     if (REAL_CST == TREE_CODE(oprnd_tree[opnumber])) {
       real_const = TREE_REAL_CST(oprnd_tree[opnumber]);
-      tmp_fmt = get_format_real_value_type(real_const); // maximum precision
+      // maximum precision
+      tmp_fmt = get_format_real_value_type(real_const,
+                                           oprnd_frmt[opnumber].size);
       constant = tmp_fmt.max;
     } else if (INTEGER_CST == TREE_CODE(oprnd_tree[opnumber])) {
       constant = TREE_INT_CST(oprnd_tree[opnumber]);
@@ -1700,6 +2935,93 @@ void shift_left(struct SIF oprnd_frmt[], tree oprnd_tree[], int opnumber,
   fix_f_e_bits(oprnd_frmt, oprnd_tree, opnumber);
 }
 
+/**
+ * @brief Extend an operand to a wider integer.
+ * 
+ * @details Narrow variables are used with wider intermediate values, so an
+ * operand may have to be extended before it is combined with wider operands.
+ * Each added bit is a sign bit. On the last pass a conversion to the wider
+ * type is inserted before the statement and replaces the operand. An operand
+ * in memory is first loaded into a temporary, since GIMPLE cannot convert a
+ * memory reference directly. A constant is just rebuilt with the wider type.
+ * 
+ * @param[in] gsi_p      statement iterator, points to statement being processed
+ * @param[in,out] oprnd_frmt operand ::SIF structure array
+ * @param[in,out] oprnd_tree operand tree array
+ * @param[in] opnumber   operand number to be extended
+ * @param[in] size       number of bits in the wider operand
+ */
+void widen_operand(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                   tree oprnd_tree[], int opnumber, int size)
+{
+  int extension = size - oprnd_frmt[opnumber].size;
+
+  if (extension <= 0)
+    return;
+  FXLOG(2, "  OP%d extended from %d to %d bits\n", opnumber,
+        oprnd_frmt[opnumber].size, size);
+  oprnd_frmt[opnumber].S += extension;
+  oprnd_frmt[opnumber].size = size;
+  if (!fxctx->lastpass)
+    return;
+
+  gimple stmt = gsi_stmt(*gsi_p);
+  tree wide_type = fxopt_integer_type(size);
+  tree wide_oprnd;
+  if (TREE_CONSTANT(oprnd_tree[opnumber])) {
+    wide_oprnd = fold_convert(wide_type, oprnd_tree[opnumber]);
+  } else {
+    tree narrow_oprnd = oprnd_tree[opnumber];
+    gimple new_stmt;
+    if (!is_gimple_val(narrow_oprnd)) {
+      tree load_var = make_rename_temp(TREE_TYPE(narrow_oprnd), "_fx_load");
+      new_stmt = gimple_build_assign(load_var, narrow_oprnd);
+      FXLOG_STMT(2, new_stmt);
+      gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+      narrow_oprnd = load_var;
+    }
+    wide_oprnd = make_rename_temp(wide_type, "_fx_wide");
+    new_stmt = gimple_build_assign_with_ops(NOP_EXPR, wide_oprnd,
+                                            narrow_oprnd, NULL);
+    FXLOG_STMT(2, new_stmt);
+    gsi_insert_before(gsi_p, new_stmt, GSI_SAME_STMT);
+  }
+  gimple_set_op(stmt, opnumber, wide_oprnd);
+  gimple_set_modified(stmt, true);
+  oprnd_tree[opnumber] = wide_oprnd;
+}
+
+/**
+ * @brief Bring the operands of a statement to a common size.
+ * 
+ * @details The operation is done in the size of its widest operand or of its
+ * result, whichever is larger, and narrower operands are extended. If this is
+ * wider than the result then the result is narrowed after the operation, in
+ * the same way as a double-precision product.
+ * 
+ * @param[in] gsi_p      statement iterator, points to statement being processed
+ * @param[in,out] oprnd_frmt operand ::SIF structure array
+ * @param[in,out] oprnd_tree operand tree array
+ * @return    number of bits in the operation
+ */
+int match_operand_sizes(gimple_stmt_iterator * gsi_p, struct SIF oprnd_frmt[],
+                        tree oprnd_tree[])
+{
+  int num_operands = gimple_num_ops(gsi_stmt(*gsi_p));
+  int size = oprnd_frmt[0].size;
+  int i;
+
+  for (i = 1; i < num_operands; i++) {
+    if ((oprnd_tree[i] != NULL_TREE) && (oprnd_frmt[i].size > size))
+      size = oprnd_frmt[i].size;
+  }
+  for (i = 1; i < num_operands; i++) {
+    if (oprnd_tree[i] != NULL_TREE)
+      widen_operand(gsi_p, oprnd_frmt, oprnd_tree, i, size);
+  }
+  return size;
+}
+
 /**
  * @brief Verify that a desired operand shift is valid.
  * 
@@ -1845,13 +3167,15 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
 
   if (oprnd_frmt[0].has_attribute) {
 
-    fprintf(stderr, "  Unsaturated RESULT is (%2d/%2d/%2d/%2d) shft %2d",
-            result_frmt.S, result_frmt.I, result_frmt.F, result_frmt.E,
-            result_frmt.shift);
-    temp = result_frmt.shift;
-    result_frmt.shift = 0;
-    print_min_max(result_frmt);
-    result_frmt.shift = temp;
+    if (LOG_ENABLED(2)) {
+      fprintf(fxlog, "  Unsaturated RESULT is (%2d/%2d/%2d/%2d) shft %2d",
+              result_frmt.S, result_frmt.I, result_frmt.F, result_frmt.E,
+              result_frmt.shift);
+      temp = result_frmt.shift;
+      result_frmt.shift = 0;
+      print_min_max(result_frmt);
+      result_frmt.shift = temp;
+    }
 
     if (oprnd_frmt[0].I < result_frmt.I) {
       //
@@ -1886,7 +3210,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
                           double_int_sext(double_int_neg(new_frmt.max),
                                           PRECISION(new_frmt)));
 
-      if (lastpass) {
+      if (fxctx->lastpass) {
         tree max_pos =
             double_int_to_tree(TREE_TYPE(*result_var_p), new_frmt.max);
         tree maxpos_var =
@@ -1894,7 +3218,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
         new_stmt =
             gimple_build_assign_with_ops(INTEGER_CST, maxpos_var, max_pos,
                                          NULL);
-        print_gimple_stmt(stderr, new_stmt, 2, 0);
+        FXLOG_STMT(2, new_stmt);
         //gimple_set_visited(new_stmt, true);
         gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
 
@@ -1905,7 +3229,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
           new_stmt =
               gimple_build_assign_with_ops(MIN_EXPR, satpos_var,
                                            *result_var_p, maxpos_var);
-          print_gimple_stmt(stderr, new_stmt, 2, 0);
+          FXLOG_STMT(2, new_stmt);
           //gimple_set_visited(new_stmt, true);
           gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
           *result_var_p = satpos_var;
@@ -1917,7 +3241,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
           new_stmt =
               gimple_build_assign_with_ops(NEGATE_EXPR, minneg_var,
                                            maxpos_var, NULL);
-          print_gimple_stmt(stderr, new_stmt, 2, 0);
+          FXLOG_STMT(2, new_stmt);
           //gimple_set_visited(new_stmt, true);
           gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
 
@@ -1925,7 +3249,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
           new_stmt =
               gimple_build_assign_with_ops(MAX_EXPR, sat_var, *result_var_p,
                                            minneg_var);
-          print_gimple_stmt(stderr, new_stmt, 2, 0);
+          FXLOG_STMT(2, new_stmt);
           //gimple_set_visited(new_stmt, true);
           gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
           *result_var_p = sat_var;
@@ -1934,12 +3258,15 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
       //
       // Print out the final result format
       //
-      fprintf(stderr, "    Saturated RESULT is (%2d/%2d/%2d/%2d) shft %2d",
-              new_frmt.S, new_frmt.I, new_frmt.F, new_frmt.E, new_frmt.shift);
-      temp = new_frmt.shift;
-      new_frmt.shift = 0;
-      print_min_max(new_frmt);
-      new_frmt.shift = temp;
+      if (LOG_ENABLED(2)) {
+        fprintf(fxlog, "    Saturated RESULT is (%2d/%2d/%2d/%2d) shft %2d",
+                new_frmt.S, new_frmt.I, new_frmt.F, new_frmt.E,
+                new_frmt.shift);
+        temp = new_frmt.shift;
+        new_frmt.shift = 0;
+        print_min_max(new_frmt);
+        new_frmt.shift = temp;
+      }
     }                           // result needs more I bits than oprnd0 has
   }                             // oprnd 0 has an attribute
   //
@@ -1959,7 +3286,7 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
       int bits2convert = MIN((oprnd_frmt[0].S - 1),
                              (oprnd_frmt[0].I - result_frmt.I));
       if (bits2convert > 0) {
-        fprintf(stderr, "    Converting %d S bits to I bits\n", bits2convert);
+        FXLOG(2, "    Converting %d S bits to I bits\n", bits2convert);
         new_frmt.S = result_frmt.S - bits2convert;
         new_frmt.I = result_frmt.I + bits2convert;
       }
@@ -1967,12 +3294,12 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
       // Do a right shift, adding I bits instead of S bits
       //
       shift_size = oprnd_frmt[0].I - result_frmt.I - bits2convert;
-      fprintf(stderr, "    shift_size %d to equalize I bits\n", shift_size);
+      FXLOG(2, "    shift_size %d to equalize I bits\n", shift_size);
       new_frmt.I += shift_size;
     }
     if (oprnd_frmt[0].S != new_frmt.S) {
       shift_size += oprnd_frmt[0].S - new_frmt.S;
-      fprintf(stderr, "    shift_size %d to equalize S bits\n", shift_size);
+      FXLOG(2, "    shift_size %d to equalize S bits\n", shift_size);
     }
     new_frmt.shift += shift_size;
     if (new_frmt.E > shift_size) {
@@ -1985,18 +3312,20 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
     //
     // Print out the final result format
     //
-    fprintf(stderr, "   Saturated pointer is (%2d/%2d/%2d/%2d) shft %2d",
-            new_frmt.S, new_frmt.I, new_frmt.F, new_frmt.E, new_frmt.shift);
-    temp = new_frmt.shift;
-    new_frmt.shift = shift_size;
-    print_min_max(new_frmt);
-    new_frmt.shift = temp;
+    if (LOG_ENABLED(2)) {
+      fprintf(fxlog, "   Saturated pointer is (%2d/%2d/%2d/%2d) shft %2d",
+              new_frmt.S, new_frmt.I, new_frmt.F, new_frmt.E, new_frmt.shift);
+      temp = new_frmt.shift;
+      new_frmt.shift = shift_size;
+      print_min_max(new_frmt);
+      new_frmt.shift = temp;
+    }
   }
   if (new_frmt.shift != 0) {
     // 
     // Do the required shift
     // 
-    if (lastpass) {
+    if (fxctx->lastpass) {
       tree shifted_var = make_rename_temp(TREE_TYPE(*result_var_p),
                                           "_fx_shft0");
       if (new_frmt.shift > 0) {
@@ -2014,11 +3343,81 @@ struct SIF apply_fxfrmt(gimple_stmt_iterator * gsi_p,
       }
       //gimple_set_visited(new_stmt, true);
       gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
-      print_gimple_stmt(stderr, new_stmt, 2, 0);
+      FXLOG_STMT(2, new_stmt);
       *result_var_p = shifted_var;
     }                         // lastpass
   }                           // need to shift after saturation
   return new_frmt;
 }
 
+/**
+ * @brief Take the high half of a double-precision product.
+ *
+ * @details When a double-precision product is narrowed by discarding its
+ * entire low half, the shift and the cast are emitted next to each other, so
+ * that the sequence widening multiply, add, shift and cast can be matched by
+ * a target that has a multiply that returns the high half. If rounding is
+ * enabled, the rounding bias is folded into the double-precision product
+ * before the shift, with a single addition of half of the discarded LSB:
+ *
+ *   - with signed rounding, the sign of the product, 0 or -1, is added as
+ *     well, so that a negative tie rounds away from zero
+ *   - otherwise only the constant is added
+ *
+ * @param[in] gsi_p       pointer to gimple_stmt_iterator
+ * @param[in] result_frmt ::SIF structure for the double-precision product
+ * @param[in] wide_var    the double-precision product
+ * @param[in] narrow_type the type of the single-precision result
+ * @return    the single-precision result
+ */
+tree high_part_product(gimple_stmt_iterator * gsi_p, struct SIF result_frmt,
+                       tree wide_var, tree narrow_type)
+{
+  tree wide_type = TREE_TYPE(wide_var);
+  tree high_wide = make_rename_temp(wide_type, "_fx_hiwide0");
+  tree high = make_rename_temp(narrow_type, "_fx_high0");
+  gimple new_stmt;
+
+  FXLOG(2, "  *** High half of double-precision product ***\n");
+  if (ROUNDING) {
+    tree rounded = make_rename_temp(wide_type, "_fx_round0");
+    tree bias = double_int_to_tree(wide_type,
+                                   double_int_lshift(double_int_one,
+                                                     result_frmt.shift - 1,
+                                                     HOST_BITS_PER_DOUBLE_INT,
+                                                     false));
+    if (double_int_negative_p(result_frmt.min) && !POSITIVE) {
+      // round signed, the sign is -1 if the product is negative, else 0
+      tree sign_bit_var = make_rename_temp(wide_type, "_fx_signbit0");
+      tree s_round_var = make_rename_temp(wide_type, "_fx_sround0");
+      new_stmt = gimple_build_assign_with_ops(RSHIFT_EXPR, sign_bit_var,
+                                              wide_var,
+                                              build_int_cst(integer_type_node,
+                                                            TYPE_PRECISION
+                                                            (wide_type) - 1));
+      gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+      FXLOG_STMT(2, new_stmt);
+      new_stmt = gimple_build_assign_with_ops(PLUS_EXPR, s_round_var,
+                                              wide_var, sign_bit_var);
+      gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+      FXLOG_STMT(2, new_stmt);
+      wide_var = s_round_var;
+    }
+    new_stmt = gimple_build_assign_with_ops(PLUS_EXPR, rounded, wide_var,
+                                            bias);
+    gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+    FXLOG_STMT(2, new_stmt);
+    wide_var = rounded;
+  }
+  new_stmt = gimple_build_assign_with_ops(RSHIFT_EXPR, high_wide, wide_var,
+                                          build_int_cst(integer_type_node,
+                                                        result_frmt.shift));
+  gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+  FXLOG_STMT(2, new_stmt);
+  new_stmt = gimple_build_assign_with_ops(CONVERT_EXPR, high, high_wide, NULL);
+  gsi_insert_after(gsi_p, new_stmt, GSI_NEW_STMT);
+  FXLOG_STMT(2, new_stmt);
+  return high;
+}
+
 // vim:syntax=c.doxygen
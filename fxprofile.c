@@ -0,0 +1,143 @@
+/**
+ * @file fxprofile.c
+ *
+ * @brief  Run-time library that records variable ranges for fxopt
+ *
+ * @author K. Joseph Hass
+ * @date Created: 2014-01-16T15:02:44-0500
+ * @date Last modified: 2014-01-16T15:02:44-0500
+ *
+ * @details  A program compiled with -fplugin-arg-fxopt-profile-generate calls
+ *           __fxopt_profile() every time a real variable is assigned. This
+ *           file must be linked with that program. The smallest and largest
+ *           values of each variable are kept in a table and, when the
+ *           program exits, are appended to the file named by the
+ *           FXOPT_PROFILE environment variable, or to fxopt.profile. The
+ *           file is then given to -fplugin-arg-fxopt-profile-use. Running
+ *           the program more than once adds more lines to the file, and
+ *           the plugin merges them.
+ *
+ *           This is not part of the plugin and does not use any gcc
+ *           headers.
+ *
+ * @copyright Copyright (C) 2014 Kenneth Joseph Hass
+ *
+ * @copyright This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * @copyright This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @def   PROFILE_SLOTS
+ * @brief Number of variables that can be recorded, a power of two.
+ */
+#define PROFILE_SLOTS 8192
+
+/**
+ * @brief The range of values seen for one variable.
+ */
+struct PROFILE_SLOT {
+  const char *function;         ///< name of the variable's function
+  const char *variable;         ///< name of the variable
+  int64_t key;                  ///< format key of the variable
+  double min;                   ///< smallest value seen
+  double max;                   ///< largest value seen
+  long count;                   ///< number of values seen, zero if unused
+};
+
+static struct PROFILE_SLOT profile_table[PROFILE_SLOTS];
+static int profile_registered = 0;
+static int profile_full = 0;
+
+/**
+ * @brief Append the recorded ranges to the profile file.
+ */
+static void write_profile(void)
+{
+  const char *file_name = getenv("FXOPT_PROFILE");
+  FILE *profile_file;
+  int i;
+
+  if (NULL == file_name)
+    file_name = "fxopt.profile";
+  profile_file = fopen(file_name, "a");
+  if (NULL == profile_file) {
+    fprintf(stderr, "fxprofile: cannot write %s\n", file_name);
+    return;
+  }
+  for (i = 0; i < PROFILE_SLOTS; i++) {
+    struct PROFILE_SLOT *s = &profile_table[i];
+    if (s->count)
+      fprintf(profile_file, "%s %s %lld %.17g %.17g %ld\n", s->function,
+              s->variable, (long long) s->key, s->min, s->max, s->count);
+  }
+  fclose(profile_file);
+  if (profile_full)
+    fprintf(stderr, "fxprofile: more than %d variables, some not recorded\n",
+            PROFILE_SLOTS);
+}
+
+/**
+ * @brief Record one value of a variable.
+ *
+ * @details The table is open-addressed. Function names are string constants,
+ * so the same function always passes the same pointer, but names are
+ * compared anyway in case the constants were not merged.
+ *
+ * @param[in] function name of the variable's function
+ * @param[in] variable name of the variable, written with its range
+ * @param[in] key      format key of the variable
+ * @param[in] value    the value just assigned to the variable
+ */
+void __fxopt_profile(const char *function, const char *variable, int64_t key,
+                     double value)
+{
+  uint64_t h = (uint64_t) key * 0x9e3779b97f4a7c15ULL;
+  const unsigned char *c;
+  int i, probe;
+
+  if (value != value)           // a NaN says nothing about the range
+    return;
+  if (!profile_registered) {
+    profile_registered = 1;
+    atexit(write_profile);
+  }
+  for (c = (const unsigned char *) function; *c; c++)
+    h = (h ^ *c) * 0x100000001b3ULL;
+  i = (int) (h >> 32) & (PROFILE_SLOTS - 1);
+  for (probe = 0; probe < PROFILE_SLOTS; probe++) {
+    struct PROFILE_SLOT *s = &profile_table[i];
+    if (0 == s->count) {
+      s->function = function;
+      s->variable = variable;
+      s->key = key;
+      s->min = s->max = value;
+      s->count = 1;
+      return;
+    }
+    if ((s->key == key) && ((s->function == function) ||
+                            !strcmp(s->function, function))) {
+      if (value < s->min)
+        s->min = value;
+      if (value > s->max)
+        s->max = value;
+      s->count++;
+      return;
+    }
+    i = (i + 1) & (PROFILE_SLOTS - 1);
+  }
+  profile_full = 1;
+}
+
+// vim:syntax=c.doxygen